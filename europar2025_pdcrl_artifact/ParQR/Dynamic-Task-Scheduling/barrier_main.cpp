@@ -1,216 +1,361 @@
-#include <iostream>
-#include <vector>
-#include <string>
-#include <cmath>
-#include <pthread.h>
-#include "bn2.h"
-#include <unistd.h>
-#include <csignal>
-#include <cstdlib>
-#include <random>
-#include <chrono>
-
-#define NUM_THREADS 52
-
-#define BETA 32
-#define ALPHA 32
-#define BETA_DIV_ALPHA ((int)BETA/(int)ALPHA)
-
-
-typedef struct {
-    int tid;
-    int total_task_rows;
-    int total_task_cols;
-    int m;
-    int n;
-    double* mat;
-}thread_args_t;
-
-std::vector<std::stringstream> logstreams(NUM_THREADS);
-
-TaskTable task_table;
-std::vector<double> global_up_array, global_b_array;
-pthread_barrier_t barrier;
-
-void complete_task1(double* &mat, int m, int n, int row_start, int row_end, int col_start, int col_end){
-
-    double sm, sm1, cl, clinv, up, b;
-    int _row_start = row_start == 1 ? 0 : row_start;
-
-    for (int lpivot = _row_start; lpivot < row_end; lpivot++){
-        cl = fabs(mat[lpivot * n + lpivot]);
-        sm1 = 0;
-
-        for (int k = lpivot+1; k < n; k++){
-            sm = fabs(mat[lpivot * n + k]);
-            sm1 += sm * sm;
-            cl = fmax(sm, cl);
-        }
-
-        if (cl <= 0.0) { continue; } clinv = 1.0/cl;
-
-        double d__1 = mat[lpivot * n + lpivot] * clinv;
-        sm = d__1 * d__1;
-        sm += sm1 * clinv * clinv;
-
-        cl *= sqrt(sm);
-
-        if (mat[lpivot * n + lpivot] > 0.0) { cl = -cl; }
-
-        up = mat[lpivot * n + lpivot] - cl;
-        mat[lpivot * n + lpivot] = cl;
-
-        if (row_end - lpivot < 0) { continue;; }
-
-        b = up * mat[lpivot * n + lpivot];
-
-        if (b >= 0.0) { continue; }
-
-        b = 1.0/b;
-
-        global_up_array[lpivot] = up;
-        global_b_array[lpivot] = b;
-
-        for (int j = lpivot+1; j < col_end; j++){
-            sm = mat[j * n + lpivot] * up;
-
-            for (int i__ = lpivot+1; i__ < n; i__++){
-                sm += mat[j * n + i__] * mat[lpivot * n + i__];
-            }
-
-            if (sm == 0.0) { continue; }
-
-            sm *= b;
-            mat[j * n + lpivot] += sm * up;
-
-            for (int i__ = lpivot+1; i__ < n; i__++){
-                mat[j * n + i__] += sm * mat[lpivot * n + i__];
-            }
-        }
-    }
-}
-
-void complete_task2(double* &mat, int m, int n, int row_start, int row_end, int col_start, int col_end){
-    
-    int _row_start = row_start == 1 ? 0 : row_start;
-    int _col_start = col_start == 1 ? 0 : col_start;
-
-    double up = 0.0, b = 0.0, sm = 0.0;
-
-    for (int lpivot = _row_start; lpivot < row_end; lpivot++){
-        up = global_up_array[lpivot];
-        b  = global_b_array[lpivot];
-
-        for (int j = _col_start; j < col_end; j++){
-            sm = mat[j * n + lpivot] * up;
-
-            for (int i__ = lpivot+1; i__ < n; i__++){
-                sm += mat[j * n + i__] * mat[lpivot * n + i__];
-            }
-
-            if (sm == 0.0) { continue; }
-
-            sm *= b;
-            mat[j * n + lpivot] += sm * up;
-
-            for (int i__ = lpivot+1; i__ < n; i__++){
-                mat[j * n + i__] += sm * mat[lpivot * n + i__];
-            }
-        }
-    }
-}
-
-void* thdwork(void* params){
-    thread_args_t* thread_args = (thread_args_t*)params;
-    int tid = thread_args->tid;
-    double* mat = thread_args->mat;
-    int m = thread_args->m;
-    int n = thread_args->n;
-
-    pthread_barrier_wait(&barrier);
-
-    for (int j = 0; j < task_table.cols(); j++){
-        int ctr = 0;
-        for (int i = 0; i < task_table.rows(); i++){
-
-            if (task_table.getTask(i, j) == nullptr) { ctr++; continue; }
-
-            if (ctr == i){
-                Task* first_task = task_table.getTask(ctr, j);
-                //printf("Before T1 Barrier: %d %zu %d\n", tid, ctr, j);
-                pthread_barrier_wait(&barrier);
-                if (tid == 0){
-                    //printf("Inside T1 Barrier: %d %d %d %d\n", tid, ctr, j, first_task->type);
-                    complete_task1(mat, m, n, first_task->row_start, first_task->row_end, first_task->col_start, first_task->col_end);
-                }
-                pthread_barrier_wait(&barrier);
-            }
-
-            int taskid = tid + ctr * NUM_THREADS + (ctr+1);
-
-            if (taskid < task_table.rows()){
-                //printf("After T1 barrier: %d %d %d\n", tid, taskid, j);
-                Task* task = task_table.getTask(taskid, j);
-                complete_task2(mat, m, n, task->row_start, task->row_end, task->col_start, task->col_end);
-            }
-            pthread_barrier_wait(&barrier);
-        }
-    }
-
-    return nullptr;
-}
-
-int main(int argc, char *argv[]){
-    std::cout << "[1]. Inside main." << std::endl;
-
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename>" << std::endl;
-        return EXIT_FAILURE;
-    }
-
-    matrix_t<double> data_matrix(argv[1]);
-
-    int total_task_rows = std::ceil(data_matrix.rows()/BETA);
-    int total_task_cols = std::ceil(data_matrix.rows()/ALPHA);
-
-    global_up_array.resize(data_matrix.rows(), 0.0);
-    global_b_array.resize(data_matrix.rows() , 0.0);
-
-    task_table.init(total_task_rows, total_task_cols, ALPHA, BETA, data_matrix);
-
-    std::vector<pthread_t> threads(NUM_THREADS);
-    std::vector<thread_args_t> thread_args(NUM_THREADS);
-    
-    for (int i = 0; i < NUM_THREADS; i++){
-        thread_args[i].tid = i;
-        thread_args[i].total_task_rows = total_task_rows;
-        thread_args[i].total_task_cols = total_task_cols;
-        thread_args[i].m = data_matrix.rows();
-        thread_args[i].n = data_matrix.cols();
-        thread_args[i].mat = data_matrix.data_ptr();
-    }
-
-    pthread_barrier_init(&barrier, NULL, NUM_THREADS);
-
-    auto start = std::chrono::high_resolution_clock::now();
-    
-    for (int i = 0; i < NUM_THREADS; i++){
-        pthread_create(&threads[i], NULL, thdwork, &thread_args[i]);
-    }
-
-    for (int i = 0; i < NUM_THREADS; i++){
-        pthread_join(threads[i], NULL);
-    }
-    
-    auto end = std::chrono::high_resolution_clock::now();
-
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-
-    std::cout << "Time taken: " << elapsed << " ms" << std::endl;
-
-    pthread_barrier_destroy(&barrier);
-
-    //data_matrix.save("output.txt");
-
-    return 0;
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <pthread.h>
+#include "autotune.h"
+#include "bn2.h"
+#include "idle.h"
+#include "kernels.h"
+#include "placement.h"
+#include "run_config.h"
+#include "trace.h"
+#include "metrics.h"
+#include <unistd.h>
+#include <csignal>
+#include <cstdlib>
+#include <random>
+#include <chrono>
+
+// Defaults; override with -t/-a/-b or PARQR_THREADS/ALPHA/BETA.
+#define DEFAULT_NUM_THREADS 52
+
+#define DEFAULT_BETA 32
+#define DEFAULT_ALPHA 32
+
+
+typedef struct {
+    int tid;
+    int num_threads;
+    int total_task_rows;
+    int total_task_cols;
+    int m;
+    int n;
+    int beta;
+    int beta_div_alpha;
+    double* mat;
+    bool type2_wy;      // Apply type-2 tasks through the panel's WY factor
+    int ldt;            // Leading dimension of each panel's T factor
+}thread_args_t;
+
+TaskTable task_table;
+std::vector<double> global_up_array, global_b_array;
+std::vector<double> global_t_array;
+SpinBarrier barrier;
+ThreadPlacement placement;
+// Per-task trace (--trace, and --metrics); tasks are released by barriers, so
+// there are no ready events.
+TaskTrace task_trace;
+RunMetrics run_metrics;
+
+// Rows [begin, end) of a column's trailing update [lo, hi) that worker tid
+// applies. Worker 0 also runs the look-ahead, about head rows of work, so it
+// takes that much less. Chunks are whole kernel row groups.
+void trailing_rows(int lo, int hi, int num_threads, int tid, int head, int& begin, int& end){
+    if (num_threads == 1) {
+        begin = lo;
+        end = hi;
+        return;
+    }
+    int share = (hi - lo + head) / num_threads;
+    int first = std::min(hi - lo, std::max(0, share - head) / KERNEL_ROWS * KERNEL_ROWS);
+    int per = ((hi - lo - first + num_threads - 2) / (num_threads - 1) + KERNEL_ROWS - 1) / KERNEL_ROWS * KERNEL_ROWS;
+    if (tid == 0) {
+        begin = lo;
+        end = lo + first;
+    } else {
+        begin = std::min(hi, lo + first + (tid - 1) * per);
+        end = std::min(hi, begin + per);
+    }
+}
+
+// Column j of the static schedule. At its start, panel j is factorized and
+// every row below it holds panels 0 .. j-1. Worker 0 applies panel j to the
+// next panel's pivot rows and factorizes that panel (look-ahead), while all
+// workers split the update of the remaining rows by panel j; one barrier then
+// ends the column. The panel factorization is the only serial part: the
+// reflectors are applied to the rest of the diagonal tile with the trailing
+// rows, not inside the type-1 task.
+void* thdwork(void* params){
+    thread_args_t* thread_args = (thread_args_t*)params;
+    int tid = thread_args->tid;
+    placement.bind(tid);
+    int num_threads = thread_args->num_threads;
+    double* mat = thread_args->mat;
+    int m = thread_args->m;
+    int n = thread_args->n;
+    int beta = thread_args->beta;
+    double* up_array = global_up_array.data();
+    double* b_array = global_b_array.data();
+    bool type2_wy = thread_args->type2_wy;
+    int ldt = thread_args->ldt;
+    const bool tracing = task_trace.enabled();
+    RunMetrics::HwScope hw_scope(run_metrics, tid);
+    bool sense = false;
+
+    int bda = thread_args->beta_div_alpha;
+    auto panel = [&](int j) -> const Task* {
+        if (j >= (int)task_table.cols() || j / bda >= (int)task_table.rows()) {
+            return nullptr;
+        }
+        return task_table.getTask(j / bda, j);
+    };
+    // Rows the task table covers: every row, since a partial last row block
+    // is a task row of its own (see TaskTable::task_rows).
+    const int last_row = task_table.rows() > 0 ? (int)task_table.getTask(task_table.rows() - 1, 0)->col_end : 0;
+
+    auto factor = [&](const Task* p, int j){
+        uint64_t trace_start = tracing ? task_trace.now() : 0;
+        complete_task1(mat, m, n, p->row_start, p->row_end, p->col_start, p->row_end, up_array, b_array);
+        if (type2_wy) {
+            build_wy_factor(mat, n, p->row_start, p->row_end, up_array, b_array,
+                            global_t_array.data() + (size_t)j * ldt * ldt, ldt);
+        }
+        if (tracing) {
+            task_trace.task(tid, 0, j / bda, j, 1, trace_start, task_trace.now());
+        }
+    };
+    auto update = [&](const Task* p, int j, int lo, int hi){
+        if (lo >= hi) {
+            return;
+        }
+        uint64_t trace_start = tracing ? task_trace.now() : 0;
+        if (type2_wy) {
+            complete_task2_wy(mat, m, n, p->row_start, p->row_end, lo, hi, up_array,
+                              global_t_array.data() + (size_t)j * ldt * ldt, ldt);
+        } else {
+            complete_task2(mat, m, n, p->row_start, p->row_end, lo, hi, up_array, b_array);
+        }
+        if (tracing) {
+            task_trace.task(tid, 0, (lo - 1) / beta, j, 2, trace_start, task_trace.now());
+        }
+    };
+
+    if (tid == 0 && panel(0) != nullptr) {
+        factor(panel(0), 0);
+    }
+    barrier.wait(sense);
+
+    for (int j = 0; panel(j) != nullptr; j++){
+        const Task* current = panel(j);
+        const Task* next = panel(j + 1);
+        int lo = next != nullptr ? (int)next->row_end : (int)current->row_end;
+        int head = next != nullptr ? 3 * (int)(next->row_end - next->row_start) / 2 : 0;
+
+        if (tid == 0 && next != nullptr) {
+            update(current, j, next->row_start, next->row_end);
+            factor(next, j + 1);
+        }
+        int begin, end;
+        trailing_rows(lo, last_row, num_threads, tid, head, begin, end);
+        update(current, j, begin, end);
+        barrier.wait(sense);
+    }
+
+    return nullptr;
+}
+
+// The options of run_config.h that this driver implements.
+void print_barrier_usage(const char* prog, std::ostream& os = std::cerr) {
+    os << "Usage: " << prog << " [options] <filename>\n"
+       << "  -t, --threads N       Number of worker threads (env PARQR_THREADS)\n"
+       << "  -a, --alpha N         Pivots per task (env PARQR_ALPHA)\n"
+       << "  -b, --beta N          Rows per task, a multiple of alpha (env PARQR_BETA)\n"
+       << "      --autotune        Pick alpha and beta from trial tasks or the tuning cache (env PARQR_AUTOTUNE)\n"
+       << "      --tune-cache FILE Tuning cache, or none (default $HOME/.parqr_tuning, env PARQR_TUNE_CACHE)\n"
+       << "      --spin N          Barrier waits spent spinning before yielding (env PARQR_SPIN)\n"
+       << "      --isa ISA         Kernels: auto | scalar | avx2 | avx512 (env PARQR_ISA)\n"
+       << "      --type2 MODE      Type-2 kernel: reflectors | wy (env PARQR_TYPE2)\n"
+       << "      --bind POLICY     Pin workers: none | compact | scatter (env PARQR_BIND)\n"
+       << "      --trace FILE      Write a Chrome/Perfetto trace of every task (env PARQR_TRACE)\n"
+       << "      --metrics FILE    Write a JSON (or .csv) metrics report (env PARQR_METRICS)\n"
+       << "      --hw-counters     Add cycles, instructions and LLC misses to the metrics\n"
+       << "      --timing FILE     Write the wall time of the factorization as JSON (env PARQR_TIMING)\n"
+       << "  -o, --output FILE     Save the factorized matrix to FILE\n"
+       << "      --output-format F Format of -o: text | binary, with the reflector scalars (env PARQR_OUTPUT_FORMAT)\n"
+       << "  -h, --help            Show this message\n"
+       << "The other options of a.out need the dynamic scheduler driver (main.cpp).\n";
+}
+
+// Options parse_run_config() accepts but this driver does not implement:
+// those set to anything but their default, comma-separated.
+std::string unsupported_options(const RunConfig& cfg) {
+    const RunConfig defaults;
+    std::vector<std::string> names;
+    auto check = [&names](bool set, const char* name) {
+        if (set) {
+            names.push_back(name);
+        }
+    };
+    check(cfg.queue != defaults.queue, "-q");
+    check(cfg.idle_yields != defaults.idle_yields, "--yield");
+    check(cfg.precision != defaults.precision, "--precision");
+    check(cfg.layout != defaults.layout, "--layout");
+    check(cfg.tile_cols != defaults.tile_cols, "--tile-cols");
+    check(cfg.graph != defaults.graph, "--graph");
+    check(cfg.tsqr, "--tsqr");
+    check(cfg.tsqr_leaf != defaults.tsqr_leaf, "--tsqr-leaf");
+    check(cfg.batch, "--batch");
+    check(cfg.batch_window != defaults.batch_window, "--window");
+    check(cfg.compress, "--compress");
+    check(!cfg.checkpoint_file.empty(), "--checkpoint");
+    check(cfg.checkpoint_interval != defaults.checkpoint_interval, "--checkpoint-interval");
+    check(!cfg.append_file.empty(), "--append");
+    check(cfg.delete_count > 0, "--delete-rows");
+    check(!cfg.rhs_file.empty(), "--rhs");
+    check(!cfg.solution_file.empty(), "--solution");
+    check(cfg.device != defaults.device, "--device");
+    check(cfg.device_share != defaults.device_share, "--device-share");
+    check(cfg.device_batch != defaults.device_batch, "--device-batch");
+    check(cfg.out_of_core, "--out-of-core");
+    check(cfg.memory_budget != defaults.memory_budget, "--memory-budget");
+    check(!cfg.scratch_dir.empty(), "--scratch");
+    std::string list;
+    for (const std::string& name : names) {
+        list += (list.empty() ? "" : ", ") + name;
+    }
+    return list;
+}
+
+int main(int argc, char *argv[]){
+    std::cout << "[1]. Inside main." << std::endl;
+
+    RunConfig cfg;
+    cfg.num_threads = DEFAULT_NUM_THREADS;
+    cfg.alpha = DEFAULT_ALPHA;
+    cfg.beta = DEFAULT_BETA;
+
+    try {
+        if (!parse_run_config(argc, argv, cfg)) {
+            print_barrier_usage(argv[0], std::cout);
+            return EXIT_SUCCESS;
+        }
+        if (!select_kernel_isa(parse_kernel_isa(cfg.kernel_isa))) {
+            throw std::invalid_argument("Kernel ISA not supported by this CPU: " + cfg.kernel_isa);
+        }
+        placement = ThreadPlacement(CpuTopology::detect(), parse_placement_policy(cfg.placement), cfg.num_threads);
+        std::string unsupported = unsupported_options(cfg);
+        if (!unsupported.empty()) {
+            throw std::invalid_argument("Not supported by the static driver, use the dynamic scheduler "
+                                        "driver (main.cpp): " + unsupported);
+        }
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        print_barrier_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Threads: " << cfg.num_threads;
+    if (cfg.autotune) {
+        std::cout << ", alpha: auto, beta: auto";
+    } else {
+        std::cout << ", alpha: " << cfg.alpha << ", beta: " << cfg.beta;
+    }
+    std::cout
+              << ", kernels: " << kernel_isa_name(active_kernels().isa)
+              << ", type2: " << type2_mode_name(cfg.type2)
+              << ", bind: " << placement_policy_name(placement.policy()) << std::endl;
+
+    matrix_t<double> data_matrix(cfg.input_file);
+    // The prediction models the dynamic scheduler; here it is only a guide.
+    if (cfg.autotune) {
+        TuneChoice choice = autotune_tiles(data_matrix.data_ptr(), data_matrix.rows(), data_matrix.cols(),
+                                           cfg.num_threads, cfg.type2 == Type2Mode::wy,
+                                           cfg.tune_cache.empty() ? default_tune_cache_path() : cfg.tune_cache);
+        if (choice.alpha > 0) {
+            cfg.alpha = choice.alpha;
+            cfg.beta = choice.beta;
+        }
+        std::cout << "Autotune: alpha " << cfg.alpha << ", beta " << cfg.beta << " ("
+                  << (choice.alpha == 0 ? "matrix too small" : choice.from_cache ? "cache" : "trials") << ")"
+                  << std::endl;
+    }
+    if (placement.policy() != PlacementPolicy::none) {
+        data_matrix.first_touch(cfg.beta, cfg.num_threads, [](int t) { placement.bind(t); });
+    }
+
+    int total_task_rows = TaskTable::task_rows(data_matrix.rows(), cfg.beta);
+    int total_task_cols = TaskTable::task_cols(data_matrix.rows(), data_matrix.cols(), cfg.alpha);
+
+    global_up_array.resize(data_matrix.rows(), 0.0);
+    global_b_array.resize(data_matrix.rows() , 0.0);
+
+    // The first panel holds alpha + 1 pivots (see TaskTable::init).
+    int ldt = cfg.alpha + 1;
+    if (cfg.type2 == Type2Mode::wy) {
+        global_t_array.resize((size_t)total_task_cols * ldt * ldt, 0.0);
+    }
+
+    task_table.init(total_task_rows, total_task_cols, cfg.alpha, cfg.beta, data_matrix);
+
+    if (!cfg.trace_file.empty() || !cfg.metrics_file.empty()) {
+        task_trace.init(cfg.num_threads, 1 << 16);
+    }
+    if (!cfg.metrics_file.empty()) {
+        run_metrics.init(cfg.num_threads, cfg.hw_counters);
+    }
+    std::vector<pthread_t> threads(cfg.num_threads);
+    std::vector<thread_args_t> thread_args(cfg.num_threads);
+    
+    for (int i = 0; i < cfg.num_threads; i++){
+        thread_args[i].tid = i;
+        thread_args[i].num_threads = cfg.num_threads;
+        thread_args[i].total_task_rows = total_task_rows;
+        thread_args[i].total_task_cols = total_task_cols;
+        thread_args[i].m = data_matrix.rows();
+        thread_args[i].n = data_matrix.cols();
+        thread_args[i].beta = cfg.beta;
+        thread_args[i].beta_div_alpha = cfg.beta_div_alpha();
+        thread_args[i].mat = data_matrix.data_ptr();
+        thread_args[i].type2_wy = cfg.type2 == Type2Mode::wy;
+        thread_args[i].ldt = ldt;
+    }
+
+    barrier.init(cfg.num_threads, cfg.idle_spins);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    for (int i = 0; i < cfg.num_threads; i++){
+        pthread_create(&threads[i], NULL, thdwork, &thread_args[i]);
+    }
+
+    for (int i = 0; i < cfg.num_threads; i++){
+        pthread_join(threads[i], NULL);
+    }
+    
+    auto end = std::chrono::high_resolution_clock::now();
+
+    auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    auto elapsed = elapsed_ns / 1000000;
+
+    std::cout << "Time taken: " << elapsed << " ms" << std::endl;
+    if (!cfg.timing_file.empty()) {
+        save_run_timing(cfg.timing_file, "static", data_matrix.rows(), data_matrix.cols(), cfg.num_threads, cfg.alpha,
+                        cfg.beta, elapsed_ns);
+    }
+    if (!cfg.trace_file.empty()) {
+        task_trace.save(cfg.trace_file);
+        std::cout << "Trace: " << task_trace.num_tasks() << " tasks written to " << cfg.trace_file << std::endl;
+    }
+    if (run_metrics.enabled()) {
+        double flops = householder_flops(data_matrix.rows(), data_matrix.cols());
+        RunSummary summary = run_metrics.summarize(task_trace, elapsed_ns, cfg.beta_div_alpha(), flops);
+        RunMetrics::save(cfg.metrics_file, summary);
+        std::cout << "Metrics: critical path " << summary.critical_path_ns / 1e6 << " ms, written to "
+                  << cfg.metrics_file << std::endl;
+    }
+
+    if (!cfg.output_file.empty() && cfg.output_format == OutputFormat::binary) {
+        // The records of save_factorization() (checkpoint.h), uncompressed.
+        const int m = data_matrix.rows();
+        matrix_t<double> scalars(2, m);
+        std::copy(global_up_array.begin(), global_up_array.end(), scalars.data_ptr());
+        std::copy(global_b_array.begin(), global_b_array.end(), scalars.data_ptr() + m);
+        data_matrix.save_binary(cfg.output_file);
+        scalars.save_binary(cfg.output_file, MATRIX_FILE_ALIGNMENT, true);
+    } else if (!cfg.output_file.empty()) {
+        data_matrix.save(cfg.output_file);
+    }
+
+    return 0;
 }
\ No newline at end of file
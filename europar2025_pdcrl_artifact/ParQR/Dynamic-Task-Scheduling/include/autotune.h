@@ -0,0 +1,262 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bn2.h"
+#include "kernels.h"
+
+// Startup selection of alpha and beta (--autotune). For each candidate tile
+// shape, one type-1 and one type-2 task are timed on the first rows of the
+// actual matrix (copied to scratch, so the matrix is untouched), and the
+// factorization time is predicted from those two timings:
+//
+//   work      sum over panels j of t1(j) + (rows below the panel) * t2(j)
+//   critical  the type-1 chain plus one type-2 task per row block
+//   predicted max(work / threads, critical) + tasks * overhead / threads
+//
+// where a task's time scales with the length of its pivot rows, n - alpha*j.
+// The shape with the lowest prediction wins. Results are kept in a tuning
+// cache keyed by (m, n, threads, type-2 kernel, CPU model), so later runs on
+// the same machine skip the trials.
+
+struct TuneChoice {
+    int alpha = 0;
+    int beta = 0;
+    double predicted_ms = 0;
+    bool from_cache = false;
+};
+
+// Scheduling cost of one task (pop, dependency release, push) in the dynamic
+// scheduler, from --metrics runs: wall time minus task time, per task.
+constexpr double TUNE_TASK_OVERHEAD_NS = 600;
+
+inline std::string cpu_model_name() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                size_t start = line.find_first_not_of(' ', colon + 1);
+                return start == std::string::npos ? "unknown" : line.substr(start);
+            }
+        }
+    }
+    return "unknown";
+}
+
+// $HOME/.parqr_tuning, or parqr_tuning in the working directory.
+inline std::string default_tune_cache_path() {
+    const char* home = std::getenv("HOME");
+    return home != nullptr && *home != '\0' ? std::string(home) + "/.parqr_tuning" : "parqr_tuning";
+}
+
+// Candidate shapes for an m x n matrix: beta a multiple of alpha, and three
+// row blocks of pivots so the trial tasks fit in the matrix.
+inline std::vector<std::pair<int, int>> tune_candidates(int m, int n) {
+    const int pivots = std::min(m, n);
+    static const int alphas[] = {2, 4, 8, 12, 16, 24, 32};
+    static const int ratios[] = {1, 2, 4, 8};
+    std::vector<std::pair<int, int>> shapes;
+    for (int alpha : alphas) {
+        for (int ratio : ratios) {
+            int beta = alpha * ratio;
+            if (beta <= 256 && 3 * beta + 1 <= pivots) {
+                shapes.push_back({alpha, beta});
+            }
+        }
+    }
+    return shapes;
+}
+
+// Predicted run time (ns) of an m x n factorization from the times of one
+// type-1 and one type-2 task of panel beta/alpha (pivot rows beta + 1 .. n).
+inline double predict_factorization_ns(int m, int n, int alpha, int beta, int threads, double t1_ns, double t2_ns) {
+    const int bda = beta / alpha;
+    const int rows = TaskTable::task_rows(m, beta);
+    const int cols = TaskTable::task_cols(m, n, alpha);
+    const double trial_len = n - (beta + 1);
+    double work = 0, critical = 0, tasks = 0;
+    for (int j = 0; j < cols; j++) {
+        const double scale = std::max(0, n - alpha * j) / trial_len;
+        const int below = rows - 1 - j / bda;
+        if (below < 0) {
+            break;
+        }
+        work += (t1_ns + below * t2_ns) * scale;
+        critical += t1_ns * scale;
+        // The type-2 task that hands the chain to the next row block.
+        if ((j + 1) % bda == 0 && below > 0) {
+            critical += t2_ns * scale;
+        }
+        tasks += below + 1;
+    }
+    return std::max(work / threads, critical) + tasks * TUNE_TASK_OVERHEAD_NS / threads;
+}
+
+// Best time (ns) of repeated runs of task, restoring scratch rows
+// [first, first + count) from the matrix rows before each (untimed).
+template <class Task>
+double tune_best_ns(std::vector<double>& scratch, const double* mat, size_t first, size_t count, Task task) {
+    double best = 1e30;
+    for (int rep = 0; rep < 3; rep++) {
+        std::memcpy(scratch.data() + first, mat + first, count * sizeof(double));
+        auto start = std::chrono::steady_clock::now();
+        task();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    return best;
+}
+
+// Times the candidates on the first rows of mat (m x n, row-major) and
+// returns the shape with the lowest predicted time, or {0, 0} if the matrix
+// is too small for any candidate.
+inline TuneChoice tune_by_trials(const double* mat, int m, int n, int threads, bool type2_wy) {
+    TuneChoice best;
+    const std::vector<std::pair<int, int>> shapes = tune_candidates(m, n);
+    if (shapes.empty()) {
+        return best;
+    }
+    const int max_beta = std::max_element(shapes.begin(), shapes.end(), [](auto a, auto b) {
+        return a.second < b.second;
+    })->second;
+    std::vector<double> scratch((size_t)(3 * max_beta + 1) * n);
+    std::vector<double> up(n), b(n);
+    std::vector<double> T;
+    // Threads beyond the cores only share them.
+    const unsigned cores = std::thread::hardware_concurrency();
+    const int workers = cores == 0 ? threads : std::min<int>(threads, cores);
+
+    for (auto [alpha, beta] : shapes) {
+        // Panel j = beta/alpha: its type-1 task on row block 1, and the
+        // type-2 task of row block 2.
+        const int row_start = beta + 1, row_end = beta + alpha + 1;
+        const int t1_end = 2 * beta + 1, t2_start = 2 * beta + 1, t2_end = 3 * beta + 1;
+        const int ldt = alpha + 1;
+        T.assign((size_t)ldt * ldt, 0.0);
+        std::fill(up.begin(), up.end(), 0.0);
+        std::fill(b.begin(), b.end(), 0.0);
+        const size_t t1_first = (size_t)row_start * n, t1_count = (size_t)(t1_end - row_start) * n;
+        const size_t t2_first = (size_t)t2_start * n, t2_count = (size_t)(t2_end - t2_start) * n;
+
+        auto task1 = [&] {
+            complete_task1(scratch.data(), n, n, row_start, row_end, row_start, t1_end, up.data(), b.data());
+            if (type2_wy) {
+                build_wy_factor(scratch.data(), n, row_start, row_end, up.data(), b.data(), T.data(), ldt);
+            }
+        };
+        auto task2 = [&] {
+            if (type2_wy) {
+                complete_task2_wy(scratch.data(), n, n, row_start, row_end, t2_start, t2_end, up.data(), T.data(),
+                                  ldt);
+            } else {
+                complete_task2(scratch.data(), n, n, row_start, row_end, t2_start, t2_end, up.data(), b.data());
+            }
+        };
+        const double t1 = tune_best_ns(scratch, mat, t1_first, t1_count, task1);
+        // Leave the factorized panel in scratch for the type-2 trials.
+        const double t2 = tune_best_ns(scratch, mat, t2_first, t2_count, task2);
+
+        const double predicted = predict_factorization_ns(m, n, alpha, beta, workers, t1, t2) * 1e-6;
+        if (best.alpha == 0 || predicted < best.predicted_ms) {
+            best.alpha = alpha;
+            best.beta = beta;
+            best.predicted_ms = predicted;
+        }
+    }
+    return best;
+}
+
+// Tuning results, one per line:
+//   <m> <n> <threads> <type2> <alpha> <beta> <predicted_ms> <cpu model>
+class TuningCache {
+    struct Entry {
+        int m;
+        int n;
+        int threads;
+        std::string type2;
+        int alpha;
+        int beta;
+        double predicted_ms;
+        std::string cpu;
+    };
+    std::string path;
+    std::vector<Entry> entries;
+
+public:
+    // Reads path if it exists; malformed lines are skipped.
+    explicit TuningCache(const std::string& path) : path(path) {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            Entry e;
+            if (line.empty() || line[0] == '#' ||
+                !(fields >> e.m >> e.n >> e.threads >> e.type2 >> e.alpha >> e.beta >> e.predicted_ms)) {
+                continue;
+            }
+            std::getline(fields >> std::ws, e.cpu);
+            if (e.alpha > 0 && e.beta % e.alpha == 0) {
+                entries.push_back(e);
+            }
+        }
+    }
+
+    bool lookup(int m, int n, int threads, const std::string& type2, const std::string& cpu,
+                TuneChoice& choice) const {
+        for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+            if (it->m == m && it->n == n && it->threads == threads && it->type2 == type2 && it->cpu == cpu) {
+                choice.alpha = it->alpha;
+                choice.beta = it->beta;
+                choice.predicted_ms = it->predicted_ms;
+                choice.from_cache = true;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Records a result and appends it to the file. Returns false if the file
+    // cannot be written; the result is still used for this run.
+    bool store(int m, int n, int threads, const std::string& type2, const std::string& cpu,
+               const TuneChoice& choice) {
+        entries.push_back({m, n, threads, type2, choice.alpha, choice.beta, choice.predicted_ms, cpu});
+        std::ofstream out(path, std::ios::app);
+        out << m << " " << n << " " << threads << " " << type2 << " " << choice.alpha << " " << choice.beta << " "
+            << choice.predicted_ms << " " << cpu << "\n";
+        return static_cast<bool>(out);
+    }
+};
+
+// Picks alpha and beta for an m x n row-major matrix: from the cache at
+// cache_path if it has an entry for this machine, otherwise by trials, whose
+// result is then added to the cache. cache_path "none" disables the cache.
+// Returns {0, 0} if the matrix is too small to tune.
+inline TuneChoice autotune_tiles(const double* mat, int m, int n, int threads, bool type2_wy,
+                                 const std::string& cache_path) {
+    const std::string type2 = type2_wy ? "wy" : "reflectors";
+    const std::string cpu = cpu_model_name();
+    const bool cached = cache_path != "none";
+    TuningCache cache(cached ? cache_path : std::string());
+    TuneChoice choice;
+    if (cached && cache.lookup(m, n, threads, type2, cpu, choice)) {
+        return choice;
+    }
+    choice = tune_by_trials(mat, m, n, threads, type2_wy);
+    if (cached && choice.alpha > 0 && !cache.store(m, n, threads, type2, cpu, choice)) {
+        std::cerr << "Warning: cannot write tuning cache " << cache_path << std::endl;
+    }
+    return choice;
+}
+
+#endif // AUTOTUNE_H
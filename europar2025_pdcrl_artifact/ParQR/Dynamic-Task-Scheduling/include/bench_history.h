@@ -0,0 +1,732 @@
+#ifndef BENCH_HISTORY_H
+#define BENCH_HISTORY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Statistics and result database of the regression harness
+// (tools/bench_regress.cpp, make regress).
+//
+// A benchmark run times both drivers over a grid of sizes and thread counts,
+// a few trials per point after warm-up runs. Each point is summarized by the
+// median of its trials and a distribution-free confidence interval of the
+// median (order statistics of the binomial): run times are skewed by the odd
+// slow trial, so the mean and a normal interval would follow the outliers.
+//
+// Runs are appended to a JSON database, and one of them (by label) is the
+// baseline. A point is a regression when its median is more than threshold
+// slower than the baseline's AND a one-sided Mann-Whitney U test on the two
+// sets of trials gives p < significance; an improvement likewise. The
+// threshold keeps run-to-run noise of a few percent from being reported, the
+// test keeps a single unlucky trial from being reported. The test is exact
+// for small samples without ties, so with 5 trials a side the smallest
+// p-value is 1/252; with 3 it is 1/20, and nothing passes p < 0.01.
+
+// ============================== Statistics ============================== //
+
+struct SampleSummary {
+    int count = 0;
+    double median = 0;
+    double ci_low = 0;          // Confidence interval of the median
+    double ci_high = 0;
+    double confidence = 0;      // Its actual coverage, at least the one asked for when count allows
+    double mean = 0;
+    double min = 0;
+    double max = 0;
+};
+
+inline double sample_median(std::vector<double> v) {
+    if (v.empty()) {
+        return 0;
+    }
+    std::sort(v.begin(), v.end());
+    const size_t h = v.size() / 2;
+    return v.size() % 2 ? v[h] : (v[h - 1] + v[h]) / 2;
+}
+
+// P(X <= k) for X ~ Binomial(n, 1/2).
+inline double binomial_half_cdf(int n, int k) {
+    double sum = 0;
+    for (int i = 0; i <= k && i <= n; i++) {
+        sum += std::exp(std::lgamma(n + 1.0) - std::lgamma(i + 1.0) - std::lgamma(n - i + 1.0) - n * std::log(2.0));
+    }
+    return std::min(sum, 1.0);
+}
+
+// The interval [x_(k), x_(n+1-k)] of the sorted samples covers the median
+// with probability 1 - 2 P(X <= k - 1); k is the largest rank that reaches
+// confidence. Fewer than 6 samples cannot reach 95%: the interval is then
+// [min, max], with its lower coverage recorded.
+inline SampleSummary summarize_samples(std::vector<double> samples, double confidence = 0.95) {
+    SampleSummary s;
+    s.count = (int)samples.size();
+    if (samples.empty()) {
+        return s;
+    }
+    std::sort(samples.begin(), samples.end());
+    s.median = sample_median(samples);
+    s.min = samples.front();
+    s.max = samples.back();
+    double sum = 0;
+    for (double v : samples) {
+        sum += v;
+    }
+    s.mean = sum / s.count;
+
+    int k = 1;
+    for (int r = s.count / 2; r >= 1; r--) {
+        if (1.0 - 2.0 * binomial_half_cdf(s.count, r - 1) >= confidence) {
+            k = r;
+            break;
+        }
+    }
+    s.ci_low = samples[k - 1];
+    s.ci_high = samples[s.count - k];
+    s.confidence = s.count == 1 ? 0.0 : 1.0 - 2.0 * binomial_half_cdf(s.count, k - 1);
+    return s;
+}
+
+// One-sided Mann-Whitney U test: the p-value of samples a being no larger
+// than samples b, small when a tends to be larger (slower, for times). Exact
+// without ties for up to 25 samples a side, the normal approximation with
+// tie and continuity corrections otherwise.
+inline double mann_whitney_greater(const std::vector<double>& a, const std::vector<double>& b) {
+    const int na = (int)a.size(), nb = (int)b.size();
+    if (na == 0 || nb == 0) {
+        return 1.0;
+    }
+    double u = 0;
+    bool ties = false;
+    for (double x : a) {
+        for (double y : b) {
+            u += x > y ? 1.0 : x == y ? 0.5 : 0.0;
+            ties = ties || x == y;
+        }
+    }
+    // Ties within a sample change the variance only.
+    std::vector<double> all(a);
+    all.insert(all.end(), b.begin(), b.end());
+    std::sort(all.begin(), all.end());
+    double tie_sum = 0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j] == all[i]) {
+            j++;
+        }
+        const double t = (double)(j - i);
+        tie_sum += t * t * t - t;
+        ties = ties || t > 1;
+        i = j;
+    }
+
+    if (!ties && na <= 25 && nb <= 25) {
+        // ways[i][j][u]: orderings of i a's and j b's with u pairs a > b,
+        // built by placing the largest value last: an a above j b's, or a b.
+        std::vector<std::vector<std::vector<double>>> ways(na + 1, std::vector<std::vector<double>>(nb + 1));
+        for (int i = 0; i <= na; i++) {
+            for (int j = 0; j <= nb; j++) {
+                std::vector<double>& w = ways[i][j];
+                w.assign((size_t)i * j + 1, 0.0);
+                if (i == 0 || j == 0) {
+                    w[0] = 1;
+                    continue;
+                }
+                const std::vector<double>& with_a = ways[i - 1][j];
+                const std::vector<double>& with_b = ways[i][j - 1];
+                for (size_t v = 0; v < with_a.size(); v++) {
+                    w[v + j] += with_a[v];
+                }
+                for (size_t v = 0; v < with_b.size(); v++) {
+                    w[v] += with_b[v];
+                }
+            }
+        }
+        const std::vector<double>& w = ways[na][nb];
+        double total = 0, tail = 0;
+        for (size_t v = 0; v < w.size(); v++) {
+            total += w[v];
+            if ((double)v >= u) {
+                tail += w[v];
+            }
+        }
+        return tail / total;
+    }
+
+    const double n = na + nb;
+    const double mean = na * nb / 2.0;
+    const double var = na * nb / 12.0 * ((n + 1) - tie_sum / (n * (n - 1)));
+    if (var <= 0) {
+        return 1.0;
+    }
+    const double z = (u - mean - 0.5) / std::sqrt(var);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+// ================================ JSON ================================ //
+
+// Just enough JSON for the database: objects keep their key order, numbers
+// are doubles.
+class JsonValue {
+public:
+    enum Kind { null, boolean, number, string, array, object };
+
+    JsonValue() = default;
+    JsonValue(bool v) : kind_(boolean), bool_(v) {}
+    JsonValue(double v) : kind_(number), number_(v) {}
+    JsonValue(int v) : kind_(number), number_(v) {}
+    JsonValue(const char* v) : kind_(string), string_(v) {}
+    JsonValue(const std::string& v) : kind_(string), string_(v) {}
+
+    static JsonValue make_array() {
+        JsonValue v;
+        v.kind_ = array;
+        return v;
+    }
+    static JsonValue make_object() {
+        JsonValue v;
+        v.kind_ = object;
+        return v;
+    }
+
+    Kind kind() const { return kind_; }
+    bool as_bool() const { return bool_; }
+    double as_number() const { return number_; }
+    const std::string& as_string() const { return string_; }
+    const std::vector<JsonValue>& items() const { return items_; }
+    const std::vector<std::pair<std::string, JsonValue>>& members() const { return members_; }
+
+    void push_back(JsonValue v) { items_.push_back(std::move(v)); }
+
+    // Sets key, replacing an existing member.
+    void set(const std::string& key, JsonValue v) {
+        for (auto& m : members_) {
+            if (m.first == key) {
+                m.second = std::move(v);
+                return;
+            }
+        }
+        members_.emplace_back(key, std::move(v));
+    }
+
+    // The member key, or nullptr.
+    const JsonValue* find(const std::string& key) const {
+        for (const auto& m : members_) {
+            if (m.first == key) {
+                return &m.second;
+            }
+        }
+        return nullptr;
+    }
+
+    double number_or(const std::string& key, double fallback) const {
+        const JsonValue* v = find(key);
+        return v != nullptr && v->kind_ == number ? v->number_ : fallback;
+    }
+    std::string string_or(const std::string& key, const std::string& fallback) const {
+        const JsonValue* v = find(key);
+        return v != nullptr && v->kind_ == string ? v->string_ : fallback;
+    }
+
+    // Throws std::runtime_error on malformed input.
+    static JsonValue parse(const std::string& text) {
+        size_t pos = 0;
+        JsonValue v = parse_value(text, pos);
+        skip_space(text, pos);
+        if (pos != text.size()) {
+            fail(pos);
+        }
+        return v;
+    }
+
+    // Objects and arrays of objects one member per line; arrays of numbers
+    // and small objects on one line.
+    void write(std::ostream& os, int indent = 0) const {
+        switch (kind_) {
+            case null: os << "null"; break;
+            case boolean: os << (bool_ ? "true" : "false"); break;
+            case number: write_number(os, number_); break;
+            case string: write_string(os, string_); break;
+            case array:
+                if (flat()) {
+                    os << "[";
+                    for (size_t i = 0; i < items_.size(); i++) {
+                        os << (i ? ", " : "");
+                        items_[i].write(os, indent);
+                    }
+                    os << "]";
+                } else {
+                    os << "[\n";
+                    for (size_t i = 0; i < items_.size(); i++) {
+                        os << std::string(indent + 2, ' ');
+                        items_[i].write(os, indent + 2);
+                        os << (i + 1 < items_.size() ? ",\n" : "\n");
+                    }
+                    os << std::string(indent, ' ') << "]";
+                }
+                break;
+            case object:
+                if (flat()) {
+                    os << "{";
+                    for (size_t i = 0; i < members_.size(); i++) {
+                        os << (i ? ", " : "");
+                        write_string(os, members_[i].first);
+                        os << ": ";
+                        members_[i].second.write(os, indent);
+                    }
+                    os << "}";
+                } else {
+                    os << "{\n";
+                    for (size_t i = 0; i < members_.size(); i++) {
+                        os << std::string(indent + 2, ' ');
+                        write_string(os, members_[i].first);
+                        os << ": ";
+                        members_[i].second.write(os, indent + 2);
+                        os << (i + 1 < members_.size() ? ",\n" : "\n");
+                    }
+                    os << std::string(indent, ' ') << "}";
+                }
+                break;
+        }
+    }
+
+private:
+    Kind kind_ = null;
+    bool bool_ = false;
+    double number_ = 0;
+    std::string string_;
+    std::vector<JsonValue> items_;
+    std::vector<std::pair<std::string, JsonValue>> members_;
+
+    // Without nested arrays or objects, except arrays of numbers.
+    bool flat() const {
+        for (const JsonValue& v : items_) {
+            if (v.kind_ == array || v.kind_ == object) {
+                return false;
+            }
+        }
+        for (const auto& m : members_) {
+            if (m.second.kind_ == object || (m.second.kind_ == array && !m.second.flat())) {
+                return false;
+            }
+        }
+        return kind_ == array || members_.size() <= 16;
+    }
+
+    [[noreturn]] static void fail(size_t pos) {
+        throw std::runtime_error("Malformed JSON at offset " + std::to_string(pos));
+    }
+
+    static void skip_space(const std::string& t, size_t& pos) {
+        while (pos < t.size() && (t[pos] == ' ' || t[pos] == '\n' || t[pos] == '\r' || t[pos] == '\t')) {
+            pos++;
+        }
+    }
+
+    static bool consume(const std::string& t, size_t& pos, const char* word) {
+        const size_t len = std::char_traits<char>::length(word);
+        if (t.compare(pos, len, word) == 0) {
+            pos += len;
+            return true;
+        }
+        return false;
+    }
+
+    static std::string parse_string(const std::string& t, size_t& pos) {
+        if (pos >= t.size() || t[pos] != '"') {
+            fail(pos);
+        }
+        std::string out;
+        for (pos++; pos < t.size() && t[pos] != '"'; pos++) {
+            char c = t[pos];
+            if (c == '\\') {
+                if (++pos >= t.size()) {
+                    fail(pos);
+                }
+                switch (t[pos]) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case 'b': c = '\b'; break;
+                    case 'f': c = '\f'; break;
+                    case 'u': {
+                        // Only what write_string emits: control characters.
+                        if (pos + 4 >= t.size()) {
+                            fail(pos);
+                        }
+                        c = (char)std::strtol(t.substr(pos + 1, 4).c_str(), nullptr, 16);
+                        pos += 4;
+                        break;
+                    }
+                    default: c = t[pos]; break;
+                }
+            }
+            out += c;
+        }
+        if (pos >= t.size()) {
+            fail(pos);
+        }
+        pos++;
+        return out;
+    }
+
+    static JsonValue parse_value(const std::string& t, size_t& pos) {
+        skip_space(t, pos);
+        if (pos >= t.size()) {
+            fail(pos);
+        }
+        const char c = t[pos];
+        if (c == '{') {
+            JsonValue v = make_object();
+            pos++;
+            skip_space(t, pos);
+            if (pos < t.size() && t[pos] == '}') {
+                pos++;
+                return v;
+            }
+            while (true) {
+                skip_space(t, pos);
+                std::string key = parse_string(t, pos);
+                skip_space(t, pos);
+                if (pos >= t.size() || t[pos++] != ':') {
+                    fail(pos);
+                }
+                v.members_.emplace_back(std::move(key), parse_value(t, pos));
+                skip_space(t, pos);
+                if (pos < t.size() && t[pos] == ',') {
+                    pos++;
+                } else if (pos < t.size() && t[pos] == '}') {
+                    pos++;
+                    return v;
+                } else {
+                    fail(pos);
+                }
+            }
+        }
+        if (c == '[') {
+            JsonValue v = make_array();
+            pos++;
+            skip_space(t, pos);
+            if (pos < t.size() && t[pos] == ']') {
+                pos++;
+                return v;
+            }
+            while (true) {
+                v.items_.push_back(parse_value(t, pos));
+                skip_space(t, pos);
+                if (pos < t.size() && t[pos] == ',') {
+                    pos++;
+                } else if (pos < t.size() && t[pos] == ']') {
+                    pos++;
+                    return v;
+                } else {
+                    fail(pos);
+                }
+            }
+        }
+        if (c == '"') {
+            return JsonValue(parse_string(t, pos));
+        }
+        if (consume(t, pos, "true")) {
+            return JsonValue(true);
+        }
+        if (consume(t, pos, "false")) {
+            return JsonValue(false);
+        }
+        if (consume(t, pos, "null")) {
+            return JsonValue();
+        }
+        const char* start = t.c_str() + pos;
+        char* end = nullptr;
+        const double v = std::strtod(start, &end);
+        if (end == start) {
+            fail(pos);
+        }
+        pos += end - start;
+        return JsonValue(v);
+    }
+
+    static void write_number(std::ostream& os, double v) {
+        if (!std::isfinite(v)) {
+            os << "null";
+            return;
+        }
+        std::ostringstream s;
+        s.precision(10);
+        s << v;
+        os << s.str();
+    }
+
+    static void write_string(std::ostream& os, const std::string& s) {
+        os << '"';
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                os << '\\' << c;
+            } else if (c == '\n') {
+                os << "\\n";
+            } else if ((unsigned char)c < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                os << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+            } else {
+                os << c;
+            }
+        }
+        os << '"';
+    }
+};
+
+// ============================== Database ============================== //
+
+// One point of the grid: a driver on an m x n matrix with threads workers.
+struct BenchEntry {
+    std::string driver;         // dynamic (main.cpp) or static (barrier_main.cpp)
+    int m = 0;
+    int n = 0;
+    int threads = 0;
+    int alpha = 0;
+    int beta = 0;
+    std::vector<double> samples_ms;     // Timed trials, warm-up runs excluded
+    SampleSummary stats;
+    double gflops_per_s = 0;    // Of the median, with householder_flops (metrics.h)
+    double efficiency = 0;      // Parallel efficiency; see set_parallel_efficiency
+
+    std::tuple<std::string, int, int, int, int, int> key() const {
+        return std::make_tuple(driver, m, n, threads, alpha, beta);
+    }
+};
+
+struct BenchRun {
+    std::string label;          // Unique in the database; the commit by default
+    std::string timestamp;      // UTC, ISO 8601
+    std::string commit;
+    std::string host;
+    std::string cpu;
+    int warmup = 0;
+    std::vector<BenchEntry> entries;
+};
+
+// Parallel efficiency of each entry against the fewest threads run for the
+// same driver and shape: T(p0) p0 / (T(p) p), which is T(1) / (p T(p)) when
+// one thread is part of the grid.
+inline void set_parallel_efficiency(BenchRun& run) {
+    std::map<std::tuple<std::string, int, int, int, int>, const BenchEntry*> reference;
+    for (const BenchEntry& e : run.entries) {
+        auto& ref = reference[std::make_tuple(e.driver, e.m, e.n, e.alpha, e.beta)];
+        if (ref == nullptr || e.threads < ref->threads) {
+            ref = &e;
+        }
+    }
+    for (BenchEntry& e : run.entries) {
+        const BenchEntry* ref = reference[std::make_tuple(e.driver, e.m, e.n, e.alpha, e.beta)];
+        e.efficiency = e.stats.median > 0 ? ref->stats.median * ref->threads / (e.stats.median * e.threads) : 0;
+    }
+}
+
+// The database file: {"baseline": label, "runs": [run, ...]}, with each run
+// {"label", "timestamp", "commit", "host", "cpu", "warmup", "results": [...]}
+// and each result carrying its trials and their summary.
+class BenchDatabase {
+public:
+    std::string baseline;       // Label of the baseline run; empty: none yet
+    std::vector<BenchRun> runs;
+
+    // Reads path if it exists. Throws std::runtime_error if it is not a
+    // database, so a typo never overwrites another file.
+    explicit BenchDatabase(const std::string& path) : path_(path) {
+        std::ifstream in(path);
+        if (!in.is_open()) {
+            return;
+        }
+        std::stringstream text;
+        text << in.rdbuf();
+        JsonValue root = JsonValue::parse(text.str());
+        const JsonValue* list = root.find("runs");
+        if (root.kind() != JsonValue::object || list == nullptr || list->kind() != JsonValue::array) {
+            throw std::runtime_error("Not a benchmark database: " + path);
+        }
+        baseline = root.string_or("baseline", "");
+        for (const JsonValue& r : list->items()) {
+            runs.push_back(read_run(r));
+        }
+    }
+
+    // The run labelled label, or nullptr.
+    const BenchRun* find(const std::string& label) const {
+        for (const BenchRun& r : runs) {
+            if (r.label == label) {
+                return &r;
+            }
+        }
+        return nullptr;
+    }
+
+    // Adds run, replacing an earlier run with its label.
+    void add(const BenchRun& run) {
+        for (BenchRun& r : runs) {
+            if (r.label == run.label) {
+                r = run;
+                return;
+            }
+        }
+        runs.push_back(run);
+    }
+
+    void save() const {
+        JsonValue root = JsonValue::make_object();
+        root.set("baseline", baseline);
+        JsonValue list = JsonValue::make_array();
+        for (const BenchRun& r : runs) {
+            list.push_back(write_run(r));
+        }
+        root.set("runs", list);
+
+        const std::string tmp = path_ + ".tmp";
+        {
+            std::ofstream out(tmp);
+            if (!out.is_open()) {
+                throw std::runtime_error("Error opening file for writing: " + tmp);
+            }
+            root.write(out);
+            out << "\n";
+            if (out.fail()) {
+                throw std::runtime_error("Error writing benchmark database: " + tmp);
+            }
+        }
+        // Replaced whole, so an interrupted save leaves the old database.
+        if (std::rename(tmp.c_str(), path_.c_str()) != 0) {
+            throw std::runtime_error("Error replacing benchmark database: " + path_);
+        }
+    }
+
+private:
+    std::string path_;
+
+    static BenchRun read_run(const JsonValue& r) {
+        BenchRun run;
+        run.label = r.string_or("label", "");
+        run.timestamp = r.string_or("timestamp", "");
+        run.commit = r.string_or("commit", "");
+        run.host = r.string_or("host", "");
+        run.cpu = r.string_or("cpu", "");
+        run.warmup = (int)r.number_or("warmup", 0);
+        if (const JsonValue* results = r.find("results")) {
+            for (const JsonValue& v : results->items()) {
+                BenchEntry e;
+                e.driver = v.string_or("driver", "");
+                e.m = (int)v.number_or("m", 0);
+                e.n = (int)v.number_or("n", 0);
+                e.threads = (int)v.number_or("threads", 0);
+                e.alpha = (int)v.number_or("alpha", 0);
+                e.beta = (int)v.number_or("beta", 0);
+                if (const JsonValue* samples = v.find("samples_ms")) {
+                    for (const JsonValue& s : samples->items()) {
+                        e.samples_ms.push_back(s.as_number());
+                    }
+                }
+                // The summary is derived; recomputing it keeps old files usable.
+                e.stats = summarize_samples(e.samples_ms);
+                e.gflops_per_s = v.number_or("gflops_per_s", 0);
+                e.efficiency = v.number_or("efficiency", 0);
+                run.entries.push_back(e);
+            }
+        }
+        return run;
+    }
+
+    static JsonValue write_run(const BenchRun& run) {
+        JsonValue r = JsonValue::make_object();
+        r.set("label", run.label);
+        r.set("timestamp", run.timestamp);
+        r.set("commit", run.commit);
+        r.set("host", run.host);
+        r.set("cpu", run.cpu);
+        r.set("warmup", run.warmup);
+        JsonValue results = JsonValue::make_array();
+        for (const BenchEntry& e : run.entries) {
+            JsonValue v = JsonValue::make_object();
+            v.set("driver", e.driver);
+            v.set("m", e.m);
+            v.set("n", e.n);
+            v.set("threads", e.threads);
+            v.set("alpha", e.alpha);
+            v.set("beta", e.beta);
+            JsonValue samples = JsonValue::make_array();
+            for (double s : e.samples_ms) {
+                samples.push_back(s);
+            }
+            v.set("samples_ms", samples);
+            v.set("median_ms", e.stats.median);
+            v.set("ci_low_ms", e.stats.ci_low);
+            v.set("ci_high_ms", e.stats.ci_high);
+            v.set("confidence", e.stats.confidence);
+            v.set("gflops_per_s", e.gflops_per_s);
+            v.set("efficiency", e.efficiency);
+            results.push_back(v);
+        }
+        r.set("results", results);
+        return r;
+    }
+};
+
+// ============================= Comparison ============================= //
+
+struct BenchComparison {
+    enum Verdict { unchanged, regression, improvement, no_baseline };
+
+    const BenchEntry* current = nullptr;
+    const BenchEntry* base = nullptr;   // nullptr: the baseline lacks this point
+    double ratio = 0;           // Median time, current over baseline
+    double p_value = 1;         // Of the change in the direction of ratio
+    Verdict verdict = no_baseline;
+};
+
+inline const char* bench_verdict_name(BenchComparison::Verdict v) {
+    switch (v) {
+        case BenchComparison::regression:  return "REGRESSION";
+        case BenchComparison::improvement: return "improvement";
+        case BenchComparison::unchanged:   return "unchanged";
+        default:                           return "new";
+    }
+}
+
+// Compares every entry of current with the same point of base. threshold is
+// the relative change of the median below which nothing is flagged (0.05:
+// 5%); significance the p-value a flagged change must stay below.
+inline std::vector<BenchComparison> compare_bench_runs(const BenchRun& current, const BenchRun& base,
+                                                       double threshold, double significance) {
+    std::vector<BenchComparison> out;
+    for (const BenchEntry& e : current.entries) {
+        BenchComparison c;
+        c.current = &e;
+        for (const BenchEntry& b : base.entries) {
+            if (b.key() == e.key() && !b.samples_ms.empty()) {
+                c.base = &b;
+                break;
+            }
+        }
+        if (c.base != nullptr && c.base->stats.median > 0) {
+            c.ratio = e.stats.median / c.base->stats.median;
+            const bool slower = c.ratio >= 1;
+            c.p_value = slower ? mann_whitney_greater(e.samples_ms, c.base->samples_ms)
+                               : mann_whitney_greater(c.base->samples_ms, e.samples_ms);
+            c.verdict = BenchComparison::unchanged;
+            if (c.p_value < significance && std::abs(c.ratio - 1) > threshold) {
+                c.verdict = slower ? BenchComparison::regression : BenchComparison::improvement;
+            }
+        }
+        out.push_back(c);
+    }
+    return out;
+}
+
+#endif // BENCH_HISTORY_H
@@ -1,939 +1,2127 @@
-#include <iostream>
-#include <vector>
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <stdexcept>
-#include <initializer_list>
-
-#include <chrono>
-#include <functional>
-#include <type_traits>
-
-#include <cmath>
-#include <algorithm>
-
-#include <mutex>
-#include <optional>
-#include <atomic>
-
-// Helper function to get a string representation of the time unit.
-template <typename Duration>
-constexpr const char* get_time_unit() {
-    if constexpr (std::is_same_v<Duration, std::chrono::nanoseconds>) {
-        return "nanoseconds";
-    } else if constexpr (std::is_same_v<Duration, std::chrono::microseconds>) {
-        return "microseconds";
-    } else if constexpr (std::is_same_v<Duration, std::chrono::milliseconds>) {
-        return "milliseconds";
-    } else if constexpr (std::is_same_v<Duration, std::chrono::seconds>) {
-        return "seconds";
-    } else {
-        return "time units";
-    }
-}
-
-// Function to measure execution time of a given function
-// The default is std::chrono::nanoseconds.
-template <typename TimeUnit = std::chrono::nanoseconds, typename Func, typename... Args>
-auto measure_exec_time(Func&& func, Args&&... args) {
-    auto start = std::chrono::high_resolution_clock::now();
-
-    // Handle functions that return void separately.
-    if constexpr (std::is_void_v<std::invoke_result_t<Func, Args...>>) {
-        std::invoke(std::forward<Func>(func), std::forward<Args>(args)...);
-        auto end = std::chrono::high_resolution_clock::now();
-        auto elapsed = std::chrono::duration_cast<TimeUnit>(end - start);
-        std::cout << "Time elapsed: " << elapsed.count() << " " 
-                  << get_time_unit<TimeUnit>() << "\n";
-        // No value is returned.
-    } else {
-        auto result = std::invoke(std::forward<Func>(func), std::forward<Args>(args)...);
-        auto end = std::chrono::high_resolution_clock::now();
-        auto elapsed = std::chrono::duration_cast<TimeUnit>(end - start);
-        std::cout << "Time elapsed: " << elapsed.count() << " " 
-                  << get_time_unit<TimeUnit>() << "\n";
-        return result;
-    }
-}
-
-template <class T>
-class matrix_t {
-private:
-    int m;   // Number of rows
-    int n;   // Number of columns
-    T* data; // Pointer to allocated array holding matrix elements
-
-public:
-    // Default constructor
-    matrix_t() : m(0), n(0), data(nullptr) {}
-
-    // Parameterized constructor
-    matrix_t(int rows, int cols) : m(rows), n(cols), data(nullptr) {
-        if (rows > 0 && cols > 0) {
-            data = new T[rows * cols];
-        }
-    }
-
-    // Constructor to read matrix from a file
-    matrix_t(const std::string& filename) : m(0), n(0), data(nullptr) {
-        read_matrix(filename);
-    }
-
-    // Initializer list constructor
-    matrix_t(std::initializer_list<std::initializer_list<T>> init) : m(0), n(0), data(nullptr) {
-        m = static_cast<int>(init.size());
-        n = (m > 0) ? static_cast<int>(init.begin()->size()) : 0;
-
-        // Check that all rows have the same number of columns.
-        for (const auto& row : init) {
-            if (static_cast<int>(row.size()) != n) {
-                throw std::invalid_argument("All rows in initializer list must have the same number of columns.");
-            }
-        }
-
-        // Allocate memory.
-        if (m * n > 0) {
-            data = new T[m * n];
-        }
-
-        // Populate the matrix.
-        int i = 0;
-        for (const auto& row : init) {
-            int j = 0;
-            for (const auto& value : row) {
-                data[i * n + j] = value;
-                ++j;
-            }
-            ++i;
-        }
-    }
-
-    // Copy constructor
-    matrix_t(const matrix_t& other) : m(other.m), n(other.n), data(nullptr) {
-        if (m * n > 0) {
-            data = new T[m * n];
-            for (int i = 0; i < m * n; ++i) {
-                data[i] = other.data[i];
-            }
-        }
-    }
-
-    // Move constructor
-    matrix_t(matrix_t&& other) noexcept : m(other.m), n(other.n), data(other.data) {
-        other.m = 0;
-        other.n = 0;
-        other.data = nullptr;
-    }
-
-    // Copy assignment operator
-    matrix_t& operator=(const matrix_t& other) {
-        if (this != &other) {
-            // Delete current data.
-            delete[] data;
-            m = other.m;
-            n = other.n;
-            data = nullptr;
-            if (m * n > 0) {
-                data = new T[m * n];
-                for (int i = 0; i < m * n; ++i) {
-                    data[i] = other.data[i];
-                }
-            }
-        }
-        return *this;
-    }
-
-    // Move assignment operator
-    matrix_t& operator=(matrix_t&& other) noexcept {
-        if (this != &other) {
-            // Delete current data.
-            delete[] data;
-            m = other.m;
-            n = other.n;
-            data = other.data;
-
-            other.m = 0;
-            other.n = 0;
-            other.data = nullptr;
-        }
-        return *this;
-    }
-
-    // Destructor
-    ~matrix_t() {
-        delete[] data;
-    }
-
-    // Fill the matrix with a constant value of type T.
-    void fill(const T& value) {
-        if (data != nullptr) {
-            std::fill(data, data + m * n, value);
-        }
-    }
-
-    // Method to read matrix from a file.
-    void read_matrix(const std::string& filename) {
-        // Clean up any previously allocated data.
-        delete[] data;
-        data = nullptr;
-        m = 0;
-        n = 0;
-
-        std::ifstream infile(filename);
-        if (!infile.is_open()) {
-            throw std::runtime_error("Error opening file: " + filename);
-        }
-
-        std::string line;
-        if (!std::getline(infile, line)) {
-            throw std::runtime_error("Error: file is empty.");
-        }
-
-        // Try to interpret the first line as a header containing m and n.
-        bool headerParsed = false;
-        {
-            std::istringstream iss(line);
-            int possible_m, possible_n;
-            if (iss >> possible_m >> possible_n) {
-                std::string extra;
-                if (!(iss >> extra)) { // Exactly two tokens found.
-                    headerParsed = true;
-                    m = possible_m;
-                    n = possible_n;
-                }
-            }
-        }
-
-        if (headerParsed) {
-            // Allocate memory for the matrix data.
-            if (m * n > 0) {
-                data = new T[m * n];
-            }
-
-            // Read m*n values from the file.
-            for (int i = 0; i < m; ++i) {
-                for (int j = 0; j < n; ++j) {
-                    if (!(infile >> data[i * n + j])) {
-                        throw std::runtime_error("Error reading matrix value at (" +
-                                                 std::to_string(i) + ", " + std::to_string(j) + ").");
-                    }
-                }
-            }
-
-            // Ensure there is no extra data.
-            T extra;
-            if (infile >> extra) {
-                throw std::runtime_error("Extra data found in the file after reading the matrix.");
-            }
-        } else {
-            // No valid header found: treat the file as pure matrix data.
-            std::vector<T> temp_data;
-            {
-                std::istringstream row_stream(line);
-                T value;
-                while (row_stream >> value) {
-                    temp_data.push_back(value);
-                }
-            }
-            if (temp_data.empty()) {
-                throw std::runtime_error("Error: first line does not contain any matrix data.");
-            }
-            // Determine number of columns from the first line.
-            n = temp_data.size();
-            m = 1; // One row has been read already.
-
-            // Process the rest of the file.
-            while (std::getline(infile, line)) {
-                if (line.empty()) {
-                    continue;
-                }
-                std::istringstream row_stream(line);
-                int col_count = 0;
-                T value;
-                while (row_stream >> value) {
-                    temp_data.push_back(value);
-                    ++col_count;
-                }
-                if (col_count != n) {
-                    throw std::runtime_error("Inconsistent number of columns in the matrix file. "
-                                             "Expected " + std::to_string(n) + ", but got " +
-                                             std::to_string(col_count) + ".");
-                }
-                ++m;
-            }
-            // Allocate memory and copy the temporary data.
-            if (m * n > 0) {
-                data = new T[m * n];
-            }
-            for (size_t i = 0; i < temp_data.size(); i++) {
-                data[i] = temp_data[i];
-            }
-        }
-        infile.close();
-    }
-
-    // Accessor methods.
-    int rows() const { return m; }
-    int cols() const { return n; }
-
-    // Element access operators.
-    T& operator()(int row, int col) {
-        if (row < 0 || row >= m || col < 0 || col >= n) {
-            throw std::out_of_range("Matrix indices out of range");
-        }
-        return data[row * n + col];
-    }
-
-    const T& operator()(int row, int col) const {
-        if (row < 0 || row >= m || col < 0 || col >= n) {
-            throw std::out_of_range("Matrix indices out of range");
-        }
-        return data[row * n + col];
-    }
-
-    // Inline getter.
-    inline T get(int row, int col) const {
-        return data[row * n + col];
-    }
-
-    // Inline setter.
-    inline void set(int row, int col, T value) {
-        data[row * n + col] = value;
-    }
-
-    // Return raw pointer to data (non-const and const).
-    inline T* data_ptr() {
-        return data;
-    }
-
-    inline const T* data_ptr() const {
-        return data;
-    }
-
-    // Display the matrix.
-    void display() const {
-        if (m == 0 || n == 0 || data == nullptr) {
-            std::cerr << "Matrix is not allocated.\n";
-            return;
-        }
-
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j) {
-                std::cout << data[i * n + j] << " ";
-            }
-            std::cout << "\n";
-        }
-    }
-
-    // Save the matrix to a file.
-    void save(const std::string& filename) const {
-        if (m == 0 || n == 0 || data == nullptr) {
-            std::cerr << "Matrix is not allocated.\n";
-            return;
-        }
-
-        std::ofstream outfile(filename);
-        if (!outfile.is_open()) {
-            throw std::runtime_error("Error opening file for writing: " + filename);
-        }
-
-        // Write the matrix data.
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j) {
-                outfile << data[i * n + j];
-                if (j < n - 1) {
-                    outfile << " ";
-                }
-            }
-            outfile << "\n";
-            if (outfile.fail()) {
-                throw std::runtime_error("Error writing matrix data to file: " + filename);
-            }
-        }
-        outfile.close();
-    }
-};
-
-class DependencyTable {
-    size_t m;        // Number of rows
-    size_t n;        // Number of columns
-    bool* data;      // Pointer to the dynamically allocated bool array
-
-    public:
-    // Default constructor
-    DependencyTable() : m(0), n(0), data(nullptr) {}
-
-    // Constructor: Initializes the dependency table with given rows and columns
-    DependencyTable(size_t total_task_rows, size_t total_task_cols) : m(0), n(0), data(nullptr) {
-        init(total_task_rows, total_task_cols);
-    }
-
-    // Destructor: Frees the dynamically allocated memory
-    ~DependencyTable() {
-        delete[] data;
-    }
-
-    // Deleted copy constructor and copy assignment to prevent accidental copying
-    DependencyTable(const DependencyTable&) = delete;
-    DependencyTable& operator=(const DependencyTable&) = delete;
-
-    // Move constructor
-    DependencyTable(DependencyTable&& other) noexcept
-        : m(other.m), n(other.n), data(other.data) {
-        other.m = 0;
-        other.n = 0;
-        other.data = nullptr;
-    }
-
-    // Move assignment operator
-    DependencyTable& operator=(DependencyTable&& other) noexcept {
-        if (this != &other) {
-            delete[] data;
-            m = other.m;
-            n = other.n;
-            data = other.data;
-
-            other.m = 0;
-            other.n = 0;
-            other.data = nullptr;
-        }
-        return *this;
-    }
-
-    // Initializes the dependency table with given rows and columns
-    void init(size_t total_task_rows, size_t total_task_cols) {
-        delete[] data; // Clean up existing data if any
-        m = total_task_rows;
-        n = total_task_cols;
-        data = new bool[m * n]();
-
-        for (size_t i = 0; i < m * n; ++i) {
-            data[i] = false;
-        }
-    }
-
-    // Retrieves the dependency value at (i, j)
-    inline bool getDependency(size_t i, size_t j) const {
-        size_t idx =  i * n + j;
-        return data[idx];
-    }
-
-    // Sets the dependency value at (i, j)
-    inline void setDependency(size_t i, size_t j, bool value) {
-        size_t idx =  i * n + j;
-        data[idx] = value;
-    }
-
-    // Overloaded operator() for safe indexing
-    bool operator()(size_t i, size_t j) const {
-        if (i >= m || j >= n) {
-            throw std::out_of_range("Index out of bounds: (" + std::to_string(i) + ", " + std::to_string(j) + ")");
-        }
-        return getDependency(i, j);
-    }
-
-    // Overloaded operator() for safe setting with bounds checking
-    void operator()(size_t i, size_t j, bool value) {
-        if (i >= m || j >= n) {
-            throw std::out_of_range("Index out of bounds: (" + std::to_string(i) + ", " + std::to_string(j) + ")");
-        }
-        setDependency(i, j, value);
-    }
-
-    // Prints the dependency table
-    void printDependencyTable(std::ostream &os = std::cout) const {
-        for (size_t i = 0; i < m; ++i) {
-            for (size_t j = 0; j < n; ++j) {
-                os << (getDependency(i, j) ? "1 " : "0 ");
-            }
-            os << "\n";
-        }
-    }
-
-    // Accessors for rows and columns
-    size_t rows() const { return m; }
-    size_t cols() const { return n; }
-
-};
-
-class DependencyTableAtomic {
-    size_t m;                   // Number of rows
-    size_t n;                   // Number of columns
-    std::atomic<bool>* data;    // Pointer to dynamically allocated atomic<bool> array
-
-public:
-    // Default constructor
-    DependencyTableAtomic() : m(0), n(0), data(nullptr) {}
-
-    // Constructor: Initializes the dependency table with given rows and columns
-    DependencyTableAtomic(size_t total_task_rows, size_t total_task_cols)
-        : m(0), n(0), data(nullptr)
-    {
-        init(total_task_rows, total_task_cols);
-    }
-
-    // Destructor: Frees the dynamically allocated memory
-    ~DependencyTableAtomic() {
-        delete[] data;
-    }
-
-    // Deleted copy constructor and copy assignment to prevent accidental copying
-    DependencyTableAtomic(const DependencyTableAtomic&) = delete;
-    DependencyTableAtomic& operator=(const DependencyTableAtomic&) = delete;
-
-    // Move constructor
-    DependencyTableAtomic(DependencyTableAtomic&& other) noexcept
-        : m(other.m), n(other.n), data(other.data)
-    {
-        other.m = 0;
-        other.n = 0;
-        other.data = nullptr;
-    }
-
-    // Move assignment operator
-    DependencyTableAtomic& operator=(DependencyTableAtomic&& other) noexcept {
-        if (this != &other) {
-            delete[] data;
-            m = other.m;
-            n = other.n;
-            data = other.data;
-
-            other.m = 0;
-            other.n = 0;
-            other.data = nullptr;
-        }
-        return *this;
-    }
-
-    // Initializes the dependency table with given rows and columns
-    void init(size_t total_task_rows, size_t total_task_cols) {
-        // Clean up existing data if any
-        delete[] data;
-
-        m = total_task_rows;
-        n = total_task_cols;
-
-        // Allocate new storage for atomic<bool>
-        data = new std::atomic<bool>[m * n];
-
-        // Initialize all values to false
-        for (size_t i = 0; i < m * n; ++i) {
-            data[i].store(false, std::memory_order_relaxed);
-        }
-    }
-
-    // Retrieves the dependency value at (i, j) using an atomic load
-    inline bool getDependency(size_t i, size_t j) const {
-        size_t idx = i * n + j;
-        // Acquire ordering to ensure we read the latest value from any writer
-        return data[idx].load(std::memory_order_seq_cst);
-    }
-
-    // Sets the dependency value at (i, j) using an atomic store
-    inline void setDependency(size_t i, size_t j, bool value) {
-        size_t idx = i * n + j;
-        // Release ordering to ensure that prior writes in this thread are visible
-        // to other threads that subsequently acquire this location
-        data[idx].store(value, std::memory_order_seq_cst);
-    }
-
-    // Overloaded operator() for safe indexing (read)
-    bool operator()(size_t i, size_t j) const {
-        if (i >= m || j >= n) {
-            throw std::out_of_range("Index out of bounds: (" + std::to_string(i)
-                                    + ", " + std::to_string(j) + ")");
-        }
-        return getDependency(i, j);
-    }
-
-    // Overloaded operator() for safe setting (write)
-    void operator()(size_t i, size_t j, bool value) {
-        if (i >= m || j >= n) {
-            throw std::out_of_range("Index out of bounds: (" + std::to_string(i)
-                                    + ", " + std::to_string(j) + ")");
-        }
-        setDependency(i, j, value);
-    }
-
-    // Prints the dependency table
-     void printDependencyTable(std::ostream &os = std::cout) const {
-        for (size_t i = 0; i < m; ++i) {
-            for (size_t j = 0; j < n; ++j) {
-                // For printing, an acquire load ensures we see the latest state
-                bool val = data[i * n + j].load(std::memory_order_acquire);
-                os << (val ? "1 " : "0 ");
-            }
-            os << "\n";
-        }
-    }
-
-    // Accessors for rows and columns
-    size_t rows() const { return m; }
-    size_t cols() const { return n; }
-};
-
-struct Task {
-    unsigned char type;
-    unsigned int priority;
-    bool enq_nxt_t1;
-    size_t row_start;
-    size_t row_end;
-    size_t col_start;
-    size_t col_end;
-    size_t chunk_idx_i;
-    size_t chunk_idx_j;
-};
-
-class TaskTable {
-private:
-    int m;                     // number of task rows
-    int n;                     // number of task columns
-    std::vector<Task*> data;      // vector holding pointers to Task objects
-
-public:
-    TaskTable()
-        : m(0), n(0)
-    {
-        // 'data' is initially empty.
-    }
-
-    // Parameterized constructor that calls init().
-    template <typename T>
-    TaskTable(int total_task_rows, int total_task_cols, int alpha, int beta, matrix_t<T>& mat)
-        : m(0), n(0)
-    {
-        init(total_task_rows, total_task_cols, alpha, beta, mat);
-    }
-
-    ~TaskTable() {
-        for (Task* t : data) {
-            delete t;
-        }
-    }
-
-    // Disallow copy construction and copy assignment.
-    TaskTable(const TaskTable&) = delete;
-    TaskTable& operator=(const TaskTable&) = delete;
-
-    // (Optional) Use default move construction and move assignment.
-    TaskTable(TaskTable&&) noexcept = default;
-    TaskTable& operator=(TaskTable&&) noexcept = default;
-
-    template <typename T>
-    void init(int total_task_rows, int total_task_cols, int alpha, int beta, matrix_t<T>& mat) {
-        // Delete any previously allocated tasks.
-        for (Task* t : data) {
-            delete t;
-        }
-        data.clear();
-
-        m = total_task_rows;
-        n = total_task_cols;
-        data.resize(m * n, nullptr);
-
-        int beta_div_alpha = beta / alpha;
-
-        int ctr = 1;
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j) {
-                Task* new_task = new Task();
-
-                // Set the type and possibly the enq_nxt_t1 flag based on the indices and beta_by_alpha.
-                if (i * beta_div_alpha <= j && j < (i+1) * beta_div_alpha){
-                    new_task->type = 1;
-                    ctr = i + 1;
-                } else {
-                    new_task->type = 2;
-                    if (i == ctr && ((i-1) * beta_div_alpha <= j && j < i * beta_div_alpha)){
-                        new_task->enq_nxt_t1 = true;
-                    } else {
-                        new_task->enq_nxt_t1 = false;
-                    }
-                }
-
-                // If j is outside the designated range, free new_task and leave the cell as nullptr.
-                if (j >= (i+1) * beta_div_alpha) {
-                    delete new_task;
-                    continue;
-                }
-
-                // Set the boundaries for the task.
-                new_task->row_start   = alpha * j + 1;
-                new_task->row_end     = std::min(alpha *(j + 1) + 1, mat.rows());
-                new_task->col_start   = beta * i + 1;
-                new_task->col_end     = std::min(beta  *(i + 1) + 1, mat.rows());
-                new_task->chunk_idx_i = i;
-                new_task->chunk_idx_j = j;
-
-                // bottomL = (total_task_rows - 1 - i) + (total_task_cols - 1 - j) + 1
-                new_task->priority = (m - 1 - i) + (n - 1 - j) + 1;
-                // Store the task pointer in the vector.
-                data[i * n + j] = new_task;
-            }
-        }
-    }
-
-    inline Task* getTask(int i, int j) const {
-        return data[i * n + j];
-    }
-
-    // Overloaded operator() for accessing the task at (i, j) with bounds checking.
-    Task* operator()(int i, int j) const {
-        if (i >= m || j >= n)
-            throw std::out_of_range("Index out of bounds in TaskTable::operator()");
-        return data[i * n + j];
-    }
-
-    // Prints the task table.
-    // For each cell, it prints the task type (or "N" if the pointer is nullptr).
-    void printTaskTable() const {
-        for (int i = 0; i < m; ++i) {
-            for (int j = 0; j < n; ++j) {
-                Task* t = data[i * n + j];
-                if (t)
-                    std::cout << static_cast<int>(t->priority) << " ";
-                else
-                    std::cout << "N ";
-            }
-            std::cout << "\n";
-        }
-    }
-
-    // Accessors for the number of rows and columns.
-    int rows() const { return m; }
-    int cols() const { return n; }
-};
-
-template <class T>
-class CircularQueueMtx {
-    std::vector<T> buffer;      // Internal storage.
-    const size_t capacity;      // Maximum number of elements.
-    size_t front;               // Index of the first element.
-    size_t rear;                // Index one past the last element.
-    size_t count;               // Number of elements in the queue.
-    mutable std::mutex mutex;   // Mutex for thread-safety.
-
-    public:
-    // Construct a circular queue with fixed capacity.
-    explicit CircularQueueMtx(size_t capacity)
-        : buffer(capacity), capacity(capacity),
-          front(0), rear(0), count(0)
-    { }
-
-    // Returns true if the queue is empty.
-    bool empty() const {
-        std::lock_guard<std::mutex> lock(mutex);
-        return count == 0;
-    }
-
-    // Returns true if the queue is full.
-    bool full() const {
-        std::lock_guard<std::mutex> lock(mutex);
-        return count == capacity;
-    }
-
-    // Returns the current number of elements.
-    size_t size() const {
-        std::lock_guard<std::mutex> lock(mutex);
-        return count;
-    }
-
-    // Push an element at the front of the queue.
-    // Returns true if the operation was successful (i.e. the queue wasn’t full).
-    bool push_front(const T &value) {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (count == capacity) {
-            return false;  // Queue is full.
-        }
-        // Move front backward (circularly) and store the value.
-        front = (front + capacity - 1) % capacity;
-        buffer[front] = value;
-        ++count;
-        return true;
-    }
-
-    // Push an element at the back of the queue.
-    // Returns true if the operation was successful (i.e. the queue wasn’t full).
-    bool push_back(const T &value) {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (count == capacity) {
-            return false;  // Queue is full.
-        }
-        buffer[rear] = value;
-        rear = (rear + 1) % capacity;
-        ++count;
-        return true;
-    }
-
-    // An alias for push_back.
-    inline bool push(const T &value) {
-        return push_back(value);
-    }
-
-    // Pop an element from the front.
-    // If the queue is empty, returns std::nullopt.
-    std::optional<T> pop_front() {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (count == 0) {
-            return std::nullopt;  // Queue is empty.
-        }
-        T value = buffer[front];
-        front = (front + 1) % capacity;
-        --count;
-        return value;
-    }
-
-    // Pop an element from the back.
-    // If the queue is empty, returns std::nullopt.
-    std::optional<T> pop_back() {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (count == 0) {
-            return std::nullopt;  // Queue is empty.
-        }
-        rear = (rear + capacity - 1) % capacity;
-        T value = buffer[rear];
-        --count;
-        return value;
-    }
-
-    // An alias for pop_front.
-    std::optional<T> pop() {
-        return pop_front();
-    }
-};
-
-template<class T>
-class CircularQueueAtomic {
-    T* buffer;          // Raw array storage for elements.
-    const size_t capacity;    // Maximum number of elements allowed.
-
-    // Two atomic counters (which may be negative) track the logical indices.
-    std::atomic<int64_t> left;  // Points to the first valid element.
-    std::atomic<int64_t> right; // Points to one past the last valid element.
-
-    // A mutex used only for query operations.
-    mutable std::mutex query_mutex;
-    
-public:
-    // Constructs the deque with the given capacity.
-    // (Capacity is the maximum number of elements that can be stored.)
-    explicit CircularQueueAtomic(size_t cap)
-      : capacity(cap), left(0), right(0)
-    {
-        // Allocate a raw array for storage.
-        buffer = new T[capacity];
-    }
-
-    ~CircularQueueAtomic() {
-        delete[] buffer;
-    }
-
-    // Returns true if the deque is empty.
-    bool empty() const {
-        std::lock_guard<std::mutex> lock(query_mutex);
-        return (right.load(std::memory_order_acquire) - left.load(std::memory_order_acquire)) == 0;
-    }
-
-    // Returns true if the deque is full.
-    bool full() const {
-        std::lock_guard<std::mutex> lock(query_mutex);
-        return (right.load(std::memory_order_acquire) - left.load(std::memory_order_acquire)) >= static_cast<int64_t>(capacity);
-    }
-
-    // Returns the current number of elements.
-    size_t size() const {
-        std::lock_guard<std::mutex> lock(query_mutex);
-        return static_cast<size_t>(right.load(std::memory_order_acquire) - left.load(std::memory_order_acquire));
-    }
-
-    // ---- Lock-free update methods (using atomics & compare_exchange) ----
-
-    // push_back: Append an element at the back.
-    // Returns false if the deque is full.
-    bool push_back(const T &value) {
-        while (true) {
-            int64_t current_right = right.load(std::memory_order_relaxed);
-            int64_t current_left  = left.load(std::memory_order_acquire);
-            if ((current_right - current_left) >= static_cast<int64_t>(capacity))
-                return false;  // full
-
-            if (right.compare_exchange_weak(current_right, current_right + 1,
-                                            std::memory_order_acq_rel, std::memory_order_relaxed))
-            {
-                size_t index = static_cast<size_t>(current_right % capacity);
-                buffer[index] = value;
-                return true;
-            }
-        }
-    }
-
-    // push_front: Insert an element at the front.
-    // Returns false if the deque is full.
-    bool push_front(const T &value) {
-        while (true) {
-            int64_t current_left  = left.load(std::memory_order_relaxed);
-            int64_t current_right = right.load(std::memory_order_acquire);
-            if ((current_right - current_left) >= static_cast<int64_t>(capacity))
-                return false;  // full
-
-            int64_t new_left = current_left - 1;
-            if (left.compare_exchange_weak(current_left, new_left,
-                                           std::memory_order_acq_rel, std::memory_order_relaxed))
-            {
-                size_t index = static_cast<size_t>(((new_left % capacity) + capacity) % capacity);
-                buffer[index] = value;
-                return true;
-            }
-        }
-    }
-
-    // pop_front: Remove and return an element from the front.
-    // Returns std::nullopt if the deque is empty.
-    std::optional<T> pop_front() {
-        while (true) {
-            int64_t current_left  = left.load(std::memory_order_relaxed);
-            int64_t current_right = right.load(std::memory_order_acquire);
-            if (current_left == current_right)
-                return std::nullopt;  // empty
-
-            if (left.compare_exchange_weak(current_left, current_left + 1,
-                                           std::memory_order_acq_rel, std::memory_order_relaxed))
-            {
-                size_t index = static_cast<size_t>(((current_left % capacity) + capacity) % capacity);
-                T value = buffer[index];
-                return value;
-            }
-        }
-    }
-
-    // pop_back: Remove and return an element from the back.
-    // Returns std::nullopt if the deque is empty.
-    std::optional<T> pop_back() {
-        while (true) {
-            int64_t current_right = right.load(std::memory_order_relaxed);
-            int64_t current_left  = left.load(std::memory_order_acquire);
-            if (current_left == current_right)
-                return std::nullopt;  // empty
-
-            int64_t new_right = current_right - 1;
-            if (right.compare_exchange_weak(current_right, new_right,
-                                            std::memory_order_acq_rel, std::memory_order_relaxed))
-            {
-                size_t index = static_cast<size_t>(((new_right % capacity) + capacity) % capacity);
-                T value = buffer[index];
-                return value;
-            }
-        }
-    }
-
-    // push: Alias for push_back so that the deque can be used as a normal FIFO queue.
-    inline bool push(const T &value) {
-        return push_back(value);
-    }
-
-    // pop: Alias for pop_front so that the deque can be used as a normal FIFO queue.
-    inline std::optional<T> pop() {
-        return pop_front();
-    }
-};
+#ifndef BN2_H
+#define BN2_H
+
+#include <iostream>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <initializer_list>
+
+#include <chrono>
+#include <functional>
+#include <type_traits>
+
+#include <cmath>
+#include <algorithm>
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <atomic>
+#include <new>
+
+#include <cstdint>
+#include <limits>
+#include <cstring>
+#include <charconv>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Helper function to get a string representation of the time unit.
+template <typename Duration>
+constexpr const char* get_time_unit() {
+    if constexpr (std::is_same_v<Duration, std::chrono::nanoseconds>) {
+        return "nanoseconds";
+    } else if constexpr (std::is_same_v<Duration, std::chrono::microseconds>) {
+        return "microseconds";
+    } else if constexpr (std::is_same_v<Duration, std::chrono::milliseconds>) {
+        return "milliseconds";
+    } else if constexpr (std::is_same_v<Duration, std::chrono::seconds>) {
+        return "seconds";
+    } else {
+        return "time units";
+    }
+}
+
+// Function to measure execution time of a given function
+// The default is std::chrono::nanoseconds.
+template <typename TimeUnit = std::chrono::nanoseconds, typename Func, typename... Args>
+auto measure_exec_time(Func&& func, Args&&... args) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Handle functions that return void separately.
+    if constexpr (std::is_void_v<std::invoke_result_t<Func, Args...>>) {
+        std::invoke(std::forward<Func>(func), std::forward<Args>(args)...);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto elapsed = std::chrono::duration_cast<TimeUnit>(end - start);
+        std::cout << "Time elapsed: " << elapsed.count() << " " 
+                  << get_time_unit<TimeUnit>() << "\n";
+        // No value is returned.
+    } else {
+        auto result = std::invoke(std::forward<Func>(func), std::forward<Args>(args)...);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto elapsed = std::chrono::duration_cast<TimeUnit>(end - start);
+        std::cout << "Time elapsed: " << elapsed.count() << " " 
+                  << get_time_unit<TimeUnit>() << "\n";
+        return result;
+    }
+}
+
+// On-disk header of the binary matrix format. The header is followed by
+// padding up to data_offset and then rows*cols elements in row-major order.
+// data_offset is a multiple of alignment, so a page-aligned file can be
+// mmap'ed and used in place.
+struct matrix_file_header_t {
+    char     magic[8];      // "PARQRMAT"
+    uint32_t version;       // MATRIX_FILE_VERSION
+    uint32_t byte_order;    // MATRIX_FILE_BYTE_ORDER as written by the producer
+    uint32_t dtype;         // One of matrix_dtype_t
+    uint32_t elem_size;     // sizeof(element) in bytes
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t alignment;     // Alignment of data_offset in bytes
+    uint64_t data_offset;   // Byte offset of the first element
+};
+
+static constexpr char     MATRIX_FILE_MAGIC[8]    = {'P', 'A', 'R', 'Q', 'R', 'M', 'A', 'T'};
+static constexpr uint32_t MATRIX_FILE_VERSION     = 1;
+static constexpr uint32_t MATRIX_FILE_BYTE_ORDER  = 0x01020304;
+static constexpr uint64_t MATRIX_FILE_ALIGNMENT   = 4096;
+
+enum matrix_dtype_t : uint32_t {
+    MATRIX_DTYPE_UNKNOWN = 0,
+    MATRIX_DTYPE_INT32   = 1,
+    MATRIX_DTYPE_INT64   = 2,
+    MATRIX_DTYPE_FLOAT32 = 3,
+    MATRIX_DTYPE_FLOAT64 = 4,
+};
+
+template <typename T>
+constexpr uint32_t matrix_dtype() {
+    if constexpr (std::is_same_v<T, int32_t>) {
+        return MATRIX_DTYPE_INT32;
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        return MATRIX_DTYPE_INT64;
+    } else if constexpr (std::is_same_v<T, float>) {
+        return MATRIX_DTYPE_FLOAT32;
+    } else if constexpr (std::is_same_v<T, double>) {
+        return MATRIX_DTYPE_FLOAT64;
+    } else {
+        return MATRIX_DTYPE_UNKNOWN;
+    }
+}
+
+// Header of a rows x cols matrix of T whose data starts at the first multiple
+// of alignment after the header.
+template <typename T>
+matrix_file_header_t make_matrix_file_header(uint64_t rows, uint64_t cols, uint64_t alignment) {
+    matrix_file_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MATRIX_FILE_MAGIC, sizeof(MATRIX_FILE_MAGIC));
+    header.version = MATRIX_FILE_VERSION;
+    header.byte_order = MATRIX_FILE_BYTE_ORDER;
+    header.dtype = matrix_dtype<T>();
+    header.elem_size = sizeof(T);
+    header.rows = rows;
+    header.cols = cols;
+    header.alignment = alignment;
+    header.data_offset = (sizeof(header) + alignment - 1) / alignment * alignment;
+    return header;
+}
+
+// Returns true if the file starts with the binary matrix magic.
+inline bool is_binary_matrix_file(const std::string& filename) {
+    std::ifstream infile(filename, std::ios::binary);
+    char magic[sizeof(MATRIX_FILE_MAGIC)] = {};
+    if (!infile.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, MATRIX_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+// Byte offsets of the matrices in a binary file. A file may hold several
+// matrices back to back (save_binary with append); each starts at a multiple
+// of the previous matrix's alignment, so every one can be mapped in place.
+inline std::vector<uint64_t> binary_matrix_records(const std::string& filename) {
+    std::ifstream infile(filename, std::ios::binary | std::ios::ate);
+    if (!infile.is_open()) {
+        throw std::runtime_error("Error opening file: " + filename);
+    }
+    const uint64_t file_size = static_cast<uint64_t>(infile.tellg());
+
+    std::vector<uint64_t> records;
+    uint64_t offset = 0;
+    while (offset < file_size) {
+        matrix_file_header_t header;
+        infile.seekg(static_cast<std::streamoff>(offset));
+        if (!infile.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(MATRIX_FILE_MAGIC)) != 0 ||
+            header.alignment == 0 || header.data_offset < sizeof(header)) {
+            throw std::runtime_error("Error reading " + filename + ": bad matrix header at byte "
+                                     + std::to_string(offset) + ".");
+        }
+        records.push_back(offset);
+        const uint64_t end = offset + header.data_offset + header.rows * header.cols * header.elem_size;
+        offset = (end + header.alignment - 1) / header.alignment * header.alignment;
+    }
+    return records;
+}
+
+// Element order of matrix_t storage. row_major is the order of the matrix
+// files. tiled stores each tile_rows x tile_cols block contiguously (row-major
+// inside the tile), tiles in row-major tile order, each starting on a
+// MATRIX_TILE_ALIGNMENT boundary; edge tiles are padded to the full size.
+enum class MatrixLayout {
+    row_major,
+    tiled
+};
+
+static constexpr size_t MATRIX_TILE_ALIGNMENT = 64;
+
+inline const char* matrix_layout_name(MatrixLayout layout) {
+    return layout == MatrixLayout::tiled ? "tiled" : "row_major";
+}
+
+inline MatrixLayout parse_matrix_layout(const std::string& text) {
+    if (text == "row_major") {
+        return MatrixLayout::row_major;
+    }
+    if (text == "tiled") {
+        return MatrixLayout::tiled;
+    }
+    throw std::invalid_argument("Unknown matrix layout: " + text);
+}
+
+template <class T>
+class matrix_t {
+private:
+    int m;   // Number of rows
+    int n;   // Number of columns
+    T* data; // Pointer to allocated array holding matrix elements
+
+    // Set when data points into a read-only file mapping (MAP_PRIVATE, so
+    // in-place updates are copy-on-write and never reach the file).
+    void*  map_base = nullptr;
+    size_t map_length = 0;
+
+    // Storage layout (see to_tiled()). aligned is set when data comes from
+    // allocate_aligned().
+    MatrixLayout storage_layout = MatrixLayout::row_major;
+    int    tile_m = 0;          // Rows per tile
+    int    tile_n = 0;          // Columns per tile
+    int    tile_cols_n = 0;     // Tiles per tile row
+    size_t tile_size = 0;       // Elements from one tile to the next
+    bool   aligned = false;
+
+    static T* allocate_aligned(size_t count) {
+        return static_cast<T*>(::operator new[](count * sizeof(T), std::align_val_t(MATRIX_TILE_ALIGNMENT)));
+    }
+
+    // Frees the current storage, whether heap-allocated or mapped, and
+    // resets the layout to row-major.
+    void release() {
+        if (map_base != nullptr) {
+            munmap(map_base, map_length);
+            map_base = nullptr;
+            map_length = 0;
+        } else if (aligned) {
+            ::operator delete[](static_cast<void*>(data), std::align_val_t(MATRIX_TILE_ALIGNMENT));
+        } else {
+            delete[] data;
+        }
+        data = nullptr;
+        storage_layout = MatrixLayout::row_major;
+        tile_m = tile_n = tile_cols_n = 0;
+        tile_size = 0;
+        aligned = false;
+    }
+
+    // Number of elements in the storage, including tile padding.
+    size_t storage_size() const {
+        if (storage_layout == MatrixLayout::row_major) {
+            return static_cast<size_t>(m) * n;
+        }
+        return static_cast<size_t>((m + tile_m - 1) / tile_m) * tile_cols_n * tile_size;
+    }
+
+    // Copies storage and layout from other, into fresh storage.
+    void copy_from(const matrix_t& other) {
+        m = other.m;
+        n = other.n;
+        const size_t count = other.storage_size();
+        if (count > 0 && other.data != nullptr) {
+            data = other.aligned ? allocate_aligned(count) : new T[count];
+            aligned = other.aligned;
+            std::copy(other.data, other.data + count, data);
+        }
+        storage_layout = other.storage_layout;
+        tile_m = other.tile_m;
+        tile_n = other.tile_n;
+        tile_cols_n = other.tile_cols_n;
+        tile_size = other.tile_size;
+    }
+
+    // Takes over other's storage and layout, leaving it empty.
+    void take_from(matrix_t& other) noexcept {
+        m = other.m;
+        n = other.n;
+        data = other.data;
+        map_base = other.map_base;
+        map_length = other.map_length;
+        storage_layout = other.storage_layout;
+        tile_m = other.tile_m;
+        tile_n = other.tile_n;
+        tile_cols_n = other.tile_cols_n;
+        tile_size = other.tile_size;
+        aligned = other.aligned;
+
+        other.m = 0;
+        other.n = 0;
+        other.data = nullptr;
+        other.map_base = nullptr;
+        other.map_length = 0;
+        other.storage_layout = MatrixLayout::row_major;
+        other.tile_m = other.tile_n = other.tile_cols_n = 0;
+        other.tile_size = 0;
+        other.aligned = false;
+    }
+
+    // Copies row `row` into out[0, n) in column order.
+    void copy_row(int row, T* out) const {
+        if (storage_layout == MatrixLayout::row_major) {
+            std::copy(data + static_cast<size_t>(row) * n, data + static_cast<size_t>(row + 1) * n, out);
+            return;
+        }
+        for (int c = 0; c < n; c += tile_n) {
+            const T* src = data + index(row, c);
+            std::copy(src, src + std::min(tile_n, n - c), out + c);
+        }
+    }
+
+    static bool is_text_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+    }
+
+    // Returns the end of the whitespace-free token starting at p.
+    static const char* token_end(const char* p, const char* end) {
+        while (p < end && !is_text_space(*p)) {
+            ++p;
+        }
+        return p;
+    }
+
+    // Converts one token; accepts a leading '+', which std::from_chars does not.
+    template <typename V>
+    static bool parse_token(const char* begin, const char* end, V& value) {
+        if (begin < end && *begin == '+') {
+            ++begin;
+        }
+        auto result = std::from_chars(begin, end, value);
+        return result.ec == std::errc() && result.ptr == end;
+    }
+
+    // Per-chunk result of the counting pass.
+    struct text_chunk_t {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        size_t values = 0;       // Tokens in the chunk
+        size_t offset = 0;       // Index of the chunk's first value in data
+        int bad_columns = -1;    // Column count of the first inconsistent line
+        size_t bad_value = std::numeric_limits<size_t>::max();  // Index of the first unparsable value
+    };
+
+    // Parses [text, end) into data. The first line is a header if it holds
+    // exactly two integers (m n); otherwise it is the first row and fixes n.
+    // Each chunk is counted first (validating the per-line column count in the
+    // headerless case), so every thread knows where its values go and can
+    // write them in place during the second pass.
+    void parse_text(const char* text, const char* end, unsigned num_threads) {
+        const char* first_end = std::find(text, end, '\n');
+
+        // Try to interpret the first line as a header containing m and n.
+        bool headerParsed = false;
+        {
+            const char* tok[3] = {};
+            const char* tok_end[3] = {};
+            int count = 0;
+            for (const char* p = text; p < first_end && count < 3;) {
+                if (is_text_space(*p)) {
+                    ++p;
+                    continue;
+                }
+                tok[count] = p;
+                p = token_end(p, first_end);
+                tok_end[count++] = p;
+            }
+            int possible_m, possible_n;
+            if (count == 2 && parse_token(tok[0], tok_end[0], possible_m) &&
+                parse_token(tok[1], tok_end[1], possible_n)) {
+                headerParsed = true;
+                m = possible_m;
+                n = possible_n;
+            }
+        }
+
+        const char* body = text;
+        if (headerParsed) {
+            body = first_end < end ? first_end + 1 : end;
+        } else {
+            int count = 0;
+            for (const char* p = text; p < first_end;) {
+                if (is_text_space(*p)) {
+                    ++p;
+                    continue;
+                }
+                p = token_end(p, first_end);
+                ++count;
+            }
+            if (count == 0) {
+                throw std::runtime_error("Error: first line does not contain any matrix data.");
+            }
+            // Determine number of columns from the first line.
+            n = count;
+        }
+
+        // Split the body at line boundaries, with at least ~1 MiB per chunk.
+        if (num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        const size_t body_size = static_cast<size_t>(end - body);
+        const size_t min_chunk = size_t(1) << 20;
+        const size_t num_chunks = std::max<size_t>(1, std::min<size_t>(num_threads, body_size / min_chunk));
+
+        std::vector<text_chunk_t> chunks(num_chunks);
+        const char* prev = body;
+        for (size_t c = 0; c < num_chunks; ++c) {
+            const char* split = end;
+            if (c + 1 < num_chunks) {
+                split = std::max(prev, body + body_size / num_chunks * (c + 1));
+                split = std::find(split, end, '\n');
+                split = split < end ? split + 1 : end;
+            }
+            chunks[c].begin = prev;
+            chunks[c].end = split;
+            prev = split;
+        }
+
+        auto run_chunks = [&](auto&& pass) {
+            std::vector<std::thread> workers;
+            workers.reserve(num_chunks - 1);
+            for (size_t c = 1; c < num_chunks; ++c) {
+                workers.emplace_back(pass, std::ref(chunks[c]));
+            }
+            pass(chunks[0]);
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        };
+
+        // Pass 1: count values per chunk, checking every non-blank line of a
+        // headerless file against the column count of the first line.
+        const bool check_columns = !headerParsed;
+        run_chunks([check_columns, this](text_chunk_t& chunk) {
+            size_t values = 0;
+            int line_values = 0;
+            for (const char* p = chunk.begin; p < chunk.end;) {
+                char c = *p;
+                if (c == '\n') {
+                    if (check_columns && line_values != 0 && line_values != n && chunk.bad_columns < 0) {
+                        chunk.bad_columns = line_values;
+                    }
+                    line_values = 0;
+                    ++p;
+                } else if (is_text_space(c)) {
+                    ++p;
+                } else {
+                    p = token_end(p, chunk.end);
+                    ++line_values;
+                    ++values;
+                }
+            }
+            if (check_columns && line_values != 0 && line_values != n && chunk.bad_columns < 0) {
+                chunk.bad_columns = line_values;
+            }
+            chunk.values = values;
+        });
+
+        size_t total = 0;
+        for (auto& chunk : chunks) {
+            if (chunk.bad_columns >= 0) {
+                throw std::runtime_error("Inconsistent number of columns in the matrix file. "
+                                         "Expected " + std::to_string(n) + ", but got " +
+                                         std::to_string(chunk.bad_columns) + ".");
+            }
+            chunk.offset = total;
+            total += chunk.values;
+        }
+
+        if (headerParsed) {
+            const size_t expected = m > 0 && n > 0 ? static_cast<size_t>(m) * n : 0;
+            if (total < expected) {
+                throw std::runtime_error("Error reading matrix value at (" +
+                                         std::to_string(total / n) + ", " + std::to_string(total % n) + ").");
+            }
+            if (total > expected) {
+                throw std::runtime_error("Extra data found in the file after reading the matrix.");
+            }
+        } else {
+            if (total / n > static_cast<size_t>(std::numeric_limits<int>::max())) {
+                throw std::runtime_error("Matrix text file has too many rows.");
+            }
+            m = static_cast<int>(total / n);
+        }
+
+        // Allocate memory for the matrix data.
+        if (total > 0) {
+            data = new T[total];
+        }
+
+        // Pass 2: convert each chunk's values into its slice of data.
+        T* out = data;
+        run_chunks([out](text_chunk_t& chunk) {
+            T* dst = out + chunk.offset;
+            size_t idx = 0;
+            for (const char* p = chunk.begin; p < chunk.end;) {
+                if (is_text_space(*p)) {
+                    ++p;
+                    continue;
+                }
+                const char* q = token_end(p, chunk.end);
+                if (!parse_token(p, q, dst[idx]) && chunk.bad_value == std::numeric_limits<size_t>::max()) {
+                    chunk.bad_value = chunk.offset + idx;
+                }
+                ++idx;
+                p = q;
+            }
+        });
+
+        for (const auto& chunk : chunks) {
+            if (chunk.bad_value != std::numeric_limits<size_t>::max()) {
+                throw std::runtime_error("Error reading matrix value at (" +
+                                         std::to_string(chunk.bad_value / n) + ", " +
+                                         std::to_string(chunk.bad_value % n) + ").");
+            }
+        }
+    }
+
+public:
+    // Default constructor
+    matrix_t() : m(0), n(0), data(nullptr) {}
+
+    // Parameterized constructor
+    matrix_t(int rows, int cols) : m(rows), n(cols), data(nullptr) {
+        if (rows > 0 && cols > 0) {
+            data = new T[rows * cols];
+        }
+    }
+
+    // Constructor to read matrix from a file
+    matrix_t(const std::string& filename) : m(0), n(0), data(nullptr) {
+        read_matrix(filename);
+    }
+
+    // Initializer list constructor
+    matrix_t(std::initializer_list<std::initializer_list<T>> init) : m(0), n(0), data(nullptr) {
+        m = static_cast<int>(init.size());
+        n = (m > 0) ? static_cast<int>(init.begin()->size()) : 0;
+
+        // Check that all rows have the same number of columns.
+        for (const auto& row : init) {
+            if (static_cast<int>(row.size()) != n) {
+                throw std::invalid_argument("All rows in initializer list must have the same number of columns.");
+            }
+        }
+
+        // Allocate memory.
+        if (m * n > 0) {
+            data = new T[m * n];
+        }
+
+        // Populate the matrix.
+        int i = 0;
+        for (const auto& row : init) {
+            int j = 0;
+            for (const auto& value : row) {
+                data[i * n + j] = value;
+                ++j;
+            }
+            ++i;
+        }
+    }
+
+    // Copy constructor; the copy keeps other's layout.
+    matrix_t(const matrix_t& other) : m(0), n(0), data(nullptr) {
+        copy_from(other);
+    }
+
+    // Move constructor
+    matrix_t(matrix_t&& other) noexcept : m(0), n(0), data(nullptr) {
+        take_from(other);
+    }
+
+    // Copy assignment operator
+    matrix_t& operator=(const matrix_t& other) {
+        if (this != &other) {
+            // Delete current data.
+            release();
+            copy_from(other);
+        }
+        return *this;
+    }
+
+    // Move assignment operator
+    matrix_t& operator=(matrix_t&& other) noexcept {
+        if (this != &other) {
+            // Delete current data.
+            release();
+            take_from(other);
+        }
+        return *this;
+    }
+
+    // Destructor
+    ~matrix_t() {
+        release();
+    }
+
+    // Fill the matrix with a constant value of type T.
+    void fill(const T& value) {
+        if (data != nullptr) {
+            std::fill(data, data + storage_size(), value);
+        }
+    }
+
+    // Replaces the contents with a row-major copy of other converted to T,
+    // such as a float working copy of a double matrix.
+    template <class U>
+    void assign_converted(const matrix_t<U>& other) {
+        release();
+        m = other.rows();
+        n = other.cols();
+        if (m == 0 || n == 0 || other.data_ptr() == nullptr) {
+            return;
+        }
+        data = new T[static_cast<size_t>(m) * n];
+        if (other.layout() == MatrixLayout::row_major) {
+            std::transform(other.data_ptr(), other.data_ptr() + static_cast<size_t>(m) * n, data,
+                           [](U value) { return static_cast<T>(value); });
+            return;
+        }
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                data[static_cast<size_t>(i) * n + j] = static_cast<T>(other.get(i, j));
+            }
+        }
+    }
+
+    // Method to read matrix from a file.
+    // Binary files (see matrix_file_header_t) are detected by their magic and
+    // memory-mapped; anything else is parsed as whitespace-separated text.
+    // Text is split into chunks at line boundaries and parsed by num_threads
+    // threads (0: one per hardware thread) straight into the matrix storage.
+    void read_matrix(const std::string& filename, unsigned num_threads = 0) {
+        if (is_binary_matrix_file(filename)) {
+            read_binary(filename);
+            return;
+        }
+
+        // Clean up any previously allocated data.
+        release();
+        m = 0;
+        n = 0;
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+        const size_t file_size = static_cast<size_t>(st.st_size);
+        if (file_size == 0) {
+            ::close(fd);
+            throw std::runtime_error("Error: file is empty.");
+        }
+
+        // Map the text read-only; fall back to a heap copy if mmap fails.
+        std::vector<char> fallback;
+        void* text_map = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text_map == MAP_FAILED) {
+            text_map = nullptr;
+            fallback.resize(file_size);
+            size_t done = 0;
+            while (done < file_size) {
+                ssize_t got = ::pread(fd, fallback.data() + done, file_size - done, static_cast<off_t>(done));
+                if (got <= 0) {
+                    ::close(fd);
+                    throw std::runtime_error("Error reading file: " + filename);
+                }
+                done += static_cast<size_t>(got);
+            }
+        } else {
+            madvise(text_map, file_size, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+
+        try {
+            const char* text = text_map != nullptr ? static_cast<const char*>(text_map) : fallback.data();
+            parse_text(text, text + file_size, num_threads);
+        } catch (...) {
+            if (text_map != nullptr) {
+                munmap(text_map, file_size);
+            }
+            release();
+            m = 0;
+            n = 0;
+            throw;
+        }
+        if (text_map != nullptr) {
+            munmap(text_map, file_size);
+        }
+    }
+
+    // Method to read a binary matrix file. With use_mmap the file is mapped
+    // MAP_PRIVATE and used in place; otherwise, or if the mapping fails, the
+    // payload is read into a heap buffer with a single bulk read. offset
+    // selects a matrix of a multi-matrix file (see binary_matrix_records).
+    void read_binary(const std::string& filename, bool use_mmap = true, uint64_t offset = 0) {
+        release();
+        m = 0;
+        n = 0;
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening file: " + filename);
+        }
+
+        matrix_file_header_t header;
+        struct stat st;
+        if (::pread(fd, &header, sizeof(header), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(header)) ||
+            ::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Error reading binary matrix header: " + filename);
+        }
+
+        std::string error;
+        if (std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(MATRIX_FILE_MAGIC)) != 0) {
+            error = "not a binary matrix file";
+        } else if (header.version != MATRIX_FILE_VERSION) {
+            error = "unsupported format version " + std::to_string(header.version);
+        } else if (header.byte_order != MATRIX_FILE_BYTE_ORDER) {
+            error = "byte order does not match this machine";
+        } else if (header.dtype != matrix_dtype<T>() || header.elem_size != sizeof(T)) {
+            error = "element type does not match the matrix type (dtype " + std::to_string(header.dtype) + ")";
+        } else if (header.rows > static_cast<uint64_t>(std::numeric_limits<int>::max()) ||
+                   header.cols > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+            error = "dimensions exceed the supported range";
+        } else if (header.data_offset < sizeof(header) ||
+                   static_cast<uint64_t>(st.st_size) < offset + header.data_offset + header.rows * header.cols * sizeof(T)) {
+            error = "file is truncated";
+        }
+        if (!error.empty()) {
+            ::close(fd);
+            throw std::runtime_error("Error reading " + filename + ": " + error + ".");
+        }
+
+        const size_t count = static_cast<size_t>(header.rows) * static_cast<size_t>(header.cols);
+        const size_t bytes = count * sizeof(T);
+
+        const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        if (use_mmap && bytes > 0 && offset % page == 0 && header.data_offset % page == 0) {
+            size_t length = static_cast<size_t>(header.data_offset) + bytes;
+            void* base = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+            if (base != MAP_FAILED) {
+                map_base = base;
+                map_length = length;
+                data = reinterpret_cast<T*>(static_cast<char*>(base) + header.data_offset);
+            }
+        }
+
+        if (data == nullptr && count > 0) {
+            data = new T[count];
+            char* dst = reinterpret_cast<char*>(data);
+            size_t done = 0;
+            while (done < bytes) {
+                ssize_t got = ::pread(fd, dst + done, bytes - done,
+                                      static_cast<off_t>(offset + header.data_offset + done));
+                if (got <= 0) {
+                    ::close(fd);
+                    release();
+                    throw std::runtime_error("Error reading matrix data from file: " + filename);
+                }
+                done += static_cast<size_t>(got);
+            }
+        }
+
+        ::close(fd);
+        m = static_cast<int>(header.rows);
+        n = static_cast<int>(header.cols);
+    }
+
+    // Save the matrix in the binary format read by read_binary(). With append
+    // the matrix is added after the ones already in the file, padded to
+    // alignment, so one file can hold a whole batch.
+    void save_binary(const std::string& filename, uint64_t alignment = MATRIX_FILE_ALIGNMENT,
+                     bool append = false) const {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            throw std::invalid_argument("Alignment must be a power of two.");
+        }
+
+        const matrix_file_header_t header =
+            make_matrix_file_header<T>(static_cast<uint64_t>(m), static_cast<uint64_t>(n), alignment);
+
+        struct stat st;
+        const uint64_t existing = append && ::stat(filename.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+        std::ofstream outfile(filename, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+        if (!outfile.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+        if (existing % alignment != 0) {
+            std::vector<char> gap(alignment - existing % alignment, 0);
+            outfile.write(gap.data(), static_cast<std::streamsize>(gap.size()));
+        }
+
+        std::vector<char> padding(header.data_offset - sizeof(header), 0);
+        outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        outfile.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+        if (data != nullptr && storage_layout == MatrixLayout::row_major) {
+            outfile.write(reinterpret_cast<const char*>(data),
+                          static_cast<std::streamsize>(static_cast<size_t>(m) * n * sizeof(T)));
+        } else if (data != nullptr) {
+            std::vector<T> row(n);
+            for (int i = 0; i < m; ++i) {
+                copy_row(i, row.data());
+                outfile.write(reinterpret_cast<const char*>(row.data()),
+                              static_cast<std::streamsize>(static_cast<size_t>(n) * sizeof(T)));
+            }
+        }
+        if (outfile.fail()) {
+            throw std::runtime_error("Error writing matrix data to file: " + filename);
+        }
+        outfile.close();
+    }
+
+    // Re-lays the storage out in tile_rows x tile_cols tiles (see
+    // MatrixLayout). Element access, display() and the save functions keep
+    // working in row-major terms; data_ptr() points to the first tile.
+    void to_tiled(int tile_rows, int tile_cols) {
+        static_assert(std::is_trivially_copyable_v<T>, "Tiled storage requires a trivially copyable element type.");
+        if (tile_rows <= 0 || tile_cols <= 0) {
+            throw std::invalid_argument("Tile dimensions must be positive.");
+        }
+        if (storage_layout == MatrixLayout::tiled) {
+            if (tile_rows == tile_m && tile_cols == tile_n) {
+                return;
+            }
+            to_row_major();
+        }
+
+        const size_t per_line = std::max<size_t>(1, MATRIX_TILE_ALIGNMENT / sizeof(T));
+        const size_t stride = (static_cast<size_t>(tile_rows) * tile_cols + per_line - 1) / per_line * per_line;
+        const int tiles_per_row = (n + tile_cols - 1) / tile_cols;
+        const size_t count = static_cast<size_t>((m + tile_rows - 1) / tile_rows) * tiles_per_row * stride;
+
+        T* tiles = nullptr;
+        if (count > 0) {
+            tiles = allocate_aligned(count);
+            std::fill(tiles, tiles + count, T());
+            for (int i = 0; i < m; ++i) {
+                const T* src = data + static_cast<size_t>(i) * n;
+                T* dst = tiles + static_cast<size_t>(i / tile_rows) * tiles_per_row * stride
+                       + static_cast<size_t>(i % tile_rows) * tile_cols;
+                for (int c = 0; c < n; c += tile_cols, dst += stride) {
+                    std::copy(src + c, src + c + std::min(tile_cols, n - c), dst);
+                }
+            }
+        }
+
+        const int rows = m, cols = n;
+        release();
+        m = rows;
+        n = cols;
+        data = tiles;
+        aligned = tiles != nullptr;
+        storage_layout = MatrixLayout::tiled;
+        tile_m = tile_rows;
+        tile_n = tile_cols;
+        tile_cols_n = tiles_per_row;
+        tile_size = stride;
+    }
+
+    // Converts tiled storage back to plain row-major storage.
+    void to_row_major() {
+        if (storage_layout == MatrixLayout::row_major) {
+            return;
+        }
+        T* rows_data = nullptr;
+        if (data != nullptr) {
+            rows_data = new T[static_cast<size_t>(m) * n];
+            for (int i = 0; i < m; ++i) {
+                copy_row(i, rows_data + static_cast<size_t>(i) * n);
+            }
+        }
+        const int rows = m, cols = n;
+        release();
+        m = rows;
+        n = cols;
+        data = rows_data;
+    }
+
+    // Moves the storage to fresh, untouched pages and fills them in parallel:
+    // num_threads threads each call on_start(t) (to bind themselves to worker
+    // t's CPU) and copy the row blocks b of block_rows rows with
+    // b % num_threads == t. Under the kernel's first-touch policy each block
+    // then lives on the node of the thread that copied it. In the tiled layout
+    // block_rows must be a multiple of tile_rows().
+    void first_touch(int block_rows, int num_threads, const std::function<void(int)>& on_start) {
+        if (block_rows <= 0 || num_threads <= 0) {
+            throw std::invalid_argument("Block rows and thread count must be positive.");
+        }
+        if (storage_layout == MatrixLayout::tiled && block_rows % tile_m != 0) {
+            throw std::invalid_argument("Row blocks must hold whole tile rows.");
+        }
+        const size_t count = storage_size();
+        if (data == nullptr || count == 0) {
+            return;
+        }
+
+        // Neither allocation touches the pages (T is not initialized).
+        T* fresh = aligned ? allocate_aligned(count) : new T[count];
+        const int num_blocks = (m + block_rows - 1) / block_rows;
+        auto block_begin = [&](int b) {
+            if (b >= num_blocks) {
+                return count;
+            }
+            return storage_layout == MatrixLayout::row_major
+                       ? static_cast<size_t>(b) * block_rows * n
+                       : static_cast<size_t>(b) * (block_rows / tile_m) * tile_cols_n * tile_size;
+        };
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([&, t] {
+                on_start(t);
+                for (int b = t; b < num_blocks; b += num_threads) {
+                    std::copy(data + block_begin(b), data + block_begin(b + 1), fresh + block_begin(b));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        const int rows = m, cols = n;
+        const MatrixLayout layout = storage_layout;
+        const int tm = tile_m, tn = tile_n, tcols = tile_cols_n;
+        const size_t tsize = tile_size;
+        const bool was_aligned = aligned;
+        release();
+        m = rows;
+        n = cols;
+        data = fresh;
+        aligned = was_aligned;
+        storage_layout = layout;
+        tile_m = tm;
+        tile_n = tn;
+        tile_cols_n = tcols;
+        tile_size = tsize;
+    }
+
+    MatrixLayout layout() const { return storage_layout; }
+    int tile_rows() const { return tile_m; }
+    int tile_cols() const { return tile_n; }
+    int tiles_per_row() const { return tile_cols_n; }
+    size_t tile_stride() const { return tile_size; }
+
+    // Storage offset of element (row, col) in the current layout.
+    inline size_t index(int row, int col) const {
+        if (storage_layout == MatrixLayout::row_major) {
+            return static_cast<size_t>(row) * n + col;
+        }
+        return (static_cast<size_t>(row / tile_m) * tile_cols_n + col / tile_n) * tile_size
+             + static_cast<size_t>(row % tile_m) * tile_n + col % tile_n;
+    }
+
+    // True if the elements live in a file mapping rather than on the heap.
+    bool is_mapped() const { return map_base != nullptr; }
+
+    // Accessor methods.
+    int rows() const { return m; }
+    int cols() const { return n; }
+
+    // Element access operators.
+    T& operator()(int row, int col) {
+        if (row < 0 || row >= m || col < 0 || col >= n) {
+            throw std::out_of_range("Matrix indices out of range");
+        }
+        return data[index(row, col)];
+    }
+
+    const T& operator()(int row, int col) const {
+        if (row < 0 || row >= m || col < 0 || col >= n) {
+            throw std::out_of_range("Matrix indices out of range");
+        }
+        return data[index(row, col)];
+    }
+
+    // Inline getter.
+    inline T get(int row, int col) const {
+        return data[index(row, col)];
+    }
+
+    // Inline setter.
+    inline void set(int row, int col, T value) {
+        data[index(row, col)] = value;
+    }
+
+    // Return raw pointer to the storage (non-const and const); row-major
+    // unless the matrix has been converted with to_tiled().
+    inline T* data_ptr() {
+        return data;
+    }
+
+    inline const T* data_ptr() const {
+        return data;
+    }
+
+    // Display the matrix.
+    void display() const {
+        if (m == 0 || n == 0 || data == nullptr) {
+            std::cerr << "Matrix is not allocated.\n";
+            return;
+        }
+
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                std::cout << get(i, j) << " ";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    // Save the matrix to a file.
+    void save(const std::string& filename) const {
+        if (m == 0 || n == 0 || data == nullptr) {
+            std::cerr << "Matrix is not allocated.\n";
+            return;
+        }
+
+        std::ofstream outfile(filename);
+        if (!outfile.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+
+        // Enough digits for read_matrix() to recover every value exactly.
+        outfile.precision(std::numeric_limits<T>::max_digits10);
+
+        // Write the matrix data.
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                outfile << get(i, j);
+                if (j < n - 1) {
+                    outfile << " ";
+                }
+            }
+            outfile << "\n";
+            if (outfile.fail()) {
+                throw std::runtime_error("Error writing matrix data to file: " + filename);
+            }
+        }
+        outfile.close();
+    }
+};
+
+class DependencyTable {
+    size_t m;        // Number of rows
+    size_t n;        // Number of columns
+    bool* data;      // Pointer to the dynamically allocated bool array
+
+    public:
+    // Default constructor
+    DependencyTable() : m(0), n(0), data(nullptr) {}
+
+    // Constructor: Initializes the dependency table with given rows and columns
+    DependencyTable(size_t total_task_rows, size_t total_task_cols) : m(0), n(0), data(nullptr) {
+        init(total_task_rows, total_task_cols);
+    }
+
+    // Destructor: Frees the dynamically allocated memory
+    ~DependencyTable() {
+        delete[] data;
+    }
+
+    // Deleted copy constructor and copy assignment to prevent accidental copying
+    DependencyTable(const DependencyTable&) = delete;
+    DependencyTable& operator=(const DependencyTable&) = delete;
+
+    // Move constructor
+    DependencyTable(DependencyTable&& other) noexcept
+        : m(other.m), n(other.n), data(other.data) {
+        other.m = 0;
+        other.n = 0;
+        other.data = nullptr;
+    }
+
+    // Move assignment operator
+    DependencyTable& operator=(DependencyTable&& other) noexcept {
+        if (this != &other) {
+            delete[] data;
+            m = other.m;
+            n = other.n;
+            data = other.data;
+
+            other.m = 0;
+            other.n = 0;
+            other.data = nullptr;
+        }
+        return *this;
+    }
+
+    // Initializes the dependency table with given rows and columns
+    void init(size_t total_task_rows, size_t total_task_cols) {
+        delete[] data; // Clean up existing data if any
+        m = total_task_rows;
+        n = total_task_cols;
+        data = new bool[m * n]();
+
+        for (size_t i = 0; i < m * n; ++i) {
+            data[i] = false;
+        }
+    }
+
+    // Retrieves the dependency value at (i, j)
+    inline bool getDependency(size_t i, size_t j) const {
+        size_t idx =  i * n + j;
+        return data[idx];
+    }
+
+    // Sets the dependency value at (i, j)
+    inline void setDependency(size_t i, size_t j, bool value) {
+        size_t idx =  i * n + j;
+        data[idx] = value;
+    }
+
+    // Overloaded operator() for safe indexing
+    bool operator()(size_t i, size_t j) const {
+        if (i >= m || j >= n) {
+            throw std::out_of_range("Index out of bounds: (" + std::to_string(i) + ", " + std::to_string(j) + ")");
+        }
+        return getDependency(i, j);
+    }
+
+    // Overloaded operator() for safe setting with bounds checking
+    void operator()(size_t i, size_t j, bool value) {
+        if (i >= m || j >= n) {
+            throw std::out_of_range("Index out of bounds: (" + std::to_string(i) + ", " + std::to_string(j) + ")");
+        }
+        setDependency(i, j, value);
+    }
+
+    // Prints the dependency table
+    void printDependencyTable(std::ostream &os = std::cout) const {
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                os << (getDependency(i, j) ? "1 " : "0 ");
+            }
+            os << "\n";
+        }
+    }
+
+    // Accessors for rows and columns
+    size_t rows() const { return m; }
+    size_t cols() const { return n; }
+
+};
+
+// Storage layout of DependencyTableAtomic.
+//  packed:      one byte per entry, row-major; neighbouring rows can share a
+//               cache line when the table has fewer than 64 columns.
+//  row_aligned: every row starts on its own cache line. A row's entries are
+//               written in order by that row block's dependency chain, so a
+//               line is never written by two concurrently running tasks.
+//  padded:      one cache line per entry; no sharing at all, at 64x the memory.
+enum class DependencyLayout {
+    packed,
+    row_aligned,
+    padded
+};
+
+class DependencyTableAtomic {
+    static constexpr size_t CACHE_LINE = 64;
+
+    size_t m;                   // Number of rows
+    size_t n;                   // Number of columns
+    size_t row_stride;          // Distance between rows, in entries
+    size_t entry_stride;        // Distance between columns, in entries
+    size_t capacity;            // Number of allocated entries
+    DependencyLayout table_layout;
+    std::atomic<bool>* data;    // Cache-line aligned atomic<bool> array
+
+    static std::atomic<bool>* allocate(size_t count) {
+        void* raw = ::operator new[](count * sizeof(std::atomic<bool>), std::align_val_t(CACHE_LINE));
+        return static_cast<std::atomic<bool>*>(raw);
+    }
+
+    static void deallocate(std::atomic<bool>* ptr) {
+        if (ptr != nullptr) {
+            ::operator delete[](static_cast<void*>(ptr), std::align_val_t(CACHE_LINE));
+        }
+    }
+
+    inline size_t index(size_t i, size_t j) const {
+        return i * row_stride + j * entry_stride;
+    }
+
+public:
+    // Default constructor
+    DependencyTableAtomic()
+        : m(0), n(0), row_stride(0), entry_stride(1), capacity(0),
+          table_layout(DependencyLayout::row_aligned), data(nullptr) {}
+
+    // Constructor: Initializes the dependency table with given rows and columns
+    DependencyTableAtomic(size_t total_task_rows, size_t total_task_cols,
+                          DependencyLayout layout = DependencyLayout::row_aligned)
+        : DependencyTableAtomic()
+    {
+        init(total_task_rows, total_task_cols, layout);
+    }
+
+    // Destructor: Frees the dynamically allocated memory
+    ~DependencyTableAtomic() {
+        deallocate(data);
+    }
+
+    // Deleted copy constructor and copy assignment to prevent accidental copying
+    DependencyTableAtomic(const DependencyTableAtomic&) = delete;
+    DependencyTableAtomic& operator=(const DependencyTableAtomic&) = delete;
+
+    // Move constructor
+    DependencyTableAtomic(DependencyTableAtomic&& other) noexcept
+        : m(other.m), n(other.n), row_stride(other.row_stride), entry_stride(other.entry_stride),
+          capacity(other.capacity), table_layout(other.table_layout), data(other.data)
+    {
+        other.m = 0;
+        other.n = 0;
+        other.row_stride = 0;
+        other.capacity = 0;
+        other.data = nullptr;
+    }
+
+    // Move assignment operator
+    DependencyTableAtomic& operator=(DependencyTableAtomic&& other) noexcept {
+        if (this != &other) {
+            deallocate(data);
+            m = other.m;
+            n = other.n;
+            row_stride = other.row_stride;
+            entry_stride = other.entry_stride;
+            capacity = other.capacity;
+            table_layout = other.table_layout;
+            data = other.data;
+
+            other.m = 0;
+            other.n = 0;
+            other.row_stride = 0;
+            other.capacity = 0;
+            other.data = nullptr;
+        }
+        return *this;
+    }
+
+    // Initializes the dependency table with given rows and columns
+    void init(size_t total_task_rows, size_t total_task_cols,
+              DependencyLayout layout = DependencyLayout::row_aligned) {
+        // Clean up existing data if any
+        deallocate(data);
+        data = nullptr;
+
+        m = total_task_rows;
+        n = total_task_cols;
+        table_layout = layout;
+
+        switch (layout) {
+            case DependencyLayout::packed:
+                entry_stride = 1;
+                row_stride = n;
+                break;
+            case DependencyLayout::row_aligned:
+                entry_stride = 1;
+                row_stride = (n + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+                break;
+            case DependencyLayout::padded:
+                entry_stride = CACHE_LINE;
+                row_stride = n * CACHE_LINE;
+                break;
+        }
+
+        // Allocate new storage for atomic<bool>, rounded up to whole lines
+        capacity = (m * row_stride + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        if (capacity > 0) {
+            data = allocate(capacity);
+        }
+
+        // Initialize all values (padding included) to false
+        for (size_t i = 0; i < capacity; ++i) {
+            new (&data[i]) std::atomic<bool>(false);
+        }
+    }
+
+    // Sets every entry back to false, keeping the storage, so the table can be
+    // used for another run of the same shape.
+    void reset() {
+        for (size_t i = 0; i < capacity; ++i) {
+            data[i].store(false, std::memory_order_relaxed);
+        }
+    }
+
+    // Retrieves the dependency value at (i, j). The acquire load pairs with the
+    // release store in setDependency, so a reader that sees true also sees the
+    // tile updates made by the task that completed (i, j).
+    inline bool getDependency(size_t i, size_t j) const {
+        return data[index(i, j)].load(std::memory_order_acquire);
+    }
+
+    // Sets the dependency value at (i, j) with release ordering, publishing the
+    // writer's prior tile updates to readers that acquire this entry.
+    inline void setDependency(size_t i, size_t j, bool value) {
+        data[index(i, j)].store(value, std::memory_order_release);
+    }
+
+    // Overloaded operator() for safe indexing (read)
+    bool operator()(size_t i, size_t j) const {
+        if (i >= m || j >= n) {
+            throw std::out_of_range("Index out of bounds: (" + std::to_string(i)
+                                    + ", " + std::to_string(j) + ")");
+        }
+        return getDependency(i, j);
+    }
+
+    // Overloaded operator() for safe setting (write)
+    void operator()(size_t i, size_t j, bool value) {
+        if (i >= m || j >= n) {
+            throw std::out_of_range("Index out of bounds: (" + std::to_string(i)
+                                    + ", " + std::to_string(j) + ")");
+        }
+        setDependency(i, j, value);
+    }
+
+    // Prints the dependency table
+     void printDependencyTable(std::ostream &os = std::cout) const {
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                bool val = getDependency(i, j);
+                os << (val ? "1 " : "0 ");
+            }
+            os << "\n";
+        }
+    }
+
+    // Accessors for rows and columns
+    size_t rows() const { return m; }
+    size_t cols() const { return n; }
+    DependencyLayout layout() const { return table_layout; }
+    // Bytes of storage backing the table.
+    size_t footprint() const { return capacity * sizeof(std::atomic<bool>); }
+};
+
+// One cell of the task grid. Tile bounds and indices are 32-bit, so a task
+// fits in 40 bytes and the arena stays dense.
+struct Task {
+    uint32_t row_start;
+    uint32_t row_end;
+    uint32_t col_start;
+    uint32_t col_end;
+    uint32_t chunk_idx_i;
+    uint32_t chunk_idx_j;
+    uint32_t priority;
+    // Unmet predecessors: the left neighbour (i, j-1) and, for type-2 tasks,
+    // the type-1 task that factorizes panel j. The thread whose completion
+    // drops this to zero is the one that makes the task ready.
+    std::atomic<int> deps_remaining;
+    uint32_t graph;            // TaskTable::graphId() of the owning table
+    unsigned char type;
+    unsigned char num_deps;
+    bool enq_nxt_t1;
+};
+
+// How TaskTable materializes the task grid.
+//   eager: every task is built by init(), in one arena.
+//   lazy:  a task column (all row blocks of one panel) is built when its
+//          first dependency is released and recycled once all its tasks
+//          have completed, so only a sliding window of columns is alive.
+enum class TaskGraphMode {
+    eager,
+    lazy
+};
+
+inline const char* task_graph_mode_name(TaskGraphMode mode) {
+    return mode == TaskGraphMode::lazy ? "lazy" : "eager";
+}
+
+inline TaskGraphMode parse_task_graph_mode(const std::string& text) {
+    if (text == "eager") {
+        return TaskGraphMode::eager;
+    }
+    if (text == "lazy") {
+        return TaskGraphMode::lazy;
+    }
+    throw std::invalid_argument("Unknown task graph mode: " + text);
+}
+
+class TaskTable {
+private:
+    int m;                     // number of task rows
+    int n;                     // number of task columns
+    int num_tasks = 0;         // number of non-empty cells
+    int alpha = 1;
+    int beta = 1;
+    int beta_div_alpha = 1;
+    int mat_rows = 0;          // rows of the matrix, for the task bounds
+    int mat_pivots = 0;        // min(rows, columns): one reflector per pivot row
+    uint32_t graph_id = 0;     // Copied into every Task::graph
+    TaskGraphMode graph_mode = TaskGraphMode::eager;
+    // Task rows this table runs: i % num_owners == owner (see setRowOwner).
+    int num_owners = 1;
+    int owner = 0;
+
+    // Eager mode. The non-empty cells of task row i are exactly j < row_len(i),
+    // so the tasks live row by row in one arena and cell (i, j) is
+    // tasks[row_offset[i] + j]; row_offset has m + 1 entries.
+    std::unique_ptr<Task[]> tasks;
+    std::vector<uint32_t> row_offset;
+
+    // Lazy mode. Column j holds the cells of task rows first_row(j) .. m - 1,
+    // in a slab of m tasks. A slab is taken from the free list (or allocated)
+    // when the column is first released and returned when its last task
+    // completes; column pointers are published with release ordering once the
+    // tasks are initialized.
+    struct ColumnSlab {
+        std::unique_ptr<Task[]> tasks;
+        std::atomic<int> completed{0};
+    };
+    struct LazyColumns {
+        std::unique_ptr<std::atomic<ColumnSlab*>[]> columns;    // n entries
+        std::vector<std::unique_ptr<ColumnSlab>> slabs;         // Every slab ever allocated
+        std::vector<ColumnSlab*> free_slabs;
+        std::mutex mutex;                                       // Guards slabs and free_slabs
+        int live = 0;                                           // Columns currently alive
+        int peak = 0;
+    };
+    std::unique_ptr<LazyColumns> lazy;
+
+    int row_len(int i) const { return std::min((i + 1) * beta_div_alpha, n); }
+    int first_row(int j) const { return j / beta_div_alpha; }
+    // First task row at or after i that this table owns.
+    int next_owned_row(int i) const { return i + ((owner - i) % num_owners + num_owners) % num_owners; }
+    // Owned task rows in [first, m).
+    int owned_rows_from(int first) const {
+        const int k = next_owned_row(first);
+        return k < m ? (m - 1 - k) / num_owners + 1 : 0;
+    }
+
+    // Fills in cell (i, j), which must be non-empty.
+    void init_task(Task* t, int i, int j) const {
+        // Type-1 cells are the last beta/alpha cells of each row; enq_nxt_t1
+        // marks the type-2 cells below the previous row's type-1 cells.
+        if (i * beta_div_alpha <= j && j < (i+1) * beta_div_alpha) {
+            t->type = 1;
+            t->enq_nxt_t1 = false;
+        } else {
+            t->type = 2;
+            t->enq_nxt_t1 = (i-1) * beta_div_alpha <= j && j < i * beta_div_alpha;
+        }
+
+        // Set the boundaries for the task.
+        t->row_start   = alpha * j + 1;
+        t->row_end     = std::min(alpha *(j + 1) + 1, mat_pivots);
+        t->col_start   = beta * i + 1;
+        t->col_end     = std::min(beta  *(i + 1) + 1, mat_rows);
+        t->chunk_idx_i = i;
+        t->chunk_idx_j = j;
+        t->graph       = graph_id;
+
+        // bottomL = (total_task_rows - 1 - i) + (total_task_cols - 1 - j) + 1
+        t->priority = (m - 1 - i) + (n - 1 - j) + 1;
+        t->num_deps = (j > 0 ? 1 : 0) + (t->type == 2 ? 1 : 0);
+        t->deps_remaining.store(t->num_deps, std::memory_order_relaxed);
+    }
+
+    // Slab of column j, building the column if it is not alive yet.
+    ColumnSlab* acquire_column(int j) const {
+        ColumnSlab* slab = lazy->columns[j].load(std::memory_order_acquire);
+        if (slab != nullptr) {
+            return slab;
+        }
+
+        std::lock_guard<std::mutex> lock(lazy->mutex);
+        slab = lazy->columns[j].load(std::memory_order_acquire);
+        if (slab != nullptr) {
+            return slab;
+        }
+        if (!lazy->free_slabs.empty()) {
+            slab = lazy->free_slabs.back();
+            lazy->free_slabs.pop_back();
+        } else {
+            lazy->slabs.push_back(std::make_unique<ColumnSlab>());
+            slab = lazy->slabs.back().get();
+            slab->tasks.reset(new Task[m]());
+        }
+        for (int i = first_row(j); i < m; ++i) {
+            init_task(&slab->tasks[i - first_row(j)], i, j);
+        }
+        slab->completed.store(0, std::memory_order_relaxed);
+        lazy->columns[j].store(slab, std::memory_order_release);
+        lazy->peak = std::max(lazy->peak, ++lazy->live);
+        return slab;
+    }
+
+    // Counts t as completed and recycles its column after the last task.
+    // Nothing may touch t afterwards.
+    void retire(const Task* t) const {
+        const int j = t->chunk_idx_j;
+        ColumnSlab* slab = lazy->columns[j].load(std::memory_order_acquire);
+        if (slab->completed.fetch_add(1, std::memory_order_acq_rel) + 1 == owned_rows_from(first_row(j))) {
+            std::lock_guard<std::mutex> lock(lazy->mutex);
+            lazy->columns[j].store(nullptr, std::memory_order_relaxed);
+            lazy->free_slabs.push_back(slab);
+            --lazy->live;
+        }
+    }
+
+public:
+    TaskTable()
+        : m(0), n(0)
+    {
+        // The arena is initially empty.
+    }
+
+    // Parameterized constructor that calls init().
+    template <typename T>
+    TaskTable(int total_task_rows, int total_task_cols, int alpha, int beta, matrix_t<T>& mat,
+              TaskGraphMode mode = TaskGraphMode::eager, uint32_t graph = 0)
+        : m(0), n(0)
+    {
+        init(total_task_rows, total_task_cols, alpha, beta, mat, mode, graph);
+    }
+
+    // Disallow copy construction and copy assignment.
+    TaskTable(const TaskTable&) = delete;
+    TaskTable& operator=(const TaskTable&) = delete;
+
+    // (Optional) Use default move construction and move assignment.
+    TaskTable(TaskTable&&) noexcept = default;
+    TaskTable& operator=(TaskTable&&) noexcept = default;
+
+    // Grid of an m x n matrix: row blocks of beta rows and panels of alpha
+    // pivots, with one pivot per row up to min(m, n). Block and panel
+    // boundaries sit at 1 + multiples of beta and alpha, so row 0 joins the
+    // first of each and a partial last block or panel is kept.
+    static int task_rows(int m, int beta) { return std::max(1, (m - 1 + beta - 1) / beta); }
+    static int task_cols(int m, int n, int alpha) {
+        return std::max(1, (std::min(m, n) - 1 + alpha - 1) / alpha);
+    }
+
+    // graph tags the tasks, so that a scheduler running several tables at
+    // once can tell which one a task belongs to.
+    template <typename T>
+    void init(int total_task_rows, int total_task_cols, int alpha, int beta, matrix_t<T>& mat,
+              TaskGraphMode mode = TaskGraphMode::eager, uint32_t graph = 0) {
+        init(total_task_rows, total_task_cols, alpha, beta, mat.rows(), mat.cols(), mode, graph);
+    }
+
+    // The same for a rows x cols matrix that is not held in a matrix_t (an
+    // out-of-core run, see out_of_core.h).
+    void init(int total_task_rows, int total_task_cols, int alpha, int beta, int rows, int cols,
+              TaskGraphMode mode = TaskGraphMode::eager, uint32_t graph = 0) {
+        m = total_task_rows;
+        n = total_task_cols;
+        this->alpha = alpha;
+        this->beta = beta;
+        beta_div_alpha = beta / alpha;
+        mat_rows = rows;
+        mat_pivots = std::min(rows, cols);
+        graph_mode = mode;
+        graph_id = graph;
+        tasks.reset();
+        row_offset.clear();
+        lazy.reset();
+
+        // Row i holds the cells j < (i + 1) * beta_div_alpha.
+        uint64_t total = 0;
+        for (int i = 0; i < m; ++i) {
+            total += row_len(i);
+            if (total > std::numeric_limits<uint32_t>::max()) {
+                throw std::length_error("TaskTable: too many tasks for 32-bit indices.");
+            }
+        }
+        num_tasks = static_cast<int>(total);
+
+        if (mode == TaskGraphMode::lazy) {
+            lazy = std::make_unique<LazyColumns>();
+            lazy->columns.reset(new std::atomic<ColumnSlab*>[n]());
+            // The root task's column is alive from the start.
+            if (m > 0 && n > 0) {
+                acquire_column(0);
+            }
+            return;
+        }
+
+        row_offset.assign(m + 1, 0);
+        for (int i = 0; i < m; ++i) {
+            row_offset[i + 1] = row_offset[i] + row_len(i);
+        }
+        tasks.reset(num_tasks > 0 ? new Task[num_tasks]() : nullptr);
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < row_len(i); ++j) {
+                init_task(&tasks[row_offset[i] + j], i, j);
+            }
+        }
+    }
+
+    // Task at (i, j), or nullptr for a cell above the staircase (or, in lazy
+    // mode, a cell whose column is not alive). O(1).
+    inline Task* getTask(int i, int j) const {
+        if (j >= row_len(i)) {
+            return nullptr;
+        }
+        if (lazy) {
+            ColumnSlab* slab = lazy->columns[j].load(std::memory_order_acquire);
+            return slab != nullptr ? &slab->tasks[i - first_row(j)] : nullptr;
+        }
+        return &tasks[row_offset[i] + j];
+    }
+
+    // Marks one dependency of task (i, j) as met. Returns the task if this call
+    // satisfied its last dependency (so the caller must schedule it), and
+    // nullptr otherwise or if the cell holds no task.
+    inline Task* releaseDependency(int i, int j) const {
+        Task* t = nullptr;
+        if (lazy && j < row_len(i)) {
+            t = &acquire_column(j)->tasks[i - first_row(j)];
+        } else {
+            t = getTask(i, j);
+        }
+        if (t != nullptr && t->deps_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            return t;
+        }
+        return nullptr;
+    }
+
+    // Releases the successors of a completed task, calling ready(Task*) for each
+    // one whose last dependency this completion satisfied. The right neighbour
+    // continues the task's row-block chain (for a type-1 task it is the next
+    // panel, so it is released first); a type-1 task also unblocks the type-2
+    // tasks below it in its panel. In lazy mode t may be recycled once this
+    // returns.
+    template <typename ReadyFn>
+    inline void releaseSuccessors(const Task* t, ReadyFn&& ready) const {
+        int i = t->chunk_idx_i;
+        int j = t->chunk_idx_j;
+        if (j + 1 < n) {
+            if (Task* next = releaseDependency(i, j + 1)) {
+                ready(next);
+            }
+        }
+        if (t->type == 1) {
+            releasePanel(i, j, ready);
+        }
+        if (lazy) {
+            retire(t);
+        }
+    }
+
+    // Releases the type-2 tasks of panel j in the owned task rows below row
+    // i, whose type-1 task has completed: locally from releaseSuccessors(),
+    // or on another process when the panel arrives (mpi_main.cpp).
+    template <typename ReadyFn>
+    inline void releasePanel(int i, int j, ReadyFn&& ready) const {
+        for (int k = next_owned_row(i + 1); k < m; k += num_owners) {
+            if (Task* next = releaseDependency(k, j)) {
+                ready(next);
+            }
+        }
+    }
+
+    // Distributed runs spread the task rows, and with them the row blocks of
+    // the matrix, cyclically over num_owners processes: task row i belongs
+    // to process i % num_owners. This table then only releases and counts
+    // the rows of owner; every task row of a single-process run is owned.
+    // Call before the graph runs.
+    void setRowOwner(int owners, int which) {
+        if (owners < 1 || which < 0 || which >= owners) {
+            throw std::invalid_argument("TaskTable: invalid row owner.");
+        }
+        num_owners = owners;
+        owner = which;
+    }
+
+    bool ownsRow(int i) const { return i % num_owners == owner; }
+
+    // Tasks in the owned task rows; numTasks() for a single process.
+    int ownedTasks() const {
+        int count = 0;
+        for (int i = next_owned_row(0); i < m; i += num_owners) {
+            count += row_len(i);
+        }
+        return count;
+    }
+
+    // Restores every task's dependency count so the graph can be run again.
+    // In lazy mode, after a complete run, this rebuilds the root column.
+    void resetDependencies() {
+        if (lazy) {
+            std::lock_guard<std::mutex> lock(lazy->mutex);
+            for (int j = 0; j < n; ++j) {
+                if (ColumnSlab* slab = lazy->columns[j].exchange(nullptr, std::memory_order_relaxed)) {
+                    lazy->free_slabs.push_back(slab);
+                    --lazy->live;
+                }
+            }
+        } else {
+            for (int k = 0; k < num_tasks; ++k) {
+                tasks[k].deps_remaining.store(tasks[k].num_deps, std::memory_order_relaxed);
+            }
+        }
+        if (lazy && m > 0 && n > 0) {
+            acquire_column(0);
+        }
+    }
+
+    // Resumes a partly run graph on a table fresh from init() (see
+    // checkpoint.h): every task for which done(i, j) holds counts as
+    // completed and releases its successors, and ready(Task*) is called for
+    // each remaining task whose dependencies are then all met, the root
+    // included if it is not done. The done cells must be closed under
+    // dependencies, as the completed cells of a paused run are. Returns the
+    // number of done tasks.
+    template <typename DoneFn, typename ReadyFn>
+    int restoreCompleted(DoneFn&& done, ReadyFn&& ready) const {
+        auto cell = [this](int i, int j) {
+            return lazy ? &acquire_column(j)->tasks[i - first_row(j)] : getTask(i, j);
+        };
+        if (m > 0 && n > 0 && ownsRow(0) && !done(0, 0)) {
+            ready(cell(0, 0));
+        }
+        int completed = 0;
+        for (int j = 0; j < n; ++j) {
+            for (int i = next_owned_row(first_row(j)); i < m; i += num_owners) {
+                if (!done(i, j)) {
+                    continue;
+                }
+                releaseSuccessors(cell(i, j), [&done, &ready](Task* next) {
+                    if (!done(next->chunk_idx_i, next->chunk_idx_j)) {
+                        ready(next);
+                    }
+                });
+                ++completed;
+            }
+        }
+        return completed;
+    }
+
+    // Overloaded operator() for accessing the task at (i, j) with bounds checking.
+    Task* operator()(int i, int j) const {
+        if (i >= m || j >= n)
+            throw std::out_of_range("Index out of bounds in TaskTable::operator()");
+        return getTask(i, j);
+    }
+
+    // Prints the task table.
+    // For each cell, it prints the task type (or "N" if the pointer is nullptr).
+    void printTaskTable() const {
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j < n; ++j) {
+                Task* t = getTask(i, j);
+                if (t)
+                    std::cout << static_cast<int>(t->priority) << " ";
+                else
+                    std::cout << "N ";
+            }
+            std::cout << "\n";
+        }
+    }
+
+    // Accessors for the number of rows and columns.
+    int rows() const { return m; }
+    int cols() const { return n; }
+    // Number of tasks in the graph.
+    int numTasks() const { return num_tasks; }
+    TaskGraphMode mode() const { return graph_mode; }
+    uint32_t graphId() const { return graph_id; }
+    // Most tasks that were alive at once: all of them in eager mode, the peak
+    // window of columns times m in lazy mode.
+    size_t peakTasks() const {
+        return lazy ? static_cast<size_t>(lazy->peak) * m : static_cast<size_t>(num_tasks);
+    }
+};
+
+template <class T>
+class CircularQueueMtx {
+    std::vector<T> buffer;      // Internal storage.
+    const size_t capacity;      // Maximum number of elements.
+    size_t front;               // Index of the first element.
+    size_t rear;                // Index one past the last element.
+    size_t count;               // Number of elements in the queue.
+    mutable std::mutex mutex;   // Mutex for thread-safety.
+
+    public:
+    // Construct a circular queue with fixed capacity.
+    explicit CircularQueueMtx(size_t capacity)
+        : buffer(capacity), capacity(capacity),
+          front(0), rear(0), count(0)
+    { }
+
+    // Returns true if the queue is empty.
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count == 0;
+    }
+
+    // Returns true if the queue is full.
+    bool full() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count == capacity;
+    }
+
+    // Returns the current number of elements.
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return count;
+    }
+
+    // Push an element at the front of the queue.
+    // Returns true if the operation was successful (i.e. the queue wasn’t full).
+    bool push_front(const T &value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == capacity) {
+            return false;  // Queue is full.
+        }
+        // Move front backward (circularly) and store the value.
+        front = (front + capacity - 1) % capacity;
+        buffer[front] = value;
+        ++count;
+        return true;
+    }
+
+    // Push an element at the back of the queue.
+    // Returns true if the operation was successful (i.e. the queue wasn’t full).
+    bool push_back(const T &value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == capacity) {
+            return false;  // Queue is full.
+        }
+        buffer[rear] = value;
+        rear = (rear + 1) % capacity;
+        ++count;
+        return true;
+    }
+
+    // An alias for push_back.
+    inline bool push(const T &value) {
+        return push_back(value);
+    }
+
+    // Pop an element from the front.
+    // If the queue is empty, returns std::nullopt.
+    std::optional<T> pop_front() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == 0) {
+            return std::nullopt;  // Queue is empty.
+        }
+        T value = buffer[front];
+        front = (front + 1) % capacity;
+        --count;
+        return value;
+    }
+
+    // Pop an element from the back.
+    // If the queue is empty, returns std::nullopt.
+    std::optional<T> pop_back() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == 0) {
+            return std::nullopt;  // Queue is empty.
+        }
+        rear = (rear + capacity - 1) % capacity;
+        T value = buffer[rear];
+        --count;
+        return value;
+    }
+
+    // An alias for pop_front.
+    std::optional<T> pop() {
+        return pop_front();
+    }
+};
+
+template<class T>
+class CircularQueueAtomic {
+    T* buffer;          // Raw array storage for elements.
+    const size_t capacity;    // Maximum number of elements allowed.
+
+    // Two atomic counters (which may be negative) track the logical indices.
+    std::atomic<int64_t> left;  // Points to the first valid element.
+    std::atomic<int64_t> right; // Points to one past the last valid element.
+
+    // A mutex used only for query operations.
+    mutable std::mutex query_mutex;
+    
+public:
+    // Constructs the deque with the given capacity.
+    // (Capacity is the maximum number of elements that can be stored.)
+    explicit CircularQueueAtomic(size_t cap)
+      : capacity(cap), left(0), right(0)
+    {
+        // Allocate a raw array for storage.
+        buffer = new T[capacity];
+    }
+
+    ~CircularQueueAtomic() {
+        delete[] buffer;
+    }
+
+    // Returns true if the deque is empty.
+    bool empty() const {
+        std::lock_guard<std::mutex> lock(query_mutex);
+        return (right.load(std::memory_order_acquire) - left.load(std::memory_order_acquire)) == 0;
+    }
+
+    // Returns true if the deque is full.
+    bool full() const {
+        std::lock_guard<std::mutex> lock(query_mutex);
+        return (right.load(std::memory_order_acquire) - left.load(std::memory_order_acquire)) >= static_cast<int64_t>(capacity);
+    }
+
+    // Returns the current number of elements.
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(query_mutex);
+        return static_cast<size_t>(right.load(std::memory_order_acquire) - left.load(std::memory_order_acquire));
+    }
+
+    // ---- Lock-free update methods (using atomics & compare_exchange) ----
+
+    // push_back: Append an element at the back.
+    // Returns false if the deque is full.
+    bool push_back(const T &value) {
+        while (true) {
+            int64_t current_right = right.load(std::memory_order_relaxed);
+            int64_t current_left  = left.load(std::memory_order_acquire);
+            if ((current_right - current_left) >= static_cast<int64_t>(capacity))
+                return false;  // full
+
+            if (right.compare_exchange_weak(current_right, current_right + 1,
+                                            std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                size_t index = static_cast<size_t>(current_right % capacity);
+                buffer[index] = value;
+                return true;
+            }
+        }
+    }
+
+    // push_front: Insert an element at the front.
+    // Returns false if the deque is full.
+    bool push_front(const T &value) {
+        while (true) {
+            int64_t current_left  = left.load(std::memory_order_relaxed);
+            int64_t current_right = right.load(std::memory_order_acquire);
+            if ((current_right - current_left) >= static_cast<int64_t>(capacity))
+                return false;  // full
+
+            int64_t new_left = current_left - 1;
+            if (left.compare_exchange_weak(current_left, new_left,
+                                           std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                size_t index = static_cast<size_t>(((new_left % capacity) + capacity) % capacity);
+                buffer[index] = value;
+                return true;
+            }
+        }
+    }
+
+    // pop_front: Remove and return an element from the front.
+    // Returns std::nullopt if the deque is empty.
+    std::optional<T> pop_front() {
+        while (true) {
+            int64_t current_left  = left.load(std::memory_order_relaxed);
+            int64_t current_right = right.load(std::memory_order_acquire);
+            if (current_left == current_right)
+                return std::nullopt;  // empty
+
+            if (left.compare_exchange_weak(current_left, current_left + 1,
+                                           std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                size_t index = static_cast<size_t>(((current_left % capacity) + capacity) % capacity);
+                T value = buffer[index];
+                return value;
+            }
+        }
+    }
+
+    // pop_back: Remove and return an element from the back.
+    // Returns std::nullopt if the deque is empty.
+    std::optional<T> pop_back() {
+        while (true) {
+            int64_t current_right = right.load(std::memory_order_relaxed);
+            int64_t current_left  = left.load(std::memory_order_acquire);
+            if (current_left == current_right)
+                return std::nullopt;  // empty
+
+            int64_t new_right = current_right - 1;
+            if (right.compare_exchange_weak(current_right, new_right,
+                                            std::memory_order_acq_rel, std::memory_order_relaxed))
+            {
+                size_t index = static_cast<size_t>(((new_right % capacity) + capacity) % capacity);
+                T value = buffer[index];
+                return value;
+            }
+        }
+    }
+
+    // push: Alias for push_back so that the deque can be used as a normal FIFO queue.
+    inline bool push(const T &value) {
+        return push_back(value);
+    }
+
+    // pop: Alias for pop_front so that the deque can be used as a normal FIFO queue.
+    inline std::optional<T> pop() {
+        return pop_front();
+    }
+};
+
+// Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", PPoPP 2013). The owning thread pushes
+// and pops at the bottom (LIFO); any other thread may steal from the top
+// (FIFO). The ring buffer grows by doubling when the owner finds it full.
+// Retired buffers are kept until destruction because a concurrent thief may
+// still be reading from one. T must be trivially copyable (e.g. Task*).
+template <class T>
+class ChaseLevDeque {
+    struct Array {
+        size_t mask;
+        std::atomic<T>* slots;
+
+        explicit Array(size_t cap) : mask(cap - 1), slots(new std::atomic<T>[cap]) {}
+        ~Array() { delete[] slots; }
+
+        size_t capacity() const { return mask + 1; }
+        T get(int64_t i) const { return slots[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, const T& value) {
+            slots[static_cast<size_t>(i) & mask].store(value, std::memory_order_relaxed);
+        }
+    };
+
+    // top is contended by thieves, bottom is written by the owner only; keep
+    // them on separate cache lines.
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Array*> array;
+    std::vector<Array*> retired;    // Owner-only
+
+    Array* grow(Array* old, int64_t t, int64_t b) {
+        Array* bigger = new Array(old->capacity() * 2);
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, old->get(i));
+        }
+        retired.push_back(old);
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+public:
+    // Capacity is rounded up to a power of two.
+    explicit ChaseLevDeque(size_t capacity = 1024) : top(0), bottom(0) {
+        size_t cap = 2;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        array.store(new Array(cap), std::memory_order_relaxed);
+    }
+
+    ~ChaseLevDeque() {
+        delete array.load(std::memory_order_relaxed);
+        for (Array* a : retired) {
+            delete a;
+        }
+    }
+
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Approximate element count; exact only when no other thread is active.
+    size_t size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Owner only: push an element at the bottom.
+    void push(const T& value) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(a->capacity()) - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, value);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // Owner only: pop the most recently pushed element.
+    // Returns std::nullopt if the deque is empty or a thief took the last one.
+    std::optional<T> pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // Empty.
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        T value = a->get(b);
+        if (t == b) {
+            // Last element: race the thieves for it.
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+        return value;
+    }
+
+    // Any thread: take the oldest element.
+    // Returns std::nullopt if the deque is empty or the steal lost a race.
+    std::optional<T> steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) {
+            return std::nullopt;
+        }
+
+        Array* a = array.load(std::memory_order_acquire);
+        T value = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return value;
+    }
+};
+
+#endif // BN2_H
@@ -0,0 +1,178 @@
+#ifndef BUCKET_QUEUE_H
+#define BUCKET_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tbb/concurrent_queue.h>
+
+// Priority ready queue for small bounded integer priorities (Task::priority
+// runs from 1 to m + n). One FIFO per priority, plus an atomic hint holding
+// one past the highest bucket that may be non-empty, so a pop is a scan down
+// from the hint to the first non-empty bucket instead of a heap operation.
+// Pops return the highest priority present, FIFO within a priority (spilled
+// elements aside); like tbb::concurrent_priority_queue, concurrent pushes make
+// that approximate.
+// Priorities at or above the bucket count share the top bucket.
+//
+// Each bucket is a bounded lock-free ring (Vyukov's MPMC queue), so pushes and
+// pops do not allocate. The tasks of one priority lie on one anti-diagonal of
+// the task grid, and only a few of them are ready at once; a bucket whose ring
+// is full spills into a TBB queue.
+//
+// The hint's low 32 bits are the bucket bound, the high 32 bits a version
+// that every push bumps. A pop lowers the bound only with a CAS from the value
+// it started scanning at, so it can never lower it past a bucket that was
+// pushed to after the scan went by: that push changed the version.
+template <class T>
+class BucketPriorityQueue {
+    static constexpr size_t RING = 64;
+
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        T value;
+    };
+
+    struct alignas(64) Bucket {
+        std::atomic<uint64_t> enqueue_pos{0};
+        std::atomic<uint64_t> dequeue_pos{0};
+        std::atomic<int64_t> spilled{0};        // Elements in overflow, counted before the push
+        Cell cells[RING];
+        tbb::concurrent_queue<T> overflow;
+
+        Bucket() {
+            for (size_t k = 0; k < RING; k++) {
+                cells[k].seq.store(k, std::memory_order_relaxed);
+            }
+        }
+
+        void push(const T& value) {
+            uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells[pos % RING];
+                int64_t dif = static_cast<int64_t>(cell.seq.load(std::memory_order_acquire) - pos);
+                if (dif == 0) {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        cell.value = value;
+                        cell.seq.store(pos + 1, std::memory_order_release);
+                        return;
+                    }
+                } else if (dif < 0) {
+                    // Full.
+                    spilled.fetch_add(1, std::memory_order_acq_rel);
+                    overflow.push(value);
+                    return;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool empty() const {
+            return enqueue_pos.load(std::memory_order_acquire) == dequeue_pos.load(std::memory_order_acquire) &&
+                   spilled.load(std::memory_order_acquire) == 0;
+        }
+
+        bool try_pop(T& value) {
+            uint64_t pos = dequeue_pos.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells[pos % RING];
+                int64_t dif = static_cast<int64_t>(cell.seq.load(std::memory_order_acquire) - (pos + 1));
+                if (dif == 0) {
+                    if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        value = cell.value;
+                        cell.seq.store(pos + RING, std::memory_order_release);
+                        return true;
+                    }
+                } else if (dif < 0) {
+                    // Empty (or the next push is still being written).
+                    break;
+                } else {
+                    pos = dequeue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            if (spilled.load(std::memory_order_acquire) > 0 && overflow.try_pop(value)) {
+                spilled.fetch_sub(1, std::memory_order_acq_rel);
+                return true;
+            }
+            return false;
+        }
+    };
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t count = 0;
+    alignas(64) std::atomic<uint64_t> hint{0};
+
+    static constexpr uint64_t VERSION = uint64_t(1) << 32;
+    static constexpr uint64_t BOUND = VERSION - 1;
+
+public:
+    explicit BucketPriorityQueue(size_t num_buckets = 1) { reserve(num_buckets); }
+
+    BucketPriorityQueue(const BucketPriorityQueue&) = delete;
+    BucketPriorityQueue& operator=(const BucketPriorityQueue&) = delete;
+
+    // Makes room for priorities [0, num_buckets), keeping the elements.
+    // Not thread-safe.
+    void reserve(size_t num_buckets) {
+        if (num_buckets <= count) {
+            return;
+        }
+        std::unique_ptr<Bucket[]> bigger(new Bucket[num_buckets]);
+        for (size_t b = 0; b < count; b++) {
+            for (T value{}; buckets[b].try_pop(value);) {
+                bigger[b].push(value);
+            }
+        }
+        buckets.swap(bigger);
+        count = num_buckets;
+    }
+
+    size_t num_buckets() const { return count; }
+
+    void push(const T& value, size_t priority) {
+        const uint64_t b = priority < count ? priority : count - 1;
+        buckets[b].push(value);
+
+        uint64_t h = hint.fetch_add(VERSION, std::memory_order_acq_rel) + VERSION;
+        while ((h & BOUND) <= b) {
+            if (hint.compare_exchange_weak(h, (h & ~BOUND) + VERSION + b + 1, std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+                break;
+            }
+        }
+    }
+
+    // Pops an element of the highest non-empty priority. Returns false if
+    // every bucket was empty when scanned.
+    bool try_pop(T& value) {
+        uint64_t h = hint.load(std::memory_order_acquire);
+        const uint64_t top = h & BOUND;
+        for (uint64_t b = top; b-- > 0;) {
+            if (buckets[b].try_pop(value)) {
+                if (b + 1 < top) {
+                    hint.compare_exchange_strong(h, (h & ~BOUND) + b + 1, std::memory_order_acq_rel,
+                                                 std::memory_order_relaxed);
+                }
+                return true;
+            }
+        }
+        if (top > 0) {
+            hint.compare_exchange_strong(h, h & ~BOUND, std::memory_order_acq_rel, std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    // Approximate; exact only when no other thread is active.
+    bool empty() const {
+        for (uint64_t b = hint.load(std::memory_order_acquire) & BOUND; b-- > 0;) {
+            if (!buckets[b].empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif // BUCKET_QUEUE_H
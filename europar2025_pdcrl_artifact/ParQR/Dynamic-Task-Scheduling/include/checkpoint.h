@@ -0,0 +1,543 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+#include "bn2.h"
+#include "downdate.h"
+
+// Binary results and checkpoints of the dynamic scheduler (main.cpp).
+//
+// A binary result (-o with --output-format binary) holds two records of the
+// binary matrix format (see matrix_file_header_t). The first is the factorized
+// m x n matrix. The second is a 2 x m record with the reflector scalars up
+// (row 0) and b (row 1), which apply_qt() and QApplier take with it. With
+// --compress the same bytes are written through gzip, so gunzip gives back a
+// file that read_binary() can map in place. A downdated factorization (see
+// downdate.h) has two records more: a 1 x K int32 record with the stored
+// rows it deleted, and a G x 4 record with one rotation (i, j, c, s) per row.
+//
+// A checkpoint (--checkpoint) is a plain file of the same records, taken
+// while the run is paused at a consistent cut (see CheckpointGate): the run's
+// shape, the matrix as it stands, the reflector scalars, the WY factors and
+// one int32 flag per task cell, 1 for the cells that have completed. It is
+// written to FILE.tmp, synced and renamed over FILE, so a crash mid-write
+// leaves the previous checkpoint intact.
+
+static constexpr double CHECKPOINT_VERSION = 1;
+
+// Sequential writer of binary matrix records to a plain or gzip file.
+class RecordWriter {
+public:
+    RecordWriter(const std::string& path, bool compress) : path(path) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Error opening file for writing: " + path + ": " + std::strerror(errno));
+        }
+        if (compress) {
+            // Huffman coding only: dense floating-point data has few repeats
+            // for LZ77 to find, and skipping the search is several times faster.
+            gz = gzdopen(fd, "wb1h");
+            if (gz == nullptr) {
+                ::close(fd);
+                throw std::runtime_error("Error starting gzip stream: " + path);
+            }
+        }
+    }
+
+    ~RecordWriter() {
+        if (gz != nullptr) {
+            gzclose(gz);
+        } else if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    // Appends a rows x cols record of T, starting on a MATRIX_FILE_ALIGNMENT
+    // boundary of the uncompressed stream.
+    template <typename T>
+    void write(const T* data, uint64_t rows, uint64_t cols) {
+        const uint64_t alignment = MATRIX_FILE_ALIGNMENT;
+        const matrix_file_header_t header = make_matrix_file_header<T>(rows, cols, alignment);
+        std::vector<char> zeros(alignment, 0);
+        if (offset % alignment != 0) {
+            put(zeros.data(), alignment - offset % alignment);
+        }
+        put(&header, sizeof(header));
+        put(zeros.data(), header.data_offset - sizeof(header));
+        put(data, rows * cols * sizeof(T));
+    }
+
+    // Finishes the file; with sync, also flushes it to the device (plain
+    // files only). Throws on any write error.
+    void close(bool sync = false) {
+        int status = 0;
+        if (gz != nullptr) {
+            status = gzclose(gz) == Z_OK ? 0 : -1;
+            gz = nullptr;
+        } else {
+            if (sync && ::fsync(fd) != 0) {
+                status = -1;
+            }
+            status |= ::close(fd);
+        }
+        fd = -1;
+        if (status != 0) {
+            throw std::runtime_error("Error writing " + path + ".");
+        }
+    }
+
+private:
+    void put(const void* bytes, uint64_t len) {
+        const char* p = static_cast<const char*>(bytes);
+        while (len > 0) {
+            const size_t chunk = static_cast<size_t>(std::min<uint64_t>(len, 1u << 30));
+            ssize_t done = 0;
+            if (gz != nullptr) {
+                done = gzwrite(gz, p, static_cast<unsigned>(chunk));
+                if (done <= 0) {
+                    throw std::runtime_error("Error writing " + path + " (gzip).");
+                }
+            } else {
+                done = ::write(fd, p, chunk);
+                if (done < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (done <= 0) {
+                    throw std::runtime_error("Error writing " + path + ": " + std::strerror(errno));
+                }
+            }
+            p += done;
+            len -= static_cast<uint64_t>(done);
+            offset += static_cast<uint64_t>(done);
+        }
+    }
+
+    std::string path;
+    int fd = -1;
+    gzFile gz = nullptr;
+    uint64_t offset = 0;        // Bytes of the uncompressed stream so far
+};
+
+// Sequential reader of the records of a plain or gzip file. A gzip file is
+// inflated into memory; a plain one is read in place.
+class RecordReader {
+public:
+    explicit RecordReader(const std::string& path) : path(path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            throw std::runtime_error("Error opening file: " + path);
+        }
+        size = static_cast<uint64_t>(st.st_size);
+        unsigned char magic[2] = {0, 0};
+        if (::pread(fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+            inflate_all();
+            size = inflated.size();
+        }
+    }
+
+    ~RecordReader() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    RecordReader(const RecordReader&) = delete;
+    RecordReader& operator=(const RecordReader&) = delete;
+
+    // Reads the next record into out, which must hold elements of type T.
+    // Returns false at the end of the file; throws on a malformed record.
+    template <typename T>
+    bool read(std::vector<T>& out, uint64_t& rows, uint64_t& cols) {
+        if (offset >= size) {
+            return false;
+        }
+        matrix_file_header_t header;
+        std::string error;
+        if (size - offset < sizeof(header)) {
+            error = "truncated header";
+        } else {
+            get(offset, &header, sizeof(header));
+            if (std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(MATRIX_FILE_MAGIC)) != 0 ||
+                header.version != MATRIX_FILE_VERSION || header.byte_order != MATRIX_FILE_BYTE_ORDER ||
+                header.alignment == 0 || header.data_offset < sizeof(header)) {
+                error = "bad matrix header";
+            } else if (header.dtype != matrix_dtype<T>() || header.elem_size != sizeof(T)) {
+                error = "unexpected element type (dtype " + std::to_string(header.dtype) + ")";
+            } else if (size - offset - std::min<uint64_t>(size - offset, header.data_offset) <
+                       header.rows * header.cols * sizeof(T)) {
+                error = "truncated data";
+            }
+        }
+        if (!error.empty()) {
+            throw std::runtime_error("Error reading " + path + " at byte " + std::to_string(offset) + ": " + error + ".");
+        }
+        rows = header.rows;
+        cols = header.cols;
+        out.resize(static_cast<size_t>(rows * cols));
+        get(offset + header.data_offset, out.data(), rows * cols * sizeof(T));
+        const uint64_t end = offset + header.data_offset + rows * cols * sizeof(T);
+        offset = (end + header.alignment - 1) / header.alignment * header.alignment;
+        return true;
+    }
+
+private:
+    void inflate_all() {
+        gzFile gz = gzdopen(::dup(fd), "rb");
+        if (gz == nullptr) {
+            throw std::runtime_error("Error opening gzip stream: " + path);
+        }
+        size_t used = 0;
+        inflated.resize(std::max<size_t>(size * 2, 1 << 20));
+        while (true) {
+            if (used == inflated.size()) {
+                inflated.resize(inflated.size() * 2);
+            }
+            const size_t want = std::min<size_t>(inflated.size() - used, 1u << 30);
+            const int got = gzread(gz, inflated.data() + used, static_cast<unsigned>(want));
+            if (got < 0) {
+                gzclose(gz);
+                throw std::runtime_error("Error inflating " + path + ".");
+            }
+            if (got == 0) {
+                break;
+            }
+            used += static_cast<size_t>(got);
+        }
+        gzclose(gz);
+        inflated.resize(used);
+        compressed = true;
+    }
+
+    void get(uint64_t at, void* dst, uint64_t len) {
+        if (compressed) {
+            std::memcpy(dst, inflated.data() + at, static_cast<size_t>(len));
+            return;
+        }
+        char* p = static_cast<char*>(dst);
+        while (len > 0) {
+            const ssize_t got = ::pread(fd, p, static_cast<size_t>(std::min<uint64_t>(len, 1u << 30)),
+                                        static_cast<off_t>(at));
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                throw std::runtime_error("Error reading " + path + ".");
+            }
+            p += got;
+            at += static_cast<uint64_t>(got);
+            len -= static_cast<uint64_t>(got);
+        }
+    }
+
+    std::string path;
+    int fd = -1;
+    bool compressed = false;
+    std::vector<char> inflated;
+    uint64_t size = 0;
+    uint64_t offset = 0;        // Start of the next record
+};
+
+// Writes a factorized matrix and, unless up is empty, its reflector record,
+// followed by the records of a non-empty downdate.
+inline void save_factorization(const std::string& path, const matrix_t<double>& mat, const std::vector<double>& up,
+                               const std::vector<double>& b, bool compress, const Downdate& downdate = Downdate()) {
+    if (mat.layout() != MatrixLayout::row_major) {
+        throw std::invalid_argument("save_factorization needs a row-major matrix.");
+    }
+    if (!downdate.empty() && up.empty()) {
+        throw std::invalid_argument("save_factorization: a downdate needs the reflector record.");
+    }
+    RecordWriter writer(path, compress);
+    writer.write(mat.data_ptr(), mat.rows(), mat.cols());
+    if (!up.empty()) {
+        std::vector<double> scalars(up);
+        scalars.insert(scalars.end(), b.begin(), b.end());
+        writer.write(scalars.data(), 2, up.size());
+    }
+    if (!downdate.empty()) {
+        const std::vector<int32_t> deleted(downdate.deleted.begin(), downdate.deleted.end());
+        writer.write(deleted.data(), 1, deleted.size());
+        std::vector<double> rotations;
+        rotations.reserve(downdate.rotations.size() * 4);
+        for (const Rotation& g : downdate.rotations) {
+            rotations.insert(rotations.end(), {double(g.i), double(g.j), g.c, g.s});
+        }
+        writer.write(rotations.data(), downdate.rotations.size(), 4);
+    }
+    writer.close();
+}
+
+// Reads a file of save_factorization(), plain or compressed. up and b are
+// left empty if it has no reflector record. The downdate records are read
+// into downdate, which is left empty without them; a file that has them
+// cannot be read without a downdate.
+inline void load_factorization(const std::string& path, matrix_t<double>& mat, std::vector<double>& up,
+                               std::vector<double>& b, Downdate* downdate = nullptr) {
+    RecordReader reader(path);
+    std::vector<double> values;
+    uint64_t rows = 0, cols = 0;
+    if (!reader.read(values, rows, cols)) {
+        throw std::runtime_error("Error reading " + path + ": no matrix.");
+    }
+    mat = matrix_t<double>(static_cast<int>(rows), static_cast<int>(cols));
+    std::copy(values.begin(), values.end(), mat.data_ptr());
+    up.clear();
+    b.clear();
+    if (downdate != nullptr) {
+        downdate->clear();
+    }
+    if (!reader.read(values, rows, cols)) {
+        return;
+    }
+    if (rows != 2 || cols != static_cast<uint64_t>(mat.rows())) {
+        throw std::runtime_error("Error reading " + path + ": bad reflector record.");
+    }
+    up.assign(values.begin(), values.begin() + cols);
+    b.assign(values.begin() + cols, values.end());
+    std::vector<int32_t> deleted;
+    if (!reader.read(deleted, rows, cols)) {
+        return;
+    }
+    if (downdate == nullptr) {
+        throw std::runtime_error("Error reading " + path + ": a downdated factorization; compact it first.");
+    }
+    if (rows != 1 && !deleted.empty()) {
+        throw std::runtime_error("Error reading " + path + ": bad downdate record.");
+    }
+    if (!reader.read(values, rows, cols) || cols != 4) {
+        throw std::runtime_error("Error reading " + path + ": bad rotation record.");
+    }
+    downdate->deleted.assign(deleted.begin(), deleted.end());
+    downdate->rotations.resize(rows);
+    for (uint64_t k = 0; k < rows; k++) {
+        const double* g = values.data() + 4 * k;
+        downdate->rotations[k] = Rotation{static_cast<int>(g[0]), static_cast<int>(g[1]), g[2], g[3]};
+    }
+    try {
+        check_downdate(*downdate, mat.rows(), mat.cols());
+    } catch (const std::invalid_argument& e) {
+        throw std::runtime_error("Error reading " + path + ": " + e.what());
+    }
+}
+
+// Holds a running task graph at a consistent cut for a checkpoint. Every
+// task handed to the ready queue is counted until it completes. pause()
+// stops handing released tasks to the queue and waits until the count
+// drains: then no task is queued or running, and the dependency table lists
+// exactly the tasks whose updates are in the matrix. resume() returns the
+// tasks released in the meantime, to be pushed again. Between checkpoints a
+// task costs the workers one flag load and two counter updates.
+class CheckpointGate {
+public:
+    void enable() { on = true; }
+    bool enabled() const { return on; }
+
+    // Counts count tasks pushed from outside the workers (the roots).
+    void submitted(int count) { outstanding.fetch_add(count); }
+
+    // For a task a worker has just released: returns true if the gate holds
+    // it, and otherwise counts it and returns false (the caller pushes it).
+    bool hold(Task* task) {
+        if (!pausing.load()) {
+            outstanding.fetch_add(1);
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pausing.load()) {
+            outstanding.fetch_add(1);
+            return false;
+        }
+        held.push_back(task);
+        return true;
+    }
+
+    // For a task that has run and released its successors. The counter and
+    // the flag are sequentially consistent, so either this call sees the
+    // pause or pause() sees the count this call left.
+    void completed() {
+        if (outstanding.fetch_sub(1) == 1 && pausing.load()) {
+            std::lock_guard<std::mutex> lock(mutex);
+            drained.notify_all();
+        }
+    }
+
+    // Waits until no task is queued or running.
+    void pause() {
+        std::unique_lock<std::mutex> lock(mutex);
+        pausing.store(true);
+        drained.wait(lock, [this] { return outstanding.load() == 0; });
+    }
+
+    // Ends a pause; the caller pushes the returned tasks.
+    std::vector<Task*> resume() {
+        std::lock_guard<std::mutex> lock(mutex);
+        pausing.store(false);
+        std::vector<Task*> tasks;
+        tasks.swap(held);
+        outstanding.fetch_add(static_cast<int>(tasks.size()));
+        return tasks;
+    }
+
+    // Sleeps for interval; returns false at once when stop() is called.
+    bool sleep(std::chrono::milliseconds interval) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return !wake.wait_for(lock, interval, [this] { return stopping; });
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        wake.notify_all();
+    }
+
+private:
+    bool on = false;
+    std::atomic<bool> pausing{false};
+    std::atomic<int> outstanding{0};    // Tasks queued or running
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::vector<Task*> held;
+};
+
+// Shape of a checkpointed run; a checkpoint only resumes a run with the same.
+struct CheckpointInfo {
+    int m = 0;
+    int n = 0;
+    int alpha = 0;
+    int beta = 0;
+    bool wy = false;
+    int completed = 0;          // Tasks done when it was taken
+
+    bool same_run(const CheckpointInfo& other) const {
+        return m == other.m && n == other.n && alpha == other.alpha && beta == other.beta && wy == other.wy;
+    }
+};
+
+// The state of a paused run, copied so that the workers can go on while it
+// is written out.
+template <class Real>
+struct CheckpointSnapshot {
+    CheckpointInfo info;
+    std::vector<Real> matrix;
+    std::vector<Real> up, b;
+    std::vector<Real> t;                // WY factors; empty with --type2 reflectors
+    std::vector<int32_t> done;          // task_rows x task_cols completion flags
+    int task_rows = 0;
+    int task_cols = 0;
+
+    // Copies a paused run of the shape in run.
+    void capture(const CheckpointInfo& run, const Real* mat, const std::vector<Real>& up_array,
+                 const std::vector<Real>& b_array, const std::vector<Real>& t_array,
+                 const DependencyTableAtomic& deps) {
+        info = run;
+        matrix.assign(mat, mat + (size_t)run.m * run.n);
+        up = up_array;
+        b = b_array;
+        t = t_array;
+        task_rows = static_cast<int>(deps.rows());
+        task_cols = static_cast<int>(deps.cols());
+        done.assign((size_t)task_rows * task_cols, 0);
+        info.completed = 0;
+        for (int i = 0; i < task_rows; ++i) {
+            for (int j = 0; j < task_cols; ++j) {
+                done[(size_t)i * task_cols + j] = deps.getDependency(i, j);
+                info.completed += done[(size_t)i * task_cols + j];
+            }
+        }
+    }
+
+    // Puts the state back into a run fresh from init() and marks the done
+    // cells completed: ready(Task*) gets the tasks to start from (see
+    // TaskTable::restoreCompleted). Returns the number of done tasks.
+    template <class ReadyFn>
+    int restore(Real* mat, std::vector<Real>& up_array, std::vector<Real>& b_array, std::vector<Real>& t_array,
+                DependencyTableAtomic& deps, const TaskTable& table, ReadyFn&& ready) const {
+        if (static_cast<int>(deps.rows()) != task_rows || static_cast<int>(deps.cols()) != task_cols ||
+            up_array.size() != up.size() || t_array.size() != t.size()) {
+            throw std::invalid_argument("Checkpoint does not match the run.");
+        }
+        std::copy(matrix.begin(), matrix.end(), mat);
+        std::copy(up.begin(), up.end(), up_array.begin());
+        std::copy(b.begin(), b.end(), b_array.begin());
+        std::copy(t.begin(), t.end(), t_array.begin());
+        auto is_done = [this](int i, int j) { return done[(size_t)i * task_cols + j] != 0; };
+        for (int i = 0; i < task_rows; ++i) {
+            for (int j = 0; j < task_cols; ++j) {
+                if (is_done(i, j)) {
+                    deps.setDependency(i, j, true);
+                }
+            }
+        }
+        return table.restoreCompleted(is_done, ready);
+    }
+
+    void save(const std::string& path) const {
+        const std::string tmp = path + ".tmp";
+        const double meta[] = {CHECKPOINT_VERSION, (double)info.m, (double)info.n, (double)info.alpha,
+                               (double)info.beta, info.wy ? 1.0 : 0.0, (double)info.completed};
+        RecordWriter writer(tmp, false);
+        writer.write(meta, 1, sizeof(meta) / sizeof(meta[0]));
+        writer.write(matrix.data(), info.m, info.n);
+        std::vector<Real> scalars(up);
+        scalars.insert(scalars.end(), b.begin(), b.end());
+        writer.write(scalars.data(), 2, up.size());
+        writer.write(t.data(), 1, t.size());
+        writer.write(done.data(), task_rows, task_cols);
+        writer.close(true);
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            throw std::runtime_error("Error renaming " + tmp + " to " + path + ": " + std::strerror(errno));
+        }
+    }
+
+    // Reads a checkpoint of save(); throws if it is not one, or holds
+    // another element type.
+    void load(const std::string& path) {
+        RecordReader reader(path);
+        std::vector<double> meta;
+        std::vector<Real> scalars;
+        uint64_t rows = 0, cols = 0, up_rows = 0, up_cols = 0, t_rows = 0, t_cols = 0;
+        bool ok = reader.read(meta, rows, cols) && meta.size() == 7 && meta[0] == CHECKPOINT_VERSION;
+        if (ok) {
+            info.m = static_cast<int>(meta[1]);
+            info.n = static_cast<int>(meta[2]);
+            info.alpha = static_cast<int>(meta[3]);
+            info.beta = static_cast<int>(meta[4]);
+            info.wy = meta[5] != 0;
+            info.completed = static_cast<int>(meta[6]);
+            uint64_t done_rows = 0, done_cols = 0;
+            ok = reader.read(matrix, rows, cols) && rows == (uint64_t)info.m && cols == (uint64_t)info.n &&
+                 reader.read(scalars, up_rows, up_cols) && up_rows == 2 && reader.read(t, t_rows, t_cols) &&
+                 reader.read(done, done_rows, done_cols);
+            task_rows = static_cast<int>(done_rows);
+            task_cols = static_cast<int>(done_cols);
+        }
+        if (!ok) {
+            throw std::runtime_error("Error reading checkpoint " + path + ": not a checkpoint of this version.");
+        }
+        up.assign(scalars.begin(), scalars.begin() + up_cols);
+        b.assign(scalars.begin() + up_cols, scalars.end());
+    }
+};
+
+#endif // CHECKPOINT_H
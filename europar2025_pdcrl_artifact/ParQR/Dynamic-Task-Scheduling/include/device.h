@@ -0,0 +1,387 @@
+#ifndef DEVICE_H
+#define DEVICE_H
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bn2.h"
+#include "kernels.h"
+#include "run_config.h"
+#ifdef PARQR_CUDA
+#include <cublas_v2.h>
+#include <cuda_runtime.h>
+#endif
+
+// Hybrid CPU/device execution (--device). Type-2 tasks carry most of the
+// flops and are regular updates of whole row blocks, while the type-1 chain
+// is latency-bound; so a share of the row blocks is kept resident on a
+// device, which runs every type-2 task of those blocks, and the CPU workers
+// run all other tasks. A device block k (k >= 1) is copied to the device
+// before the run and stays there until its last type-2 task, the task of
+// panel min(k * beta/alpha, panels) - 1. It is then copied back, and its
+// type-1 tasks (if it holds pivots) follow on the CPU. The only other traffic
+// is the panels: the first device task of panel j copies the panel's pivot
+// rows, reflector scalars and T factor to the device. The device thread
+// (main.cpp) pops ready device tasks in batches, runs a batch with one
+// synchronization and then completes its tasks exactly as a worker does, so
+// the dependency table and the task graph see no difference.
+//
+// Backends:
+//   host  the device copy is a separate host allocation and the CPU kernels
+//         run on it; this exercises the whole protocol on any machine and
+//         matches a CPU-only run bit for bit.
+//   cuda  (make gpu, -DPARQR_CUDA) the device copy lives in device memory and
+//         each task is applied through the panel's WY factor with cuBLAS
+//         GEMMs on one stream.
+
+// Device row blocks: share percent of the blocks 1 .. blocks - 1, spread
+// evenly (block 0 has no type-2 tasks).
+struct DeviceSplit {
+    int share = 0;      // Percent of the row blocks
+    int beta_div_alpha = 1;
+    int panels = 0;     // Task columns
+
+    bool on_device(int i) const { return i >= 1 && i * share / 100 != (i - 1) * share / 100; }
+
+    // Whether task (i, j) runs on the device.
+    bool takes(const Task* t) const { return t->type == 2 && on_device(t->chunk_idx_i); }
+
+    // Whether task (i, j) is the last type-2 task of row block i, after which
+    // the block goes back to the host.
+    bool leaves_device(int i, int j) const { return j + 1 == std::min(i * beta_div_alpha, panels); }
+};
+
+// Copy of the matrix on a device, with the panels uploaded so far. Tasks are
+// queued and run asynchronously until synchronize().
+template <class Real>
+class DeviceBackend {
+public:
+    virtual ~DeviceBackend() = default;
+    virtual const char* name() const = 0;
+    // Room for the m x n row-major matrix and for panels T factors of
+    // ldt x ldt; wy: type-2 tasks apply T (otherwise up and b).
+    virtual void allocate(int m, int n, int panels, int ldt, bool wy) = 0;
+    virtual void upload_rows(const Real* mat, int begin, int end) = 0;
+    virtual void download_rows(Real* mat, int begin, int end) = 0;
+    // Panel j: pivot rows [begin, end) of mat from column begin, their up/b,
+    // and the panel's T (ldt x ldt).
+    virtual void upload_panel(int j, const Real* mat, int begin, int end, const Real* up_array,
+                              const Real* b_array, const Real* T) = 0;
+    // Applies panel j, pivots [begin, end), to rows [col_start, col_end).
+    virtual void enqueue_type2(int j, int begin, int end, int col_start, int col_end) = 0;
+    virtual void synchronize() = 0;
+};
+
+// Device copy in host memory, updated by the CPU kernels.
+template <class Real>
+class HostDevice : public DeviceBackend<Real> {
+    std::unique_ptr<Real[]> mat;    // Left uninitialized: rows never uploaded are never touched
+    std::vector<Real> up_array, b_array, t_array;
+    int m = 0, n = 0, ldt = 0;
+    bool wy = true;
+
+public:
+    const char* name() const override { return "host"; }
+
+    void allocate(int rows, int cols, int panels, int ld, bool use_wy) override {
+        m = rows;
+        n = cols;
+        ldt = ld;
+        wy = use_wy;
+        mat.reset(new Real[(size_t)m * n]);
+        up_array.assign(m, 0);
+        b_array.assign(m, 0);
+        t_array.assign(wy ? (size_t)panels * ldt * ldt : 0, 0);
+    }
+
+    void upload_rows(const Real* src, int begin, int end) override {
+        std::memcpy(mat.get() + (size_t)begin * n, src + (size_t)begin * n, (size_t)(end - begin) * n * sizeof(Real));
+    }
+
+    void download_rows(Real* dst, int begin, int end) override {
+        std::memcpy(dst + (size_t)begin * n, mat.get() + (size_t)begin * n, (size_t)(end - begin) * n * sizeof(Real));
+    }
+
+    void upload_panel(int j, const Real* src, int begin, int end, const Real* up, const Real* b,
+                      const Real* T) override {
+        for (int r = begin; r < end; r++) {
+            std::copy(src + (size_t)r * n + begin, src + (size_t)(r + 1) * n, mat.get() + (size_t)r * n + begin);
+        }
+        std::copy(up + begin, up + end, up_array.begin() + begin);
+        std::copy(b + begin, b + end, b_array.begin() + begin);
+        if (wy) {
+            std::copy(T, T + (size_t)ldt * ldt, t_array.begin() + (size_t)j * ldt * ldt);
+        }
+    }
+
+    // The kernels take the task's own bounds: row_start 1 stands for pivot 0.
+    void enqueue_type2(int j, int begin, int end, int col_start, int col_end) override {
+        const int row_start = begin == 0 ? 1 : begin;
+        if (wy) {
+            complete_task2_wy(mat.get(), m, n, row_start, end, col_start, col_end, up_array.data(),
+                              t_array.data() + (size_t)j * ldt * ldt, ldt);
+        } else {
+            complete_task2(mat.get(), m, n, row_start, end, col_start, col_end, up_array.data(), b_array.data());
+        }
+    }
+
+    void synchronize() override {}
+};
+
+#ifdef PARQR_CUDA
+inline void cuda_check(cudaError_t status, const char* what) {
+    if (status != cudaSuccess) {
+        throw std::runtime_error(std::string("CUDA: ") + what + ": " + cudaGetErrorString(status));
+    }
+}
+
+inline void cublas_check(cublasStatus_t status, const char* what) {
+    if (status != CUBLAS_STATUS_SUCCESS) {
+        throw std::runtime_error(std::string("cuBLAS: ") + what + " failed (" + std::to_string(status) + ")");
+    }
+}
+
+inline cublasStatus_t cublas_gemm(cublasHandle_t h, cublasOperation_t ta, cublasOperation_t tb, int m, int n, int k,
+                                  double alpha, const double* A, int lda, const double* B, int ldb, double beta,
+                                  double* C, int ldc) {
+    return cublasDgemm(h, ta, tb, m, n, k, &alpha, A, lda, B, ldb, &beta, C, ldc);
+}
+
+inline cublasStatus_t cublas_gemm(cublasHandle_t h, cublasOperation_t ta, cublasOperation_t tb, int m, int n, int k,
+                                  float alpha, const float* A, int lda, const float* B, int ldb, float beta,
+                                  float* C, int ldc) {
+    return cublasSgemm(h, ta, tb, m, n, k, &alpha, A, lda, B, ldb, &beta, C, ldc);
+}
+
+// Device copy in CUDA memory. A task applies its panel through the WY form
+// (see kernels.h), X <- X - ((X V) T) V^T for the target rows X, as GEMMs on
+// the column-major view of the row-major storage (row r is column r, the
+// leading dimension is n). V is split at p1 = end: its k x k head, with the
+// zeros and the up scalars of the reflectors, is built on the host and
+// uploaded with the panel; its tail [p1, n) is read in place from the pivot
+// rows. Without --type2 wy the panel's T factor is built on the host.
+template <class Real>
+class CudaDevice : public DeviceBackend<Real> {
+    Real* mat = nullptr;
+    Real* heads = nullptr;      // ldt x ldt head of V per panel, column-major
+    Real* factors = nullptr;    // ldt x ldt T factor per panel, as built (row-major)
+    Real* w = nullptr;          // k x rows scratch: X V, then (X V) T
+    Real* wt = nullptr;
+    size_t scratch = 0;         // Elements of w and wt
+    cudaStream_t stream = nullptr;
+    cublasHandle_t handle = nullptr;
+    int m = 0, n = 0, ldt = 0;
+    bool wy = true;
+    std::vector<int> panel_begin;
+    std::vector<Real> head, t;
+
+    void reserve_scratch(size_t count) {
+        if (count <= scratch) {
+            return;
+        }
+        cuda_check(cudaStreamSynchronize(stream), "synchronize");
+        cudaFree(w);
+        cudaFree(wt);
+        cuda_check(cudaMalloc(&w, count * sizeof(Real)), "allocate scratch");
+        cuda_check(cudaMalloc(&wt, count * sizeof(Real)), "allocate scratch");
+        scratch = count;
+    }
+
+public:
+    CudaDevice() {
+        cuda_check(cudaStreamCreate(&stream), "create stream");
+        cublas_check(cublasCreate(&handle), "create handle");
+        cublas_check(cublasSetStream(handle, stream), "set stream");
+    }
+
+    ~CudaDevice() override {
+        cudaStreamSynchronize(stream);
+        cudaFree(mat);
+        cudaFree(heads);
+        cudaFree(factors);
+        cudaFree(w);
+        cudaFree(wt);
+        cublasDestroy(handle);
+        cudaStreamDestroy(stream);
+    }
+
+    const char* name() const override { return "cuda"; }
+
+    void allocate(int rows, int cols, int panels, int ld, bool use_wy) override {
+        m = rows;
+        n = cols;
+        ldt = ld;
+        wy = use_wy;
+        panel_begin.assign(panels, 0);
+        cuda_check(cudaMalloc(&mat, (size_t)m * n * sizeof(Real)), "allocate matrix");
+        cuda_check(cudaMalloc(&heads, (size_t)panels * ldt * ldt * sizeof(Real)), "allocate panels");
+        cuda_check(cudaMalloc(&factors, (size_t)panels * ldt * ldt * sizeof(Real)), "allocate panels");
+    }
+
+    void upload_rows(const Real* src, int begin, int end) override {
+        cuda_check(cudaMemcpyAsync(mat + (size_t)begin * n, src + (size_t)begin * n,
+                                   (size_t)(end - begin) * n * sizeof(Real), cudaMemcpyHostToDevice, stream),
+                   "upload rows");
+        cuda_check(cudaStreamSynchronize(stream), "upload rows");
+    }
+
+    void download_rows(Real* dst, int begin, int end) override {
+        cuda_check(cudaMemcpyAsync(dst + (size_t)begin * n, mat + (size_t)begin * n,
+                                   (size_t)(end - begin) * n * sizeof(Real), cudaMemcpyDeviceToHost, stream),
+                   "download rows");
+        cuda_check(cudaStreamSynchronize(stream), "download rows");
+    }
+
+    void upload_panel(int j, const Real* src, int begin, int end, const Real* up, const Real* b,
+                      const Real* T) override {
+        const int k = end - begin;
+        panel_begin[j] = begin;
+        // Head of V: column p is reflector begin + p over columns [begin, end).
+        head.assign((size_t)ldt * ldt, 0);
+        for (int p = 0; p < k; p++) {
+            head[(size_t)p * ldt + p] = up[begin + p];
+            for (int c = p + 1; c < k; c++) {
+                head[(size_t)p * ldt + c] = src[(size_t)(begin + p) * n + begin + c];
+            }
+        }
+        if (!wy) {
+            t.assign((size_t)ldt * ldt, 0);
+            build_wy_factor(src, n, begin == 0 ? 1 : begin, end, up, b, t.data(), ldt);
+            T = t.data();
+        }
+        const size_t offset = (size_t)j * ldt * ldt;
+        if (end < n) {
+            cuda_check(cudaMemcpy2DAsync(mat + (size_t)begin * n + end, n * sizeof(Real),
+                                         src + (size_t)begin * n + end, n * sizeof(Real),
+                                         (size_t)(n - end) * sizeof(Real), k, cudaMemcpyHostToDevice, stream),
+                       "upload panel");
+        }
+        cuda_check(cudaMemcpyAsync(heads + offset, head.data(), head.size() * sizeof(Real),
+                                   cudaMemcpyHostToDevice, stream), "upload panel");
+        cuda_check(cudaMemcpyAsync(factors + offset, T, (size_t)ldt * ldt * sizeof(Real),
+                                   cudaMemcpyHostToDevice, stream), "upload panel");
+        // head and t are reused by the next upload.
+        cuda_check(cudaStreamSynchronize(stream), "upload panel");
+    }
+
+    void enqueue_type2(int j, int begin, int end, int col_start, int col_end) override {
+        const int k = end - begin, rows = col_end - col_start, tail = n - end;
+        reserve_scratch((size_t)k * rows);
+        const Real* v_head = heads + (size_t)j * ldt * ldt;
+        const Real* v_tail = mat + (size_t)begin * n + end;
+        // T as built is row-major; read column-major it is T^T, so
+        // ((X V) T)^T = T^T (X V)^T is a plain product.
+        const Real* t_cm = factors + (size_t)j * ldt * ldt;
+        Real* x_head = mat + (size_t)col_start * n + begin;
+        Real* x_tail = mat + (size_t)col_start * n + end;
+
+        // w = (X V)^T, k x rows.
+        cublas_check(cublas_gemm(handle, CUBLAS_OP_T, CUBLAS_OP_N, k, rows, k, Real(1), v_head, ldt, x_head, n,
+                                 Real(0), w, k), "gemm");
+        if (tail > 0) {
+            cublas_check(cublas_gemm(handle, CUBLAS_OP_T, CUBLAS_OP_N, k, rows, tail, Real(1), v_tail, n, x_tail, n,
+                                     Real(1), w, k), "gemm");
+        }
+        // wt = T^T w
+        cublas_check(cublas_gemm(handle, CUBLAS_OP_N, CUBLAS_OP_N, k, rows, k, Real(1), t_cm, ldt, w, k, Real(0),
+                                 wt, k), "gemm");
+        // X^T -= V^T wt
+        cublas_check(cublas_gemm(handle, CUBLAS_OP_N, CUBLAS_OP_N, k, rows, k, Real(-1), v_head, ldt, wt, k, Real(1),
+                                 x_head, n), "gemm");
+        if (tail > 0) {
+            cublas_check(cublas_gemm(handle, CUBLAS_OP_N, CUBLAS_OP_N, tail, rows, k, Real(-1), v_tail, n, wt, k,
+                                     Real(1), x_tail, n), "gemm");
+        }
+    }
+
+    void synchronize() override { cuda_check(cudaStreamSynchronize(stream), "synchronize"); }
+};
+#endif
+
+template <class Real>
+std::unique_ptr<DeviceBackend<Real>> make_device_backend(DeviceKind kind) {
+    switch (kind) {
+        case DeviceKind::host:
+            return std::make_unique<HostDevice<Real>>();
+        case DeviceKind::cuda:
+#ifdef PARQR_CUDA
+            return std::make_unique<CudaDevice<Real>>();
+#else
+            throw std::invalid_argument("This build has no CUDA support (build with make gpu).");
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+// A job's device side: the backend, the panels already uploaded, and the
+// traffic. All calls but the constructor come from the device thread, and
+// reach host rows only once the tasks that ordered them have completed.
+template <class Real>
+class DeviceRows {
+    std::unique_ptr<DeviceBackend<Real>> backend;
+    DeviceSplit split;
+    std::vector<char> uploaded;     // Per panel
+    int m = 0, n = 0, beta = 1, ldt = 0;
+
+public:
+    size_t bytes_up = 0;
+    size_t bytes_down = 0;
+
+    bool enabled() const { return backend != nullptr; }
+    const char* name() const { return backend->name(); }
+
+    // Allocates the device copy of the m x n mat and copies the device row
+    // blocks to it.
+    void init(DeviceKind kind, const DeviceSplit& which, const Real* mat, int rows, int cols, int block_rows,
+              int ld, bool wy) {
+        backend = make_device_backend<Real>(kind);
+        if (!backend) {
+            return;
+        }
+        split = which;
+        m = rows;
+        n = cols;
+        beta = block_rows;
+        ldt = ld;
+        uploaded.assign(split.panels, 0);
+        backend->allocate(m, n, split.panels, ldt, wy);
+        for (int i = 1; i < TaskTable::task_rows(m, beta); i++) {
+            if (split.on_device(i)) {
+                const int begin = std::min(beta * i + 1, m), end = std::min(beta * (i + 1) + 1, m);
+                backend->upload_rows(mat, begin, end);
+                bytes_up += (size_t)(end - begin) * n * sizeof(Real);
+            }
+        }
+    }
+
+    // Queues type-2 task t, uploading its panel first if this is the panel's
+    // first device task. t_array holds the T factors of all panels.
+    void enqueue(const Task* t, const Real* mat, const Real* up_array, const Real* b_array, const Real* t_array) {
+        const int j = t->chunk_idx_j;
+        const int begin = t->row_start == 1 ? 0 : t->row_start;
+        if (!uploaded[j]) {
+            backend->upload_panel(j, mat, begin, t->row_end, up_array, b_array,
+                                  t_array != nullptr ? t_array + (size_t)j * ldt * ldt : nullptr);
+            bytes_up += ((size_t)(t->row_end - begin) * (n - begin + 2) + (size_t)ldt * ldt) * sizeof(Real);
+            uploaded[j] = 1;
+        }
+        backend->enqueue_type2(j, begin, t->row_end, t->col_start, t->col_end);
+    }
+
+    void synchronize() { backend->synchronize(); }
+
+    // After a synchronize(): copies t's row block back to mat if t was its
+    // last device task.
+    void finish(const Task* t, Real* mat) {
+        if (split.leaves_device(t->chunk_idx_i, t->chunk_idx_j)) {
+            backend->download_rows(mat, t->col_start, t->col_end);
+            bytes_down += (size_t)(t->col_end - t->col_start) * n * sizeof(Real);
+        }
+    }
+};
+
+#endif // DEVICE_H
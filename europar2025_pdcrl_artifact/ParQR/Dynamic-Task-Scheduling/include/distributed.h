@@ -0,0 +1,157 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Distribution and panel messages of the MPI driver (mpi_main.cpp). A task
+// of cell (i, j) reads and writes whole matrix rows: the rows of row block i
+// and, for a type-2 task, the pivot rows of panel j. The row blocks are
+// therefore the unit of distribution: block i lives on rank i % ranks (a 1D
+// row-block-cyclic layout with blocks of beta rows), and a rank runs exactly
+// the task row of each block it owns. The only dependencies that cross ranks are
+// those from a panel's type-1 task to the type-2 tasks below it, so once a
+// panel is factorized its pivot rows, reflector scalars and T factor are sent
+// to every rank that owns a block below it.
+//
+// Every rank keeps the global row-major indexing, so the kernels run
+// unchanged, but only its own blocks and the panels in use are resident:
+// the other rows are released with release_pages() after loading, received
+// panels are written in place, and a panel is released again once its last
+// local type-2 task has run.
+
+// Row blocks of an m-row matrix spread over ranks. Block i holds rows
+// [block_begin(i), block_end(i)), with row 0 joining block 0 (see
+// TaskTable::task_rows).
+struct RowBlockCyclic {
+    int ranks = 1;
+    int rank = 0;
+    int blocks = 0;     // Task rows
+    int beta = 1;
+    int m = 0;
+
+    RowBlockCyclic() = default;
+    RowBlockCyclic(int ranks, int rank, int blocks, int beta, int m)
+        : ranks(ranks), rank(rank), blocks(blocks), beta(beta), m(m) {}
+
+    int owner(int i) const { return i % ranks; }
+    bool owns(int i) const { return owner(i) == rank; }
+    int block_begin(int i) const { return i == 0 ? 0 : std::min(beta * i + 1, m); }
+    int block_end(int i) const { return std::min(beta * (i + 1) + 1, m); }
+
+    // Blocks this rank owns.
+    int owned_blocks() const { return rank < blocks ? (blocks - 1 - rank) / ranks + 1 : 0; }
+
+    // Ranks other than block i's owner that own a block below it: the
+    // receivers of the panels factorized in block i. The next ranks - 1
+    // blocks cover all of them.
+    std::vector<int> panel_receivers(int i) const {
+        std::vector<int> receivers;
+        for (int k = i + 1; k < blocks && k < i + ranks; k++) {
+            receivers.push_back(owner(k));
+        }
+        return receivers;
+    }
+
+    // Owned blocks below block i: the local type-2 tasks of each of its panels.
+    int owned_blocks_below(int i) const {
+        int first = i + 1 + ((rank - (i + 1)) % ranks + ranks) % ranks;
+        return first < blocks ? (blocks - 1 - first) / ranks + 1 : 0;
+    }
+};
+
+// Pivot rows [begin, end) of panel j, with row 0 joining panel 0 (see
+// complete_task1).
+inline void panel_rows(int j, int alpha, int pivots, int& begin, int& end) {
+    begin = j == 0 ? 0 : std::min(alpha * j + 1, pivots);
+    end = std::min(alpha * (j + 1) + 1, pivots);
+}
+
+// A panel message is one array of doubles:
+//   [0]              the panel index j
+//   [1, 1 + k)       up of the k pivots
+//   [.., + k)        b of the pivots
+//   [.., + ldt^2)    the panel's T factor (with WY only)
+//   then the k pivot rows, each from column begin to n.
+inline size_t panel_message_size(int begin, int end, int n, int ldt, bool wy) {
+    const size_t k = end - begin;
+    return 1 + 2 * k + (wy ? (size_t)ldt * ldt : 0) + k * (size_t)(n - begin);
+}
+
+// Packs panel j of the m x n row-major mat, rows [begin, end), into msg.
+inline void pack_panel(const double* mat, int n, int j, int begin, int end, const double* up_array,
+                       const double* b_array, const double* T, int ldt, bool wy, std::vector<double>& msg) {
+    msg.resize(panel_message_size(begin, end, n, ldt, wy));
+    double* out = msg.data();
+    *out++ = j;
+    out = std::copy(up_array + begin, up_array + end, out);
+    out = std::copy(b_array + begin, b_array + end, out);
+    if (wy) {
+        out = std::copy(T, T + (size_t)ldt * ldt, out);
+    }
+    for (int r = begin; r < end; r++) {
+        out = std::copy(mat + (size_t)r * n + begin, mat + (size_t)(r + 1) * n, out);
+    }
+}
+
+inline int panel_of_message(const double* msg) { return static_cast<int>(msg[0]); }
+
+// Writes a message of size count from pack_panel() back into the same places
+// of mat, up_array, b_array and the panel's T (t_array of panel j). Returns
+// the panel index.
+inline int unpack_panel(const double* msg, size_t count, double* mat, int n, int alpha, int pivots,
+                        double* up_array, double* b_array, double* t_array, int ldt, bool wy) {
+    const int j = panel_of_message(msg);
+    int begin, end;
+    panel_rows(j, alpha, pivots, begin, end);
+    if (count != panel_message_size(begin, end, n, ldt, wy)) {
+        throw std::runtime_error("Panel message " + std::to_string(j) + " has " + std::to_string(count) +
+                                 " values, expected " + std::to_string(panel_message_size(begin, end, n, ldt, wy)));
+    }
+    const size_t k = end - begin;
+    const double* in = msg + 1;
+    std::copy(in, in + k, up_array + begin);
+    in += k;
+    std::copy(in, in + k, b_array + begin);
+    in += k;
+    if (wy) {
+        std::copy(in, in + (size_t)ldt * ldt, t_array + (size_t)j * ldt * ldt);
+        in += (size_t)ldt * ldt;
+    }
+    for (int r = begin; r < end; r++) {
+        const size_t len = n - begin;
+        std::copy(in, in + len, mat + (size_t)r * n + begin);
+        in += len;
+    }
+    return j;
+}
+
+// Hands the whole pages inside [begin, end) back to the OS and replaces them
+// with fresh zero pages; pages that [begin, end) only partly covers are kept.
+// The range must lie in one allocation (heap, or a private file mapping,
+// which madvise alone would only revert to the file: its pages would still
+// be mapped as soon as they are read). Returns the bytes released.
+inline size_t release_pages(void* begin, void* end) {
+    static const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + page - 1) / page * page;
+    const uintptr_t last = reinterpret_cast<uintptr_t>(end) / page * page;
+    if (last <= first) {
+        return 0;
+    }
+    void* fresh = mmap(reinterpret_cast<void*>(first), last - first, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    return fresh == MAP_FAILED ? 0 : last - first;
+}
+
+// Releases rows [begin, end) of the row-major mat with n columns.
+inline size_t release_rows(double* mat, int n, int begin, int end) {
+    return release_pages(mat + (size_t)begin * n, mat + (size_t)end * n);
+}
+
+#endif // DISTRIBUTED_H
@@ -0,0 +1,171 @@
+#ifndef DOWNDATE_H
+#define DOWNDATE_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Rows deleted from a factorization by Givens downdating (QrEngine::delete_rows
+// with a Downdate, a.out --delete-rows). In the reflector format, deleting
+// an old row of M changes every later reflector, so only a refactorization
+// could produce it. A downdated factorization instead keeps the deleted rows
+// in mat as ghosts, whose reflectors stay in
+//
+//   Q = H_0 ... H_{p-1} G_0 G_1 ... G_{g-1},    p = min(stored rows, n),
+//
+// and retriangularizes what is left: for the rows M' of M that are not
+// deleted, in order, M' H_0 ... H_{p-1} is the lower triangle of those rows
+// with the columns of the ghosts filled in, and the Givens rotations G_k
+// zero them again, one row after another, so that M' Q = [L' 0]. Row r of
+// L' takes columns [0, r] of the stored row of the r-th kept row, which are
+// below that row's own reflector; the lower parts of ghost rows are zero.
+// Deleting count rows takes count rotations per later row, each applied to
+// the rows below it: O(count m n) work instead of a refactorization.
+//
+// Appending to a downdated factorization appends to the stored rows as
+// usual, applies the rotations to the new rows and retriangularizes them.
+// Ghosts and rotations accumulate, so QrEngine compacts the factorization
+// back to the reflector format (an exact refactorization of M') when that is
+// the cheaper way to carry out an update; QrEngine::compact() does so on
+// request. The binary result stores the ghosts and rotations as two more
+// records (see checkpoint.h).
+
+// x_i <- c x_i - s x_j, x_j <- s x_i + c x_j on the coordinates i < j of a
+// row vector x.
+struct Rotation {
+    int i = 0, j = 0;
+    double c = 1, s = 0;
+};
+
+struct Downdate {
+    std::vector<int> deleted;           // Stored rows that are not rows of M, ascending
+    std::vector<Rotation> rotations;    // G_0, G_1, ... in the order Q applies them
+
+    bool empty() const { return deleted.empty() && rotations.empty(); }
+
+    void clear() {
+        deleted.clear();
+        rotations.clear();
+    }
+
+    // The stored row of each row of M, of a factorization of stored rows.
+    std::vector<int> live_rows(int stored) const {
+        std::vector<int> live;
+        live.reserve(stored - deleted.size());
+        size_t next = 0;
+        for (int i = 0; i < stored; i++) {
+            if (next < deleted.size() && deleted[next] == i) {
+                next++;
+            } else {
+                live.push_back(i);
+            }
+        }
+        return live;
+    }
+};
+
+inline void rotate(const Rotation& g, double* x) {
+    const double xi = x[g.i], xj = x[g.j];
+    x[g.i] = g.c * xi - g.s * xj;
+    x[g.j] = g.s * xi + g.c * xj;
+}
+
+// The inverse of rotate().
+inline void unrotate(const Rotation& g, double* x) {
+    const double xi = x[g.i], xj = x[g.j];
+    x[g.i] = g.c * xi + g.s * xj;
+    x[g.j] = g.c * xj - g.s * xi;
+}
+
+// The rotation on (i, j) that zeroes x_j into x_i, applied to x.
+inline Rotation zeroing_rotation(int i, int j, double* x) {
+    Rotation g;
+    g.i = i;
+    g.j = j;
+    const double r = std::hypot(x[i], x[j]);
+    if (r != 0.0) {
+        g.c = x[i] / r;
+        g.s = -x[j] / r;
+    }
+    x[i] = r;
+    x[j] = 0.0;
+    return g;
+}
+
+// x <- x G_0 ... G_{count-1}, for x^T Q = (Q^T x)^T after the reflectors.
+inline void apply_rotations(const Rotation* rotations, size_t count, double* x) {
+    for (size_t k = 0; k < count; k++) {
+        rotate(rotations[k], x);
+    }
+}
+
+// The inverse: x <- x G_{count-1}^T ... G_0^T, before the reflectors of Q x.
+inline void undo_rotations(const Rotation* rotations, size_t count, double* x) {
+    for (size_t k = count; k-- > 0;) {
+        unrotate(rotations[k], x);
+    }
+}
+
+// Rows a block rotation handles at once.
+constexpr int ROTATION_LANES = 16;
+
+// apply_rotations() (or with undo, undo_rotations()) on each of the count
+// rows rows[k], whose columns outside [lo, hi) the rotations do not touch.
+// The rows are interleaved in scratch, ROTATION_LANES at a time, so that a
+// rotation is one vector operation on all of them.
+inline void apply_rotations_to_rows(const Rotation* rotations, size_t num_rotations, double* const* rows, int count,
+                                    int lo, int hi, bool undo, std::vector<double>& scratch) {
+    const int width = hi - lo;
+    scratch.resize((size_t)width * ROTATION_LANES);
+    for (int r0 = 0; r0 < count; r0 += ROTATION_LANES) {
+        const int lanes = std::min(ROTATION_LANES, count - r0);
+        std::fill(scratch.begin(), scratch.end(), 0.0);
+        for (int t = 0; t < lanes; t++) {
+            const double* row = rows[r0 + t] + lo;
+            for (int c = 0; c < width; c++) {
+                scratch[(size_t)c * ROTATION_LANES + t] = row[c];
+            }
+        }
+        for (size_t k = 0; k < num_rotations; k++) {
+            const Rotation& g = rotations[undo ? num_rotations - 1 - k : k];
+            const double c = g.c, s = undo ? -g.s : g.s;
+            double* xi = scratch.data() + (size_t)(g.i - lo) * ROTATION_LANES;
+            double* xj = scratch.data() + (size_t)(g.j - lo) * ROTATION_LANES;
+            double a[ROTATION_LANES], b[ROTATION_LANES];
+            std::copy(xi, xi + ROTATION_LANES, a);
+            std::copy(xj, xj + ROTATION_LANES, b);
+            for (int t = 0; t < ROTATION_LANES; t++) {
+                xi[t] = c * a[t] - s * b[t];
+                xj[t] = s * a[t] + c * b[t];
+            }
+        }
+        for (int t = 0; t < lanes; t++) {
+            double* row = rows[r0 + t] + lo;
+            for (int c = 0; c < width; c++) {
+                row[c] = scratch[(size_t)c * ROTATION_LANES + t];
+            }
+        }
+    }
+}
+
+// Throws std::invalid_argument unless downdate fits a factorization of
+// stored x n rows.
+inline void check_downdate(const Downdate& downdate, int stored, int n) {
+    for (size_t k = 0; k < downdate.deleted.size(); k++) {
+        const int row = downdate.deleted[k];
+        if (row < 0 || row >= stored || (k > 0 && row <= downdate.deleted[k - 1])) {
+            throw std::invalid_argument("Downdate: deleted rows must ascend within the " + std::to_string(stored) +
+                                        " stored rows.");
+        }
+    }
+    for (const Rotation& g : downdate.rotations) {
+        if (g.i < 0 || g.i >= g.j || g.j >= n) {
+            throw std::invalid_argument("Downdate: a rotation on columns (" + std::to_string(g.i) + ", " +
+                                        std::to_string(g.j) + ") of " + std::to_string(n) + ".");
+        }
+    }
+}
+
+#endif // DOWNDATE_H
@@ -0,0 +1,173 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// Idle handling for the dynamic scheduler's workers: a thread that finds no
+// ready task first spins with pause, then yields, and finally parks until a
+// producer signals new work (see IdleBackoff and ParkingLot). SpinBarrier is
+// the user-space barrier of the static schedule (barrier_main.cpp).
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Per-thread back-off state. wait() is called after each failed pop: for the
+// first `spins` misses it spins with an exponentially growing number of pause
+// instructions (capped at 32), for the next `yields` misses it yields the
+// core, and after that it returns false to tell the caller to park.
+class IdleBackoff {
+    int spins;
+    int yields;
+    int misses = 0;
+
+public:
+    IdleBackoff(int spins, int yields) : spins(spins), yields(yields) {}
+
+    bool wait() {
+        if (misses < spins) {
+            int pauses = 1 << (misses < 5 ? misses : 5);
+            for (int i = 0; i < pauses; ++i) {
+                cpu_relax();
+            }
+            ++misses;
+            return true;
+        }
+        if (misses < spins + yields) {
+            std::this_thread::yield();
+            ++misses;
+            return true;
+        }
+        return false;
+    }
+
+    void reset() { misses = 0; }
+};
+
+// Eventcount on which idle workers sleep. A worker announces itself with
+// prepare_park(), re-checks for work and then either cancel_park()s or
+// park()s with the returned ticket. Producers call notify_one() after
+// publishing a task; the seq_cst fence there pairs with the one in
+// prepare_park(), so either the producer sees the sleeper and bumps the epoch,
+// or the sleeper's re-check sees the task. While nobody sleeps, notify is a
+// fence plus a load of a line that is only read.
+class ParkingLot {
+    alignas(64) std::atomic<uint32_t> epoch{0};
+    alignas(64) std::atomic<int> sleepers{0};
+#ifndef __linux__
+    std::mutex mutex;
+    std::condition_variable cv;
+#endif
+
+    void wake(int count) {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+#else
+        std::lock_guard<std::mutex> lock(mutex);
+        if (count == 1) {
+            cv.notify_one();
+        } else {
+            cv.notify_all();
+        }
+#endif
+    }
+
+public:
+    uint32_t prepare_park() {
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        return epoch.load(std::memory_order_seq_cst);
+    }
+
+    void cancel_park() {
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Sleeps until the epoch moves past ticket (returns at once if it already has).
+    void park(uint32_t ticket) {
+#ifdef __linux__
+        while (epoch.load(std::memory_order_acquire) == ticket) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAIT_PRIVATE, ticket, nullptr, nullptr, 0);
+        }
+#else
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&] { return epoch.load(std::memory_order_acquire) != ticket; });
+#endif
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void notify_one() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) > 0) {
+            wake(1);
+        }
+    }
+
+    void notify_all() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) > 0) {
+            wake(INT_MAX);
+        }
+    }
+};
+
+// Sense-reversing centralized barrier. The last thread to arrive resets the
+// count and flips the shared sense; the others spin on it, with pause for the
+// first `spins` checks and yielding after that, so an oversubscribed run
+// still makes progress. Each thread passes its own sense flag, initially
+// false. wait() has acquire/release semantics: writes before the barrier are
+// visible to every thread after it.
+class SpinBarrier {
+    alignas(64) std::atomic<int> remaining{0};
+    alignas(64) std::atomic<bool> sense{false};
+    int count = 0;
+    int spins = 0;
+
+public:
+    explicit SpinBarrier(int threads = 1, int spins = 1000) { init(threads, spins); }
+
+    SpinBarrier(const SpinBarrier&) = delete;
+    SpinBarrier& operator=(const SpinBarrier&) = delete;
+
+    // Not thread-safe; call before the threads start.
+    void init(int threads, int spins) {
+        count = threads;
+        this->spins = spins;
+        remaining.store(threads, std::memory_order_relaxed);
+        sense.store(false, std::memory_order_relaxed);
+    }
+
+    void wait(bool& local_sense) {
+        local_sense = !local_sense;
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            remaining.store(count, std::memory_order_relaxed);
+            sense.store(local_sense, std::memory_order_release);
+            return;
+        }
+        for (int k = 0; sense.load(std::memory_order_acquire) != local_sense; ++k) {
+            if (k < spins) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+#endif // IDLE_H
@@ -0,0 +1,1033 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Householder kernels shared by the dynamic (main.cpp) and static
+// (barrier_main.cpp) drivers. Row j of the n x n row-major matrix is treated
+// as column j of the matrix being factorized; reflector lpivot lives in row
+// lpivot, and its scalars are kept in up_array[lpivot] / b_array[lpivot].
+// Every kernel is a template on the scalar type Real, double or float, and
+// the matrix, up/b arrays and T factors of one factorization share it.
+
+// Scalar reference kernels. They are used on non-x86 targets and as the
+// baseline the SIMD versions are checked against.
+
+// Largest magnitude and sum of squares of x[0, len).
+template <class Real>
+inline void column_norm_scalar(const Real *x, int len, Real *max_abs, Real *sum_sq)
+{
+    Real cl = 0.0, sm1 = 0.0;
+    for (int k = 0; k < len; k++)
+    {
+        Real sm = std::fabs(x[k]);
+        sm1 += sm * sm;
+        cl = std::fmax(sm, cl);
+    }
+    *max_abs = cl;
+    *sum_sq = sm1;
+}
+
+// Applies reflectors [row_start, row_end) to rows [col_start, col_end).
+// Target rows are independent, so each one receives every reflector of the
+// panel in turn while it is still in cache. The per-row operation order is the
+// same as applying the reflectors one at a time across all rows.
+// NPIV > 0 fixes the pivot count at compile time so the pivot loop is unrolled
+// and up/b stay in registers; NPIV == 0 is the generic runtime-count path.
+template <int NPIV, class Real>
+inline void apply_reflectors(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                             const Real *up_array, const Real *b_array)
+{
+    const int npiv = NPIV > 0 ? NPIV : row_end - row_start;
+
+    for (int j = col_start; j < col_end; j++)
+    {
+        Real *row = mat + (size_t)j * n;
+
+        for (int p = 0; p < npiv; p++)
+        {
+            const int lpivot = row_start + p;
+            const Real *piv = mat + (size_t)lpivot * n;
+            const Real up = up_array[lpivot];
+
+            Real sm = row[lpivot] * up;
+
+            for (int i__ = lpivot + 1; i__ < n; i__++)
+            {
+                sm += row[i__] * piv[i__];
+            }
+
+            if (sm == 0.0)
+            {
+                continue;
+            }
+
+            sm *= b_array[lpivot];
+            row[lpivot] += sm * up;
+
+            for (int i__ = lpivot + 1; i__ < n; i__++)
+            {
+                row[i__] += sm * piv[i__];
+            }
+        }
+    }
+}
+
+// Scalar type-2 application; full tiles of the common alpha values take a
+// fixed-size path.
+template <class Real>
+inline void apply_reflectors_scalar(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                                    const Real *up_array, const Real *b_array)
+{
+    switch (row_end - row_start)
+    {
+    case 4:  apply_reflectors<4>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array);  return;
+    case 8:  apply_reflectors<8>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array);  return;
+    case 12: apply_reflectors<12>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array); return;
+    case 16: apply_reflectors<16>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array); return;
+    case 24: apply_reflectors<24>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array); return;
+    case 32: apply_reflectors<32>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array); return;
+    default: apply_reflectors<0>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array);  return;
+    }
+}
+
+// ---- SIMD kernels -----------------------------------------------------------
+//
+// Written once with GCC vector extensions for a vector of W elements and
+// instantiated inside functions compiled for AVX2 (32 bytes: W = 4 doubles or
+// 8 floats) and AVX-512 (64 bytes), so the binary carries every variant
+// regardless of -march and picks one at runtime.
+//
+// The type-2 kernel processes KERNEL_ROWS target rows at a time, so every
+// reflector element loaded is reused for all of them. Its passes are fused:
+// the axpy that applies reflector p to a row is the same pass that computes
+// the dot product with reflector p+1, so a panel of alpha reflectors streams
+// each row alpha + 1 times instead of 2 * alpha. Dot products are reassociated
+// across vector lanes, so results differ from the scalar kernels in the last
+// bits only.
+
+static constexpr int KERNEL_ROWS = 4;
+
+// The vector helpers below are always inlined into an AVX2/AVX-512 caller, so
+// the ABI of passing vectors by value never applies. GCC reports this for
+// template instantiations at the end of the translation unit, so the
+// suppression cannot be popped.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+template <int W, class Real>
+struct simd_t
+{
+    // Unaligned, aliasing-safe vector of W elements.
+    typedef Real vec __attribute__((vector_size(W * sizeof(Real)), aligned(sizeof(Real)), may_alias));
+};
+
+template <int W, class Real>
+[[gnu::always_inline]] inline typename simd_t<W, Real>::vec simd_load(const Real *p)
+{
+    return *reinterpret_cast<const typename simd_t<W, Real>::vec *>(p);
+}
+
+template <int W, class Real>
+[[gnu::always_inline]] inline void simd_store(Real *p, typename simd_t<W, Real>::vec v)
+{
+    *reinterpret_cast<typename simd_t<W, Real>::vec *>(p) = v;
+}
+
+template <int W, class Real>
+[[gnu::always_inline]] inline Real simd_sum(typename simd_t<W, Real>::vec v)
+{
+    Real s = 0.0;
+    for (int k = 0; k < W; k++)
+    {
+        s += v[k];
+    }
+    return s;
+}
+
+template <int W, class Real>
+[[gnu::always_inline]] inline void column_norm_simd(const Real *x, int len, Real *max_abs, Real *sum_sq)
+{
+    typedef typename simd_t<W, Real>::vec vec;
+    vec vmax = {}, vsum = {};
+    int k = 0;
+    for (; k + W <= len; k += W)
+    {
+        vec v = simd_load<W>(x + k);
+        vsum += v * v;
+        v = v < Real(0) ? -v : v;
+        vmax = v > vmax ? v : vmax;
+    }
+    Real cl = 0.0;
+    for (int q = 0; q < W; q++)
+    {
+        cl = std::fmax(cl, vmax[q]);
+    }
+    Real sm1 = simd_sum<W, Real>(vsum);
+    for (; k < len; k++)
+    {
+        sm1 += x[k] * x[k];
+        cl = std::fmax(cl, std::fabs(x[k]));
+    }
+    *max_abs = cl;
+    *sum_sq = sm1;
+}
+
+// Applies reflectors [p0, p1) to the NR rows in rows[].
+template <int W, int NR, class Real>
+[[gnu::always_inline]] inline void apply_rows_simd(const Real *mat, int n, int p0, int p1, Real *const *rows,
+                                                   const Real *up, const Real *b)
+{
+    typedef typename simd_t<W, Real>::vec vec;
+    Real acc[NR];
+
+    // Dot products with the first reflector.
+    {
+        const Real *piv = mat + (size_t)p0 * n;
+        vec va[NR] = {};
+        int i = p0 + 1;
+        for (; i + W <= n; i += W)
+        {
+            vec x = simd_load<W>(piv + i);
+            for (int r = 0; r < NR; r++)
+            {
+                va[r] += simd_load<W>(rows[r] + i) * x;
+            }
+        }
+        for (int r = 0; r < NR; r++)
+        {
+            acc[r] = rows[r][p0] * up[p0] + simd_sum<W, Real>(va[r]);
+        }
+        for (; i < n; i++)
+        {
+            for (int r = 0; r < NR; r++)
+            {
+                acc[r] += rows[r][i] * piv[i];
+            }
+        }
+    }
+
+    for (int lpivot = p0; lpivot < p1; lpivot++)
+    {
+        const Real *piv = mat + (size_t)lpivot * n;
+        Real s[NR];
+        vec vs[NR];
+        for (int r = 0; r < NR; r++)
+        {
+            // A zero dot product (or a degenerate pivot, b == 0) gives s == 0,
+            // which leaves the row unchanged.
+            s[r] = acc[r] * b[lpivot];
+            vs[r] = vec{} + s[r];
+            rows[r][lpivot] += s[r] * up[lpivot];
+        }
+
+        if (lpivot + 1 == p1)
+        {
+            // Last reflector: plain axpy.
+            int i = lpivot + 1;
+            for (; i + W <= n; i += W)
+            {
+                vec x = simd_load<W>(piv + i);
+                for (int r = 0; r < NR; r++)
+                {
+                    simd_store<W>(rows[r] + i, simd_load<W>(rows[r] + i) + vs[r] * x);
+                }
+            }
+            for (; i < n; i++)
+            {
+                for (int r = 0; r < NR; r++)
+                {
+                    rows[r][i] += s[r] * piv[i];
+                }
+            }
+            break;
+        }
+
+        // Fused pass: axpy with reflector lpivot, dot with reflector lpivot + 1.
+        const int next = lpivot + 1;
+        const Real *pnext = mat + (size_t)next * n;
+        for (int r = 0; r < NR; r++)
+        {
+            rows[r][next] += s[r] * piv[next];
+            acc[r] = rows[r][next] * up[next];
+        }
+
+        vec va[NR] = {};
+        int i = next + 1;
+        for (; i + W <= n; i += W)
+        {
+            vec x = simd_load<W>(piv + i);
+            vec y = simd_load<W>(pnext + i);
+            for (int r = 0; r < NR; r++)
+            {
+                vec v = simd_load<W>(rows[r] + i) + vs[r] * x;
+                simd_store<W>(rows[r] + i, v);
+                va[r] += v * y;
+            }
+        }
+        for (int r = 0; r < NR; r++)
+        {
+            acc[r] += simd_sum<W, Real>(va[r]);
+        }
+        for (; i < n; i++)
+        {
+            for (int r = 0; r < NR; r++)
+            {
+                rows[r][i] += s[r] * piv[i];
+                acc[r] += rows[r][i] * pnext[i];
+            }
+        }
+    }
+}
+
+template <int W, class Real>
+[[gnu::always_inline]] inline void apply_reflectors_simd(Real *mat, int n, int row_start, int row_end,
+                                                         int col_start, int col_end,
+                                                         const Real *up_array, const Real *b_array)
+{
+    if (row_start >= row_end)
+    {
+        return;
+    }
+    int j = col_start;
+    for (; j + KERNEL_ROWS <= col_end; j += KERNEL_ROWS)
+    {
+        Real *rows[KERNEL_ROWS];
+        for (int r = 0; r < KERNEL_ROWS; r++)
+        {
+            rows[r] = mat + (size_t)(j + r) * n;
+        }
+        apply_rows_simd<W, KERNEL_ROWS>(mat, n, row_start, row_end, rows, up_array, b_array);
+    }
+    for (; j < col_end; j++)
+    {
+        Real *rows[1] = {mat + (size_t)j * n};
+        apply_rows_simd<W, 1>(mat, n, row_start, row_end, rows, up_array, b_array);
+    }
+}
+
+// ---- Storage views ------------------------------------------------------------
+//
+// The WY kernels address the matrix through a view, so one implementation
+// serves both the row-major storage and the tiled layout of matrix_t. A view
+// splits a row's columns into segments that are contiguous in memory:
+// segment_of(c) is the segment holding column c, [segment_begin(J),
+// segment_end(J)) its columns, and seg(r, J) a pointer p with p[c] equal to
+// element (r, c) for every column c of segment J. Within a segment, the next
+// row_run(r, k) rows (at most k) follow row r at a distance of pitch().
+
+template <class Real>
+struct BasicRowMajorView
+{
+    Real *mat;
+    int n;
+
+    int segments() const { return 1; }
+    int segment_of(int) const { return 0; }
+    int segment_begin(int) const { return 0; }
+    int segment_end(int) const { return n; }
+    size_t pitch() const { return n; }
+    int row_run(int, int k) const { return k; }
+    Real *seg(int r, int) const { return mat + (size_t)r * n; }
+    Real &at(int r, int c) const { return mat[(size_t)r * n + c]; }
+};
+
+typedef BasicRowMajorView<double> RowMajorView;
+
+// Tiled storage (see matrix_t::to_tiled): tile_m x tile_n tiles, each
+// row-major inside, stored tile_stride elements apart in row-major tile
+// order. Segments are tile columns; seg() offsets the tile's row pointer by
+// -segment_begin(J), which stays inside the allocation because tile (I, J)
+// has at least J whole tiles before it.
+template <class Real>
+struct BasicTiledView
+{
+    Real *base;
+    int n;
+    int tile_m;
+    int tile_n;
+    int tiles_per_row;
+    size_t tile_stride;
+
+    int segments() const { return tiles_per_row; }
+    int segment_of(int c) const { return c / tile_n; }
+    int segment_begin(int J) const { return J * tile_n; }
+    int segment_end(int J) const { return std::min(n, (J + 1) * tile_n); }
+    size_t pitch() const { return tile_n; }
+    int row_run(int r, int k) const { return std::min(k, tile_m - r % tile_m); }
+    Real *seg(int r, int J) const
+    {
+        return base + ((size_t)(r / tile_m) * tiles_per_row + J) * tile_stride + (size_t)(r % tile_m) * tile_n
+               - (size_t)J * tile_n;
+    }
+    Real &at(int r, int c) const { return seg(r, segment_of(c))[c]; }
+};
+
+typedef BasicTiledView<double> TiledView;
+
+// Walks the segments of a view that overlap columns [lo, hi):
+//     for (SegmentRange s(A, lo, hi); s; s.next()) ... s.J, [s.b, s.e) ...
+template <class View>
+struct SegmentRange
+{
+    const View &A;
+    int hi, J, b, e;
+
+    SegmentRange(const View &A, int lo, int hi)
+        : A(A), hi(hi), J(A.segment_of(lo)), b(lo), e(std::min(hi, A.segment_end(J))) {}
+    explicit operator bool() const { return J < A.segments() && b < e; }
+    void next()
+    {
+        ++J;
+        b = A.segment_begin(J);
+        e = std::min(hi, A.segment_end(J));
+    }
+};
+
+// ---- Compact WY (blocked type-2) ---------------------------------------------
+//
+// Reflector p of a panel [p0, p1) is H_p = I - tau_p v_p v_p^T, with
+// tau_p = -b_array[p], v_p[p] = up_array[p], v_p[i] = mat[p][i] for i > p, and
+// zero before p; so V is read in place from the panel rows. The product
+// H_p0 ... H_p1-1 equals I - V T V^T with T upper triangular (LAPACK dlarft,
+// forward/columnwise). Applying the panel to a target row x in order,
+// H_p1-1 ... H_p0 x, is then x^T <- x^T - ((x^T V) T) V^T: two GEMM-like
+// sweeps over the tile and a small triangular product, instead of alpha
+// separate dot/axpy passes.
+
+// Builds T for the panel [row_start, row_end): k x k with k = row_end - start,
+// row-major with leading dimension ldt.
+template <class View, class Real>
+inline void build_wy_factor(const View &A, int row_start, int row_end,
+                            const Real *up_array, const Real *b_array, Real *T, int ldt)
+{
+    const int p0 = row_start == 1 ? 0 : row_start;
+    const int k = row_end - p0;
+    std::vector<Real> z(k);
+
+    for (int c = 0; c < k; c++)
+    {
+        const int lc = p0 + c;
+        const Real tau = -b_array[lc];
+
+        // z = V[:, 0:c]^T v_c; v_c is zero before lc.
+        for (int q = 0; q < c; q++)
+        {
+            z[q] = A.at(p0 + q, lc) * up_array[lc];
+        }
+        for (SegmentRange s(A, lc + 1, A.n); s; s.next())
+        {
+            const Real *vc = A.seg(lc, s.J);
+            for (int q = 0; q < c; q++)
+            {
+                const Real *vq = A.seg(p0 + q, s.J);
+                Real d = 0.0;
+                for (int i = s.b; i < s.e; i++)
+                {
+                    d += vq[i] * vc[i];
+                }
+                z[q] += d;
+            }
+        }
+
+        // T[0:c, c] = -tau T[0:c, 0:c] z
+        for (int r = 0; r < c; r++)
+        {
+            Real sum = 0.0;
+            for (int q = r; q < c; q++)
+            {
+                sum += T[r * ldt + q] * z[q];
+            }
+            T[r * ldt + c] = -tau * sum;
+        }
+        T[c * ldt + c] = tau;
+        for (int r = c + 1; r < k; r++)
+        {
+            T[r * ldt + c] = 0.0;
+        }
+    }
+}
+
+template <class Real>
+inline void build_wy_factor(const Real *mat, int n, int row_start, int row_end,
+                            const Real *up_array, const Real *b_array, Real *T, int ldt)
+{
+    build_wy_factor(BasicRowMajorView<Real>{const_cast<Real *>(mat), n}, row_start, row_end, up_array, b_array, T, ldt);
+}
+
+// w[r][pb + p] += rows[r][lo:hi] . piv[pb + p][lo:hi] for P reflectors.
+template <int W, int R, int P, class Real>
+[[gnu::always_inline]] inline void wy_dots(const Real *const *piv, int pb, int lo, int hi, Real *const *rows,
+                                           Real *w, int k)
+{
+    typedef typename simd_t<W, Real>::vec vec;
+
+    vec acc[R][P] = {};
+    int i = lo;
+    for (; i + W <= hi; i += W)
+    {
+        vec x[R];
+        for (int r = 0; r < R; r++)
+        {
+            x[r] = simd_load<W>(rows[r] + i);
+        }
+        for (int p = 0; p < P; p++)
+        {
+            vec v = simd_load<W>(piv[pb + p] + i);
+            for (int r = 0; r < R; r++)
+            {
+                acc[r][p] += x[r] * v;
+            }
+        }
+    }
+    for (int r = 0; r < R; r++)
+    {
+        for (int p = 0; p < P; p++)
+        {
+            Real sum = simd_sum<W, Real>(acc[r][p]);
+            for (int t = i; t < hi; t++)
+            {
+                sum += rows[r][t] * piv[pb + p][t];
+            }
+            w[r * k + pb + p] += sum;
+        }
+    }
+}
+
+// rows[r][lo:hi] -= sum_p wt[r][p] * v_p[lo:hi] for the kr reflectors
+// v_p = v0 + p * pitch; wt has row stride k.
+template <int W, int R, class Real>
+[[gnu::always_inline]] inline void wy_update(const Real *v0, size_t pitch, int kr, int k, int lo, int hi,
+                                             Real *const *rows, const Real *wt)
+{
+    typedef typename simd_t<W, Real>::vec vec;
+    int i = lo;
+    for (; i + W <= hi; i += W)
+    {
+        vec x[R];
+        for (int r = 0; r < R; r++)
+        {
+            x[r] = simd_load<W>(rows[r] + i);
+        }
+        const Real *v = v0 + i;
+        for (int p = 0; p < kr; p++, v += pitch)
+        {
+            vec vp = simd_load<W>(v);
+            for (int r = 0; r < R; r++)
+            {
+                x[r] -= (vec{} + wt[r * k + p]) * vp;
+            }
+        }
+        for (int r = 0; r < R; r++)
+        {
+            simd_store<W>(rows[r] + i, x[r]);
+        }
+    }
+    for (; i < hi; i++)
+    {
+        for (int p = 0; p < kr; p++)
+        {
+            const Real v = v0[p * pitch + i];
+            for (int r = 0; r < R; r++)
+            {
+                rows[r][i] -= wt[r * k + p] * v;
+            }
+        }
+    }
+}
+
+// Applies the panel [p0, p1) to the R target rows starting at row j through
+// its T factor. w, wt (R x k) and piv (k) are scratch.
+template <int W, int P, int R, class View, class Real>
+[[gnu::always_inline]] inline void apply_wy_rows(const View &A, int p0, int p1, int j, const Real *up,
+                                                 const Real *T, int ldt, Real *w, Real *wt,
+                                                 const Real **piv)
+{
+    const int k = p1 - p0;
+    Real *rows[R];
+
+    // w = X V: the triangular head [p0, p1), then the rectangular part
+    // [p1, n) in register blocks of P reflectors.
+    for (int r = 0; r < R; r++)
+    {
+        for (int p = 0; p < k; p++)
+        {
+            w[r * k + p] = A.at(j + r, p0 + p) * up[p0 + p];
+        }
+    }
+    for (SegmentRange s(A, p0 + 1, p1); s; s.next())
+    {
+        for (int r = 0; r < R; r++)
+        {
+            rows[r] = A.seg(j + r, s.J);
+        }
+        for (int p = 0; p < k; p++)
+        {
+            const Real *vp = A.seg(p0 + p, s.J);
+            for (int r = 0; r < R; r++)
+            {
+                Real sum = 0.0;
+                for (int t = std::max(s.b, p0 + p + 1); t < s.e; t++)
+                {
+                    sum += rows[r][t] * vp[t];
+                }
+                w[r * k + p] += sum;
+            }
+        }
+    }
+    for (SegmentRange s(A, p1, A.n); s; s.next())
+    {
+        for (int r = 0; r < R; r++)
+        {
+            rows[r] = A.seg(j + r, s.J);
+        }
+        for (int p = 0; p < k; p++)
+        {
+            piv[p] = A.seg(p0 + p, s.J);
+        }
+        int pb = 0;
+        for (; pb + P <= k; pb += P)
+        {
+            wy_dots<W, R, P>(piv, pb, s.b, s.e, rows, w, k);
+        }
+        for (; pb < k; pb++)
+        {
+            wy_dots<W, R, 1>(piv, pb, s.b, s.e, rows, w, k);
+        }
+    }
+
+    // wt = w T
+    for (int r = 0; r < R; r++)
+    {
+        for (int p = 0; p < k; p++)
+        {
+            Real sum = 0.0;
+            for (int q = 0; q <= p; q++)
+            {
+                sum += w[r * k + q] * T[q * ldt + p];
+            }
+            wt[r * k + p] = sum;
+        }
+    }
+
+    // X -= wt V^T: triangular head, then the rectangular part.
+    for (int r = 0; r < R; r++)
+    {
+        for (int p = 0; p < k; p++)
+        {
+            A.at(j + r, p0 + p) -= wt[r * k + p] * up[p0 + p];
+        }
+    }
+    for (SegmentRange s(A, p0 + 1, p1); s; s.next())
+    {
+        for (int r = 0; r < R; r++)
+        {
+            rows[r] = A.seg(j + r, s.J);
+        }
+        for (int p = 0; p < k; p++)
+        {
+            const Real *vp = A.seg(p0 + p, s.J);
+            for (int r = 0; r < R; r++)
+            {
+                const Real coef = wt[r * k + p];
+                for (int t = std::max(s.b, p0 + p + 1); t < s.e; t++)
+                {
+                    rows[r][t] -= coef * vp[t];
+                }
+            }
+        }
+    }
+    for (SegmentRange s(A, p1, A.n); s; s.next())
+    {
+        for (int r = 0; r < R; r++)
+        {
+            rows[r] = A.seg(j + r, s.J);
+        }
+        // Consecutive panel rows are pitch apart within a run (see the views).
+        for (int q = 0; q < k;)
+        {
+            const int kr = A.row_run(p0 + q, k - q);
+            wy_update<W, R>(A.seg(p0 + q, s.J), A.pitch(), kr, k, s.b, s.e, rows, wt + q);
+            q += kr;
+        }
+    }
+}
+
+template <int W, int P, class View, class Real>
+[[gnu::always_inline]] inline void apply_wy_simd(const View &A, int row_start, int row_end,
+                                                 int col_start, int col_end,
+                                                 const Real *up_array, const Real *T, int ldt)
+{
+    const int k = row_end - row_start;
+    if (k <= 0)
+    {
+        return;
+    }
+    // Scratch on the stack for common panel widths; the tiled type-1 task
+    // calls this once per pivot.
+    constexpr int STACK_K = 64;
+    Real stack_buf[2 * KERNEL_ROWS * STACK_K];
+    const Real *stack_piv[STACK_K];
+    std::vector<Real> heap_buf;
+    std::vector<const Real *> heap_piv;
+    Real *w = stack_buf;
+    const Real **piv = stack_piv;
+    if (k > STACK_K)
+    {
+        heap_buf.resize((size_t)2 * KERNEL_ROWS * k);
+        heap_piv.resize(k);
+        w = heap_buf.data();
+        piv = heap_piv.data();
+    }
+    Real *wt = w + KERNEL_ROWS * k;
+
+    int j = col_start;
+    for (; j + KERNEL_ROWS <= col_end; j += KERNEL_ROWS)
+    {
+        apply_wy_rows<W, P, KERNEL_ROWS>(A, row_start, row_end, j, up_array, T, ldt, w, wt, piv);
+    }
+    for (; j < col_end; j++)
+    {
+        apply_wy_rows<W, P, 1>(A, row_start, row_end, j, up_array, T, ldt, w, wt, piv);
+    }
+}
+
+// Elements per vector of the given width in bytes.
+template <class Real>
+constexpr int simd_lanes(int bytes)
+{
+    return bytes / static_cast<int>(sizeof(Real));
+}
+
+// Generic build: 16-byte vectors (SSE2 on x86, lowered to scalar elsewhere).
+template <class Real>
+inline void apply_wy_scalar(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                            const Real *up_array, const Real *T, int ldt)
+{
+    apply_wy_simd<simd_lanes<Real>(16), 4>(BasicRowMajorView<Real>{mat, n}, row_start, row_end, col_start, col_end,
+                                           up_array, T, ldt);
+}
+
+template <class Real>
+inline void apply_wy_tiled_scalar(const BasicTiledView<Real> &A, int row_start, int row_end, int col_start,
+                                  int col_end, const Real *up_array, const Real *T, int ldt)
+{
+    apply_wy_simd<simd_lanes<Real>(16), 4>(A, row_start, row_end, col_start, col_end, up_array, T, ldt);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PARQR_X86_KERNELS 1
+
+template <class Real>
+__attribute__((target("avx2,fma")))
+inline void apply_reflectors_avx2(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                                  const Real *up_array, const Real *b_array)
+{
+    apply_reflectors_simd<simd_lanes<Real>(32)>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array);
+}
+
+template <class Real>
+__attribute__((target("avx2,fma")))
+inline void apply_wy_avx2(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                          const Real *up_array, const Real *T, int ldt)
+{
+    // 16 ymm registers: 4 rows x 2 reflectors of accumulators.
+    apply_wy_simd<simd_lanes<Real>(32), 2>(BasicRowMajorView<Real>{mat, n}, row_start, row_end, col_start, col_end,
+                                           up_array, T, ldt);
+}
+
+template <class Real>
+__attribute__((target("avx2,fma")))
+inline void apply_wy_tiled_avx2(const BasicTiledView<Real> &A, int row_start, int row_end, int col_start,
+                                int col_end, const Real *up_array, const Real *T, int ldt)
+{
+    apply_wy_simd<simd_lanes<Real>(32), 2>(A, row_start, row_end, col_start, col_end, up_array, T, ldt);
+}
+
+template <class Real>
+__attribute__((target("avx2,fma")))
+inline void column_norm_avx2(const Real *x, int len, Real *max_abs, Real *sum_sq)
+{
+    column_norm_simd<simd_lanes<Real>(32)>(x, len, max_abs, sum_sq);
+}
+
+template <class Real>
+__attribute__((target("avx512f")))
+inline void apply_reflectors_avx512(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                                    const Real *up_array, const Real *b_array)
+{
+    apply_reflectors_simd<simd_lanes<Real>(64)>(mat, n, row_start, row_end, col_start, col_end, up_array, b_array);
+}
+
+template <class Real>
+__attribute__((target("avx512f")))
+inline void apply_wy_avx512(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                            const Real *up_array, const Real *T, int ldt)
+{
+    // 32 zmm registers: 4 rows x 4 reflectors of accumulators.
+    apply_wy_simd<simd_lanes<Real>(64), 4>(BasicRowMajorView<Real>{mat, n}, row_start, row_end, col_start, col_end,
+                                           up_array, T, ldt);
+}
+
+template <class Real>
+__attribute__((target("avx512f")))
+inline void apply_wy_tiled_avx512(const BasicTiledView<Real> &A, int row_start, int row_end, int col_start,
+                                  int col_end, const Real *up_array, const Real *T, int ldt)
+{
+    apply_wy_simd<simd_lanes<Real>(64), 4>(A, row_start, row_end, col_start, col_end, up_array, T, ldt);
+}
+
+template <class Real>
+__attribute__((target("avx512f")))
+inline void column_norm_avx512(const Real *x, int len, Real *max_abs, Real *sum_sq)
+{
+    column_norm_simd<simd_lanes<Real>(64)>(x, len, max_abs, sum_sq);
+}
+#endif
+
+// ---- Runtime selection ------------------------------------------------------
+
+enum class KernelIsa
+{
+    scalar,
+    avx2,
+    avx512
+};
+
+template <class Real>
+using apply_reflectors_fn = void (*)(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                                     const Real *up_array, const Real *b_array);
+template <class Real>
+using column_norm_fn = void (*)(const Real *x, int len, Real *max_abs, Real *sum_sq);
+template <class Real>
+using apply_wy_fn = void (*)(Real *mat, int n, int row_start, int row_end, int col_start, int col_end,
+                             const Real *up_array, const Real *T, int ldt);
+template <class Real>
+using apply_wy_tiled_fn = void (*)(const BasicTiledView<Real> &A, int row_start, int row_end, int col_start,
+                                   int col_end, const Real *up_array, const Real *T, int ldt);
+
+template <class Real>
+struct BasicKernelSet
+{
+    KernelIsa isa;
+    apply_reflectors_fn<Real> apply;  // Reflectors [row_start, row_end) onto rows [col_start, col_end)
+    column_norm_fn<Real> norm;        // Largest magnitude and sum of squares of a vector
+    apply_wy_fn<Real> apply_wy;       // Blocked apply of a panel through its T factor
+    apply_wy_tiled_fn<Real> apply_wy_tiled;  // The same on tiled storage
+};
+
+typedef BasicKernelSet<double> KernelSet;
+
+inline const char *kernel_isa_name(KernelIsa isa)
+{
+    switch (isa)
+    {
+    case KernelIsa::avx2:   return "avx2";
+    case KernelIsa::avx512: return "avx512";
+    default:                return "scalar";
+    }
+}
+
+inline bool kernel_isa_supported(KernelIsa isa)
+{
+    switch (isa)
+    {
+#ifdef PARQR_X86_KERNELS
+    case KernelIsa::avx2:   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case KernelIsa::avx512: return __builtin_cpu_supports("avx512f");
+#endif
+    case KernelIsa::scalar: return true;
+    default:                return false;
+    }
+}
+
+inline KernelIsa detect_kernel_isa()
+{
+    if (kernel_isa_supported(KernelIsa::avx512))
+    {
+        return KernelIsa::avx512;
+    }
+    if (kernel_isa_supported(KernelIsa::avx2))
+    {
+        return KernelIsa::avx2;
+    }
+    return KernelIsa::scalar;
+}
+
+// Accepts "auto" (the best supported ISA), "scalar", "avx2" or "avx512".
+inline KernelIsa parse_kernel_isa(const std::string &text)
+{
+    if (text == "auto")   return detect_kernel_isa();
+    if (text == "scalar") return KernelIsa::scalar;
+    if (text == "avx2")   return KernelIsa::avx2;
+    if (text == "avx512") return KernelIsa::avx512;
+    throw std::invalid_argument("Unknown kernel ISA: " + text);
+}
+
+template <class Real = double>
+inline BasicKernelSet<Real> make_kernel_set(KernelIsa isa)
+{
+    switch (isa)
+    {
+#ifdef PARQR_X86_KERNELS
+    case KernelIsa::avx2:   return {isa, apply_reflectors_avx2<Real>, column_norm_avx2<Real>,
+                                    apply_wy_avx2<Real>, apply_wy_tiled_avx2<Real>};
+    case KernelIsa::avx512: return {isa, apply_reflectors_avx512<Real>, column_norm_avx512<Real>,
+                                    apply_wy_avx512<Real>, apply_wy_tiled_avx512<Real>};
+#endif
+    default:                return {KernelIsa::scalar, apply_reflectors_scalar<Real>, column_norm_scalar<Real>,
+                                    apply_wy_scalar<Real>, apply_wy_tiled_scalar<Real>};
+    }
+}
+
+// Kernels used by complete_task1/complete_task2 for each scalar type; the
+// best supported ISA unless select_kernel_isa() was called.
+template <class Real = double>
+inline BasicKernelSet<Real> &active_kernels()
+{
+    static BasicKernelSet<Real> kernels = make_kernel_set<Real>(detect_kernel_isa());
+    return kernels;
+}
+
+// Switches the kernels to isa. Returns false, leaving them unchanged, if the
+// CPU does not support it. Call before starting the workers.
+inline bool select_kernel_isa(KernelIsa isa)
+{
+    if (!kernel_isa_supported(isa))
+    {
+        return false;
+    }
+    active_kernels<double>() = make_kernel_set<double>(isa);
+    active_kernels<float>() = make_kernel_set<float>(isa);
+    return true;
+}
+
+// Applies reflector lpivot alone to rows [col_start, col_end): the reflector
+// kernel on row-major storage, a one-reflector WY update (T = tau) on tiles.
+template <class Real>
+inline void apply_single_reflector(const BasicKernelSet<Real> &kernels, const BasicRowMajorView<Real> &A,
+                                   int lpivot, int col_start, int col_end, const Real *up_array,
+                                   const Real *b_array)
+{
+    kernels.apply(A.mat, A.n, lpivot, lpivot + 1, col_start, col_end, up_array, b_array);
+}
+
+template <class Real>
+inline void apply_single_reflector(const BasicKernelSet<Real> &kernels, const BasicTiledView<Real> &A,
+                                   int lpivot, int col_start, int col_end, const Real *up_array,
+                                   const Real *b_array)
+{
+    const Real tau = -b_array[lpivot];
+    kernels.apply_wy_tiled(A, lpivot, lpivot + 1, col_start, col_end, up_array, &tau, 1);
+}
+
+// Type-1 task: generates the reflectors for pivots [row_start, row_end) and
+// applies each one to the remaining rows of the diagonal tile (< col_end).
+template <class View, class Real>
+inline void complete_task1(const View &A, int row_start, int row_end, int col_start, int col_end,
+                           Real *up_array, Real *b_array)
+{
+    const BasicKernelSet<Real> &kernels = active_kernels<Real>();
+    Real sm, sm1, cl, clinv, up, b;
+    int _row_start = row_start == 1 ? 0 : row_start;
+
+    for (int lpivot = _row_start; lpivot < row_end; lpivot++)
+    {
+        Real &diag = A.at(lpivot, lpivot);
+
+        cl = 0.0;
+        sm1 = 0.0;
+        for (SegmentRange s(A, lpivot + 1, A.n); s; s.next())
+        {
+            Real seg_max, seg_sq;
+            kernels.norm(A.seg(lpivot, s.J) + s.b, s.e - s.b, &seg_max, &seg_sq);
+            cl = std::fmax(seg_max, cl);
+            sm1 += seg_sq;
+        }
+        cl = std::fmax(std::fabs(diag), cl);
+
+        // A zero column yields no reflector; its up/b stay zero and the
+        // type-2 tasks treat it as the identity.
+        if (cl <= 0.0)
+        {
+            continue;
+        }
+        clinv = Real(1) / cl;
+
+        Real d__1 = diag * clinv;
+        sm = d__1 * d__1;
+        sm += sm1 * clinv * clinv;
+
+        cl *= std::sqrt(sm);
+
+        if (diag > 0.0)
+        {
+            cl = -cl;
+        }
+
+        up = diag - cl;
+        diag = cl;
+
+        b = up * diag;
+
+        if (b >= 0.0)
+        {
+            continue;
+        }
+
+        b = Real(1) / b;
+
+        up_array[lpivot] = up;
+        b_array[lpivot] = b;
+
+        // Apply the new reflector to the rest of the diagonal tile.
+        apply_single_reflector(kernels, A, lpivot, lpivot + 1, col_end, up_array, b_array);
+    }
+}
+
+template <class Real>
+inline void complete_task1(Real *mat, int m, int n, int row_start, int row_end, int col_start, int col_end,
+                           Real *up_array, Real *b_array)
+{
+    complete_task1(BasicRowMajorView<Real>{mat, n}, row_start, row_end, col_start, col_end, up_array, b_array);
+}
+
+// Type-2 task: applies the reflectors of an already factorized panel to a
+// trailing tile.
+template <class Real>
+inline void complete_task2(Real *mat, int m, int n, int row_start, int row_end, int col_start, int col_end,
+                           const Real *up_array, const Real *b_array)
+{
+    int _row_start = row_start == 1 ? 0 : row_start;
+    int _col_start = col_start == 1 ? 0 : col_start;
+
+    active_kernels<Real>().apply(mat, n, _row_start, row_end, _col_start, col_end, up_array, b_array);
+}
+
+// Blocked type-2 task: applies the panel through its compact WY factor T,
+// built by build_wy_factor() once the panel's type-1 task has completed.
+template <class Real>
+inline void complete_task2_wy(Real *mat, int m, int n, int row_start, int row_end, int col_start, int col_end,
+                              const Real *up_array, const Real *T, int ldt)
+{
+    int _row_start = row_start == 1 ? 0 : row_start;
+    int _col_start = col_start == 1 ? 0 : col_start;
+
+    active_kernels<Real>().apply_wy(mat, n, _row_start, row_end, _col_start, col_end, up_array, T, ldt);
+}
+
+template <class Real>
+inline void complete_task2_wy(const BasicTiledView<Real> &A, int row_start, int row_end, int col_start,
+                              int col_end, const Real *up_array, const Real *T, int ldt)
+{
+    int _row_start = row_start == 1 ? 0 : row_start;
+    int _col_start = col_start == 1 ? 0 : col_start;
+
+    active_kernels<Real>().apply_wy_tiled(A, _row_start, row_end, _col_start, col_end, up_array, T, ldt);
+}
+
+#endif // KERNELS_H
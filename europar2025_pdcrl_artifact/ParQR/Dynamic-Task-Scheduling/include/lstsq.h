@@ -0,0 +1,454 @@
+#ifndef LSTSQ_H
+#define LSTSQ_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "downdate.h"
+
+// Least-squares solves with a factorized matrix (--rhs). The drivers
+// factorize the rows of the m x n matrix M: the reflectors H_0 ... H_{p-1}
+// (p = min(m, n)) applied in order from the right leave [L 0], so the n x m
+// matrix A = M^T is A = Q [R; 0] with Q = H_0 ... H_{p-1} and R = L^T. For
+// m <= n, min ||A x - b|| is then solved by c = Q^T b and R x = c[0, m).
+//
+// The factors may be float (--precision float and mixed) while every vector
+// is double: each solve applies the stored reflectors in double arithmetic.
+// With mixed precision, lstsq_refine() corrects the float solution with
+// Bjorck's refinement of the augmented system
+//
+//   [ I   A ] [ r ]   [ b ]
+//   [ A^T 0 ] [ x ] = [ 0 ],
+//
+// whose residuals are computed in double from the original matrix and whose
+// corrections are solved with the float factors. Unlike refining x alone, it
+// converges to the double-precision solution for problems with a large
+// residual r = b - A x too, as long as cond(A) is well below 1 / eps(float).
+//
+// QApplier handles blocks of right-hand sides: Q, Q^T and the solve for
+// nrhs vectors at once, spread over threads. Each vector is transformed on
+// its own, so the work is nrhs independent chains over the panels of
+// reflectors; the vectors are cut into blocks, which workers take
+// dynamically, as the TSQR leaves are (tsqr.h). Within a block, each panel
+// of QAPPLY_PANEL reflectors is applied through its compact WY factor
+// (see kernels.h), so a reflector row is loaded once for the whole block.
+// QApplier also takes factorizations with deleted rows (downdate.h): their
+// rotations follow the reflectors and R comes from the rows that are kept.
+
+// y <- H_lpivot y for reflector lpivot of the factorized m x n row-major mat
+// (see kernels.h: v = (up, mat[lpivot][lpivot + 1 ..]), H = I + b v v^T).
+template <class Real>
+inline void apply_reflector(const Real* mat, int n, int lpivot, const Real* up_array, const Real* b_array,
+                            double* y) {
+    const Real* v = mat + (size_t)lpivot * n;
+    const double up = up_array[lpivot];
+    double s = y[lpivot] * up;
+    for (int i = lpivot + 1; i < n; i++) {
+        s += v[i] * y[i];
+    }
+    if (s == 0.0) {
+        return;
+    }
+    s *= b_array[lpivot];
+    y[lpivot] += s * up;
+    for (int i = lpivot + 1; i < n; i++) {
+        y[i] += s * v[i];
+    }
+}
+
+// y <- Q^T y for an n-vector y: H_0 first.
+template <class Real>
+inline void apply_qt(const Real* mat, int m, int n, const Real* up_array, const Real* b_array, double* y) {
+    const int pivots = std::min(m, n);
+    for (int p = 0; p < pivots; p++) {
+        apply_reflector(mat, n, p, up_array, b_array, y);
+    }
+}
+
+// y <- Q y for an n-vector y: H_{p-1} first.
+template <class Real>
+inline void apply_q(const Real* mat, int m, int n, const Real* up_array, const Real* b_array, double* y) {
+    for (int p = std::min(m, n) - 1; p >= 0; p--) {
+        apply_reflector(mat, n, p, up_array, b_array, y);
+    }
+}
+
+inline void check_pivot(double diag, int k) {
+    if (diag == 0.0) {
+        throw std::runtime_error("Least squares: R is singular (zero pivot " + std::to_string(k) + ").");
+    }
+}
+
+// Solves R x = c in place for c[0, m), R = L^T with L the lower triangle of
+// the factorized mat. Row k of mat holds column k of R, so the substitution
+// walks rows; with rows, row k of L is row rows[k] of mat (a Downdate's
+// kept rows).
+template <class Real>
+inline void solve_r(const Real* mat, int m, int n, double* c, const int* rows = nullptr) {
+    for (int k = m - 1; k >= 0; k--) {
+        const Real* row = mat + (size_t)(rows != nullptr ? rows[k] : k) * n;
+        check_pivot(row[k], k);
+        c[k] /= row[k];
+        for (int i = 0; i < k; i++) {
+            c[i] -= row[i] * c[k];
+        }
+    }
+}
+
+// Solves R^T h = g (that is, L h = g) in place for g[0, m).
+template <class Real>
+inline void solve_rt(const Real* mat, int m, int n, double* g) {
+    for (int k = 0; k < m; k++) {
+        const Real* row = mat + (size_t)k * n;
+        double s = g[k];
+        for (int i = 0; i < k; i++) {
+            s -= row[i] * g[i];
+        }
+        check_pivot(row[k], k);
+        g[k] = s / row[k];
+    }
+}
+
+// Checks every pivot of R up front, so that solves spread over threads
+// cannot fail half-way.
+template <class Real>
+inline void check_r_pivots(const Real* mat, int m, int n, const int* rows = nullptr) {
+    for (int k = 0; k < m; k++) {
+        check_pivot(mat[(size_t)(rows != nullptr ? rows[k] : k) * n + k], k);
+    }
+}
+
+inline void check_lstsq_shape(int m, int n) {
+    if (m > n) {
+        throw std::invalid_argument("Least squares needs at least as many columns as rows (" + std::to_string(m) +
+                                    " x " + std::to_string(n) + ").");
+    }
+}
+
+// x = argmin ||M^T x - rhs|| from the factorization of the m x n matrix M
+// (m <= n): rhs has n entries, x gets m.
+template <class Real>
+inline void lstsq_solve(const Real* factor, int m, int n, const Real* up_array, const Real* b_array,
+                        const double* rhs, double* x) {
+    check_lstsq_shape(m, n);
+    std::vector<double> c(rhs, rhs + n);
+    apply_qt(factor, m, n, up_array, b_array, c.data());
+    solve_r(factor, m, n, c.data());
+    std::copy(c.begin(), c.begin() + m, x);
+}
+
+constexpr int REFINE_MAX_ITERATIONS = 10;
+
+struct RefineResult {
+    int iterations = 0;         // Corrections applied
+    bool converged = false;     // The last correction was below sqrt(eps(double)) of x
+    double correction = 0;      // max |dx| / max |x| of the last correction
+    double residual = 0;        // ||b - A x||_2 of the result
+};
+
+// Solves min ||M^T x - rhs|| for the original m x n double matrix mat:
+// starts from the solution with the (float) factorization of mat and refines
+// it in double until the correction stops shrinking or drops below
+// eps(double), at most max_iterations times.
+template <class Real>
+inline RefineResult lstsq_refine(const double* mat, const Real* factor, int m, int n, const Real* up_array,
+                                 const Real* b_array, const double* rhs, double* x,
+                                 int max_iterations = REFINE_MAX_ITERATIONS) {
+    const double eps = std::numeric_limits<double>::epsilon();
+    lstsq_solve(factor, m, n, up_array, b_array, rhs, x);
+
+    // r = b - A x, where (A x) = sum_k x_k * row k of mat.
+    std::vector<double> r(rhs, rhs + n);
+    for (int k = 0; k < m; k++) {
+        const double* row = mat + (size_t)k * n;
+        for (int i = 0; i < n; i++) {
+            r[i] -= x[k] * row[i];
+        }
+    }
+
+    RefineResult result;
+    std::vector<double> f(n), h(m), dx(m), dr(n);
+    double previous = std::numeric_limits<double>::infinity();
+    for (int it = 0; it < max_iterations; it++) {
+        // f = b - r - A x, g = -A^T r.
+        for (int i = 0; i < n; i++) {
+            f[i] = rhs[i] - r[i];
+        }
+        for (int k = 0; k < m; k++) {
+            const double* row = mat + (size_t)k * n;
+            double g = 0.0;
+            for (int i = 0; i < n; i++) {
+                f[i] -= x[k] * row[i];
+                g -= row[i] * r[i];
+            }
+            h[k] = g;
+        }
+
+        // R^T h = g; d = Q^T f; R dx = d[0, m) - h; dr = Q [h; d[m, n)].
+        solve_rt(factor, m, n, h.data());
+        apply_qt(factor, m, n, up_array, b_array, f.data());
+        for (int k = 0; k < m; k++) {
+            dx[k] = f[k] - h[k];
+            dr[k] = h[k];
+        }
+        std::copy(f.begin() + m, f.end(), dr.begin() + m);
+        solve_r(factor, m, n, dx.data());
+        apply_q(factor, m, n, up_array, b_array, dr.data());
+
+        double dx_max = 0.0, x_max = 0.0;
+        for (int k = 0; k < m; k++) {
+            dx_max = std::max(dx_max, std::fabs(dx[k]));
+            x_max = std::max(x_max, std::fabs(x[k]));
+        }
+        const double correction = x_max > 0.0 ? dx_max / x_max : dx_max;
+        // A correction no smaller than the last one only adds rounding noise.
+        if (correction >= previous) {
+            break;
+        }
+        for (int k = 0; k < m; k++) {
+            x[k] += dx[k];
+        }
+        for (int i = 0; i < n; i++) {
+            r[i] += dr[i];
+        }
+        result.iterations++;
+        result.correction = correction;
+        if (correction <= eps || correction > 0.5 * previous) {
+            break;
+        }
+        previous = correction;
+    }
+    result.converged = result.correction <= std::sqrt(eps);
+
+    // The true residual of the result, not the refined r.
+    double sum = 0.0;
+    std::copy(rhs, rhs + n, r.begin());
+    for (int k = 0; k < m; k++) {
+        const double* row = mat + (size_t)k * n;
+        for (int i = 0; i < n; i++) {
+            r[i] -= x[k] * row[i];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        sum += r[i] * r[i];
+    }
+    result.residual = std::sqrt(sum);
+    return result;
+}
+
+// ---- Blocks of right-hand sides -----------------------------------------------
+
+// Reflectors grouped into one WY panel by QApplier, and the vectors per
+// block a worker takes.
+constexpr int QAPPLY_PANEL = 32;
+constexpr int QAPPLY_BLOCK = 8;
+
+// Runs body(first, last) over [0, count) in chunks of chunk on up to
+// threads workers (the calling thread is one of them).
+template <class Body>
+void parallel_chunks(int count, int chunk, int threads, Body body) {
+    const int chunks = (count + chunk - 1) / chunk;
+    threads = std::max(1, std::min(threads, chunks));
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int c = next.fetch_add(1); c < chunks; c = next.fetch_add(1)) {
+            body(c * chunk, std::min(count, (c + 1) * chunk));
+        }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+// Q, Q^T and least-squares solves for blocks of vectors, with the
+// factorization of the m x n matrix M (see lstsq_solve). A block of nrhs
+// vectors of n entries is row-major: vector r starts at Y + r * ldy. The
+// factors are only read, so one QApplier may serve several threads.
+template <class Real>
+class QApplier {
+    const Real* mat;
+    int m, n, pivots;
+    const Real* up_array;
+    const Real* b_array;
+    int threads;
+    std::vector<double> t_factors;  // QAPPLY_PANEL^2 per panel, row-major, upper triangular
+    const Downdate* downdate;       // Rotations after the reflectors, or null
+    std::vector<int> kept;          // Stored row of each row of M, with a downdate
+    int rows_of_m;
+
+    const Rotation* rotations() const { return downdate != nullptr ? downdate->rotations.data() : nullptr; }
+    size_t num_rotations() const { return downdate != nullptr ? downdate->rotations.size() : 0; }
+    const int* kept_rows() const { return downdate != nullptr ? kept.data() : nullptr; }
+
+    int panels() const { return (pivots + QAPPLY_PANEL - 1) / QAPPLY_PANEL; }
+    const double* t_of(int panel) const { return t_factors.data() + (size_t)panel * QAPPLY_PANEL * QAPPLY_PANEL; }
+
+    // T of reflectors [p0, p1) in double, as build_wy_factor() does.
+    void build_t(int p0, int p1, double* T) const {
+        const int k = p1 - p0, ld = QAPPLY_PANEL;
+        std::vector<double> z(k);
+        for (int c = 0; c < k; c++) {
+            const int lc = p0 + c;
+            const Real* vc = mat + (size_t)lc * n;
+            for (int q = 0; q < c; q++) {
+                const Real* vq = mat + (size_t)(p0 + q) * n;
+                double d = (double)vq[lc] * up_array[lc];
+                for (int i = lc + 1; i < n; i++) {
+                    d += (double)vq[i] * vc[i];
+                }
+                z[q] = d;
+            }
+            const double tau = -(double)b_array[lc];
+            for (int r = 0; r < c; r++) {
+                double sum = 0.0;
+                for (int q = r; q < c; q++) {
+                    sum += T[r * ld + q] * z[q];
+                }
+                T[r * ld + c] = -tau * sum;
+            }
+            T[c * ld + c] = tau;
+            for (int r = c + 1; r < k; r++) {
+                T[r * ld + c] = 0.0;
+            }
+        }
+    }
+
+    // Applies the reflectors of panel to rows [0, rows) of Y: H_p0 first for
+    // Q^T, that is y^T <- y^T - ((y^T V) T) V^T, and (y^T V) T^T for Q.
+    void apply_panel(int panel, bool transpose, double* Y, int rows, int ldy, std::vector<double>& w,
+                     std::vector<double>& wt) const {
+        const int p0 = panel * QAPPLY_PANEL, p1 = std::min(pivots, p0 + QAPPLY_PANEL), k = p1 - p0;
+        const int ld = QAPPLY_PANEL;
+        const double* T = t_of(panel);
+
+        // w = Y V
+        for (int p = 0; p < k; p++) {
+            const int lp = p0 + p;
+            const Real* v = mat + (size_t)lp * n;
+            const double up = up_array[lp];
+            for (int r = 0; r < rows; r++) {
+                const double* y = Y + (size_t)r * ldy;
+                double s = y[lp] * up;
+                for (int i = lp + 1; i < n; i++) {
+                    s += v[i] * y[i];
+                }
+                w[r * ld + p] = s;
+            }
+        }
+        // wt = w T (Q^T) or w T^T (Q)
+        for (int r = 0; r < rows; r++) {
+            for (int p = 0; p < k; p++) {
+                double sum = 0.0;
+                if (transpose) {
+                    for (int q = 0; q <= p; q++) {
+                        sum += w[r * ld + q] * T[q * ld + p];
+                    }
+                } else {
+                    for (int q = p; q < k; q++) {
+                        sum += w[r * ld + q] * T[p * ld + q];
+                    }
+                }
+                wt[r * ld + p] = sum;
+            }
+        }
+        // Y -= wt V^T
+        for (int p = 0; p < k; p++) {
+            const int lp = p0 + p;
+            const Real* v = mat + (size_t)lp * n;
+            const double up = up_array[lp];
+            for (int r = 0; r < rows; r++) {
+                double* y = Y + (size_t)r * ldy;
+                const double c = wt[r * ld + p];
+                y[lp] -= c * up;
+                for (int i = lp + 1; i < n; i++) {
+                    y[i] -= c * v[i];
+                }
+            }
+        }
+    }
+
+    void apply(bool transpose, double* Y, int nrhs, int ldy) const {
+        parallel_chunks(nrhs, QAPPLY_BLOCK, threads, [&](int first, int last) {
+            std::vector<double> w(QAPPLY_BLOCK * QAPPLY_PANEL), wt(QAPPLY_BLOCK * QAPPLY_PANEL);
+            double* block = Y + (size_t)first * ldy;
+            if (transpose) {
+                for (int panel = 0; panel < panels(); panel++) {
+                    apply_panel(panel, true, block, last - first, ldy, w, wt);
+                }
+                for (int r = 0; r < last - first; r++) {
+                    apply_rotations(rotations(), num_rotations(), block + (size_t)r * ldy);
+                }
+            } else {
+                for (int r = 0; r < last - first; r++) {
+                    undo_rotations(rotations(), num_rotations(), block + (size_t)r * ldy);
+                }
+                for (int panel = panels() - 1; panel >= 0; panel--) {
+                    apply_panel(panel, false, block, last - first, ldy, w, wt);
+                }
+            }
+        });
+    }
+
+public:
+    // Factors as the drivers leave them: the factorized m x n row-major mat
+    // and the reflector scalars, and for a factorization with deleted rows
+    // its downdate, which must outlive the QApplier (m counts the stored
+    // rows). The WY factors of the panels are built here, in parallel.
+    QApplier(const Real* mat, int m, int n, const Real* up_array, const Real* b_array, int threads,
+             const Downdate* downdate = nullptr)
+        : mat(mat), m(m), n(n), pivots(std::min(m, n)), up_array(up_array), b_array(b_array),
+          threads(std::max(1, threads)), downdate(downdate), rows_of_m(m) {
+        if (downdate != nullptr) {
+            check_downdate(*downdate, m, n);
+            kept = downdate->live_rows(m);
+            rows_of_m = (int)kept.size();
+        }
+        t_factors.assign((size_t)panels() * QAPPLY_PANEL * QAPPLY_PANEL, 0.0);
+        parallel_chunks(panels(), 1, this->threads, [this](int first, int) {
+            build_t(first * QAPPLY_PANEL, std::min(pivots, (first + 1) * QAPPLY_PANEL),
+                    t_factors.data() + (size_t)first * QAPPLY_PANEL * QAPPLY_PANEL);
+        });
+    }
+
+    // Y <- Q^T Y, for nrhs vectors of n entries.
+    void apply_qt(double* Y, int nrhs, int ldy) const { apply(true, Y, nrhs, ldy); }
+
+    // Y <- Q Y.
+    void apply_q(double* Y, int nrhs, int ldy) const { apply(false, Y, nrhs, ldy); }
+
+    // X = argmin ||M^T x - b|| for each of the nrhs vectors b of B (n
+    // entries, leading dimension ldb); X gets nrhs rows of the m rows of M
+    // (m <= n), not counting deleted ones.
+    void solve(const double* B, int nrhs, int ldb, double* X, int ldx) const {
+        check_lstsq_shape(rows_of_m, n);
+        check_r_pivots(mat, rows_of_m, n, kept_rows());
+        parallel_chunks(nrhs, QAPPLY_BLOCK, threads, [&](int first, int last) {
+            const int rows = last - first;
+            std::vector<double> c((size_t)rows * n), w(QAPPLY_BLOCK * QAPPLY_PANEL), wt(QAPPLY_BLOCK * QAPPLY_PANEL);
+            for (int r = 0; r < rows; r++) {
+                std::copy(B + (size_t)(first + r) * ldb, B + (size_t)(first + r) * ldb + n, c.begin() + (size_t)r * n);
+            }
+            for (int panel = 0; panel < panels(); panel++) {
+                apply_panel(panel, true, c.data(), rows, n, w, wt);
+            }
+            for (int r = 0; r < rows; r++) {
+                double* cr = c.data() + (size_t)r * n;
+                apply_rotations(rotations(), num_rotations(), cr);
+                solve_r(mat, rows_of_m, n, cr, kept_rows());
+                std::copy(cr, cr + rows_of_m, X + (size_t)(first + r) * ldx);
+            }
+        });
+    }
+};
+
+#endif // LSTSQ_H
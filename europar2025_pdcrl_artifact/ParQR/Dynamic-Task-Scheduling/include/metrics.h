@@ -0,0 +1,395 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "trace.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// End-of-run scheduler and kernel metrics (--metrics FILE). Task times come
+// from the task trace, which --metrics switches on; the workers add the
+// scheduler events the trace does not see, and optionally hardware counters
+// (--hw-counters). The report is JSON, or CSV (one row per thread) when the
+// file name ends in .csv.
+
+// Scheduler events of one worker, only written by that worker.
+struct alignas(64) WorkerCounters {
+    uint64_t failed_pops = 0;   // try_pop calls that found nothing
+    uint64_t parks = 0;         // Times the worker slept on the parking lot
+};
+
+// Hardware counters of the calling thread through perf_event_open, counting
+// user-space events only so it works with perf_event_paranoid up to 2.
+class PerfCounters {
+public:
+    static constexpr int count = 3;
+    static const char* name(int k) {
+        static const char* names[count] = {"cycles", "instructions", "llc_misses"};
+        return names[k];
+    }
+
+private:
+    int fds[count] = {-1, -1, -1};
+
+public:
+    PerfCounters() = default;
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    ~PerfCounters() { close(); }
+
+    // Opens and starts the counters. Returns false if the kernel refused any
+    // of them, in which case none are open.
+    bool open() {
+#ifdef __linux__
+        const uint64_t configs[count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                         PERF_COUNT_HW_CACHE_MISSES};
+        for (int k = 0; k < count; k++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[k];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[k] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds[k] < 0) {
+                close();
+                return false;
+            }
+        }
+        for (int k = 0; k < count; k++) {
+            ioctl(fds[k], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds[k], PERF_EVENT_IOC_ENABLE, 0);
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Reads the counts so far into values. Returns false if not open.
+    bool read(uint64_t values[count]) const {
+        for (int k = 0; k < count; k++) {
+            if (fds[k] < 0 || ::read(fds[k], &values[k], sizeof(uint64_t)) != static_cast<ssize_t>(sizeof(uint64_t))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void close() {
+        for (int k = 0; k < count; k++) {
+            if (fds[k] >= 0) {
+                ::close(fds[k]);
+                fds[k] = -1;
+            }
+        }
+    }
+};
+
+// Model flop count of the drivers' factorization of an m x n matrix, which
+// is the Householder QR of its n x m transpose: 2 p^2 (q - p/3) with
+// p = min(m, n) and q = max(m, n); 4/3 n^3 for a square matrix.
+inline double householder_flops(int m, int n) {
+    const double p = std::min(m, n), q = std::max(m, n);
+    return 2.0 * p * p * (q - p / 3.0);
+}
+
+// Timing record of one run (--timing FILE), read by the regression harness
+// (tools/bench_regress.cpp): the wall time of the factorization alone, to the
+// nanosecond and without the task trace that --metrics switches on.
+inline void save_run_timing(const std::string& filename, const char* driver, int m, int n, int threads, int alpha,
+                            int beta, uint64_t wall_ns) {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        throw std::runtime_error("Error opening file for writing: " + filename);
+    }
+    const double flops = householder_flops(m, n);
+    out.precision(10);
+    out << "{\"driver\": \"" << driver << "\", \"m\": " << m << ", \"n\": " << n << ", \"threads\": " << threads
+        << ", \"alpha\": " << alpha << ", \"beta\": " << beta << ", \"wall_ns\": " << wall_ns
+        << ", \"flops\": " << flops << ", \"gflops_per_s\": " << (wall_ns > 0 ? flops / wall_ns : 0.0) << "}\n";
+    if (out.fail()) {
+        throw std::runtime_error("Error writing timing file: " + filename);
+    }
+}
+
+// Summary of one run; filled in by RunMetrics::summarize().
+struct RunSummary {
+    struct Thread {
+        uint64_t type1_tasks = 0, type2_tasks = 0;
+        uint64_t type1_ns = 0, type2_ns = 0;
+        uint64_t pushes = 0;
+        uint64_t failed_pops = 0, parks = 0;
+        bool has_hw = false;
+        uint64_t hw[PerfCounters::count] = {};
+
+        uint64_t busy_ns() const { return type1_ns + type2_ns; }
+        uint64_t pops() const { return type1_tasks + type2_tasks; }
+    };
+    uint64_t wall_ns = 0;
+    std::vector<Thread> threads;            // Workers, then the main thread
+    uint64_t critical_path_ns = 0;          // Longest dependency chain of any job, in measured task times
+    double flops = 0;                       // Model flop count of the factorizations
+    // Ready-to-start delays: queue_hist[b] counts delays below 2^b us (the
+    // last bucket holds the rest).
+    std::vector<uint64_t> queue_hist;
+    uint64_t queue_samples = 0;
+    uint64_t queue_p50_ns = 0, queue_p90_ns = 0, queue_p99_ns = 0, queue_max_ns = 0;
+};
+
+class RunMetrics {
+    std::vector<std::unique_ptr<WorkerCounters>> counters_;
+    struct alignas(64) Hw {
+        bool ok = false;
+        uint64_t values[PerfCounters::count] = {};
+    };
+    std::vector<std::unique_ptr<Hw>> hw_;
+    bool on = false;
+    bool hw_on = false;
+
+public:
+    static constexpr int queue_buckets = 21;
+
+    // Enables the counters of threads [0, threads); with hw, workers also
+    // sample hardware counters (see HwScope).
+    void init(int threads, bool hw) {
+        counters_.clear();
+        hw_.clear();
+        for (int t = 0; t < threads; t++) {
+            counters_.emplace_back(new WorkerCounters());
+            hw_.emplace_back(new Hw());
+        }
+        on = true;
+        hw_on = hw;
+    }
+
+    bool enabled() const { return on; }
+    bool hw_enabled() const { return hw_on; }
+    WorkerCounters& counters(int tid) { return *counters_[tid]; }
+
+    // Counts hardware events of the calling thread for its lifetime.
+    class HwScope {
+        RunMetrics* metrics;
+        int tid;
+        PerfCounters perf;
+        bool ok = false;
+
+    public:
+        HwScope(RunMetrics& m, int tid) : metrics(&m), tid(tid) {
+            ok = m.hw_on && perf.open();
+        }
+        ~HwScope() {
+            if (ok) {
+                Hw& hw = *metrics->hw_[tid];
+                hw.ok = perf.read(hw.values);
+            }
+        }
+    };
+
+    // Combines the counters with the task times of trace. beta_div_alpha
+    // gives the task graph's shape, for the critical path.
+    RunSummary summarize(const TaskTrace& trace, uint64_t wall_ns, int beta_div_alpha, double flops) const;
+
+    static void write_json(std::ostream& os, const RunSummary& s);
+    static void write_csv(std::ostream& os, const RunSummary& s);
+
+    // JSON, or CSV if filename ends in ".csv".
+    static void save(const std::string& filename, const RunSummary& s) {
+        std::ofstream out(filename);
+        if (!out.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+        if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0) {
+            write_csv(out, s);
+        } else {
+            write_json(out, s);
+        }
+        if (out.fail()) {
+            throw std::runtime_error("Error writing metrics file: " + filename);
+        }
+    }
+};
+
+inline RunSummary RunMetrics::summarize(const TaskTrace& trace, uint64_t wall_ns, int beta_div_alpha,
+                                        double flops) const {
+    RunSummary s;
+    s.wall_ns = wall_ns;
+    s.flops = flops;
+    // One row per worker; the drivers' main thread (an extra trace thread)
+    // only pushes the roots of a batch.
+    s.threads.resize(counters_.empty() ? trace.threads() : counters_.size());
+    s.queue_hist.assign(queue_buckets, 0);
+
+    const std::vector<TraceReady> ready = trace.sorted_ready();
+    std::vector<uint64_t> delays;
+    std::vector<TraceTask> all;
+    for (int t = 0; t < std::min<int>(trace.threads(), s.threads.size()); t++) {
+        RunSummary::Thread& th = s.threads[t];
+        th.pushes = trace.num_ready(t);
+        for (const TraceTask& e : trace.tasks(t)) {
+            const uint64_t dur = e.end_ns - e.start_ns;
+            if (e.type == 1) {
+                th.type1_tasks++;
+                th.type1_ns += dur;
+            } else {
+                th.type2_tasks++;
+                th.type2_ns += dur;
+            }
+            uint64_t ready_ns = 0;
+            if (TaskTrace::find_ready(ready, e, ready_ns)) {
+                const uint64_t delay = e.start_ns - ready_ns;
+                delays.push_back(delay);
+                int b = 0;
+                while (b < queue_buckets - 1 && delay >= (1000ull << b)) {
+                    b++;
+                }
+                s.queue_hist[b]++;
+            }
+        }
+        all.insert(all.end(), trace.tasks(t).begin(), trace.tasks(t).end());
+    }
+    for (size_t t = 0; t < counters_.size(); t++) {
+        s.threads[t].failed_pops = counters_[t]->failed_pops;
+        s.threads[t].parks = counters_[t]->parks;
+        s.threads[t].has_hw = hw_[t]->ok;
+        std::copy(hw_[t]->values, hw_[t]->values + PerfCounters::count, s.threads[t].hw);
+    }
+
+    s.queue_samples = delays.size();
+    if (!delays.empty()) {
+        std::sort(delays.begin(), delays.end());
+        auto pct = [&](double p) { return delays[static_cast<size_t>(p * (delays.size() - 1))]; };
+        s.queue_p50_ns = pct(0.50);
+        s.queue_p90_ns = pct(0.90);
+        s.queue_p99_ns = pct(0.99);
+        s.queue_max_ns = delays.back();
+    }
+
+    // Longest path through each job's task graph with the measured task
+    // times: (i, j) follows (i, j-1) and, for a type-2 task, the type-1 task
+    // (j / beta_div_alpha, j). Sorting by (job, j, type, i) is a topological
+    // order. The static schedule splits a cell into row chunks, traced as
+    // several type-2 events of one cell (the diagonal one alongside its
+    // type-1 task); the chunks run side by side, so a cell finishes with its
+    // longest chunk.
+    std::sort(all.begin(), all.end(), [](const TraceTask& a, const TraceTask& b) {
+        return a.job != b.job ? a.job < b.job
+             : a.j != b.j     ? a.j < b.j
+             : a.type != b.type ? a.type < b.type
+                              : a.i < b.i;
+    });
+    std::unordered_map<uint64_t, uint64_t> finish;   // (i, j, type) of the current job -> path length
+    auto key = [](uint64_t i, uint64_t j, uint64_t type) { return i << 33 | j << 1 | (type == 2 ? 1 : 0); };
+    auto path = [&](uint64_t i, uint64_t j, uint64_t type) {
+        auto it = finish.find(key(i, j, type));
+        return it == finish.end() ? uint64_t(0) : it->second;
+    };
+    for (size_t k = 0; k < all.size(); k++) {
+        const TraceTask& e = all[k];
+        if (k > 0 && all[k - 1].job != e.job) {
+            finish.clear();
+        }
+        uint64_t before = e.j > 0 ? std::max(path(e.i, e.j - 1, 1), path(e.i, e.j - 1, 2)) : 0;
+        if (e.type == 2 && beta_div_alpha > 0) {
+            before = std::max(before, path(e.j / beta_div_alpha, e.j, 1));
+        }
+        const uint64_t length = before + (e.end_ns - e.start_ns);
+        uint64_t& done = finish[key(e.i, e.j, e.type)];
+        done = std::max(done, length);
+        s.critical_path_ns = std::max(s.critical_path_ns, length);
+    }
+    return s;
+}
+
+inline void RunMetrics::write_json(std::ostream& os, const RunSummary& s) {
+    auto ms = [](uint64_t ns) { return ns / 1e6; };
+    RunSummary::Thread total;
+    for (const auto& th : s.threads) {
+        total.type1_tasks += th.type1_tasks;
+        total.type2_tasks += th.type2_tasks;
+        total.type1_ns += th.type1_ns;
+        total.type2_ns += th.type2_ns;
+        total.pushes += th.pushes;
+        total.failed_pops += th.failed_pops;
+        total.parks += th.parks;
+    }
+
+    os << "{\n  \"wall_ms\": " << ms(s.wall_ns) << ",\n"
+       << "  \"critical_path_ms\": " << ms(s.critical_path_ns) << ",\n"
+       << "  \"tasks\": {\"type1\": " << total.type1_tasks << ", \"type2\": " << total.type2_tasks << "},\n"
+       << "  \"task_ms\": {\"type1\": " << ms(total.type1_ns) << ", \"type2\": " << ms(total.type2_ns) << "},\n"
+       << "  \"queue\": {\"pushes\": " << total.pushes << ", \"pops\": " << total.pops()
+       << ", \"failed_pops\": " << total.failed_pops << ", \"parks\": " << total.parks << "},\n"
+       << "  \"flops\": " << s.flops << ",\n"
+       << "  \"gflops_per_s\": " << (s.wall_ns > 0 ? s.flops / s.wall_ns : 0.0) << ",\n"
+       << "  \"queue_delay_us\": {\"samples\": " << s.queue_samples
+       << ", \"p50\": " << s.queue_p50_ns / 1000.0 << ", \"p90\": " << s.queue_p90_ns / 1000.0
+       << ", \"p99\": " << s.queue_p99_ns / 1000.0 << ", \"max\": " << s.queue_max_ns / 1000.0
+       << ",\n    \"histogram\": [";
+    for (size_t b = 0; b < s.queue_hist.size(); b++) {
+        os << (b ? ", " : "") << "{\"lt_us\": ";
+        if (b + 1 < s.queue_hist.size()) {
+            os << (1ull << b);
+        } else {
+            os << "null";
+        }
+        os << ", \"count\": " << s.queue_hist[b] << "}";
+    }
+    os << "]},\n  \"threads\": [\n";
+    for (size_t t = 0; t < s.threads.size(); t++) {
+        const auto& th = s.threads[t];
+        os << "    {\"thread\": " << t << ", \"busy_ms\": " << ms(th.busy_ns())
+           << ", \"idle_ms\": " << ms(s.wall_ns > th.busy_ns() ? s.wall_ns - th.busy_ns() : 0)
+           << ", \"type1_tasks\": " << th.type1_tasks << ", \"type2_tasks\": " << th.type2_tasks
+           << ", \"type1_ms\": " << ms(th.type1_ns) << ", \"type2_ms\": " << ms(th.type2_ns)
+           << ", \"pushes\": " << th.pushes << ", \"pops\": " << th.pops()
+           << ", \"failed_pops\": " << th.failed_pops << ", \"parks\": " << th.parks;
+        if (th.has_hw) {
+            for (int k = 0; k < PerfCounters::count; k++) {
+                os << ", \"" << PerfCounters::name(k) << "\": " << th.hw[k];
+            }
+        }
+        os << "}" << (t + 1 < s.threads.size() ? "," : "") << "\n";
+    }
+    os << "  ]\n}\n";
+}
+
+inline void RunMetrics::write_csv(std::ostream& os, const RunSummary& s) {
+    os << "thread,busy_ns,idle_ns,type1_tasks,type2_tasks,type1_ns,type2_ns,pushes,pops,failed_pops,parks";
+    for (int k = 0; k < PerfCounters::count; k++) {
+        os << "," << PerfCounters::name(k);
+    }
+    os << "\n";
+    for (size_t t = 0; t < s.threads.size(); t++) {
+        const auto& th = s.threads[t];
+        os << t << "," << th.busy_ns() << "," << (s.wall_ns > th.busy_ns() ? s.wall_ns - th.busy_ns() : 0) << ","
+           << th.type1_tasks << "," << th.type2_tasks << "," << th.type1_ns << "," << th.type2_ns << ","
+           << th.pushes << "," << th.pops() << "," << th.failed_pops << "," << th.parks;
+        for (int k = 0; k < PerfCounters::count; k++) {
+            os << ",";
+            if (th.has_hw) {
+                os << th.hw[k];
+            }
+        }
+        os << "\n";
+    }
+}
+
+#endif // METRICS_H
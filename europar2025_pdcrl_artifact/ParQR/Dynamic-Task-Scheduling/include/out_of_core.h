@@ -0,0 +1,400 @@
+#ifndef OUT_OF_CORE_H
+#define OUT_OF_CORE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+#include "bn2.h"
+#include "distributed.h"
+
+// Out-of-core factorization (--out-of-core) of matrices larger than memory.
+// The matrix lives in a working file in the binary matrix format: a copy of
+// the input that is factorized in place and is also the result. A task of
+// cell (i, j) touches row block i and the pivot rows of panel j, which lie in
+// row block j / (beta / alpha), so only a budget of row blocks needs to be
+// resident. The factorization runs in sweeps over windows of consecutive row
+// blocks, as many as the budget allows. A window's blocks are read once; the
+// pivot blocks of all earlier windows are then streamed past them in panel
+// order, at most OOC_PIVOT_SLOTS resident at a time, while the window's own
+// panels run in core as usual. A block is written back as soon as its last
+// task retires and released when its window ends; a pivot block is released
+// once every block of the window has applied its panels (it is final on disk
+// already).
+//
+// A helper I/O thread (run()) does every read and write. It keeps the next
+// pivot blocks loaded ahead of the tasks that apply them and, once a window
+// has only its own panels left, starts on the pivot blocks of the next
+// window. The scheduler passes each ready task through admit(), which holds
+// it back while its rows are not resident; the I/O thread hands it to the
+// ready queue after the load. Within a pivot block, and after a block's first
+// task, its rows stay put, so only the first task of each panel block takes
+// the lock.
+//
+// As in distributed.h, the matrix keeps its global row-major indexing in one
+// reserved address range, so the kernels run unchanged: loads fill rows in
+// place and evictions hand the pages back with release_rows(). The budget
+// covers the resident row blocks only; the reflector scalars, the T factors
+// and the task graph stay in memory.
+
+// Pivot blocks resident at once: the one being applied and the next.
+static constexpr int OOC_PIVOT_SLOTS = 2;
+
+class OutOfCoreMatrix {
+public:
+    OutOfCoreMatrix() = default;
+    OutOfCoreMatrix(const OutOfCoreMatrix&) = delete;
+    OutOfCoreMatrix& operator=(const OutOfCoreMatrix&) = delete;
+    ~OutOfCoreMatrix() { close(); }
+
+    // Copies the double matrix at offset of the binary file input into the
+    // working file path (empty: an unnamed temporary file in scratch_dir, or
+    // $TMPDIR, or /tmp) and plans sweeps of whole beta-row blocks whose
+    // resident blocks fit in budget_bytes. Throws std::invalid_argument if
+    // the budget holds fewer than 1 + OOC_PIVOT_SLOTS blocks.
+    void open(const std::string& input, uint64_t offset, const std::string& path, const std::string& scratch_dir,
+              int alpha, int beta, size_t budget_bytes) {
+        close();
+        int in = ::open(input.c_str(), O_RDONLY);
+        if (in < 0) {
+            throw std::runtime_error("Error opening file: " + input);
+        }
+        matrix_file_header_t header;
+        if (::pread(in, &header, sizeof(header), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(header)) ||
+            std::memcmp(header.magic, MATRIX_FILE_MAGIC, sizeof(MATRIX_FILE_MAGIC)) != 0 ||
+            header.version != MATRIX_FILE_VERSION || header.byte_order != MATRIX_FILE_BYTE_ORDER ||
+            header.dtype != MATRIX_DTYPE_FLOAT64 || header.elem_size != sizeof(double) ||
+            header.rows > static_cast<uint64_t>(std::numeric_limits<int>::max()) ||
+            header.cols > static_cast<uint64_t>(std::numeric_limits<int>::max())) {
+            ::close(in);
+            throw std::runtime_error("Error reading " + input + ": out-of-core runs need a binary matrix of doubles.");
+        }
+        m_ = static_cast<int>(header.rows);
+        n_ = static_cast<int>(header.cols);
+        bda_ = beta / alpha;
+        panels_ = TaskTable::task_cols(m_, n_, alpha);
+        blocks_ = TaskTable::task_rows(m_, beta);
+        layout_ = RowBlockCyclic(1, 0, blocks_, beta, m_);
+
+        // Block 0 holds one row more than the others.
+        const size_t block_max = static_cast<size_t>(beta + 1) * n_ * sizeof(double);
+        const size_t slots = budget_bytes / std::max<size_t>(block_max, 1);
+        if (slots >= static_cast<size_t>(blocks_)) {
+            window_ = blocks_;
+        } else if (slots >= static_cast<size_t>(1 + OOC_PIVOT_SLOTS)) {
+            window_ = static_cast<int>(slots) - OOC_PIVOT_SLOTS;
+        } else {
+            ::close(in);
+            throw std::invalid_argument("A memory budget of " + std::to_string(budget_bytes >> 20) + " MB holds " +
+                                        std::to_string(slots) + " row blocks of " +
+                                        std::to_string(block_max >> 10) + " KB; out-of-core runs need at least " +
+                                        std::to_string(1 + OOC_PIVOT_SLOTS) + ".");
+        }
+        budget_ = budget_bytes;
+
+        std::string where = path;
+        if (path.empty()) {
+            std::string dir = scratch_dir;
+            if (dir.empty()) {
+                const char* tmp = std::getenv("TMPDIR");
+                dir = tmp != nullptr && *tmp != '\0' ? tmp : "/tmp";
+            }
+            where = dir;
+            std::string name = dir + "/parqr-ooc-XXXXXX";
+            fd_ = ::mkstemp(&name[0]);
+            if (fd_ >= 0) {
+                ::unlink(name.c_str());
+            }
+        } else {
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        }
+        if (fd_ < 0) {
+            ::close(in);
+            throw std::runtime_error(std::string("Error creating the out-of-core working file ") +
+                                     (path.empty() ? "in " : "") + where);
+        }
+
+        // The working file: a fresh header and the input's elements.
+        const matrix_file_header_t out = make_matrix_file_header<double>(header.rows, header.cols,
+                                                                         MATRIX_FILE_ALIGNMENT);
+        data_offset_ = out.data_offset;
+        std::vector<char> buffer(out.data_offset, 0);
+        std::memcpy(buffer.data(), &out, sizeof(out));
+        io(true, fd_, buffer.data(), buffer.size(), 0);
+        const uint64_t bytes = header.rows * header.cols * sizeof(double);
+        buffer.resize(std::min<uint64_t>(bytes, 8 << 20));
+        for (uint64_t done = 0; done < bytes; done += buffer.size()) {
+            const size_t chunk = static_cast<size_t>(std::min<uint64_t>(buffer.size(), bytes - done));
+            try {
+                io(false, in, buffer.data(), chunk, offset + header.data_offset + done);
+                io(true, fd_, buffer.data(), chunk, data_offset_ + done);
+            } catch (...) {
+                ::close(in);
+                close();
+                throw;
+            }
+        }
+        ::close(in);
+
+        // Reserve the whole matrix; pages are only committed by loads.
+        map_length_ = std::max<size_t>(static_cast<size_t>(m_) * n_ * sizeof(double), 1);
+        void* base = ::mmap(nullptr, map_length_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                            -1, 0);
+        if (base == MAP_FAILED) {
+            close();
+            throw std::runtime_error("Cannot reserve the address range of the out-of-core matrix.");
+        }
+        data_ = static_cast<double*>(base);
+
+        parked_.assign(blocks_, nullptr);
+        resident_.assign(blocks_, 0);
+        waiters_.assign(blocks_, std::vector<Task*>());
+        block_pending_.reset(new std::atomic<int>[blocks_]());
+        pivot_pending_.reset(new std::atomic<int>[blocks_]());
+        admitted_ = 0;
+        window_first_.store(0, std::memory_order_relaxed);
+    }
+
+    bool enabled() const { return fd_ >= 0; }
+    double* data() const { return data_; }
+    int rows() const { return m_; }
+    int cols() const { return n_; }
+    int blocks() const { return blocks_; }
+    int window() const { return window_; }
+    int sweeps() const { return (blocks_ + window_ - 1) / window_; }
+    size_t budget() const { return budget_; }
+
+    // Blocks read and bytes moved by run(), and the most bytes of row blocks
+    // resident at once.
+    long long loads = 0;
+    size_t bytes_read = 0;
+    size_t bytes_written = 0;
+    size_t peak_resident = 0;
+
+    // Called for every task that has become ready. Returns true if the task
+    // can run now; otherwise it is held and run() hands it to its ready()
+    // callback once its rows are resident. Safe from any thread.
+    bool admit(Task* task) {
+        const int j = task->chunk_idx_j;
+        if (j % bda_ != 0) {
+            return true;
+        }
+        const int i = task->chunk_idx_i;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (i >= admitted_) {
+            parked_[i] = task;
+            return false;
+        }
+        const int p = j / bda_;
+        if (task->type == 2 && p < window_first_.load(std::memory_order_relaxed) && !resident_[p]) {
+            waiters_[p].push_back(task);
+            return false;
+        }
+        return true;
+    }
+
+    // Called after a task has run, before its successors are released. Safe
+    // from any thread.
+    void retire(const Task* task) {
+        const int i = task->chunk_idx_i;
+        const int p = task->chunk_idx_j / bda_;
+        const bool pivot_done = task->type == 2 && p < window_first_.load(std::memory_order_relaxed) &&
+                                pivot_pending_[p].fetch_sub(1, std::memory_order_acq_rel) == 1;
+        const bool block_done = block_pending_[i].fetch_sub(1, std::memory_order_acq_rel) == 1;
+        if (pivot_done || block_done) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (pivot_done) {
+                done_pivots_.push_back(p);
+            }
+            if (block_done) {
+                done_blocks_.push_back(i);
+            }
+            events_.notify_one();
+        }
+    }
+
+    // The I/O thread: runs every sweep, passing the tasks admit() held back
+    // to ready() as their rows arrive, and returns once the last block is
+    // written back. The root task must go through admit() as well.
+    void run(const std::function<void(Task*)>& ready) {
+        int pivot_sweep = 0;   // Sweep the pivot stream is loading for
+        int next_pivot = 0;    // Next pivot block of that sweep
+        int resident_pivots = 0;
+        std::vector<Task*> released;
+        std::vector<int> done_blocks, done_pivots;
+
+        for (int w = 0; w < sweeps(); w++) {
+            const int lo = w * window_, hi = std::min(lo + window_, blocks_), needed = pivots_needed(w);
+            for (int p = 0; p < needed; p++) {
+                pivot_pending_[p].store((hi - lo) * panels_of(p), std::memory_order_relaxed);
+            }
+            for (int i = lo; i < hi; i++) {
+                block_pending_[i].store(std::min((i + 1) * bda_, panels_), std::memory_order_relaxed);
+            }
+            window_first_.store(lo, std::memory_order_relaxed);
+            if (pivot_sweep < w) {
+                pivot_sweep = w;
+                next_pivot = 0;
+            }
+
+            int loaded = lo, stored = 0, retired = 0;
+            while (stored < hi - lo) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    done_blocks.swap(done_blocks_);
+                    done_pivots.swap(done_pivots_);
+                }
+                for (int p : done_pivots) {
+                    evict(p);
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    resident_[p] = 0;
+                    resident_pivots--;
+                    retired++;
+                }
+                for (int i : done_blocks) {
+                    store(i);
+                    stored++;
+                }
+                if (!done_blocks.empty() || !done_pivots.empty()) {
+                    done_blocks.clear();
+                    done_pivots.clear();
+                    continue;
+                }
+
+                // Once this sweep's pivot blocks are all applied, prefetch
+                // those of the next sweep that are already final on disk.
+                if (pivot_sweep == w && next_pivot == needed && retired == needed && w + 1 < sweeps()) {
+                    pivot_sweep = w + 1;
+                    next_pivot = 0;
+                }
+                const int limit = pivot_sweep == w ? needed : std::min(pivots_needed(w + 1), lo);
+                if (resident_pivots < OOC_PIVOT_SLOTS && next_pivot < limit) {
+                    load(next_pivot);
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    resident_[next_pivot] = 1;
+                    released.swap(waiters_[next_pivot]);
+                    next_pivot++;
+                    resident_pivots++;
+                } else if (loaded < hi) {
+                    load(loaded);
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    admitted_ = loaded + 1;
+                    if (parked_[loaded] != nullptr) {
+                        released.push_back(parked_[loaded]);
+                        parked_[loaded] = nullptr;
+                    }
+                    loaded++;
+                } else {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    events_.wait(lock, [this] { return !done_blocks_.empty() || !done_pivots_.empty(); });
+                    continue;
+                }
+                for (Task* task : released) {
+                    ready(task);
+                }
+                released.clear();
+            }
+            for (int i = lo; i < hi; i++) {
+                evict(i);
+            }
+        }
+    }
+
+private:
+    int m_ = 0;
+    int n_ = 0;
+    int bda_ = 1;               // Panels per row block
+    int panels_ = 0;
+    int blocks_ = 0;
+    int window_ = 1;            // Row blocks per sweep
+    size_t budget_ = 0;
+    RowBlockCyclic layout_;
+    int fd_ = -1;               // Working file
+    uint64_t data_offset_ = 0;
+    double* data_ = nullptr;
+    size_t map_length_ = 0;
+    size_t resident_bytes_ = 0;
+
+    // Guarded by mutex_.
+    std::mutex mutex_;
+    std::condition_variable events_;
+    int admitted_ = 0;                          // Blocks [0, admitted_) have been loaded
+    std::vector<Task*> parked_;                 // Per block: its first task, until it is loaded
+    std::vector<char> resident_;                // Per block: loaded as a pivot block
+    std::vector<std::vector<Task*>> waiters_;   // Per pivot block: tasks waiting for it
+    std::vector<int> done_blocks_, done_pivots_;
+
+    std::atomic<int> window_first_{0};                  // First block of the current sweep
+    std::unique_ptr<std::atomic<int>[]> block_pending_; // Per block of the sweep: tasks left
+    std::unique_ptr<std::atomic<int>[]> pivot_pending_; // Per pivot block: type-2 tasks of the sweep left
+
+    // Blocks holding pivots: those with at least one panel.
+    int pivot_blocks() const { return (panels_ + bda_ - 1) / bda_; }
+    int pivots_needed(int w) const { return std::min(w * window_, pivot_blocks()); }
+    int panels_of(int p) const { return std::min((p + 1) * bda_, panels_) - p * bda_; }
+
+    size_t block_bytes(int i) const {
+        return static_cast<size_t>(layout_.block_end(i) - layout_.block_begin(i)) * n_ * sizeof(double);
+    }
+    double* block_data(int i) const { return data_ + static_cast<size_t>(layout_.block_begin(i)) * n_; }
+    uint64_t block_offset(int i) const {
+        return data_offset_ + static_cast<uint64_t>(layout_.block_begin(i)) * n_ * sizeof(double);
+    }
+
+    void load(int i) {
+        io(false, fd_, block_data(i), block_bytes(i), block_offset(i));
+        loads++;
+        bytes_read += block_bytes(i);
+        resident_bytes_ += block_bytes(i);
+        peak_resident = std::max(peak_resident, resident_bytes_);
+    }
+
+    void store(int i) {
+        io(true, fd_, block_data(i), block_bytes(i), block_offset(i));
+        bytes_written += block_bytes(i);
+    }
+
+    void evict(int i) {
+        release_rows(data_, n_, layout_.block_begin(i), layout_.block_end(i));
+        resident_bytes_ -= block_bytes(i);
+    }
+
+    // Reads or writes all of [buf, buf + bytes) at offset of fd.
+    static void io(bool write, int fd, void* buf, size_t bytes, uint64_t offset) {
+        char* p = static_cast<char*>(buf);
+        for (size_t done = 0; done < bytes;) {
+            const ssize_t got = write ? ::pwrite(fd, p + done, bytes - done, static_cast<off_t>(offset + done))
+                                      : ::pread(fd, p + done, bytes - done, static_cast<off_t>(offset + done));
+            if (got <= 0) {
+                throw std::runtime_error(std::string("Out-of-core ") + (write ? "write" : "read") + " failed: " +
+                                         (got == 0 ? "unexpected end of file" : std::strerror(errno)));
+            }
+            done += static_cast<size_t>(got);
+        }
+    }
+
+    void close() {
+        if (data_ != nullptr) {
+            ::munmap(data_, map_length_);
+            data_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+};
+
+#endif // OUT_OF_CORE_H
@@ -0,0 +1,210 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+// NUMA placement for the drivers: which CPU and node each worker runs on, and
+// which worker owns each row block of the matrix. Row block b (beta rows,
+// the target rows of task row i == b) is owned by worker b % num_threads; the
+// matrix storage is first-touched by the owners (matrix_t::first_touch) and
+// the work-stealing queue routes a task to its block's node. Topology comes
+// from sysfs, so no libnuma is needed.
+
+// Parses a kernel CPU list such as "0-3,8,10-11".
+inline std::vector<int> parse_cpu_list(const std::string &text)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(text);
+    std::string range;
+    while (std::getline(ss, range, ','))
+    {
+        range.erase(std::remove_if(range.begin(), range.end(), [](unsigned char c) { return std::isspace(c); }),
+                    range.end());
+        if (range.empty())
+        {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// NUMA nodes and their CPUs, restricted to the CPUs this process may run on.
+struct CpuTopology
+{
+    std::vector<std::vector<int>> node_cpus;    // Only nodes with usable CPUs
+
+    int num_nodes() const { return static_cast<int>(node_cpus.size()); }
+
+    // Reads /sys/devices/system/node; falls back to one node holding the
+    // affinity mask if that is unavailable.
+    static CpuTopology detect()
+    {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                CPU_SET(cpu, &allowed);
+            }
+        }
+
+        CpuTopology topology;
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string nodes;
+        std::getline(online, nodes);
+        for (int node : parse_cpu_list(nodes))
+        {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string text;
+            std::getline(list, text);
+            std::vector<int> usable;
+            for (int cpu : parse_cpu_list(text))
+            {
+                if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                {
+                    usable.push_back(cpu);
+                }
+            }
+            if (!usable.empty())
+            {
+                topology.node_cpus.push_back(usable);
+            }
+        }
+
+        if (topology.node_cpus.empty())
+        {
+            std::vector<int> usable;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &allowed))
+                {
+                    usable.push_back(cpu);
+                }
+            }
+            topology.node_cpus.push_back(usable);
+        }
+        return topology;
+    }
+};
+
+// How workers are bound to CPUs.
+enum class PlacementPolicy
+{
+    none,       // Not bound; the kernel places threads and pages
+    compact,    // Fill the CPUs of node 0, then node 1, ...
+    scatter     // Round-robin over the nodes
+};
+
+inline const char *placement_policy_name(PlacementPolicy policy)
+{
+    switch (policy)
+    {
+    case PlacementPolicy::compact: return "compact";
+    case PlacementPolicy::scatter: return "scatter";
+    default:                       return "none";
+    }
+}
+
+inline PlacementPolicy parse_placement_policy(const std::string &text)
+{
+    if (text == "none")    return PlacementPolicy::none;
+    if (text == "compact") return PlacementPolicy::compact;
+    if (text == "scatter") return PlacementPolicy::scatter;
+    throw std::invalid_argument("Unknown placement policy: " + text);
+}
+
+// CPU and node of every worker under a policy. More workers than CPUs wrap
+// around. With PlacementPolicy::none every worker is on node 0 of a one-node
+// placement, so nothing downstream distinguishes nodes.
+class ThreadPlacement
+{
+    PlacementPolicy policy_ = PlacementPolicy::none;
+    int nodes_ = 1;
+    std::vector<int> cpu_;      // Per worker; -1 when unbound
+    std::vector<int> node_;     // Per worker
+
+public:
+    ThreadPlacement() = default;
+
+    ThreadPlacement(const CpuTopology &topology, PlacementPolicy policy, int num_threads)
+        : policy_(policy), cpu_(num_threads, -1), node_(num_threads, 0)
+    {
+        if (policy == PlacementPolicy::none || topology.num_nodes() == 0)
+        {
+            policy_ = PlacementPolicy::none;
+            return;
+        }
+        nodes_ = topology.num_nodes();
+
+        if (policy == PlacementPolicy::compact)
+        {
+            std::vector<std::pair<int, int>> order;     // (cpu, node)
+            for (int node = 0; node < nodes_; node++)
+            {
+                for (int cpu : topology.node_cpus[node])
+                {
+                    order.emplace_back(cpu, node);
+                }
+            }
+            for (int tid = 0; tid < num_threads; tid++)
+            {
+                cpu_[tid] = order[tid % order.size()].first;
+                node_[tid] = order[tid % order.size()].second;
+            }
+        }
+        else
+        {
+            for (int tid = 0; tid < num_threads; tid++)
+            {
+                const int node = tid % nodes_;
+                const std::vector<int> &cpus = topology.node_cpus[node];
+                cpu_[tid] = cpus[(tid / nodes_) % cpus.size()];
+                node_[tid] = node;
+            }
+        }
+    }
+
+    PlacementPolicy policy() const { return policy_; }
+    int num_nodes() const { return nodes_; }
+    int num_threads() const { return static_cast<int>(node_.size()); }
+    int cpu_of(int tid) const { return cpu_[tid]; }
+    int node_of(int tid) const { return node_[tid]; }
+
+    // Owner of row block `block` and the node its pages live on.
+    int block_owner(int block) const { return block % num_threads(); }
+    int block_node(int block) const { return node_[block_owner(block)]; }
+
+    // Binds the calling thread to worker tid's CPU. Returns false if the
+    // kernel refused; a no-op that succeeds when workers are not bound.
+    bool bind(int tid) const
+    {
+        if (policy_ == PlacementPolicy::none)
+        {
+            return true;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu_[tid], &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+};
+
+#endif // PLACEMENT_H
@@ -0,0 +1,101 @@
+#ifndef QR_ENGINE_H
+#define QR_ENGINE_H
+
+#include <memory>
+#include <vector>
+#include "bn2.h"
+#include "downdate.h"
+#include "run_config.h"
+
+// Embeddable factorization engine (libparqr.a, built with make lib). A
+// QrEngine owns a resident pool of worker threads that runs the same task
+// graph and kernels as the dynamic scheduler of main.cpp, so a server can
+// factorize matrices without starting a process or any threads per call.
+//
+// factor() may be called from several client threads at once. Each call is
+// a job with its own task graph; the jobs share the pool and its ready queue,
+// as the matrices of a --batch run do, so one job's panel chain overlaps the
+// others' updates. A job runs in one of max_jobs contexts, which keep their
+// task table, dependency table and reflector storage for the next call: a
+// call with the shape of an earlier one only resets them. Callers beyond
+// max_jobs wait for a context to free up.
+//
+//     QrEngine engine(QrEngineOptions{8, 4, 16});
+//     matrix_t<double> m;
+//     m.read_matrix("matrix.txt");
+//     engine.factor(m);   // In place, as a.out -t 8 -a 4 -b 16 would
+//
+// Workers park when there is no work and the engine is destroyed only after
+// every factor() call has returned.
+
+struct QrEngineOptions {
+    int threads = 0;                    // Worker threads; 0: one per hardware thread
+    int alpha = 4;                      // Pivots per task
+    int beta = 16;                      // Rows per task, a multiple of alpha
+    Type2Mode type2 = Type2Mode::wy;
+    QueuePolicy queue = QueuePolicy::fifo;  // fifo or priority
+    TaskGraphMode graph = TaskGraphMode::eager;
+    int max_jobs = 8;                   // factor() calls in flight at once
+    int idle_spins = 100;               // Failed pops spent spinning before yielding
+    int idle_yields = 10;               // Failed pops spent yielding before parking
+};
+
+class QrEngine {
+public:
+    // Starts the workers. Throws std::invalid_argument for bad options.
+    explicit QrEngine(const QrEngineOptions& options = QrEngineOptions());
+    ~QrEngine();
+
+    QrEngine(const QrEngine&) = delete;
+    QrEngine& operator=(const QrEngine&) = delete;
+
+    // Factorizes the rows of mat in place, converting a tiled matrix to
+    // row-major first. The result is the one a.out saves with the same
+    // alpha, beta and type-2 kernel. Safe to call from several threads at
+    // once on different matrices; blocks until this matrix is done.
+    void factor(matrix_t<double>& mat);
+
+    // The same, also returning the reflector scalars that apply_qt() and
+    // QApplier (lstsq.h) take with the factorized matrix.
+    void factor(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b);
+
+    // Incremental updates of such a factorization (see qr_update.h), run as
+    // small task graphs on the same pool. append_rows() turns the m x n
+    // factorization mat, up, b into that of M with the k rows of rows below
+    // it, in O(k min(m, n) n) work; mat grows to m + k rows. delete_rows()
+    // removes rows [first, first + count) of M in the same format, which
+    // refactorizes the rows after them: cheap for the last rows, more than a
+    // refactorization for old ones. Both throw std::invalid_argument for
+    // mismatched shapes.
+    void append_rows(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b,
+                     const matrix_t<double>& rows);
+    void delete_rows(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b, int first, int count);
+
+    // The same for a factorization that may have deleted rows (downdate.h),
+    // as a.out --append and --delete-rows run them; first and count number
+    // the rows of M, without the ghosts. Deleting old rows retriangularizes
+    // the rows after them with Givens rotations, O(count m n) work, unless
+    // compacting (see compact()) costs less, or the rotations have piled up
+    // to where undoing them would cost more than a refactorization.
+    // Appending applies the rotations to the new rows and retriangularizes
+    // them.
+    void append_rows(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b, Downdate& downdate,
+                     const matrix_t<double>& rows);
+    void delete_rows(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b, Downdate& downdate,
+                     int first, int count);
+
+    // Turns a factorization with deleted rows into the one factor() gives
+    // for the rows of M that are left, and clears downdate: the rows after
+    // the first ghost are restored and refactorized.
+    void compact(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b, Downdate& downdate);
+
+    int threads() const;
+    const QrEngineOptions& options() const;
+
+private:
+    struct Context;
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+#endif // QR_ENGINE_H
@@ -0,0 +1,397 @@
+#ifndef QR_UPDATE_H
+#define QR_UPDATE_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "bn2.h"
+#include "downdate.h"
+#include "kernels.h"
+#include "lstsq.h"
+
+// Updating the factorization of M when rows are appended or removed
+// (QrEngine::append_rows and delete_rows, a.out --append and --delete-rows).
+//
+// Row i of a factorized M depends on rows [0, i] only: reflector i is
+// generated from row i once reflectors 0 .. i-1 have been applied to it. So
+// appending k rows to a factorized m x n matrix leaves its m rows as they
+// are, and the new rows need
+//
+//   1. the p = min(m, n) existing reflectors, applied in order: the type-2
+//      tasks of a full factorization that touch them, and
+//   2. a factorization of their columns [p, n), which generates reflectors
+//      p .. min(m + k, n) - 1 (nothing to do when m >= n),
+//
+// O(k p n + k^2 n) work instead of the O((m + k)^2 n) of refactorizing. The
+// result is the factorization of [M; rows] in the format factor() saves, up
+// to rounding: the panels of the new pivots start at p, not on the panel
+// grid of a full run.
+//
+// Removing rows [first, first + count) keeps the rows before them. Each row
+// i after them is taken back to its state before reflector s = min(first, p)
+// by applying H_min(i, p-1) ... H_s to its stored [L_i 0] (a reflector is its
+// own inverse), and the restored rows are appended to the first `first` rows
+// with step 2 only. Removing the most recent rows is therefore free, while
+// removing old ones changes every later reflector: the rows after them are
+// restored one reflector at a time and refactorized, more work than a
+// refactorization. QrEngine does that only to keep the reflector format, or
+// to compact a downdated factorization (downdate.h), and otherwise deletes
+// old rows by Givens downdating: the deleted rows stay as ghosts, and the
+// rows after them are retriangularized with count rotations each.
+//
+// RowUpdateGraph holds the tasks of step 1, of a restore and of the Givens
+// sweeps, for the engine's workers. Step 1 cuts the new rows into blocks and
+// the reflectors into the panels of TaskTable (the first alpha + 1 pivots,
+// then alpha each). Task (i, j) applies panel j to block i after (i, j - 1),
+// like the type-2 chain of a row block; with --type2 wy it also waits for a
+// task that rebuilds the panel's WY factor from the stored reflectors.
+// Restore tasks are independent, as are the tasks that apply the stored
+// rotations to appended rows. A Givens sweep is a factorization's graph with
+// rotations in place of reflectors: the rows of L are cut into blocks, the
+// diagonal task (j, j) generates the rotations of the rows of block j, and
+// task (i, j) applies them to block i after (i, j - 1) and (j, j). Step 2 is
+// an ordinary factorization.
+
+class RowUpdateGraph {
+public:
+    // Task::type of the update tasks.
+    enum : unsigned char {
+        wy_factor = 1,      // Builds the T factor of panel chunk_idx_j
+        apply_panel = 2,    // Applies panel chunk_idx_j to block chunk_idx_i
+        restore_rows = 3,   // Restores block chunk_idx_i into the output rows
+        givens = 4,         // Applies the rotations of block chunk_idx_j to block chunk_idx_i
+        rotate_rows = 5     // Applies the stored rotations to block chunk_idx_i
+    };
+
+    // Tasks that apply reflectors [0, pivots) of mat (row-major, n columns,
+    // scalars up/b) to its rows [first_row, last_row), block_rows at a time.
+    void init_append(double* mat, int n, const double* up, const double* b, int first_row, int last_row,
+                     int pivots, int alpha, int block_rows, bool wy, uint32_t graph_id) {
+        reset(mat, n, up, b, first_row, last_row, block_rows, graph_id);
+        num_pivots = pivots;
+        ldt = alpha + 1;
+        panels = 0;
+        for (int p = 0; p < pivots; p = panel_end(p, alpha, pivots)) {
+            panels++;
+        }
+        num_wy = wy ? panels : 0;
+        t.assign((size_t)num_wy * ldt * ldt, 0.0);
+        allocate((size_t)num_wy + (size_t)blocks * panels);
+
+        int p = 0;
+        for (int j = 0; j < panels; j++) {
+            const int end = panel_end(p, alpha, pivots);
+            if (wy) {
+                init_task(&tasks[j], wy_factor, p, end, 0, 0, 0, j, panels - j, 0);
+            }
+            for (int i = 0; i < blocks; i++) {
+                const int r0 = first_row + i * block_rows;
+                const int r1 = std::min(r0 + block_rows, last_row);
+                init_task(apply_task(i, j), apply_panel, p, end, r0, r1, i, j, panels - j, (j > 0) + (wy ? 1 : 0));
+            }
+            p = end;
+        }
+    }
+
+    // Tasks that write count rows of the factorized mat, as they were before
+    // reflector from_pivot of pivots, to its rows from target_row on, which lie
+    // past every reflector row. Output row k is stored row rows[k], ascending.
+    // For a downdated factorization, whose stored rows hold rotated rows of
+    // L, the rotations are undone first.
+    void init_restore(double* mat, int n, const double* up, const double* b, const int* rows, int count,
+                      const Rotation* rotations, size_t num_rotations, int target_row, int from_pivot, int pivots,
+                      int block_rows, uint32_t graph_id) {
+        reset(mat, n, up, b, 0, count, block_rows, graph_id);
+        source = rows;
+        rotation = rotations;
+        rotation_count = num_rotations;
+        num_pivots = pivots;
+        restore_from = from_pivot;
+        target = target_row;
+        allocate(blocks);
+        for (int i = 0; i < blocks; i++) {
+            const int r0 = i * block_rows;
+            // Later rows undo more reflectors; run them first.
+            init_task(&tasks[i], restore_rows, from_pivot, pivots, r0, std::min(r0 + block_rows, count), i, 0,
+                      i, 0);
+        }
+    }
+
+    // Tasks that apply the rotations G_0 ... G_{count-1} to the rows
+    // [first_row, last_row) of mat, as rotated rows of L.
+    void init_rotate(double* mat, int n, int first_row, int last_row, const Rotation* rotations, size_t count,
+                     int block_rows, uint32_t graph_id) {
+        reset(mat, n, nullptr, nullptr, first_row, last_row, block_rows, graph_id);
+        rotation = rotations;
+        rotation_count = count;
+        allocate(blocks);
+        for (int i = 0; i < blocks; i++) {
+            const int r0 = first_row + i * block_rows;
+            init_task(&tasks[i], rotate_rows, 0, 0, r0, std::min(r0 + block_rows, last_row), i, 0, 0, 0);
+        }
+    }
+
+    // A Givens sweep that retriangularizes the rows [first_live, live_end) of
+    // L, row r of which is stored in row rows[r] of mat and reaches column
+    // min(n - 1, r + extra): rotation (r, c) zeroes column c of row r into its
+    // diagonal, for c = r + 1 .. min(n - 1, r + extra) in order, and goes on
+    // to the rows below. The rotations are appended to rotations, pivot by
+    // pivot, when the tasks run; rows before first_live are already
+    // triangular and not touched.
+    void init_givens(double* mat, int n, const int* rows, int first_live, int live_end, int extra,
+                     std::vector<Rotation>& rotations, int block_rows, uint32_t graph_id) {
+        reset(mat, n, nullptr, nullptr, first_live, live_end, block_rows, graph_id);
+        source = rows;
+        sweep_extra = extra;
+        const int pivot_end = std::max(first_live, std::min(live_end, n - 1));
+        slots.assign(pivot_end - first_live + 1, rotations.size());
+        for (int r = first_live; r < pivot_end; r++) {
+            const int count = std::max(0, std::min(n - 1, r + extra) - r);
+            slots[r - first_live + 1] = slots[r - first_live] + count;
+        }
+        rotations.resize(slots.back());
+        generated = rotations.data();
+        if (slots.back() == slots.front()) {
+            allocate(0);
+            return;
+        }
+        pivot_blocks = (pivot_end - first_live + block_rows - 1) / block_rows;
+        allocate(givens_task_index(blocks, 0));
+        for (int i = 0; i < blocks; i++) {
+            const int r0 = first_live + i * block_rows;
+            const int r1 = std::min(r0 + block_rows, live_end);
+            for (int j = 0; j <= std::min(i, pivot_blocks - 1); j++) {
+                const int p0 = first_live + j * block_rows;
+                const int p1 = std::min(p0 + block_rows, pivot_end);
+                init_task(givens_task(i, j), givens, p0, p1, r0, r1, i, j, 2 * (blocks - j) + (i == j),
+                          (j > 0) + (j < i));
+            }
+        }
+    }
+
+    int numTasks() const { return num_tasks; }
+
+    // Hands the tasks without predecessors to ready.
+    template <class ReadyFn>
+    void roots(ReadyFn&& ready) {
+        for (int k = 0; k < num_tasks; k++) {
+            if (tasks[k].num_deps == 0) {
+                ready(&tasks[k]);
+            }
+        }
+    }
+
+    void run(const Task* task) {
+        const KernelSet& kernels = active_kernels<double>();
+        switch (task->type) {
+            case wy_factor:
+                build_wy_factor(mat, n, task->row_start, task->row_end, up, b, t_of(task->chunk_idx_j), ldt);
+                break;
+            case apply_panel:
+                if (num_wy > 0) {
+                    kernels.apply_wy(mat, n, task->row_start, task->row_end, task->col_start, task->col_end, up,
+                                     t_of(task->chunk_idx_j), ldt);
+                } else {
+                    kernels.apply(mat, n, task->row_start, task->row_end, task->col_start, task->col_end, up, b);
+                }
+                break;
+            case givens:
+                givens_block(task);
+                break;
+            case rotate_rows:
+                rotate_block(task->col_start, task->col_end);
+                break;
+            default:
+                restore_block(task->col_start, task->col_end);
+                break;
+        }
+    }
+
+    // Hands the successors that task completes to ready.
+    template <class ReadyFn>
+    void releaseSuccessors(const Task* task, ReadyFn&& ready) {
+        const int j = task->chunk_idx_j;
+        if (task->type == wy_factor) {
+            for (int i = 0; i < blocks; i++) {
+                release(apply_task(i, j), ready);
+            }
+        } else if (task->type == apply_panel && j + 1 < panels) {
+            release(apply_task(task->chunk_idx_i, j + 1), ready);
+        } else if (task->type == givens) {
+            const int i = task->chunk_idx_i;
+            if (j < std::min(i, pivot_blocks - 1)) {
+                release(givens_task(i, j + 1), ready);
+            }
+            if (i == j) {
+                for (int below = i + 1; below < blocks; below++) {
+                    release(givens_task(below, j), ready);
+                }
+            }
+        }
+    }
+
+private:
+    std::unique_ptr<Task[]> tasks;
+    int num_tasks = 0;
+    int capacity = 0;
+    std::vector<double> t;      // WY factors of the panels, ldt x ldt each
+    double* mat = nullptr;
+    const double* up = nullptr;
+    const double* b = nullptr;
+    int target = 0;             // Row that restore writes row first to
+    int n = 0;
+    int first = 0;              // First row of block 0
+    int blocks = 0;
+    int panels = 0;
+    int num_wy = 0;             // WY factor tasks, stored before the apply tasks
+    int num_pivots = 0;
+    int restore_from = 0;
+    int ldt = 1;
+    uint32_t graph = 0;
+    const int* source = nullptr;    // Stored row of each restored row, or of each row of L
+    const Rotation* rotation = nullptr;     // The rotations restore and rotate tasks apply
+    Rotation* generated = nullptr;          // The rotations of a Givens sweep
+    size_t rotation_count = 0;
+    std::vector<size_t> slots;      // First rotation of each pivot of a Givens sweep, and the end
+    int pivot_blocks = 0;           // Blocks of a Givens sweep that hold pivots
+    int sweep_extra = 0;            // Columns past its diagonal a row of the sweep reaches
+
+    static int panel_end(int p, int alpha, int pivots) {
+        return std::min(p == 0 ? alpha + 1 : p + alpha, pivots);
+    }
+
+    Task* apply_task(int i, int j) { return &tasks[num_wy + (size_t)i * panels + j]; }
+    double* t_of(int panel) { return t.data() + (size_t)panel * ldt * ldt; }
+
+    // Block i of a Givens sweep has tasks for the pivot blocks [0, min(i + 1,
+    // pivot_blocks)), stored block after block.
+    size_t givens_task_index(int i, int j) const {
+        const size_t head = (size_t)std::min(i, pivot_blocks);
+        return head * (head + 1) / 2 + (size_t)(i - head) * pivot_blocks + j;
+    }
+    Task* givens_task(int i, int j) { return &tasks[givens_task_index(i, j)]; }
+
+    void reset(double* matrix, int cols, const double* up_array, const double* b_array, int first_row, int last_row,
+               int block_rows, uint32_t graph_id) {
+        mat = matrix;
+        n = cols;
+        up = up_array;
+        b = b_array;
+        first = first_row;
+        blocks = (last_row - first_row + block_rows - 1) / block_rows;
+        panels = 0;
+        num_wy = 0;
+        graph = graph_id;
+        source = nullptr;
+        rotation = nullptr;
+        generated = nullptr;
+        rotation_count = 0;
+        pivot_blocks = 0;
+    }
+
+    void allocate(size_t count) {
+        if ((int)count > capacity) {
+            tasks.reset(new Task[count]);
+            capacity = (int)count;
+        }
+        num_tasks = (int)count;
+    }
+
+    void init_task(Task* task, unsigned char type, int row_start, int row_end, int col_start, int col_end, int i,
+                   int j, int priority, int deps) {
+        task->row_start = row_start;
+        task->row_end = row_end;
+        task->col_start = col_start;
+        task->col_end = col_end;
+        task->chunk_idx_i = i;
+        task->chunk_idx_j = j;
+        task->priority = priority;
+        task->deps_remaining.store(deps, std::memory_order_relaxed);
+        task->graph = graph;
+        task->type = type;
+        task->num_deps = deps;
+        task->enq_nxt_t1 = false;
+    }
+
+    template <class ReadyFn>
+    void release(Task* task, ReadyFn& ready) {
+        if (task->deps_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            ready(task);
+        }
+    }
+
+    // Output rows [r0, r1) as they were before reflector restore_from: each
+    // stored [L_i 0] (with the rotations undone) with reflectors min(i, p - 1)
+    // down to restore_from applied. The block takes one reflector at a time,
+    // through the type-2 kernel.
+    void restore_block(int r0, int r1) const {
+        const KernelSet& kernels = active_kernels<double>();
+        for (int k = r0; k < r1; k++) {
+            const double* row = mat + (size_t)source[k] * n;
+            const int diag = std::min(source[k], n - 1);
+            double* y = mat + (size_t)(target + k) * n;
+            std::copy(row, row + diag + 1, y);
+            std::fill(y + diag + 1, y + n, 0.0);
+        }
+        if (rotation_count > 0) {
+            std::vector<double*> rows(r1 - r0);
+            std::vector<double> scratch;
+            for (int k = r0; k < r1; k++) {
+                rows[k - r0] = mat + (size_t)(target + k) * n;
+            }
+            apply_rotations_to_rows(rotation, rotation_count, rows.data(), r1 - r0, 0, n, true, scratch);
+            for (int k = r0; k < r1; k++) {
+                std::fill(rows[k - r0] + std::min(source[k], n - 1) + 1, rows[k - r0] + n, 0.0);
+            }
+        }
+        for (int q = std::min(source[r1 - 1], num_pivots - 1); q >= restore_from; q--) {
+            const int k = (int)(std::lower_bound(source + r0, source + r1, q) - source);
+            kernels.apply(mat, n, q, q + 1, target + k, target + r1, up, b);
+        }
+    }
+
+    double* live_row(int r) const { return mat + (size_t)source[r] * n; }
+
+    // Task (i, j) of a Givens sweep: pivots [row_start, row_end), rows
+    // [col_start, col_end). The diagonal task generates each pivot's
+    // rotations from its row and applies them to the rows below it in the
+    // block; the others apply every rotation of the pivots, row by row.
+    void givens_block(const Task* task) const {
+        const int p0 = task->row_start, p1 = task->row_end, r0 = task->col_start, r1 = task->col_end;
+        auto slot = [this](int p) { return slots[p - first]; };
+        if (task->chunk_idx_i == task->chunk_idx_j) {
+            for (int p = p0; p < p1; p++) {
+                Rotation* g = generated + slot(p);
+                const size_t count = slot(p + 1) - slot(p);
+                double* x = live_row(p);
+                for (size_t k = 0; k < count; k++) {
+                    g[k] = zeroing_rotation(p, p + 1 + (int)k, x);
+                }
+                for (int r = p + 1; r < r1; r++) {
+                    apply_rotations(g, count, live_row(r));
+                }
+            }
+            return;
+        }
+        std::vector<double*> rows(r1 - r0);
+        std::vector<double> scratch;
+        for (int r = r0; r < r1; r++) {
+            rows[r - r0] = live_row(r);
+        }
+        apply_rotations_to_rows(generated + slot(p0), slot(p1) - slot(p0), rows.data(), r1 - r0, p0,
+                                std::min(n, p1 + sweep_extra), false, scratch);
+    }
+
+    // Rows [r0, r1) of mat through the stored rotations.
+    void rotate_block(int r0, int r1) const {
+        std::vector<double*> rows(r1 - r0);
+        std::vector<double> scratch;
+        for (int r = r0; r < r1; r++) {
+            rows[r - r0] = mat + (size_t)r * n;
+        }
+        apply_rotations_to_rows(rotation, rotation_count, rows.data(), r1 - r0, 0, n, false, scratch);
+    }
+};
+
+#endif // QR_UPDATE_H
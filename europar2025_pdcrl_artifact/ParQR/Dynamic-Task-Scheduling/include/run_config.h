@@ -0,0 +1,460 @@
+#ifndef RUN_CONFIG_H
+#define RUN_CONFIG_H
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Ready-queue implementation used by the dynamic scheduler (main.cpp).
+enum class QueuePolicy {
+    fifo,       // tbb::concurrent_queue
+    priority,   // tbb::concurrent_priority_queue keyed on Task::priority
+    steal,      // Per-thread Chase-Lev deques with random-victim stealing
+    bucket      // One FIFO per Task::priority (see bucket_queue.h)
+};
+
+// How type-2 tasks apply a panel's reflectors (see kernels.h).
+enum class Type2Mode {
+    reflectors, // One reflector at a time, fused dot/axpy passes
+    wy          // Blocked, through the panel's compact WY factor
+};
+
+// Scalar type of the factorization (see kernels.h).
+enum class Precision {
+    fp64,       // Factorize in double
+    fp32,       // Factorize in float
+    mixed       // Factorize in float, refine least-squares solutions in double (see lstsq.h)
+};
+
+// Where the type-2 tasks of the device row blocks run (see device.h).
+enum class DeviceKind {
+    none,       // Every task runs on the CPU workers
+    host,       // A separate host copy, updated by the CPU kernels
+    cuda        // CUDA device memory and cuBLAS (builds with PARQR_CUDA only)
+};
+
+// File format of the factorized matrix saved with -o.
+enum class OutputFormat {
+    text,       // matrix_t::save: one row per line
+    binary      // The binary matrix format plus the reflector scalars (see checkpoint.h)
+};
+
+// Runtime parameters shared by both drivers. Each driver fills in its own
+// defaults, which are then overridden by PARQR_* environment variables and
+// finally by command-line options.
+struct RunConfig {
+    int num_threads = 1;
+    int alpha = 1;                      // Pivots (reflectors) per task
+    int beta = 1;                       // Rows per task
+    bool autotune = false;              // Pick alpha and beta at startup (see autotune.h)
+    std::string tune_cache;             // Tuning cache file; empty: the default, "none": no cache
+    QueuePolicy queue = QueuePolicy::fifo;
+    int idle_spins = 100;               // Failed pops spent spinning before yielding
+    int idle_yields = 10;               // Failed pops spent yielding before parking
+    std::string kernel_isa = "auto";    // auto | scalar | avx2 | avx512 (see kernels.h)
+    Type2Mode type2 = Type2Mode::wy;
+    Precision precision = Precision::fp64;
+    std::string layout = "row_major";   // row_major | tiled (see MatrixLayout in bn2.h)
+    int tile_cols = 512;                // Columns per tile; tiles are beta rows high
+    std::string placement = "none";     // none | compact | scatter (see placement.h)
+    std::string graph = "eager";        // eager | lazy (see TaskGraphMode in bn2.h)
+    bool tsqr = false;                  // Factorize short, wide matrices with TSQR (see tsqr.h)
+    int tsqr_leaf = 4096;               // Columns per TSQR leaf
+    bool batch = false;                 // Factorize every input in one worker pool
+    int batch_window = 4;               // Matrices in flight at once in batch mode
+    std::string input_file;             // First input
+    std::vector<std::string> inputs;    // All inputs; more than one only with --batch
+    std::string output_file;            // Empty: do not save the result
+    OutputFormat output_format = OutputFormat::text;
+    bool compress = false;              // gzip the binary result
+    std::string checkpoint_file;        // Empty: no checkpoints; resumed from if it exists
+    double checkpoint_interval = 600;   // Seconds between checkpoints, fractions allowed
+    std::string append_file;            // Rows to append to the factorization given as input (see qr_update.h)
+    int delete_first = 0;               // Rows [delete_first, delete_first + delete_count) to delete from it
+    int delete_count = 0;
+    std::string rhs_file;               // Right-hand side of a least-squares solve; empty: no solve
+    std::string solution_file;          // Empty: do not save the least-squares solution
+    std::string trace_file;             // Empty: no task trace (see trace.h)
+    std::string metrics_file;           // Empty: no metrics report (see metrics.h)
+    std::string timing_file;            // Empty: no timing record (see save_run_timing in metrics.h)
+    bool hw_counters = false;           // Add perf_event counters to the metrics
+    DeviceKind device = DeviceKind::none;   // Offload type-2 tasks (see device.h)
+    int device_share = 80;              // Percent of the row blocks kept on the device
+    int device_batch = 32;              // Ready device tasks run per synchronization
+    bool out_of_core = false;           // Keep the matrix in a file (see out_of_core.h)
+    int memory_budget = 1024;           // MB of row blocks resident at once out of core
+    std::string scratch_dir;            // Working file directory without -o; empty: $TMPDIR or /tmp
+
+    int beta_div_alpha() const { return beta / alpha; }
+    bool update() const { return !append_file.empty() || delete_count > 0; }
+};
+
+inline const char* queue_policy_name(QueuePolicy policy) {
+    switch (policy) {
+        case QueuePolicy::priority: return "priority";
+        case QueuePolicy::steal:    return "steal";
+        case QueuePolicy::bucket:   return "bucket";
+        default:                    return "fifo";
+    }
+}
+
+inline QueuePolicy parse_queue_policy(const std::string& text) {
+    if (text == "fifo" || text == "0") {
+        return QueuePolicy::fifo;
+    }
+    if (text == "priority" || text == "1") {
+        return QueuePolicy::priority;
+    }
+    if (text == "steal" || text == "2") {
+        return QueuePolicy::steal;
+    }
+    if (text == "bucket" || text == "3") {
+        return QueuePolicy::bucket;
+    }
+    throw std::invalid_argument("Unknown queue policy: " + text);
+}
+
+inline const char* type2_mode_name(Type2Mode mode) {
+    return mode == Type2Mode::wy ? "wy" : "reflectors";
+}
+
+inline Type2Mode parse_type2_mode(const std::string& text) {
+    if (text == "reflectors") {
+        return Type2Mode::reflectors;
+    }
+    if (text == "wy") {
+        return Type2Mode::wy;
+    }
+    throw std::invalid_argument("Unknown type-2 mode: " + text);
+}
+
+inline const char* precision_name(Precision precision) {
+    switch (precision) {
+        case Precision::fp32:  return "float";
+        case Precision::mixed: return "mixed";
+        default:               return "double";
+    }
+}
+
+inline Precision parse_precision(const std::string& text) {
+    if (text == "double") {
+        return Precision::fp64;
+    }
+    if (text == "float") {
+        return Precision::fp32;
+    }
+    if (text == "mixed") {
+        return Precision::mixed;
+    }
+    throw std::invalid_argument("Unknown precision: " + text);
+}
+
+inline const char* output_format_name(OutputFormat format) {
+    return format == OutputFormat::binary ? "binary" : "text";
+}
+
+inline OutputFormat parse_output_format(const std::string& text) {
+    if (text == "text") {
+        return OutputFormat::text;
+    }
+    if (text == "binary") {
+        return OutputFormat::binary;
+    }
+    throw std::invalid_argument("Unknown output format: " + text);
+}
+
+inline const char* device_kind_name(DeviceKind kind) {
+    switch (kind) {
+        case DeviceKind::host: return "host";
+        case DeviceKind::cuda: return "cuda";
+        default:               return "none";
+    }
+}
+
+inline DeviceKind parse_device_kind(const std::string& text) {
+    if (text == "none") {
+        return DeviceKind::none;
+    }
+    if (text == "host") {
+        return DeviceKind::host;
+    }
+    if (text == "cuda") {
+        return DeviceKind::cuda;
+    }
+    throw std::invalid_argument("Unknown device: " + text);
+}
+
+// Parses an integer of at least min_value, rejecting trailing garbage.
+inline int parse_bounded_int(const std::string& text, const std::string& what, long min_value) {
+    size_t consumed = 0;
+    long value = 0;
+    try {
+        value = std::stol(text, &consumed);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid value for " + what + ": " + text);
+    }
+    if (consumed != text.size() || value < min_value || value > 1 << 30) {
+        throw std::invalid_argument("Invalid value for " + what + ": " + text);
+    }
+    return static_cast<int>(value);
+}
+
+// Parses a duration in seconds, fractions allowed, of at least 1 ms (the
+// resolution of the checkpoint timer), rejecting trailing garbage.
+inline double parse_seconds(const std::string& text, const std::string& what) {
+    size_t consumed = 0;
+    double value = 0;
+    try {
+        value = std::stod(text, &consumed);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("Invalid value for " + what + ": " + text);
+    }
+    if (consumed != text.size() || !(value >= 1e-3 && value <= 1 << 30)) {
+        throw std::invalid_argument("Invalid value for " + what + ": " + text);
+    }
+    return value;
+}
+
+// Parses --delete-rows: COUNT (the oldest rows) or FIRST:COUNT.
+inline void parse_row_range(const std::string& text, int& first, int& count) {
+    const size_t colon = text.find(':');
+    if (colon == std::string::npos) {
+        first = 0;
+        count = parse_bounded_int(text, "--delete-rows", 1);
+        return;
+    }
+    first = parse_bounded_int(text.substr(0, colon), "--delete-rows", 0);
+    count = parse_bounded_int(text.substr(colon + 1), "--delete-rows", 1);
+}
+
+// Parses a strictly positive integer, rejecting trailing garbage.
+inline int parse_positive_int(const std::string& text, const std::string& what) {
+    return parse_bounded_int(text, what, 1);
+}
+
+inline int parse_non_negative_int(const std::string& text, const std::string& what) {
+    return parse_bounded_int(text, what, 0);
+}
+
+inline void print_usage(const char* prog, std::ostream& os = std::cerr) {
+    os << "Usage: " << prog << " [options] <filename>\n"
+       << "       " << prog << " [options] --batch <filename|@list>...\n"
+       << "  -t, --threads N       Number of worker threads (env PARQR_THREADS)\n"
+       << "  -a, --alpha N         Pivots per task (env PARQR_ALPHA)\n"
+       << "  -b, --beta N          Rows per task, a multiple of alpha (env PARQR_BETA)\n"
+       << "      --autotune        Pick alpha and beta from trial tasks or the tuning cache (env PARQR_AUTOTUNE)\n"
+       << "      --tune-cache FILE Tuning cache, or none (default $HOME/.parqr_tuning, env PARQR_TUNE_CACHE)\n"
+       << "  -q, --queue POLICY    Ready queue: fifo | priority | steal | bucket (env PARQR_QUEUE)\n"
+       << "      --spin N          Idle pops spent spinning before yielding (env PARQR_SPIN)\n"
+       << "      --yield N         Idle pops spent yielding before parking (env PARQR_YIELD)\n"
+       << "      --isa ISA         Kernels: auto | scalar | avx2 | avx512 (env PARQR_ISA)\n"
+       << "      --type2 MODE      Type-2 kernel: reflectors | wy (env PARQR_TYPE2)\n"
+       << "      --precision P     Factorize in double | float | mixed (env PARQR_PRECISION)\n"
+       << "      --layout LAYOUT   Matrix storage: row_major | tiled (env PARQR_LAYOUT)\n"
+       << "      --tile-cols N     Columns per tile of the tiled layout (env PARQR_TILE_COLS)\n"
+       << "      --bind POLICY     Pin workers: none | compact | scatter (env PARQR_BIND)\n"
+       << "      --graph MODE      Task graph: eager | lazy (env PARQR_GRAPH)\n"
+       << "      --tsqr            TSQR reduction tree for short, wide matrices, saving L only (env PARQR_TSQR)\n"
+       << "      --tsqr-leaf N     Columns per TSQR leaf (env PARQR_TSQR_LEAF)\n"
+       << "      --batch           Factorize every input (files, @lists, packed binaries) in one pool\n"
+       << "      --window N        Matrices in flight at once with --batch (env PARQR_WINDOW)\n"
+       << "      --trace FILE      Write a Chrome/Perfetto trace of every task (env PARQR_TRACE)\n"
+       << "      --metrics FILE    Write a JSON (or .csv) metrics report (env PARQR_METRICS)\n"
+       << "      --hw-counters     Add cycles, instructions and LLC misses to the metrics\n"
+       << "      --timing FILE     Write the wall time of the factorization as JSON (env PARQR_TIMING)\n"
+       << "      --device DEV      Run type-2 tasks of some row blocks on: none | host | cuda (env PARQR_DEVICE)\n"
+       << "      --device-share P  Percent of the row blocks kept on the device (env PARQR_DEVICE_SHARE)\n"
+       << "      --device-batch N  Ready device tasks run per synchronization (env PARQR_DEVICE_BATCH)\n"
+       << "      --out-of-core     Factorize a binary matrix from disk within --memory-budget (env PARQR_OUT_OF_CORE)\n"
+       << "      --memory-budget MB Row blocks resident at once out of core (env PARQR_MEMORY_BUDGET)\n"
+       << "      --scratch DIR     Working file directory out of core without -o (env PARQR_SCRATCH)\n"
+       << "  -o, --output FILE     Save the factorized matrix to FILE\n"
+       << "      --output-format F Format of -o: text | binary, with the reflector scalars (env PARQR_OUTPUT_FORMAT)\n"
+       << "      --compress        gzip the binary result (env PARQR_COMPRESS)\n"
+       << "      --checkpoint FILE Checkpoint the run to FILE, and resume from it if it exists (env PARQR_CHECKPOINT)\n"
+       << "      --checkpoint-interval S Seconds between checkpoints, e.g. 0.5 (default 600, env PARQR_CHECKPOINT_INTERVAL)\n"
+       << "      --append FILE     Append the rows of FILE to the binary factorization given as input\n"
+       << "      --delete-rows R   Delete rows R = COUNT (the oldest) or FIRST:COUNT from it first\n"
+       << "      --rhs FILE        Solve min ||M^T x - b|| after factorizing, for each row b of FILE (n entries)\n"
+       << "      --solution FILE   Save the least-squares solutions to FILE, one x per row\n"
+       << "  -h, --help            Show this message\n";
+}
+
+// Applies PARQR_* environment variables and then command-line options on top
+// of the defaults already stored in cfg. Throws std::invalid_argument on bad
+// input; returns false if only the help text was requested.
+inline bool parse_run_config(int argc, char* argv[], RunConfig& cfg) {
+    if (const char* env = std::getenv("PARQR_THREADS")) cfg.num_threads = parse_positive_int(env, "PARQR_THREADS");
+    if (const char* env = std::getenv("PARQR_ALPHA"))   cfg.alpha = parse_positive_int(env, "PARQR_ALPHA");
+    if (const char* env = std::getenv("PARQR_BETA"))    cfg.beta = parse_positive_int(env, "PARQR_BETA");
+    if (const char* env = std::getenv("PARQR_AUTOTUNE")) cfg.autotune = std::string(env) != "0";
+    if (const char* env = std::getenv("PARQR_TUNE_CACHE")) cfg.tune_cache = env;
+    if (const char* env = std::getenv("PARQR_QUEUE"))   cfg.queue = parse_queue_policy(env);
+    if (const char* env = std::getenv("PARQR_SPIN"))    cfg.idle_spins = parse_non_negative_int(env, "PARQR_SPIN");
+    if (const char* env = std::getenv("PARQR_YIELD"))   cfg.idle_yields = parse_non_negative_int(env, "PARQR_YIELD");
+    if (const char* env = std::getenv("PARQR_ISA"))     cfg.kernel_isa = env;
+    if (const char* env = std::getenv("PARQR_TYPE2"))   cfg.type2 = parse_type2_mode(env);
+    if (const char* env = std::getenv("PARQR_PRECISION")) cfg.precision = parse_precision(env);
+    if (const char* env = std::getenv("PARQR_LAYOUT"))  cfg.layout = env;
+    if (const char* env = std::getenv("PARQR_TILE_COLS")) cfg.tile_cols = parse_positive_int(env, "PARQR_TILE_COLS");
+    if (const char* env = std::getenv("PARQR_BIND"))    cfg.placement = env;
+    if (const char* env = std::getenv("PARQR_GRAPH"))   cfg.graph = env;
+    if (const char* env = std::getenv("PARQR_TRACE"))   cfg.trace_file = env;
+    if (const char* env = std::getenv("PARQR_METRICS")) cfg.metrics_file = env;
+    if (const char* env = std::getenv("PARQR_TIMING"))  cfg.timing_file = env;
+    if (const char* env = std::getenv("PARQR_TSQR"))    cfg.tsqr = std::string(env) != "0";
+    if (const char* env = std::getenv("PARQR_TSQR_LEAF")) cfg.tsqr_leaf = parse_positive_int(env, "PARQR_TSQR_LEAF");
+    if (const char* env = std::getenv("PARQR_WINDOW"))  cfg.batch_window = parse_positive_int(env, "PARQR_WINDOW");
+    if (const char* env = std::getenv("PARQR_DEVICE"))  cfg.device = parse_device_kind(env);
+    if (const char* env = std::getenv("PARQR_DEVICE_SHARE")) {
+        cfg.device_share = parse_non_negative_int(env, "PARQR_DEVICE_SHARE");
+    }
+    if (const char* env = std::getenv("PARQR_DEVICE_BATCH")) {
+        cfg.device_batch = parse_positive_int(env, "PARQR_DEVICE_BATCH");
+    }
+
+    if (const char* env = std::getenv("PARQR_OUT_OF_CORE")) cfg.out_of_core = std::string(env) != "0";
+    if (const char* env = std::getenv("PARQR_MEMORY_BUDGET")) {
+        cfg.memory_budget = parse_positive_int(env, "PARQR_MEMORY_BUDGET");
+    }
+    if (const char* env = std::getenv("PARQR_SCRATCH")) cfg.scratch_dir = env;
+    if (const char* env = std::getenv("PARQR_OUTPUT_FORMAT")) cfg.output_format = parse_output_format(env);
+    if (const char* env = std::getenv("PARQR_COMPRESS")) cfg.compress = std::string(env) != "0";
+    if (const char* env = std::getenv("PARQR_CHECKPOINT")) cfg.checkpoint_file = env;
+    if (const char* env = std::getenv("PARQR_CHECKPOINT_INTERVAL")) {
+        cfg.checkpoint_interval = parse_seconds(env, "PARQR_CHECKPOINT_INTERVAL");
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value;
+        bool has_inline_value = false;
+
+        // Accept both "--opt value" and "--opt=value".
+        if (arg.size() > 2 && arg[0] == '-' && arg[1] == '-') {
+            size_t eq = arg.find('=');
+            if (eq != std::string::npos) {
+                value = arg.substr(eq + 1);
+                arg = arg.substr(0, eq);
+                has_inline_value = true;
+            }
+        }
+
+        auto next_value = [&]() -> std::string {
+            if (has_inline_value) {
+                return value;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for option " + arg);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "-t" || arg == "--threads") {
+            cfg.num_threads = parse_positive_int(next_value(), arg);
+        } else if (arg == "-a" || arg == "--alpha") {
+            cfg.alpha = parse_positive_int(next_value(), arg);
+        } else if (arg == "-b" || arg == "--beta") {
+            cfg.beta = parse_positive_int(next_value(), arg);
+        } else if (arg == "--autotune") {
+            cfg.autotune = true;
+        } else if (arg == "--tune-cache") {
+            cfg.tune_cache = next_value();
+        } else if (arg == "-q" || arg == "--queue") {
+            cfg.queue = parse_queue_policy(next_value());
+        } else if (arg == "--spin") {
+            cfg.idle_spins = parse_non_negative_int(next_value(), arg);
+        } else if (arg == "--yield") {
+            cfg.idle_yields = parse_non_negative_int(next_value(), arg);
+        } else if (arg == "--isa") {
+            cfg.kernel_isa = next_value();
+        } else if (arg == "--type2") {
+            cfg.type2 = parse_type2_mode(next_value());
+        } else if (arg == "--precision") {
+            cfg.precision = parse_precision(next_value());
+        } else if (arg == "--layout") {
+            cfg.layout = next_value();
+        } else if (arg == "--tile-cols") {
+            cfg.tile_cols = parse_positive_int(next_value(), arg);
+        } else if (arg == "--bind") {
+            cfg.placement = next_value();
+        } else if (arg == "--graph") {
+            cfg.graph = next_value();
+        } else if (arg == "--tsqr") {
+            cfg.tsqr = true;
+        } else if (arg == "--tsqr-leaf") {
+            cfg.tsqr_leaf = parse_positive_int(next_value(), arg);
+        } else if (arg == "--batch") {
+            cfg.batch = true;
+        } else if (arg == "--window") {
+            cfg.batch_window = parse_positive_int(next_value(), arg);
+        } else if (arg == "--trace") {
+            cfg.trace_file = next_value();
+        } else if (arg == "--metrics") {
+            cfg.metrics_file = next_value();
+        } else if (arg == "--timing") {
+            cfg.timing_file = next_value();
+        } else if (arg == "--hw-counters") {
+            cfg.hw_counters = true;
+        } else if (arg == "--device") {
+            cfg.device = parse_device_kind(next_value());
+        } else if (arg == "--device-share") {
+            cfg.device_share = parse_non_negative_int(next_value(), arg);
+        } else if (arg == "--device-batch") {
+            cfg.device_batch = parse_positive_int(next_value(), arg);
+        } else if (arg == "--out-of-core") {
+            cfg.out_of_core = true;
+        } else if (arg == "--memory-budget") {
+            cfg.memory_budget = parse_positive_int(next_value(), arg);
+        } else if (arg == "--scratch") {
+            cfg.scratch_dir = next_value();
+        } else if (arg == "-o" || arg == "--output") {
+            cfg.output_file = next_value();
+        } else if (arg == "--output-format") {
+            cfg.output_format = parse_output_format(next_value());
+        } else if (arg == "--compress") {
+            cfg.compress = true;
+        } else if (arg == "--checkpoint") {
+            cfg.checkpoint_file = next_value();
+        } else if (arg == "--checkpoint-interval") {
+            cfg.checkpoint_interval = parse_seconds(next_value(), arg);
+        } else if (arg == "--append") {
+            cfg.append_file = next_value();
+        } else if (arg == "--delete-rows") {
+            parse_row_range(next_value(), cfg.delete_first, cfg.delete_count);
+        } else if (arg == "--rhs") {
+            cfg.rhs_file = next_value();
+        } else if (arg == "--solution") {
+            cfg.solution_file = next_value();
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw std::invalid_argument("Unknown option: " + arg);
+        } else {
+            cfg.inputs.push_back(arg);
+        }
+    }
+
+    if (cfg.inputs.empty()) {
+        throw std::invalid_argument("No input matrix file given.");
+    }
+    if (!cfg.batch && cfg.inputs.size() > 1) {
+        throw std::invalid_argument("Unexpected argument: " + cfg.inputs[1]);
+    }
+    cfg.input_file = cfg.inputs[0];
+    if (cfg.device_share > 100) {
+        throw std::invalid_argument("The device share is a percentage: " + std::to_string(cfg.device_share));
+    }
+    if (cfg.compress && cfg.output_format != OutputFormat::binary) {
+        throw std::invalid_argument("--compress needs --output-format binary.");
+    }
+    if (cfg.beta % cfg.alpha != 0) {
+        throw std::invalid_argument("beta (" + std::to_string(cfg.beta) + ") must be a multiple of alpha ("
+                                    + std::to_string(cfg.alpha) + ").");
+    }
+    return true;
+}
+
+#endif // RUN_CONFIG_H
@@ -0,0 +1,165 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Per-task execution tracing for the drivers (--trace FILE). Every worker
+// appends to its own buffer, reserved up front, so recording is two clock
+// reads and a store with no sharing between threads. After the workers have
+// joined, the buffers are merged into a Chrome trace (JSON), which
+// chrome://tracing and ui.perfetto.dev both open: one track per worker, one
+// slice per task, with the time the task spent ready but queued in its
+// arguments. Building with -DPARQR_NO_TRACE compiles all recording out.
+
+// One executed task. Times are nanoseconds since TaskTrace::init.
+struct TraceTask {
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t job;       // Matrix of the batch
+    uint32_t i;
+    uint32_t j;
+    uint32_t type;
+};
+
+// A task becoming ready (pushed to a ready queue).
+struct TraceReady {
+    uint64_t ns;
+    uint32_t job;
+    uint32_t i;
+    uint32_t j;
+};
+
+class TaskTrace {
+    static bool ready_less(const TraceReady& a, const TraceReady& b) {
+        return a.job != b.job ? a.job < b.job : a.i != b.i ? a.i < b.i : a.j < b.j;
+    }
+
+    struct alignas(64) Buffer {
+        std::vector<TraceTask> tasks;
+        std::vector<TraceReady> ready;
+    };
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::chrono::steady_clock::time_point origin;
+    bool on = false;
+
+public:
+    // Enables tracing with one buffer per thread id in [0, threads), each
+    // reserving room for reserve tasks (buffers grow past that if needed).
+    void init(int threads, size_t reserve) {
+        buffers.clear();
+        for (int t = 0; t < threads; t++) {
+            buffers.emplace_back(new Buffer());
+            buffers.back()->tasks.reserve(reserve);
+            buffers.back()->ready.reserve(reserve);
+        }
+        origin = std::chrono::steady_clock::now();
+        on = true;
+    }
+
+#ifdef PARQR_NO_TRACE
+    constexpr bool enabled() const { return false; }
+#else
+    bool enabled() const { return on; }
+#endif
+
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    void ready(int tid, uint32_t job, uint32_t i, uint32_t j) {
+        buffers[tid]->ready.push_back({now(), job, i, j});
+    }
+
+    void task(int tid, uint32_t job, uint32_t i, uint32_t j, uint32_t type, uint64_t start_ns, uint64_t end_ns) {
+        buffers[tid]->tasks.push_back({start_ns, end_ns, job, i, j, type});
+    }
+
+    int threads() const { return static_cast<int>(buffers.size()); }
+    const std::vector<TraceTask>& tasks(int tid) const { return buffers[tid]->tasks; }
+    size_t num_ready(int tid) const { return buffers[tid]->ready.size(); }
+
+    // Every ready event, sorted for find_ready().
+    std::vector<TraceReady> sorted_ready() const {
+        std::vector<TraceReady> ready;
+        for (const auto& buffer : buffers) {
+            ready.insert(ready.end(), buffer->ready.begin(), buffer->ready.end());
+        }
+        std::sort(ready.begin(), ready.end(), ready_less);
+        return ready;
+    }
+
+    // When task e became ready, from sorted_ready(). A task is only pushed
+    // once per run, so (job, i, j) identifies it. Returns false if it has no
+    // ready event (the drivers' barrier schedule, or a dropped one).
+    static bool find_ready(const std::vector<TraceReady>& ready, const TraceTask& e, uint64_t& ns) {
+        TraceReady key{0, e.job, e.i, e.j};
+        auto it = std::lower_bound(ready.begin(), ready.end(), key, ready_less);
+        if (it == ready.end() || it->job != e.job || it->i != e.i || it->j != e.j || it->ns > e.start_ns) {
+            return false;
+        }
+        ns = it->ns;
+        return true;
+    }
+
+    size_t num_tasks() const {
+        size_t count = 0;
+        for (const auto& buffer : buffers) {
+            count += buffer->tasks.size();
+        }
+        return count;
+    }
+
+    // Writes the Chrome trace. Only call once the recording threads are done.
+    // `names` labels the thread tracks; missing entries become "worker N".
+    void write_chrome_json(std::ostream& os, const std::vector<std::string>& names = {}) const;
+
+    void save(const std::string& filename, const std::vector<std::string>& names = {}) const {
+        std::ofstream out(filename);
+        if (!out.is_open()) {
+            throw std::runtime_error("Error opening file for writing: " + filename);
+        }
+        write_chrome_json(out, names);
+        if (out.fail()) {
+            throw std::runtime_error("Error writing trace file: " + filename);
+        }
+    }
+};
+
+inline void TaskTrace::write_chrome_json(std::ostream& os, const std::vector<std::string>& names) const {
+    const std::vector<TraceReady> ready = sorted_ready();
+
+    auto us = [](uint64_t ns) { return std::to_string(ns / 1000) + "." + std::to_string(ns % 1000 / 100); };
+
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    for (size_t t = 0; t < buffers.size(); t++) {
+        std::string name = t < names.size() ? names[t] : "worker " + std::to_string(t);
+        os << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << t
+           << ",\"args\":{\"name\":\"" << name << "\"}}";
+        first = false;
+    }
+    for (size_t t = 0; t < buffers.size(); t++) {
+        for (const TraceTask& e : buffers[t]->tasks) {
+            os << ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":" << t << ",\"name\":\"T" << e.type << " (" << e.i << "," << e.j
+               << ")\",\"cat\":\"type" << e.type << "\",\"ts\":" << us(e.start_ns)
+               << ",\"dur\":" << us(e.end_ns - e.start_ns) << ",\"args\":{\"job\":" << e.job << ",\"i\":" << e.i
+               << ",\"j\":" << e.j;
+            uint64_t ready_ns = 0;
+            if (find_ready(ready, e, ready_ns)) {
+                os << ",\"queued_us\":" << us(e.start_ns - ready_ns);
+            }
+            os << "}}";
+        }
+    }
+    os << "\n]}\n";
+}
+
+#endif // TRACE_H
@@ -0,0 +1,146 @@
+#ifndef TSQR_H
+#define TSQR_H
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+#include "idle.h"
+#include "kernels.h"
+
+// Communication-avoiding QR (TSQR) for short, wide matrices (--tsqr). The
+// drivers factorize the rows of an m x n matrix M: M = L Q, the QR of the
+// n x m transpose A = M^T with R = L^T. For m << n, A is tall and skinny and
+// the task grid has only a handful of row blocks, so the panel chain leaves
+// the threads idle. TSQR instead cuts the columns of M (the rows of A) into
+// one contiguous block per thread. Each thread factorizes its block on its
+// own, one leaf of columns at a time: [L | next leaf] is factorized and its
+// first m columns become the next L, so a thread only ever holds an
+// m x (m + leaf) buffer. The threads' m x m factors are then combined by a
+// binary tree, [L_a | L_b] -> L, with a barrier between the log2(threads)
+// levels. The matrix is read once and only the small factors move between
+// threads. Only the final factor is kept; the Householder vectors of the
+// leaves and of the tree are discarded.
+
+// Factorizes the m x n row-major a in place, as the drivers do but
+// sequentially: a type-1 task for each panel of alpha pivots, then the rows
+// below through the panel's WY factor (or one reflector at a time).
+inline void tsqr_factor_rows(double* a, int m, int n, int alpha, bool type2_wy, std::vector<double>& up,
+                             std::vector<double>& b, std::vector<double>& T) {
+    const int pivots = std::min(m, n);
+    const int ldt = alpha + 1;
+    up.assign(m, 0.0);
+    b.assign(m, 0.0);
+    T.assign((size_t)ldt * ldt, 0.0);
+    // Panel boundaries as in TaskTable: the first panel also holds row 0.
+    for (int row_start = 1; row_start < pivots; row_start += alpha) {
+        const int row_end = std::min(row_start + alpha, pivots);
+        complete_task1(a, m, n, row_start, row_end, row_start, row_end, up.data(), b.data());
+        if (row_end >= m) {
+            continue;
+        }
+        if (type2_wy) {
+            build_wy_factor(a, n, row_start, row_end, up.data(), b.data(), T.data(), ldt);
+            complete_task2_wy(a, m, n, row_start, row_end, row_end, m, up.data(), T.data(), ldt);
+        } else {
+            complete_task2(a, m, n, row_start, row_end, row_end, m, up.data(), b.data());
+        }
+    }
+}
+
+// Copies the lower triangle of the first m columns of the factorized
+// m x ld buffer into the m x m factor L, zeroing the rest of L.
+inline void tsqr_take_factor(const double* buf, int m, int ld, double* L) {
+    for (int r = 0; r < m; r++) {
+        const int keep = std::min(r + 1, ld);
+        std::copy(buf + (size_t)r * ld, buf + (size_t)r * ld + keep, L + (size_t)r * m);
+        std::fill(L + (size_t)r * m + keep, L + (size_t)(r + 1) * m, 0.0);
+    }
+}
+
+// Factorizes the m x n row-major mat (which is not modified) and returns its
+// m x m lower-triangular factor L, row-major, with L L^T = M M^T. threads
+// workers each start with on_start(tid); leaf_cols is the width of the column
+// leaves a worker factorizes at a time.
+inline std::vector<double> tsqr(const double* mat, int m, int n, int threads, int leaf_cols, int alpha,
+                                bool type2_wy, const std::function<void(int)>& on_start = nullptr) {
+    threads = std::max(1, threads);
+    leaf_cols = std::max(1, leaf_cols);
+    // Row-major m x m factor of each worker.
+    std::vector<std::vector<double>> factors(threads, std::vector<double>((size_t)m * m, 0.0));
+    SpinBarrier barrier(threads);
+
+    auto worker = [&](int tid) {
+        if (on_start) {
+            on_start(tid);
+        }
+        std::vector<double> up, b, T;
+        std::vector<double>& L = factors[tid];
+
+        // Leaves of this worker's block of columns: [L | leaf] -> L.
+        const int first = (int)((long long)n * tid / threads);
+        const int last = (int)((long long)n * (tid + 1) / threads);
+        std::vector<double> buf;
+        for (int c0 = first; c0 < last; c0 += leaf_cols) {
+            const int w = std::min(leaf_cols, last - c0);
+            const int ld = m + w;
+            buf.resize((size_t)m * ld);
+            for (int r = 0; r < m; r++) {
+                std::memcpy(buf.data() + (size_t)r * ld, L.data() + (size_t)r * m, m * sizeof(double));
+                std::memcpy(buf.data() + (size_t)r * ld + m, mat + (size_t)r * n + c0, w * sizeof(double));
+            }
+            tsqr_factor_rows(buf.data(), m, ld, alpha, type2_wy, up, b, T);
+            tsqr_take_factor(buf.data(), m, ld, L.data());
+        }
+
+        // Binary tree: at distance d, worker tid (a multiple of 2d) takes over
+        // the factor of worker tid + d.
+        bool sense = false;
+        buf.resize((size_t)m * 2 * m);
+        for (int d = 1; d < threads; d *= 2) {
+            barrier.wait(sense);
+            if (tid % (2 * d) == 0 && tid + d < threads) {
+                const std::vector<double>& other = factors[tid + d];
+                for (int r = 0; r < m; r++) {
+                    std::memcpy(buf.data() + (size_t)r * 2 * m, L.data() + (size_t)r * m, m * sizeof(double));
+                    std::memcpy(buf.data() + (size_t)r * 2 * m + m, other.data() + (size_t)r * m, m * sizeof(double));
+                }
+                tsqr_factor_rows(buf.data(), m, 2 * m, alpha, type2_wy, up, b, T);
+                tsqr_take_factor(buf.data(), m, 2 * m, L.data());
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return std::move(factors[0]);
+}
+
+// Leaves tsqr() factorizes: each worker's block of columns cut into leaves.
+inline long long tsqr_num_leaves(int n, int threads, int leaf_cols) {
+    threads = std::max(1, threads);
+    leaf_cols = std::max(1, leaf_cols);
+    long long leaves = 0;
+    for (int t = 0; t < threads; t++) {
+        const long long width = (long long)n * (t + 1) / threads - (long long)n * t / threads;
+        leaves += (width + leaf_cols - 1) / leaf_cols;
+    }
+    return leaves;
+}
+
+// Levels of the reduction tree for threads workers.
+inline int tsqr_tree_depth(int threads) {
+    int depth = 0;
+    for (int d = 1; d < threads; d *= 2) {
+        depth++;
+    }
+    return depth;
+}
+
+#endif // TSQR_H
@@ -1,323 +1,1762 @@
-#include <iostream>
-#include <vector>
-#include <string>
-#include <cmath>
-#include <pthread.h>
-#include "include/bn2.h"
-#include <tbb/concurrent_priority_queue.h>
-#include <tbb/tbb.h>
-#include <unistd.h>
-#include <csignal>
-#include <cstdlib>
-#include <mutex>
-
-#define NUM_THREADS 28
-
-#define BETA 16
-#define ALPHA 4
-#define BETA_DIV_ALPHA ((int)BETA / (int)ALPHA)
-
-#define USE_PRIORITY_MAIN_QUEUE 0
-typedef struct
-{
-    int tid;
-    int total_task_rows;
-    int total_task_cols;
-    int m;
-    int n;
-    double *mat;
-} thread_args_ts;
-
-std::vector<std::stringstream> logstreams(NUM_THREADS);
-
-TaskTable task_table;
-DependencyTableAtomic dependency_table;
-
-std::vector<double> global_up_array, global_b_array;
-
-
-struct TaskComparator {
-    bool operator()(const Task* a, const Task* b) const {
-        return a->priority < b->priority; 
-    }
-};
-
-tbb::concurrent_queue<Task *> wait_queue;//, taskPQ;
-
-#if USE_PRIORITY_MAIN_QUEUE
-tbb::concurrent_priority_queue<Task *, TaskComparator> taskPQ;
-#else
-tbb::concurrent_queue<Task *> taskPQ;
-#endif
-//tbb::concurrent_priority_queue<Task *, TaskComparator> taskPQ(1024);
-
-void complete_task1(double *&mat, int m, int n, int row_start, int row_end, int col_start, int col_end)
-{
-
-    double sm, sm1, cl, clinv, up, b;
-    int _row_start = row_start == 1 ? 0 : row_start;
-
-    for (int lpivot = _row_start; lpivot < row_end; lpivot++)
-    {
-        cl = fabs(mat[lpivot * n + lpivot]);
-        sm1 = 0;
-
-        for (int k = lpivot + 1; k < n; k++)
-        {
-            sm = fabs(mat[lpivot * n + k]);
-            sm1 += sm * sm;
-            cl = fmax(sm, cl);
-        }
-
-        if (cl <= 0.0)
-        {
-            return;
-        }
-        clinv = 1.0 / cl;
-
-        double d__1 = mat[lpivot * n + lpivot] * clinv;
-        sm = d__1 * d__1;
-        sm += sm1 * clinv * clinv;
-
-        cl *= sqrt(sm);
-
-        if (mat[lpivot * n + lpivot] > 0.0)
-        {
-            cl = -cl;
-        }
-
-        up = mat[lpivot * n + lpivot] - cl;
-        mat[lpivot * n + lpivot] = cl;
-
-        if (row_end - lpivot < 0)
-        {
-            return;
-        }
-
-        b = up * mat[lpivot * n + lpivot];
-
-        if (b >= 0.0)
-        {
-            return;
-        }
-
-        b = 1.0 / b;
-
-        global_up_array[lpivot] = up;
-        global_b_array[lpivot] = b;
-
-        for (int j = lpivot + 1; j < col_end; j++)
-        {
-            sm = mat[j * n + lpivot] * up;
-
-            for (int i__ = lpivot + 1; i__ < n; i__++)
-            {
-                sm += mat[j * n + i__] * mat[lpivot * n + i__];
-            }
-
-            if (sm == 0.0)
-            {
-                continue;
-            }
-
-            sm *= b;
-            mat[j * n + lpivot] += sm * up;
-
-            for (int i__ = lpivot + 1; i__ < n; i__++)
-            {
-                mat[j * n + i__] += sm * mat[lpivot * n + i__];
-            }
-        }
-    }
-}
-
-void complete_task2(double *&mat, int m, int n, int row_start, int row_end, int col_start, int col_end)
-{
-
-    int _row_start = row_start == 1 ? 0 : row_start;
-    int _col_start = col_start == 1 ? 0 : col_start;
-
-    double up = 0.0, b = 0.0, sm = 0.0;
-
-    for (int lpivot = _row_start; lpivot < row_end; lpivot++)
-    {
-        up = global_up_array[lpivot];
-        b = global_b_array[lpivot];
-
-        for (int j = _col_start; j < col_end; j++)
-        {
-            sm = mat[j * n + lpivot] * up;
-
-            for (int i__ = lpivot + 1; i__ < n; i__++)
-            {
-                sm += mat[j * n + i__] * mat[lpivot * n + i__];
-            }
-
-            if (sm == 0.0)
-            {
-                continue;
-            }
-
-            sm *= b;
-            mat[j * n + lpivot] += sm * up;
-
-            for (int i__ = lpivot + 1; i__ < n; i__++)
-            {
-                mat[j * n + i__] += sm * mat[lpivot * n + i__];
-            }
-        }
-    }
-}
-
-void *thdwork(void *params)
-{
-    thread_args_ts *thread_args = (thread_args_ts *)params;
-
-    int total_task_rows = thread_args->total_task_rows;
-    int total_task_cols = thread_args->total_task_cols;
-    double *mat = thread_args->mat;
-    int m = thread_args->m;
-    int n = thread_args->n;
-    
-    while (1)
-    {
-        Task *new_task = nullptr;
-        //auto queue_elem1 = taskPQ.pop();
-        if (taskPQ.try_pop(new_task)) ///Task *new_task = queue_elem1.value_or(nullptr))
-        {
-            int i = new_task->chunk_idx_i;
-            int j = new_task->chunk_idx_j;
-
-            int row_start = new_task->row_start;
-            int row_end = new_task->row_end;
-            int col_start = new_task->col_start;
-            int col_end = new_task->col_end;
-
-            if (new_task->type == 1)
-            {
-                complete_task1(mat, m, n, row_start, row_end, col_start, col_end);
-                dependency_table.setDependency(i, j, true);
-                for (int k = i + 1; k < total_task_rows; k++)
-                {
-                    Task *next_task = task_table.getTask(k, j);
-
-                    if (j == 0 || dependency_table.getDependency(k, j - 1))
-                    {
-                        taskPQ.push(next_task);
-                    }
-                    else
-                    {
-                        wait_queue.push(next_task);
-                    }
-                }
-            }
-            else if (new_task->type == 2)
-            {
-                complete_task2(mat, m, n, row_start, row_end, col_start, col_end);
-                dependency_table.setDependency(i, j, true);
-                if (new_task->enq_nxt_t1 && (j + 1) <= total_task_cols)
-                {
-                    taskPQ.push(task_table.getTask((j + 1) / BETA_DIV_ALPHA, j + 1));  
-                }
-            }
-        }
-    
-        Task *local_task = nullptr;
-        if (wait_queue.try_pop(local_task)) 
-        {
-            int i = local_task->chunk_idx_i;
-            int j = local_task->chunk_idx_j;
-            if (dependency_table.getDependency(i, j - 1))
-            {
-                taskPQ.push(local_task);
-            }
-            else
-            {
-                wait_queue.push(local_task);
-            }
-        }
-
-        if (dependency_table.getDependency(total_task_rows - 1, BETA_DIV_ALPHA * (total_task_rows - 1)))
-        {
-            break;
-        }
-    }
-
-    return nullptr;
-}
-
-int main(int argc, char *argv[])
-{
-    std::cout << "[1]. Inside main." << std::endl;
-
-    if (argc < 2)
-    {
-        std::cerr << "Usage: " << argv[0] << " <filename>" << std::endl;
-        return EXIT_FAILURE;
-    }
-
-    matrix_t<double> data_matrix(argv[1]);
-
-    int total_task_rows = std::ceil(data_matrix.rows() / BETA);
-    int total_task_cols = std::ceil(data_matrix.rows() / ALPHA);
-
-    global_up_array.resize(data_matrix.rows(), 0.0);
-    global_b_array.resize(data_matrix.rows(), 0.0);
-
-    dependency_table.init(total_task_rows, total_task_cols);
-    task_table.init(total_task_rows, total_task_cols, ALPHA, BETA, data_matrix);
-    //task_table.printTaskTable();
-
-    std::vector<pthread_t> threads(NUM_THREADS);
-    std::vector<thread_args_ts> thread_args(NUM_THREADS);
-
-    // for(int i = 0 ; i<task_table.rows() ; i++)
-    // {
-    //     for(int j = 0 ; j<task_table.cols();j++)
-    //     {
-    //         if(task_table.getTask(i, j) !=nullptr)
-    //         flat_graph.push_back(task_table.getTask(i, j));
-    //     }
-    // }
-
-    // std::cout<<flat_graph.size()<<" "<<task_table.rows()<<" "<<task_table.cols()<<std::endl;
-    // std::sort(flat_graph.begin(),flat_graph.end(),comparator);
-
-    for (int i = 0; i < NUM_THREADS; i++)
-    {
-        thread_args[i].tid = i;
-        thread_args[i].total_task_rows = total_task_rows;
-        thread_args[i].total_task_cols = total_task_cols;
-        thread_args[i].m = data_matrix.rows();
-        thread_args[i].n = data_matrix.cols();
-        thread_args[i].mat = data_matrix.data_ptr();
-    }
-
-    //taskPQ = taskpq_init(7);
-    //taskpq_insert(taskPQ, task_table.getTask(0, 0), total_task_rows, total_task_cols);
-    // for(int i = 0 ; i<flat_graph.size() ; i++)
-    // taskPQ.push(flat_graph[i]);
-    taskPQ.push(task_table.getTask(0, 0));
-
-    auto start = std::chrono::high_resolution_clock::now();
-
-    for (int i = 0; i < NUM_THREADS; i++)
-    {
-        pthread_create(&threads[i], NULL, thdwork, &thread_args[i]);
-    }
-
-    for (int i = 0; i < NUM_THREADS; i++)
-    {
-        pthread_join(threads[i], NULL);
-    }
- 
-    auto end = std::chrono::high_resolution_clock::now();
-
-    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-
-    std::cout << "Time taken: " << elapsed << " ms" << std::endl;
-    //dependency_table.printDependencyTable();
-    //data_matrix.save("output_intel.txt");
-
-    return 0;
-}
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <pthread.h>
+#include "include/autotune.h"
+#include "include/bn2.h"
+#include "include/bucket_queue.h"
+#include "include/checkpoint.h"
+#include "include/device.h"
+#include "include/idle.h"
+#include "include/kernels.h"
+#include "include/lstsq.h"
+#include "include/metrics.h"
+#include "include/out_of_core.h"
+#include "include/placement.h"
+#include "include/qr_engine.h"
+#include "include/run_config.h"
+#include "include/trace.h"
+#include "include/tsqr.h"
+#include <tbb/concurrent_priority_queue.h>
+#include <tbb/tbb.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstdlib>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <optional>
+
+// Defaults; override with -t/-a/-b/-q or PARQR_THREADS/ALPHA/BETA/QUEUE.
+#define DEFAULT_NUM_THREADS 28
+
+#define DEFAULT_BETA 16
+#define DEFAULT_ALPHA 4
+
+typedef struct
+{
+    int tid;
+    int idle_spins;
+    int idle_yields;
+    bool type2_wy;      // Apply type-2 tasks through the panel's WY factor
+} thread_args_ts;
+
+// The storage a job's tasks factorize, in the precision of the run, and the
+// reflector and WY state they share.
+template <class Real>
+struct FactorState
+{
+    Real *mat = nullptr;
+    std::vector<Real> up_array, b_array;
+    // Compact WY factors, one ldt x ldt block per panel (only with --type2 wy).
+    std::vector<Real> t_array;
+    BasicTiledView<Real> tiles{};
+    // Device copy of the device row blocks (only with --device).
+    DeviceRows<Real> device;
+};
+
+// One matrix being factorized: its storage, task graph and factorization
+// state. A single run is a batch of one.
+struct QrJob
+{
+    int index = 0;              // Position in the batch
+    std::string name;           // Input it was read from
+    matrix_t<double> matrix;    // As read; with --precision mixed kept for refinement
+    matrix_t<float> matrix_f;   // Float copy the tasks factorize with --precision float or mixed
+    TaskTable task_table;
+    DependencyTableAtomic dependency_table;
+    bool single = false;        // Factorize matrix_f through f32 instead of matrix through f64
+    FactorState<double> f64;
+    FactorState<float> f32;
+    int m = 0;
+    int n = 0;
+    int ldt = 0;                // Leading dimension of each panel's T factor
+    bool tiled = false;         // The matrix is in the tiled layout; use the tile kernels
+    DeviceSplit offload;        // Row blocks whose type-2 tasks run on the device
+    OutOfCoreMatrix out_of_core;    // Working file and resident row blocks (only with --out-of-core)
+    int resumed = 0;            // Tasks completed before the checkpoint it resumed from
+    std::vector<Task *> resume_tasks;   // With resumed, the ready tasks to start from
+    long graph_ms = 0;          // Time to build the task graph
+    std::atomic<int> remaining{0};  // Tasks of this job not yet completed
+};
+
+// Jobs in flight, indexed by Task::graph. A slot is only reused after its job
+// has completed, and a job is published before its root task is pushed.
+std::vector<QrJob *> job_slots;
+
+// Completed jobs, handed from the worker that ran a job's last task to the
+// main thread.
+std::mutex finished_mutex;
+std::condition_variable finished_cv;
+std::vector<QrJob *> finished_jobs;
+
+// CPU and node of every worker (see placement.h).
+ThreadPlacement placement;
+
+// Per-task trace (--trace, and --metrics); workers are threads 0..T-1, the
+// main thread is T.
+TaskTrace task_trace;
+RunMetrics run_metrics;
+
+// Tasks not yet completed, plus one while jobs are still being admitted;
+// workers exit when it reaches zero.
+alignas(64) std::atomic<int> remaining_tasks;
+ParkingLot parking_lot;
+
+// Holds the workers at a consistent cut while a checkpoint is copied (only
+// with --checkpoint).
+CheckpointGate checkpoint_gate;
+
+// Device thread (--device): its ready queue and the batches it has run.
+struct DeviceOffload
+{
+    int tid = 0;                // Trace thread id
+    int batch = 32;             // Tasks per synchronization
+    int idle_spins = 100;
+    int idle_yields = 10;
+    tbb::concurrent_queue<Task *> queue;
+    ParkingLot parking_lot;
+    long long tasks = 0;
+    long long batches = 0;
+};
+DeviceOffload device_offload;
+
+
+struct TaskComparator {
+    bool operator()(const Task* a, const Task* b) const {
+        return a->priority < b->priority;
+    }
+};
+
+typedef tbb::concurrent_queue<Task *> FifoQueue;
+typedef tbb::concurrent_priority_queue<Task *, TaskComparator> PriorityQueue;
+
+// Bucketed priority queue: the same order as PriorityQueue at close to FIFO
+// cost. Buckets are sized before the workers start, for the jobs admitted by
+// then; tasks of larger later jobs share the top bucket.
+class BucketQueue
+{
+    BucketPriorityQueue<Task *> queue;
+
+public:
+    void reserve(uint32_t max_priority) { queue.reserve((size_t)max_priority + 1); }
+    void push(Task *task) { queue.push(task, task->priority); }
+    bool try_pop(Task *&task) { return queue.try_pop(task); }
+};
+
+// Per-thread Chase-Lev deques. A thread keeps the successors it releases on
+// its own deque and pops them LIFO while their tiles are still in cache; only
+// when it runs dry does it steal the oldest task of a randomly chosen victim.
+// When the workers are bound to more than one NUMA node, a successor whose row
+// block lives on another node goes to that node's inbox instead, and a thread
+// that runs dry tries its node's inbox and same-node victims before it reaches
+// across nodes. Root tasks of batch jobs come from the main thread, which owns
+// no deque, so they go through a shared submission queue.
+class WorkStealingQueues
+{
+    struct alignas(64) Slot
+    {
+        ChaseLevDeque<Task *> deque;
+        uint64_t rng;
+    };
+    struct alignas(64) Inbox
+    {
+        tbb::concurrent_queue<Task *> queue;
+    };
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<std::unique_ptr<Inbox>> inboxes;    // Per node; empty on one node
+    std::vector<std::vector<int>> node_workers;      // Workers bound to each node
+    const ThreadPlacement *placement = nullptr;
+    tbb::concurrent_queue<Task *> submitted;         // Pushed from outside the pool
+
+    // One sweep over random victims (xorshift64) from victims[0, count), or
+    // from all workers if victims is null.
+    bool steal(int tid, const int *victims, int count, Task *&task)
+    {
+        uint64_t &x = slots[tid]->rng;
+        for (int attempt = 0; attempt < count; attempt++)
+        {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            int victim = victims != nullptr ? victims[x % count] : x % count;
+            if (victim == tid)
+            {
+                continue;
+            }
+            if (std::optional<Task *> stolen = slots[victim]->deque.steal())
+            {
+                task = *stolen;
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    // Thread tid's view, with the same push/try_pop interface as the TBB queues.
+    class Worker
+    {
+        WorkStealingQueues *queues;
+        int tid;
+
+    public:
+        Worker(WorkStealingQueues *queues, int tid) : queues(queues), tid(tid) {}
+        void push(Task *task) { queues->push(tid, task); }
+        bool try_pop(Task *&task) { return queues->try_pop(tid, task); }
+    };
+
+    void init(int num_threads, const ThreadPlacement &workers)
+    {
+        slots.clear();
+        for (int i = 0; i < num_threads; i++)
+        {
+            slots.emplace_back(new Slot());
+            slots.back()->rng = 0x9E3779B97F4A7C15ull * (i + 1);
+        }
+
+        placement = &workers;
+        inboxes.clear();
+        node_workers.clear();
+        if (workers.num_nodes() > 1)
+        {
+            node_workers.resize(workers.num_nodes());
+            for (int i = 0; i < num_threads; i++)
+            {
+                node_workers[workers.node_of(i)].push_back(i);
+            }
+            for (int node = 0; node < workers.num_nodes(); node++)
+            {
+                inboxes.emplace_back(new Inbox());
+            }
+        }
+    }
+
+    void push(int tid, Task *task)
+    {
+        if (!inboxes.empty())
+        {
+            int node = placement->block_node(task->chunk_idx_i);
+            if (node != placement->node_of(tid))
+            {
+                inboxes[node]->queue.push(task);
+                return;
+            }
+        }
+        slots[tid]->deque.push(task);
+    }
+
+    // Safe from any thread.
+    void submit(Task *task) { submitted.push(task); }
+
+    bool try_pop(int tid, Task *&task)
+    {
+        if (std::optional<Task *> own = slots[tid]->deque.pop())
+        {
+            task = *own;
+            return true;
+        }
+        if (submitted.try_pop(task))
+        {
+            return true;
+        }
+        if (inboxes.empty())
+        {
+            return steal(tid, nullptr, slots.size(), task);
+        }
+
+        // Local work first: the node's inbox, then its workers' deques.
+        const int node = placement->node_of(tid);
+        const std::vector<int> &local = node_workers[node];
+        if (inboxes[node]->queue.try_pop(task) || steal(tid, local.data(), local.size(), task))
+        {
+            return true;
+        }
+        for (size_t other = 1; other < inboxes.size(); other++)
+        {
+            if (inboxes[(node + other) % inboxes.size()]->queue.try_pop(task))
+            {
+                return true;
+            }
+        }
+        return steal(tid, nullptr, slots.size(), task);
+    }
+};
+
+// One instance per ready-queue policy; thdwork is instantiated for each and
+// the policy is picked at runtime, so the hot loop never branches on it.
+FifoQueue fifo_taskPQ;
+PriorityQueue priority_taskPQ;
+WorkStealingQueues stealing_taskPQ;
+BucketQueue bucket_taskPQ;
+
+// Thread tid's handle on the ready queue: the shared TBB queue itself, or the
+// thread's own view of the work-stealing deques.
+template <class ReadyQueue> struct ready_queue_traits;
+// submit() pushes from a thread outside the pool.
+template <> struct ready_queue_traits<FifoQueue>
+{
+    static FifoQueue &get(int) { return fifo_taskPQ; }
+    static void submit(Task *task) { fifo_taskPQ.push(task); }
+};
+template <> struct ready_queue_traits<PriorityQueue>
+{
+    static PriorityQueue &get(int) { return priority_taskPQ; }
+    static void submit(Task *task) { priority_taskPQ.push(task); }
+};
+template <> struct ready_queue_traits<WorkStealingQueues>
+{
+    static WorkStealingQueues::Worker get(int tid) { return WorkStealingQueues::Worker(&stealing_taskPQ, tid); }
+    static void submit(Task *task) { stealing_taskPQ.submit(task); }
+};
+template <> struct ready_queue_traits<BucketQueue>
+{
+    static BucketQueue &get(int) { return bucket_taskPQ; }
+    static void submit(Task *task) { bucket_taskPQ.push(task); }
+};
+
+template <class ReadyQueue>
+decltype(auto) ready_queue(int tid) { return ready_queue_traits<ReadyQueue>::get(tid); }
+
+// Runs one task on the factorization state of its job.
+template <class Real>
+void run_task(const Task *task, FactorState<Real> &state, int m, int n, int ldt, bool tiled, bool type2_wy)
+{
+    Real *mat = state.mat;
+    Real *up_array = state.up_array.data();
+    Real *b_array = state.b_array.data();
+    Real *t_array = state.t_array.data() + (size_t)task->chunk_idx_j * ldt * ldt;
+    const BasicTiledView<Real> &tiles = state.tiles;
+
+    int row_start = task->row_start;
+    int row_end = task->row_end;
+    int col_start = task->col_start;
+    int col_end = task->col_end;
+
+    if (task->type == 1 && tiled)
+    {
+        complete_task1(tiles, row_start, row_end, col_start, col_end, up_array, b_array);
+        build_wy_factor(tiles, row_start, row_end, up_array, b_array, t_array, ldt);
+    }
+    else if (task->type == 1)
+    {
+        complete_task1(mat, m, n, row_start, row_end, col_start, col_end, up_array, b_array);
+        if (type2_wy)
+        {
+            build_wy_factor(mat, n, row_start, row_end, up_array, b_array, t_array, ldt);
+        }
+    }
+    else if (task->type == 2 && tiled)
+    {
+        complete_task2_wy(tiles, row_start, row_end, col_start, col_end, up_array, t_array, ldt);
+    }
+    else if (task->type == 2)
+    {
+        if (type2_wy)
+        {
+            complete_task2_wy(mat, m, n, row_start, row_end, col_start, col_end, up_array, t_array, ldt);
+        }
+        else
+        {
+            complete_task2(mat, m, n, row_start, row_end, col_start, col_end, up_array, b_array);
+        }
+    }
+}
+
+// Completes a task that ran on thread tid: marks it in the dependency table,
+// releases its successors and counts it, handing the job back to the main
+// thread after its last task. A released type-2 task of a device row block
+// goes to the device queue, every other one to push(); out of core, a task
+// whose rows are not resident is left to the I/O thread, and during a
+// checkpoint every released task is held by the gate. Returns true if this
+// was the last task of the run.
+template <class PushFn>
+bool complete_task(Task *task, QrJob &job, int tid, bool tracing, PushFn &&push)
+{
+    job.dependency_table.setDependency(task->chunk_idx_i, task->chunk_idx_j, true);
+    if (job.out_of_core.enabled())
+    {
+        job.out_of_core.retire(task);
+    }
+
+    // Each successor is pushed exactly once, by the thread that
+    // satisfies its last dependency.
+    job.task_table.releaseSuccessors(task, [&push, &job, tid, tracing](Task *next_task) {
+        if (tracing)
+        {
+            task_trace.ready(tid, job.index, next_task->chunk_idx_i, next_task->chunk_idx_j);
+        }
+        if (checkpoint_gate.enabled() && checkpoint_gate.hold(next_task))
+        {
+            return;
+        }
+        if (job.out_of_core.enabled() && !job.out_of_core.admit(next_task))
+        {
+            return;
+        }
+        if (job.offload.takes(next_task))
+        {
+            device_offload.queue.push(next_task);
+            device_offload.parking_lot.notify_one();
+            return;
+        }
+        push(next_task);
+        parking_lot.notify_one();
+    });
+
+    // The job's last task hands it back to the main thread; nothing
+    // touches the job after that.
+    if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        std::lock_guard<std::mutex> lock(finished_mutex);
+        finished_jobs.push_back(&job);
+        finished_cv.notify_one();
+    }
+    if (checkpoint_gate.enabled())
+    {
+        checkpoint_gate.completed();
+    }
+
+    if (remaining_tasks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        parking_lot.notify_all();
+        device_offload.parking_lot.notify_all();
+        return true;
+    }
+    return false;
+}
+
+template <class ReadyQueue>
+void *thdwork(void *params)
+{
+    thread_args_ts *thread_args = (thread_args_ts *)params;
+    placement.bind(thread_args->tid);
+
+    const int tid = thread_args->tid;
+    decltype(auto) taskPQ = ready_queue<ReadyQueue>(tid);
+    bool type2_wy = thread_args->type2_wy;
+    const bool tracing = task_trace.enabled();
+    WorkerCounters *counters = run_metrics.enabled() ? &run_metrics.counters(tid) : nullptr;
+    RunMetrics::HwScope hw_scope(run_metrics, tid);
+
+    IdleBackoff idle(thread_args->idle_spins, thread_args->idle_yields);
+
+    while (1)
+    {
+        Task *new_task = nullptr;
+        //auto queue_elem1 = taskPQ.pop();
+        if (!taskPQ.try_pop(new_task)) ///Task *new_task = queue_elem1.value_or(nullptr))
+        {
+            if (counters)
+            {
+                counters->failed_pops++;
+            }
+            if (remaining_tasks.load(std::memory_order_acquire) == 0)
+            {
+                break;
+            }
+            if (idle.wait())
+            {
+                continue;
+            }
+
+            // Still nothing after spinning and yielding: park until a task is
+            // published or the graph completes.
+            uint32_t ticket = parking_lot.prepare_park();
+            if (!taskPQ.try_pop(new_task))
+            {
+                if (remaining_tasks.load(std::memory_order_acquire) == 0)
+                {
+                    parking_lot.cancel_park();
+                    break;
+                }
+                if (counters)
+                {
+                    counters->parks++;
+                }
+                parking_lot.park(ticket);
+                idle.reset();
+                continue;
+            }
+            parking_lot.cancel_park();
+        }
+        idle.reset();
+
+        QrJob &job = *job_slots[new_task->graph];
+        int i = new_task->chunk_idx_i;
+        int j = new_task->chunk_idx_j;
+        uint64_t trace_start = tracing ? task_trace.now() : 0;
+
+        if (job.single)
+        {
+            run_task(new_task, job.f32, job.m, job.n, job.ldt, job.tiled, type2_wy);
+        }
+        else
+        {
+            run_task(new_task, job.f64, job.m, job.n, job.ldt, job.tiled, type2_wy);
+        }
+        if (tracing)
+        {
+            task_trace.task(tid, job.index, i, j, new_task->type, trace_start, task_trace.now());
+        }
+        if (complete_task(new_task, job, tid, tracing, [&taskPQ](Task *next_task) { taskPQ.push(next_task); }))
+        {
+            break;
+        }
+    }
+
+    return nullptr;
+}
+
+// Runs a batch of device tasks of one job with a single synchronization, and
+// copies back the row blocks whose last device task was in it.
+template <class Real>
+void run_device_batch(const std::vector<Task *> &batch, FactorState<Real> &state)
+{
+    const Real *t_array = state.t_array.empty() ? nullptr : state.t_array.data();
+    for (const Task *task : batch)
+    {
+        state.device.enqueue(task, state.mat, state.up_array.data(), state.b_array.data(), t_array);
+    }
+    state.device.synchronize();
+    for (const Task *task : batch)
+    {
+        state.device.finish(task, state.mat);
+    }
+}
+
+// The device thread pops up to device_offload.batch ready device tasks at a
+// time, runs them, and completes them like a worker; the CPU tasks they
+// release go through the ready queue's submit(). It idles like a worker, on
+// its own parking lot. The device only serves single runs, so a batch always
+// belongs to one job.
+template <class ReadyQueue>
+void *device_work(void *)
+{
+    const int tid = device_offload.tid;
+    const bool tracing = task_trace.enabled();
+    IdleBackoff idle(device_offload.idle_spins, device_offload.idle_yields);
+    std::vector<Task *> batch;
+    batch.reserve(device_offload.batch);
+
+    bool done = false;
+    while (!done)
+    {
+        Task *task = nullptr;
+        batch.clear();
+        while ((int)batch.size() < device_offload.batch && device_offload.queue.try_pop(task))
+        {
+            batch.push_back(task);
+        }
+        if (batch.empty())
+        {
+            if (remaining_tasks.load(std::memory_order_acquire) == 0)
+            {
+                break;
+            }
+            if (idle.wait())
+            {
+                continue;
+            }
+            uint32_t ticket = device_offload.parking_lot.prepare_park();
+            if (!device_offload.queue.try_pop(task))
+            {
+                if (remaining_tasks.load(std::memory_order_acquire) == 0)
+                {
+                    device_offload.parking_lot.cancel_park();
+                    break;
+                }
+                device_offload.parking_lot.park(ticket);
+                idle.reset();
+                continue;
+            }
+            device_offload.parking_lot.cancel_park();
+            batch.push_back(task);
+        }
+        idle.reset();
+
+        QrJob &job = *job_slots[batch.front()->graph];
+        uint64_t trace_start = tracing ? task_trace.now() : 0;
+        if (job.single)
+        {
+            run_device_batch(batch, job.f32);
+        }
+        else
+        {
+            run_device_batch(batch, job.f64);
+        }
+        uint64_t trace_end = tracing ? task_trace.now() : 0;
+
+        for (size_t k = 0; k < batch.size(); k++)
+        {
+            // The batch's span is split evenly between its tasks.
+            if (tracing)
+            {
+                const uint64_t span = trace_end - trace_start;
+                task_trace.task(tid, job.index, batch[k]->chunk_idx_i, batch[k]->chunk_idx_j, batch[k]->type,
+                                trace_start + span * k / batch.size(), trace_start + span * (k + 1) / batch.size());
+            }
+            done = complete_task(batch[k], job, tid, tracing,
+                                 [](Task *next_task) { ready_queue_traits<ReadyQueue>::submit(next_task); }) || done;
+        }
+        device_offload.tasks += batch.size();
+        device_offload.batches++;
+    }
+
+    return nullptr;
+}
+
+// The I/O thread of an out-of-core job: loads and writes back its row blocks
+// (OutOfCoreMatrix::run) and hands the tasks that waited for a load to the
+// ready queue. An I/O error ends the process, as the held tasks could never
+// run.
+template <class ReadyQueue>
+void *out_of_core_work(void *arg)
+{
+    QrJob &job = *static_cast<QrJob *>(arg);
+    try
+    {
+        job.out_of_core.run([](Task *task) {
+            ready_queue_traits<ReadyQueue>::submit(task);
+            parking_lot.notify_one();
+        });
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return nullptr;
+}
+
+// Takes a checkpoint of job every cfg.checkpoint_interval seconds until
+// checkpoint_gate.stop(). The workers are only held while the state is
+// copied; the copy is written out while they go on. A failed write is
+// reported and the run continues.
+template <class ReadyQueue, class Real>
+void take_checkpoints(QrJob &job, const FactorState<Real> &state, const RunConfig &cfg)
+{
+    const CheckpointInfo run{job.m, job.n, cfg.alpha, cfg.beta, cfg.type2 == Type2Mode::wy, 0};
+    CheckpointSnapshot<Real> snapshot;
+    const std::chrono::milliseconds interval(std::llround(cfg.checkpoint_interval * 1000));
+    while (checkpoint_gate.sleep(interval))
+    {
+        auto pause_start = std::chrono::high_resolution_clock::now();
+        checkpoint_gate.pause();
+        const bool finished = job.remaining.load(std::memory_order_acquire) == 0;
+        if (!finished)
+        {
+            snapshot.capture(run, state.mat, state.up_array, state.b_array, state.t_array, job.dependency_table);
+        }
+        for (Task *task : checkpoint_gate.resume())
+        {
+            ready_queue_traits<ReadyQueue>::submit(task);
+            parking_lot.notify_one();
+        }
+        if (finished)
+        {
+            break;
+        }
+        auto pause_end = std::chrono::high_resolution_clock::now();
+        try
+        {
+            snapshot.save(cfg.checkpoint_file);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Warning: checkpoint not written: " << e.what() << std::endl;
+            continue;
+        }
+        auto write_end = std::chrono::high_resolution_clock::now();
+        std::cout << "Checkpoint: " << snapshot.info.completed << " of " << job.task_table.numTasks()
+                  << " tasks, workers held "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(pause_end - pause_start).count()
+                  << " ms, written in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(write_end - pause_end).count() << " ms"
+                  << std::endl;
+    }
+}
+
+// The checkpoint thread of a single run (--checkpoint).
+template <class ReadyQueue>
+void *checkpoint_work(void *arg)
+{
+    const auto &run = *static_cast<std::pair<QrJob *, const RunConfig *> *>(arg);
+    if (run.first->single)
+    {
+        take_checkpoints<ReadyQueue>(*run.first, run.first->f32, *run.second);
+    }
+    else
+    {
+        take_checkpoints<ReadyQueue>(*run.first, run.first->f64, *run.second);
+    }
+    return nullptr;
+}
+
+// Puts a freshly loaded job into the state of cfg.checkpoint_file: its
+// matrix and reflector state are replaced and the tasks done by then count
+// as completed. run_batch starts the job from the tasks they leave ready. A
+// checkpoint of another run ends the process.
+template <class Real>
+void resume_from_checkpoint(QrJob &job, FactorState<Real> &state, const RunConfig &cfg)
+{
+    try
+    {
+        CheckpointSnapshot<Real> snapshot;
+        snapshot.load(cfg.checkpoint_file);
+        const CheckpointInfo run{job.m, job.n, cfg.alpha, cfg.beta, cfg.type2 == Type2Mode::wy, 0};
+        if (!snapshot.info.same_run(run))
+        {
+            throw std::runtime_error("checkpoint " + cfg.checkpoint_file + " is of a " + std::to_string(snapshot.info.m) +
+                                     " x " + std::to_string(snapshot.info.n) + " run with alpha " +
+                                     std::to_string(snapshot.info.alpha) + ", beta " +
+                                     std::to_string(snapshot.info.beta) + " and type2 " +
+                                     (snapshot.info.wy ? "wy" : "reflectors") + ".");
+        }
+        job.resumed = snapshot.restore(state.mat, state.up_array, state.b_array, state.t_array, job.dependency_table,
+                                       job.task_table, [&job](Task *task) { job.resume_tasks.push_back(task); });
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    std::cout << "Checkpoint: resumed from " << cfg.checkpoint_file << ", " << job.resumed << " of "
+              << job.task_table.numTasks() << " tasks done" << std::endl;
+}
+
+// One matrix of the input: a text or binary file, or one matrix of a binary
+// file that holds several (see binary_matrix_records).
+struct MatrixSource
+{
+    std::string file;
+    bool record = false;        // Read the binary matrix at offset
+    uint64_t offset = 0;
+    std::string name;
+};
+
+// Expands the inputs into matrices. "@list" names a file with one input per
+// line (blank lines and lines starting with '#' are skipped), and a binary
+// file contributes every matrix it holds.
+std::vector<MatrixSource> expand_inputs(const std::vector<std::string> &inputs)
+{
+    std::vector<std::string> files;
+    for (const std::string &input : inputs)
+    {
+        if (input.size() > 1 && input[0] == '@')
+        {
+            std::ifstream list(input.substr(1));
+            if (!list.is_open())
+            {
+                throw std::runtime_error("Error opening input list: " + input.substr(1));
+            }
+            std::string line;
+            while (std::getline(list, line))
+            {
+                while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back())))
+                {
+                    line.pop_back();
+                }
+                if (!line.empty() && line[0] != '#')
+                {
+                    files.push_back(line);
+                }
+            }
+        }
+        else
+        {
+            files.push_back(input);
+        }
+    }
+
+    std::vector<MatrixSource> sources;
+    for (const std::string &file : files)
+    {
+        if (!is_binary_matrix_file(file))
+        {
+            sources.push_back({file, false, 0, file});
+            continue;
+        }
+        std::vector<uint64_t> records = binary_matrix_records(file);
+        for (size_t r = 0; r < records.size(); r++)
+        {
+            sources.push_back({file, true, records[r], records.size() > 1 ? file + "#" + std::to_string(r) : file});
+        }
+    }
+    return sources;
+}
+
+// Allocates the reflector scalars of a matrix with rows rows, and with
+// --type2 wy the T factor of each panel.
+template <class Real>
+void allocate_reflector_state(FactorState<Real> &state, int rows, const RunConfig &cfg, int total_task_cols,
+                              int ldt)
+{
+    state.up_array.resize(rows, 0.0);
+    state.b_array.resize(rows, 0.0);
+    if (cfg.type2 == Type2Mode::wy)
+    {
+        state.t_array.resize((size_t)total_task_cols * ldt * ldt, 0.0);
+    }
+}
+
+// Lays out the matrix the tasks factorize and allocates their reflector and
+// WY state.
+template <class Real>
+void prepare_factor_state(matrix_t<Real> &factor, FactorState<Real> &state, const RunConfig &cfg,
+                          MatrixLayout layout, int total_task_cols, int ldt, bool verbose)
+{
+    // Tiles are one task row block (beta rows) high.
+    if (layout == MatrixLayout::tiled)
+    {
+        auto convert_start = std::chrono::high_resolution_clock::now();
+        factor.to_tiled(cfg.beta, cfg.tile_cols);
+        auto convert_end = std::chrono::high_resolution_clock::now();
+        if (verbose)
+        {
+            std::cout << "Tiled layout: " << cfg.beta << " x " << cfg.tile_cols << " tiles, converted in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(convert_end - convert_start).count()
+                      << " ms" << std::endl;
+        }
+    }
+    // Re-home each row block on its owner's node before the run. In batch
+    // mode the workers are already running, so later matrices keep the pages
+    // the loader touched.
+    if (placement.policy() != PlacementPolicy::none && verbose)
+    {
+        auto touch_start = std::chrono::high_resolution_clock::now();
+        factor.first_touch(cfg.beta, cfg.num_threads, [](int t) { placement.bind(t); });
+        auto touch_end = std::chrono::high_resolution_clock::now();
+        std::cout << "Placement: " << placement.num_nodes() << " node(s), first touch in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(touch_end - touch_start).count()
+                  << " ms" << std::endl;
+    }
+    state.mat = factor.data_ptr();
+    state.tiles = BasicTiledView<Real>{factor.data_ptr(), factor.cols(), factor.tile_rows(), factor.tile_cols(),
+                                       factor.tiles_per_row(), factor.tile_stride()};
+    allocate_reflector_state(state, factor.rows(), cfg, total_task_cols, ldt);
+}
+
+// Loads a matrix for --out-of-core: copies it into its working file, which
+// the tasks factorize through the resident row blocks (see out_of_core.h).
+std::unique_ptr<QrJob> load_out_of_core_job(const MatrixSource &source, uint32_t slot, const RunConfig &cfg,
+                                            TaskGraphMode graph_mode)
+{
+    std::unique_ptr<QrJob> job(new QrJob());
+    job->name = source.name;
+    OutOfCoreMatrix &ooc = job->out_of_core;
+    auto copy_start = std::chrono::high_resolution_clock::now();
+    ooc.open(source.file, source.offset, cfg.output_file, cfg.scratch_dir, cfg.alpha, cfg.beta,
+             (size_t)cfg.memory_budget << 20);
+    auto copy_end = std::chrono::high_resolution_clock::now();
+    std::cout << "Out of core: " << ooc.blocks() << " row blocks, " << ooc.window() << " per sweep, working file "
+              << (cfg.output_file.empty() ? "(temporary)" : cfg.output_file) << " written in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(copy_end - copy_start).count() << " ms"
+              << std::endl;
+
+    job->m = ooc.rows();
+    job->n = ooc.cols();
+    job->ldt = cfg.alpha + 1;
+    int total_task_rows = TaskTable::task_rows(job->m, cfg.beta);
+    int total_task_cols = TaskTable::task_cols(job->m, job->n, cfg.alpha);
+    job->f64.mat = ooc.data();
+    allocate_reflector_state(job->f64, job->m, cfg, total_task_cols, job->ldt);
+
+    job->dependency_table.init(total_task_rows, total_task_cols);
+    auto graph_start = std::chrono::high_resolution_clock::now();
+    job->task_table.init(total_task_rows, total_task_cols, cfg.alpha, cfg.beta, job->m, job->n, graph_mode, slot);
+    auto graph_end = std::chrono::high_resolution_clock::now();
+    job->graph_ms = std::chrono::duration_cast<std::chrono::milliseconds>(graph_end - graph_start).count();
+    return job;
+}
+
+// Loads a matrix and builds everything its tasks need; its tasks are tagged
+// with slot. Progress lines are only printed for a single run. With
+// --autotune, the first matrix picks cfg.alpha and cfg.beta for the run; it is
+// loaded before the workers start, and later jobs use the same shape.
+std::unique_ptr<QrJob> load_job(const MatrixSource &source, int index, uint32_t slot, RunConfig &cfg,
+                                MatrixLayout layout, TaskGraphMode graph_mode, bool verbose)
+{
+    if (cfg.out_of_core)
+    {
+        return load_out_of_core_job(source, slot, cfg, graph_mode);
+    }
+    std::unique_ptr<QrJob> job(new QrJob());
+    job->index = index;
+    job->name = source.name;
+    matrix_t<double> &data_matrix = job->matrix;
+    if (source.record)
+    {
+        data_matrix.read_binary(source.file, true, source.offset);
+    }
+    else
+    {
+        data_matrix.read_matrix(source.file);
+    }
+
+    if (cfg.autotune && index == 0)
+    {
+        auto tune_start = std::chrono::high_resolution_clock::now();
+        TuneChoice choice = autotune_tiles(data_matrix.data_ptr(), data_matrix.rows(), data_matrix.cols(),
+                                           cfg.num_threads, cfg.type2 == Type2Mode::wy,
+                                           cfg.tune_cache.empty() ? default_tune_cache_path() : cfg.tune_cache);
+        auto tune_end = std::chrono::high_resolution_clock::now();
+        if (choice.alpha > 0)
+        {
+            cfg.alpha = choice.alpha;
+            cfg.beta = choice.beta;
+            std::cout << "Autotune: alpha " << cfg.alpha << ", beta " << cfg.beta << " ("
+                      << (choice.from_cache ? "cache" : "trials") << ", "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(tune_end - tune_start).count()
+                      << " ms), predicted " << choice.predicted_ms << " ms" << std::endl;
+        }
+        else
+        {
+            std::cout << "Autotune: matrix too small, keeping alpha " << cfg.alpha << ", beta " << cfg.beta
+                      << std::endl;
+        }
+    }
+
+    job->m = data_matrix.rows();
+    job->n = data_matrix.cols();
+    job->tiled = layout == MatrixLayout::tiled;
+    int total_task_rows = TaskTable::task_rows(job->m, cfg.beta);
+    int total_task_cols = TaskTable::task_cols(job->m, job->n, cfg.alpha);
+    // The first panel holds alpha + 1 pivots (see TaskTable::init).
+    job->ldt = cfg.alpha + 1;
+
+    job->single = cfg.precision != Precision::fp64;
+    if (job->single)
+    {
+        auto convert_start = std::chrono::high_resolution_clock::now();
+        job->matrix_f.assign_converted(data_matrix);
+        // Only refinement needs the original.
+        if (cfg.precision == Precision::fp32)
+        {
+            data_matrix = matrix_t<double>();
+        }
+        auto convert_end = std::chrono::high_resolution_clock::now();
+        if (verbose)
+        {
+            std::cout << "Precision: float copy in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(convert_end - convert_start).count()
+                      << " ms" << std::endl;
+        }
+        prepare_factor_state(job->matrix_f, job->f32, cfg, layout, total_task_cols, job->ldt, verbose);
+    }
+    else
+    {
+        prepare_factor_state(data_matrix, job->f64, cfg, layout, total_task_cols, job->ldt, verbose);
+    }
+
+    job->dependency_table.init(total_task_rows, total_task_cols);
+    auto graph_start = std::chrono::high_resolution_clock::now();
+    if (job->single)
+    {
+        job->task_table.init(total_task_rows, total_task_cols, cfg.alpha, cfg.beta, job->matrix_f, graph_mode,
+                             slot);
+    }
+    else
+    {
+        job->task_table.init(total_task_rows, total_task_cols, cfg.alpha, cfg.beta, data_matrix, graph_mode, slot);
+    }
+    auto graph_end = std::chrono::high_resolution_clock::now();
+    job->graph_ms = std::chrono::duration_cast<std::chrono::milliseconds>(graph_end - graph_start).count();
+
+    if (!cfg.checkpoint_file.empty() && std::ifstream(cfg.checkpoint_file).good())
+    {
+        if (job->single)
+        {
+            resume_from_checkpoint(*job, job->f32, cfg);
+        }
+        else
+        {
+            resume_from_checkpoint(*job, job->f64, cfg);
+        }
+    }
+
+    if (cfg.device != DeviceKind::none)
+    {
+        job->offload = DeviceSplit{cfg.device_share, cfg.beta_div_alpha(), total_task_cols};
+        const bool wy = cfg.type2 == Type2Mode::wy;
+        auto upload_start = std::chrono::high_resolution_clock::now();
+        if (job->single)
+        {
+            job->f32.device.init(cfg.device, job->offload, job->f32.mat, job->m, job->n, cfg.beta, job->ldt, wy);
+        }
+        else
+        {
+            job->f64.device.init(cfg.device, job->offload, job->f64.mat, job->m, job->n, cfg.beta, job->ldt, wy);
+        }
+        auto upload_end = std::chrono::high_resolution_clock::now();
+        if (verbose)
+        {
+            std::cout << "Device: row blocks uploaded in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(upload_end - upload_start).count()
+                      << " ms" << std::endl;
+        }
+    }
+    return job;
+}
+
+// Replaces the matrix of a job factorized in float with its result converted
+// to double, so that it is saved like any other.
+void take_float_result(QrJob &job)
+{
+    if (job.single)
+    {
+        job.matrix.assign_converted(job.matrix_f);
+        job.matrix_f = matrix_t<float>();
+        job.single = false;
+    }
+}
+
+// Runs every source through one pool of worker threads and returns the
+// elapsed wall time in nanoseconds, from the start of the workers to the
+// completion of the last job; flops gets the model flop count of the jobs. Up to cfg.batch_window jobs are alive at once
+// and their tasks share the ready queue, so one job's serial panel chain
+// overlaps the others' updates. The first window is loaded before the
+// workers start and the rest by this thread while they run. In batch mode,
+// finished jobs are appended to cfg.output_file in input order; otherwise the
+// job is returned in kept for the caller to report and save.
+template <class ReadyQueue>
+long long run_batch(const std::vector<MatrixSource> &sources, RunConfig &cfg, MatrixLayout layout,
+                    TaskGraphMode graph_mode, std::vector<pthread_t> &threads,
+                    std::vector<thread_args_ts> &thread_args, std::vector<std::unique_ptr<QrJob>> &kept,
+                    double &flops)
+{
+    flops = 0;
+    const int window = cfg.batch ? std::min<int>(cfg.batch_window, sources.size()) : 1;
+    std::vector<std::unique_ptr<QrJob>> in_flight(window);
+    std::vector<uint32_t> free_slots;
+    for (int slot = window - 1; slot >= 0; slot--)
+    {
+        free_slots.push_back(slot);
+    }
+    job_slots.assign(window, nullptr);
+
+    bool started = false;                           // Workers running
+    std::map<int, std::unique_ptr<QrJob>> held;    // Finished, waiting for their turn in the output
+    size_t next = 0;                                // Next source to admit
+    size_t retired = 0;                             // Jobs written out or handed back
+    int next_output = 0;
+    // Admitted and not yet retired; held jobs count, so output order bounds memory.
+    auto live = [&]() { return static_cast<int>(held.size()) + window - static_cast<int>(free_slots.size()); };
+
+    // Publishes a job and seeds the ready queue with its root task.
+    auto admit = [&]() {
+        uint32_t slot = free_slots.back();
+        free_slots.pop_back();
+        in_flight[slot] = load_job(sources[next], next, slot, cfg, layout, graph_mode, !cfg.batch);
+        QrJob *job = in_flight[slot].get();
+        job_slots[slot] = job;
+        next++;
+        flops += householder_flops(job->m, job->n);
+
+        int count = job->task_table.numTasks() - job->resumed;
+        if (count == 0)
+        {
+            std::lock_guard<std::mutex> lock(finished_mutex);
+            finished_jobs.push_back(job);
+            return;
+        }
+        job->remaining.store(count, std::memory_order_relaxed);
+        remaining_tasks.fetch_add(count, std::memory_order_acq_rel);
+        if (task_trace.enabled())
+        {
+            task_trace.ready(threads.size(), job->index, 0, 0);
+        }
+        // The root has the job's highest priority.
+        if constexpr (std::is_same<ReadyQueue, BucketQueue>::value)
+        {
+            if (!started)
+            {
+                bucket_taskPQ.reserve(job->task_table.getTask(0, 0)->priority);
+            }
+        }
+        // A resumed job starts from every task its checkpoint left ready.
+        if (job->resumed > 0)
+        {
+            checkpoint_gate.submitted(static_cast<int>(job->resume_tasks.size()));
+            for (Task *task : job->resume_tasks)
+            {
+                ready_queue_traits<ReadyQueue>::submit(task);
+            }
+            parking_lot.notify_all();
+            return;
+        }
+        if (checkpoint_gate.enabled())
+        {
+            checkpoint_gate.submitted(1);
+        }
+        // Out of core, the root waits for its row block like any task.
+        Task *root = job->task_table.getTask(0, 0);
+        if (!job->out_of_core.enabled() || job->out_of_core.admit(root))
+        {
+            ready_queue_traits<ReadyQueue>::submit(root);
+            parking_lot.notify_one();
+        }
+    };
+    // Drops the admission hold on remaining_tasks.
+    auto stop_admitting = [&]() {
+        if (remaining_tasks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            parking_lot.notify_all();
+            device_offload.parking_lot.notify_all();
+        }
+    };
+
+    remaining_tasks.store(1, std::memory_order_relaxed);
+    while (next < sources.size() && !free_slots.empty())
+    {
+        admit();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto end = start;
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        pthread_create(&threads[i], NULL, thdwork<ReadyQueue>, &thread_args[i]);
+    }
+    pthread_t device_thread;
+    if (cfg.device != DeviceKind::none)
+    {
+        pthread_create(&device_thread, NULL, device_work<ReadyQueue>, nullptr);
+    }
+    // Out-of-core runs are single runs: the I/O thread serves the one job.
+    pthread_t io_thread;
+    if (cfg.out_of_core)
+    {
+        pthread_create(&io_thread, NULL, out_of_core_work<ReadyQueue>, in_flight[0].get());
+    }
+    // Checkpointed runs are single runs too.
+    pthread_t checkpoint_thread;
+    std::pair<QrJob *, const RunConfig *> checkpoint_run(in_flight[0].get(), &cfg);
+    if (checkpoint_gate.enabled())
+    {
+        pthread_create(&checkpoint_thread, NULL, checkpoint_work<ReadyQueue>, &checkpoint_run);
+    }
+    started = true;
+
+    bool admitting = next < sources.size();
+    if (!admitting)
+    {
+        stop_admitting();
+    }
+    while (retired < sources.size())
+    {
+        // The window is full (or everything is admitted): wait for a job.
+        std::vector<QrJob *> done;
+        {
+            std::unique_lock<std::mutex> lock(finished_mutex);
+            finished_cv.wait(lock, [] { return !finished_jobs.empty(); });
+            done.swap(finished_jobs);
+        }
+
+        for (QrJob *job : done)
+        {
+            uint32_t slot = job->task_table.graphId();
+            job_slots[slot] = nullptr;
+            free_slots.push_back(slot);
+            held.emplace(job->index, std::move(in_flight[slot]));
+        }
+        if (!admitting && held.size() + retired == sources.size())
+        {
+            end = std::chrono::high_resolution_clock::now();
+        }
+
+        // Hand back or write finished jobs in input order.
+        for (auto it = held.find(next_output); it != held.end(); it = held.find(next_output))
+        {
+            if (!cfg.batch)
+            {
+                kept.push_back(std::move(it->second));
+            }
+            else if (!cfg.output_file.empty())
+            {
+                take_float_result(*it->second);
+                it->second->matrix.to_row_major();
+                it->second->matrix.save_binary(cfg.output_file, MATRIX_FILE_ALIGNMENT, true);
+            }
+            held.erase(it);
+            next_output++;
+            retired++;
+        }
+
+        while (admitting && live() < window)
+        {
+            admit();
+            if (next == sources.size())
+            {
+                admitting = false;
+                stop_admitting();
+            }
+        }
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    if (cfg.device != DeviceKind::none)
+    {
+        pthread_join(device_thread, NULL);
+    }
+    // The run ends when the last row block is back on disk.
+    if (cfg.out_of_core)
+    {
+        pthread_join(io_thread, NULL);
+        end = std::chrono::high_resolution_clock::now();
+    }
+    if (checkpoint_gate.enabled())
+    {
+        checkpoint_gate.stop();
+        pthread_join(checkpoint_thread, NULL);
+    }
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+// --rhs: solves min ||M^T x - b|| with the factorization of the job's matrix
+// M for every right-hand side b of the file (its rows, or a single vector),
+// refining the solutions in double with --precision mixed, and saves them,
+// one x per row, with --solution. The right-hand sides are spread over
+// num_threads workers (see QApplier).
+int solve_least_squares(QrJob &job, const RunConfig &cfg)
+{
+    try
+    {
+        matrix_t<double> rhs;
+        rhs.read_matrix(cfg.rhs_file);
+        const bool single = rhs.cols() != job.n && (size_t)rhs.rows() * rhs.cols() == (size_t)job.n;
+        if (rhs.cols() != job.n && !single)
+        {
+            throw std::invalid_argument("The right-hand side is " + std::to_string(rhs.rows()) + " x " +
+                                        std::to_string(rhs.cols()) + ", expected " + std::to_string(job.n) +
+                                        " entries per row.");
+        }
+        const int nrhs = single ? 1 : rhs.rows();
+        job.matrix.to_row_major();
+        job.matrix_f.to_row_major();
+        check_lstsq_shape(job.m, job.n);
+
+        matrix_t<double> solution(nrhs, job.m);
+        auto start = std::chrono::high_resolution_clock::now();
+        if (cfg.precision == Precision::mixed)
+        {
+            check_r_pivots(job.matrix_f.data_ptr(), job.m, job.n);
+            std::vector<RefineResult> results(nrhs);
+            parallel_chunks(nrhs, 1, cfg.num_threads, [&](int r, int) {
+                results[r] = lstsq_refine(job.matrix.data_ptr(), job.matrix_f.data_ptr(), job.m, job.n,
+                                          job.f32.up_array.data(), job.f32.b_array.data(),
+                                          rhs.data_ptr() + (size_t)r * job.n, solution.data_ptr() + (size_t)r * job.m);
+            });
+            auto end = std::chrono::high_resolution_clock::now();
+            int steps = 0, unconverged = 0;
+            double correction = 0, residual = 0;
+            for (const RefineResult &result : results)
+            {
+                steps = std::max(steps, result.iterations);
+                unconverged += result.converged ? 0 : 1;
+                correction = std::max(correction, result.correction);
+                residual = std::max(residual, result.residual);
+            }
+            std::cout << "Least squares: " << nrhs << " right-hand side(s), up to " << steps << " refinement steps";
+            if (unconverged > 0)
+            {
+                std::cout << " (" << unconverged << " not converged)";
+            }
+            std::cout << ", last correction " << correction << ", residual " << residual << ", "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms"
+                      << std::endl;
+        }
+        else
+        {
+            if (job.single)
+            {
+                QApplier<float>(job.matrix_f.data_ptr(), job.m, job.n, job.f32.up_array.data(),
+                                job.f32.b_array.data(), cfg.num_threads)
+                    .solve(rhs.data_ptr(), nrhs, job.n, solution.data_ptr(), job.m);
+            }
+            else
+            {
+                QApplier<double>(job.matrix.data_ptr(), job.m, job.n, job.f64.up_array.data(),
+                                 job.f64.b_array.data(), cfg.num_threads)
+                    .solve(rhs.data_ptr(), nrhs, job.n, solution.data_ptr(), job.m);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            std::cout << "Least squares: " << nrhs << " right-hand side(s) solved with the "
+                      << precision_name(cfg.precision) << " factors in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms"
+                      << std::endl;
+        }
+
+        if (!cfg.solution_file.empty())
+        {
+            solution.save(cfg.solution_file);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Saves the factorized matrix of a single run to cfg.output_file: as text, or
+// in the binary format with its reflector scalars (see checkpoint.h).
+void save_result(QrJob &job, const RunConfig &cfg)
+{
+    // Results are always written row-major.
+    job.matrix.to_row_major();
+    if (cfg.output_format == OutputFormat::text)
+    {
+        job.matrix.save(cfg.output_file);
+        return;
+    }
+    // A float factorization keeps its scalars in float.
+    std::vector<double> up(job.f64.up_array), b(job.f64.b_array);
+    if (up.empty())
+    {
+        up.assign(job.f32.up_array.begin(), job.f32.up_array.end());
+        b.assign(job.f32.b_array.begin(), job.f32.b_array.end());
+    }
+    auto save_start = std::chrono::high_resolution_clock::now();
+    save_factorization(cfg.output_file, job.matrix, up, b, cfg.compress);
+    auto save_end = std::chrono::high_resolution_clock::now();
+    std::cout << "Output: " << cfg.output_file << (cfg.compress ? " (binary, gzip)" : " (binary)") << " written in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(save_end - save_start).count() << " ms"
+              << std::endl;
+}
+
+// --tsqr: factorizes one short, wide matrix with the TSQR reduction tree
+// instead of the task graph, and saves its m x m factor L.
+int run_tsqr(const MatrixSource &source, const RunConfig &cfg)
+{
+    matrix_t<double> data_matrix;
+    if (source.record)
+    {
+        data_matrix.read_binary(source.file, true, source.offset);
+    }
+    else
+    {
+        data_matrix.read_matrix(source.file);
+    }
+    const int m = data_matrix.rows();
+    const int n = data_matrix.cols();
+    if (m > n)
+    {
+        std::cerr << "Warning: TSQR is meant for matrices with fewer rows than columns (" << m << " x " << n << ")"
+                  << std::endl;
+    }
+    std::cout << "TSQR: " << m << " x " << n << ", " << tsqr_num_leaves(n, cfg.num_threads, cfg.tsqr_leaf)
+              << " leaves of "
+              << cfg.tsqr_leaf << " columns, tree depth " << tsqr_tree_depth(cfg.num_threads) << std::endl;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<double> factor = tsqr(data_matrix.data_ptr(), m, n, cfg.num_threads, cfg.tsqr_leaf, cfg.alpha,
+                                      cfg.type2 == Type2Mode::wy, [](int t) { placement.bind(t); });
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Time taken: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+              << " ms" << std::endl;
+
+    if (!cfg.output_file.empty())
+    {
+        matrix_t<double> result(m, m);
+        std::copy(factor.begin(), factor.end(), result.data_ptr());
+        if (cfg.output_format == OutputFormat::binary)
+        {
+            // L alone: there are no reflectors of M to save.
+            save_factorization(cfg.output_file, result, {}, {}, cfg.compress);
+        }
+        else
+        {
+            result.save(cfg.output_file);
+        }
+    }
+    return 0;
+}
+
+// --append / --delete-rows: updates the factorization saved by an earlier
+// run with --output-format binary instead of refactorizing the whole matrix
+// (see qr_update.h), on a QrEngine with the run's threads, alpha, beta,
+// type-2 kernel and queue. Rows are deleted before the new ones are appended,
+// so one call slides a window over a stream of observations. Deleted rows are
+// downdated by Givens rotations (see downdate.h), which a binary result keeps;
+// a text result is compacted first.
+int run_update(const RunConfig &cfg)
+{
+    try
+    {
+        matrix_t<double> factor;
+        std::vector<double> up, b;
+        Downdate downdate;
+        load_factorization(cfg.input_file, factor, up, b, &downdate);
+        if (up.empty())
+        {
+            throw std::invalid_argument(cfg.input_file + " has no reflector scalars; save the factorization with "
+                                        "--output-format binary.");
+        }
+        matrix_t<double> rows;
+        if (!cfg.append_file.empty())
+        {
+            if (is_binary_matrix_file(cfg.append_file))
+            {
+                rows.read_binary(cfg.append_file, true);
+            }
+            else
+            {
+                rows.read_matrix(cfg.append_file);
+            }
+        }
+        const int m = factor.rows() - (int)downdate.deleted.size();
+
+        QrEngineOptions options;
+        options.threads = cfg.num_threads;
+        options.alpha = cfg.alpha;
+        options.beta = cfg.beta;
+        options.type2 = cfg.type2;
+        options.queue = cfg.queue;
+        options.graph = parse_task_graph_mode(cfg.graph);
+        options.idle_spins = cfg.idle_spins;
+        options.idle_yields = cfg.idle_yields;
+        QrEngine engine(options);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        if (cfg.delete_count > 0)
+        {
+            engine.delete_rows(factor, up, b, downdate, cfg.delete_first, cfg.delete_count);
+        }
+        if (!cfg.append_file.empty())
+        {
+            engine.append_rows(factor, up, b, downdate, rows);
+        }
+        if (!cfg.output_file.empty() && cfg.output_format != OutputFormat::binary)
+        {
+            engine.compact(factor, up, b, downdate);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        const int kept = factor.rows() - (int)downdate.deleted.size();
+        std::cout << "Update: " << m << " x " << factor.cols() << " -> " << kept << " x " << factor.cols()
+                  << ", " << cfg.delete_count << " rows deleted, " << rows.rows() << " appended in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms";
+        if (!downdate.empty())
+        {
+            std::cout << " (" << downdate.deleted.size() << " deleted rows kept, " << downdate.rotations.size()
+                      << " rotations)";
+        }
+        std::cout << std::endl;
+
+        if (!cfg.output_file.empty())
+        {
+            if (cfg.output_format == OutputFormat::binary)
+            {
+                save_factorization(cfg.output_file, factor, up, b, cfg.compress, downdate);
+            }
+            else
+            {
+                factor.save(cfg.output_file);
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::cout << "[1]. Inside main." << std::endl;
+
+    RunConfig cfg;
+    cfg.num_threads = DEFAULT_NUM_THREADS;
+    cfg.alpha = DEFAULT_ALPHA;
+    cfg.beta = DEFAULT_BETA;
+
+    MatrixLayout layout = MatrixLayout::row_major;
+    TaskGraphMode graph_mode = TaskGraphMode::eager;
+    try
+    {
+        if (!parse_run_config(argc, argv, cfg))
+        {
+            print_usage(argv[0], std::cout);
+            return EXIT_SUCCESS;
+        }
+        if (!select_kernel_isa(parse_kernel_isa(cfg.kernel_isa)))
+        {
+            throw std::invalid_argument("Kernel ISA not supported by this CPU: " + cfg.kernel_isa);
+        }
+        layout = parse_matrix_layout(cfg.layout);
+        graph_mode = parse_task_graph_mode(cfg.graph);
+        placement = ThreadPlacement(CpuTopology::detect(), parse_placement_policy(cfg.placement), cfg.num_threads);
+        if (layout == MatrixLayout::tiled && cfg.type2 != Type2Mode::wy)
+        {
+            throw std::invalid_argument("The tiled layout requires --type2 wy.");
+        }
+        if (cfg.tsqr && (cfg.batch || cfg.autotune || layout == MatrixLayout::tiled || !cfg.trace_file.empty() ||
+                         !cfg.metrics_file.empty() || cfg.precision != Precision::fp64 || !cfg.rhs_file.empty()))
+        {
+            throw std::invalid_argument("--tsqr does not support --batch, --autotune, --layout tiled, --trace, "
+                                        "--metrics, --precision or --rhs.");
+        }
+        if (!cfg.rhs_file.empty() && cfg.batch)
+        {
+            throw std::invalid_argument("--rhs does not support --batch.");
+        }
+        if (cfg.rhs_file.empty() && (cfg.precision == Precision::mixed || !cfg.solution_file.empty()))
+        {
+            throw std::invalid_argument("--precision mixed and --solution need --rhs.");
+        }
+        if (cfg.device != DeviceKind::none &&
+            (cfg.batch || cfg.tsqr || layout == MatrixLayout::tiled || !cfg.metrics_file.empty()))
+        {
+            throw std::invalid_argument("--device does not support --batch, --tsqr, --layout tiled or --metrics.");
+        }
+        if (cfg.out_of_core && (cfg.batch || cfg.tsqr || cfg.autotune || layout == MatrixLayout::tiled ||
+                                cfg.precision != Precision::fp64 || !cfg.rhs_file.empty() ||
+                                cfg.device != DeviceKind::none || placement.policy() != PlacementPolicy::none))
+        {
+            throw std::invalid_argument("--out-of-core does not support --batch, --tsqr, --autotune, --layout tiled, "
+                                        "--precision, --rhs, --device or --bind.");
+        }
+        // The working file is the result, so it can only be written in binary.
+        if (cfg.out_of_core && !cfg.output_file.empty() && cfg.output_format != OutputFormat::binary)
+        {
+            throw std::invalid_argument("--out-of-core writes its result in binary: -o needs --output-format binary.");
+        }
+        if (!cfg.checkpoint_file.empty() && (cfg.batch || cfg.tsqr || cfg.out_of_core || layout == MatrixLayout::tiled ||
+                                             cfg.device != DeviceKind::none))
+        {
+            throw std::invalid_argument("--checkpoint does not support --batch, --tsqr, --out-of-core, --layout tiled "
+                                        "or --device.");
+        }
+        if (cfg.update() && (cfg.batch || cfg.tsqr || cfg.autotune || cfg.out_of_core || layout == MatrixLayout::tiled ||
+                             cfg.precision != Precision::fp64 || !cfg.rhs_file.empty() ||
+                             cfg.device != DeviceKind::none || !cfg.checkpoint_file.empty() ||
+                             !cfg.trace_file.empty() || !cfg.metrics_file.empty() ||
+                             (cfg.queue != QueuePolicy::fifo && cfg.queue != QueuePolicy::priority)))
+        {
+            throw std::invalid_argument("--append and --delete-rows do not support --batch, --tsqr, --autotune, "
+                                        "--out-of-core, --layout tiled, --precision, --rhs, --device, --checkpoint, "
+                                        "--trace, --metrics or the steal and bucket queues.");
+        }
+        if (!cfg.timing_file.empty() && (cfg.batch || cfg.tsqr || cfg.update()))
+        {
+            throw std::invalid_argument("--timing does not support --batch, --tsqr, --append or --delete-rows.");
+        }
+        if (cfg.compress && (cfg.batch || cfg.out_of_core))
+        {
+            throw std::invalid_argument("--compress does not support --batch or --out-of-core.");
+        }
+#ifndef PARQR_CUDA
+        if (cfg.device == DeviceKind::cuda)
+        {
+            throw std::invalid_argument("This build has no CUDA support (build with make gpu).");
+        }
+#endif
+    }
+    catch (const std::invalid_argument &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<MatrixSource> sources = expand_inputs(cfg.inputs);
+    if (sources.empty())
+    {
+        std::cerr << "Error: no input matrices." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (cfg.out_of_core && !sources[0].record)
+    {
+        std::cerr << "Error: --out-of-core needs a binary matrix file (see convert.out)." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Threads: " << cfg.num_threads;
+    if (cfg.autotune)
+    {
+        std::cout << ", alpha: auto, beta: auto";
+    }
+    else
+    {
+        std::cout << ", alpha: " << cfg.alpha << ", beta: " << cfg.beta;
+    }
+    std::cout
+              << ", queue: " << queue_policy_name(cfg.queue)
+              << ", kernels: " << kernel_isa_name(active_kernels().isa)
+              << ", type2: " << type2_mode_name(cfg.type2)
+              << ", precision: " << precision_name(cfg.precision)
+              << ", layout: " << matrix_layout_name(layout)
+              << ", bind: " << placement_policy_name(placement.policy())
+              << ", graph: " << task_graph_mode_name(graph_mode);
+    if (cfg.device != DeviceKind::none)
+    {
+        std::cout << ", device: " << device_kind_name(cfg.device) << " (" << cfg.device_share << "% of row blocks)";
+    }
+    if (cfg.out_of_core)
+    {
+        std::cout << ", out of core: " << cfg.memory_budget << " MB";
+    }
+    if (!cfg.checkpoint_file.empty())
+    {
+        std::cout << ", checkpoint: every " << cfg.checkpoint_interval << " s";
+    }
+    std::cout << std::endl;
+    if (cfg.tsqr)
+    {
+        return run_tsqr(sources[0], cfg);
+    }
+    if (cfg.update())
+    {
+        return run_update(cfg);
+    }
+    if (cfg.batch)
+    {
+        std::cout << "Batch: " << sources.size() << " matrices, " << std::min<size_t>(cfg.batch_window, sources.size())
+                  << " in flight" << std::endl;
+    }
+
+    // Trace threads: the workers, main, and the device thread if any.
+    device_offload.tid = cfg.num_threads + 1;
+    device_offload.batch = cfg.device_batch;
+    device_offload.idle_spins = cfg.idle_spins;
+    device_offload.idle_yields = cfg.idle_yields;
+    if (!cfg.trace_file.empty() || !cfg.metrics_file.empty())
+    {
+        task_trace.init(cfg.num_threads + (cfg.device != DeviceKind::none ? 2 : 1), 1 << 16);
+    }
+    if (!cfg.metrics_file.empty())
+    {
+        run_metrics.init(cfg.num_threads, cfg.hw_counters);
+    }
+    std::vector<pthread_t> threads(cfg.num_threads);
+    std::vector<thread_args_ts> thread_args(cfg.num_threads);
+
+    for (int i = 0; i < cfg.num_threads; i++)
+    {
+        thread_args[i].tid = i;
+        thread_args[i].idle_spins = cfg.idle_spins;
+        thread_args[i].idle_yields = cfg.idle_yields;
+        thread_args[i].type2_wy = cfg.type2 == Type2Mode::wy;
+    }
+
+    if (!cfg.checkpoint_file.empty())
+    {
+        checkpoint_gate.enable();
+    }
+
+    // Batch results are appended one by one.
+    if (cfg.batch && !cfg.output_file.empty())
+    {
+        std::ofstream(cfg.output_file, std::ios::binary | std::ios::trunc);
+    }
+
+    std::vector<std::unique_ptr<QrJob>> kept;
+    long long elapsed_ns = 0;
+    double flops = 0;
+    switch (cfg.queue)
+    {
+    case QueuePolicy::priority:
+        elapsed_ns = run_batch<PriorityQueue>(sources, cfg, layout, graph_mode, threads, thread_args, kept, flops);
+        break;
+    case QueuePolicy::bucket:
+        elapsed_ns = run_batch<BucketQueue>(sources, cfg, layout, graph_mode, threads, thread_args, kept, flops);
+        break;
+    case QueuePolicy::steal:
+        stealing_taskPQ.init(cfg.num_threads, placement);
+        elapsed_ns = run_batch<WorkStealingQueues>(sources, cfg, layout, graph_mode, threads, thread_args, kept,
+                                                    flops);
+        break;
+    default:
+        elapsed_ns = run_batch<FifoQueue>(sources, cfg, layout, graph_mode, threads, thread_args, kept, flops);
+        break;
+    }
+
+    long elapsed = elapsed_ns / 1000000;
+    std::cout << "Time taken: " << elapsed << " ms" << std::endl;
+    if (!cfg.trace_file.empty())
+    {
+        std::vector<std::string> names(task_trace.threads());
+        for (int t = 0; t < cfg.num_threads; t++)
+        {
+            names[t] = "worker " + std::to_string(t);
+        }
+        names[cfg.num_threads] = "main";
+        if (cfg.device != DeviceKind::none)
+        {
+            names[device_offload.tid] = "device";
+        }
+        task_trace.save(cfg.trace_file, names);
+        std::cout << "Trace: " << task_trace.num_tasks() << " tasks written to " << cfg.trace_file << std::endl;
+    }
+    if (run_metrics.enabled())
+    {
+        RunSummary summary = run_metrics.summarize(task_trace, elapsed_ns, cfg.beta_div_alpha(), flops);
+        RunMetrics::save(cfg.metrics_file, summary);
+        if (cfg.hw_counters && std::none_of(summary.threads.begin(), summary.threads.end(),
+                                            [](const RunSummary::Thread &t) { return t.has_hw; }))
+        {
+            std::cerr << "Warning: hardware counters unavailable (perf_event_open failed)" << std::endl;
+        }
+        std::cout << "Metrics: critical path " << summary.critical_path_ns / 1e6 << " ms, written to "
+                  << cfg.metrics_file << std::endl;
+    }
+    if (cfg.batch)
+    {
+        std::cout << "Throughput: " << sources.size() * 1000.0 / std::max(elapsed, 1L) << " matrices/s" << std::endl;
+        return 0;
+    }
+
+    QrJob &job = *kept.front();
+    std::cout << "Task graph: " << job.task_table.numTasks() << " tasks, built in " << job.graph_ms
+              << " ms, peak " << job.task_table.peakTasks() << " alive ("
+              << job.task_table.peakTasks() * sizeof(Task) / (1 << 20) << " MB)" << std::endl;
+    //job.dependency_table.printDependencyTable();
+    if (!cfg.timing_file.empty())
+    {
+        save_run_timing(cfg.timing_file, "dynamic", job.m, job.n, cfg.num_threads, cfg.alpha, cfg.beta, elapsed_ns);
+    }
+    if (cfg.device != DeviceKind::none)
+    {
+        const size_t up = job.single ? job.f32.device.bytes_up : job.f64.device.bytes_up;
+        const size_t down = job.single ? job.f32.device.bytes_down : job.f64.device.bytes_down;
+        std::cout << "Device: " << device_offload.tasks << " type-2 tasks in " << device_offload.batches
+                  << " batches, " << up / (1 << 20) << " MB up, " << down / (1 << 20) << " MB down" << std::endl;
+    }
+
+    if (job.out_of_core.enabled())
+    {
+        // The working file is the result; -o names it.
+        const OutOfCoreMatrix &ooc = job.out_of_core;
+        std::cout << "Out of core: " << ooc.sweeps() << " sweeps, " << ooc.loads << " block reads, "
+                  << ooc.bytes_read / (1 << 20) << " MB read, " << ooc.bytes_written / (1 << 20)
+                  << " MB written, peak " << ooc.peak_resident / (1 << 20) << " MB resident" << std::endl;
+        return 0;
+    }
+
+    if (!cfg.rhs_file.empty() && solve_least_squares(job, cfg) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    take_float_result(job);
+    if (!cfg.output_file.empty())
+    {
+        save_result(job, cfg);
+    }
+    // The run is complete: a rerun starts afresh.
+    if (!cfg.checkpoint_file.empty())
+    {
+        std::remove(cfg.checkpoint_file.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,617 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <mpi.h>
+#include "include/autotune.h"
+#include "include/bn2.h"
+#include "include/distributed.h"
+#include "include/idle.h"
+#include "include/kernels.h"
+#include "include/metrics.h"
+#include "include/placement.h"
+#include "include/run_config.h"
+#include <tbb/concurrent_priority_queue.h>
+#include <tbb/tbb.h>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <list>
+#include <sys/resource.h>
+#include <memory>
+#include <thread>
+
+// Distributed-memory driver: the dynamic scheduler of main.cpp on every MPI
+// rank. The row blocks of the matrix are spread over the ranks in a 1D
+// row-block-cyclic layout (see distributed.h) and each rank runs the task
+// rows of its blocks with its own pool of worker threads, ready queue and
+// parking lot. The main thread of a rank does the communication: it sends
+// each panel its workers factorize to the ranks that own blocks below it
+// without waiting for the transfer, and turns every panel it receives into
+// ready type-2 tasks. Only the main thread calls MPI.
+
+// Defaults; override with -t/-a/-b/-q or PARQR_THREADS/ALPHA/BETA/QUEUE.
+#define DEFAULT_NUM_THREADS 28
+
+#define DEFAULT_BETA 16
+#define DEFAULT_ALPHA 4
+
+// Message tags. A panel message carries its panel index (see pack_panel).
+constexpr int PANEL_TAG = 1;
+constexpr int RESULT_TAG = 2;
+
+// Sleep of the communication thread once it has spun and yielded without
+// finding anything to do.
+constexpr int PROGRESS_SLEEP_US = 20;
+
+struct TaskComparator
+{
+    bool operator()(const Task *a, const Task *b) const
+    {
+        return a->priority < b->priority;
+    }
+};
+
+typedef tbb::concurrent_queue<Task *> FifoQueue;
+typedef tbb::concurrent_priority_queue<Task *, TaskComparator> PriorityQueue;
+
+// What this rank's workers and its communication thread share.
+struct RankState
+{
+    RowBlockCyclic dist;
+    TaskTable task_table;
+    double *mat = nullptr;
+    int m = 0;
+    int n = 0;
+    int alpha = 0;
+    int beta_div_alpha = 1;     // Panels per row block
+    int ldt = 0;
+    bool type2_wy = true;
+    std::vector<double> up_array, b_array;
+    std::vector<double> t_array;
+    // Local type-2 tasks still to run on each received panel; the panel's
+    // rows are released when the count drops to zero.
+    std::unique_ptr<std::atomic<int>[]> panel_users;
+    // Panels factorized here that other ranks need, for the main thread to send.
+    tbb::concurrent_queue<int> factorized;
+    alignas(64) std::atomic<int> remaining{0};
+    ParkingLot parking_lot;
+    std::atomic<size_t> released_bytes{0};
+};
+
+ThreadPlacement placement;
+
+// Runs one task of this rank's row blocks (row-major storage).
+void run_task(const Task *task, RankState &s)
+{
+    const int row_start = task->row_start;
+    const int row_end = task->row_end;
+    const int col_start = task->col_start;
+    const int col_end = task->col_end;
+    double *T = s.t_array.data() + (size_t)task->chunk_idx_j * s.ldt * s.ldt;
+
+    if (task->type == 1)
+    {
+        complete_task1(s.mat, s.m, s.n, row_start, row_end, col_start, col_end, s.up_array.data(),
+                       s.b_array.data());
+        if (s.type2_wy)
+        {
+            build_wy_factor(s.mat, s.n, row_start, row_end, s.up_array.data(), s.b_array.data(), T, s.ldt);
+        }
+    }
+    else if (s.type2_wy)
+    {
+        complete_task2_wy(s.mat, s.m, s.n, row_start, row_end, col_start, col_end, s.up_array.data(), T, s.ldt);
+    }
+    else
+    {
+        complete_task2(s.mat, s.m, s.n, row_start, row_end, col_start, col_end, s.up_array.data(),
+                       s.b_array.data());
+    }
+}
+
+// The task loop of main.cpp's thdwork, over this rank's tasks.
+template <class ReadyQueue>
+void work(RankState &s, ReadyQueue &queue, int tid, int idle_spins, int idle_yields)
+{
+    placement.bind(tid);
+    IdleBackoff idle(idle_spins, idle_yields);
+
+    while (true)
+    {
+        Task *task = nullptr;
+        if (!queue.try_pop(task))
+        {
+            if (s.remaining.load(std::memory_order_acquire) == 0)
+            {
+                break;
+            }
+            if (idle.wait())
+            {
+                continue;
+            }
+            uint32_t ticket = s.parking_lot.prepare_park();
+            if (!queue.try_pop(task))
+            {
+                if (s.remaining.load(std::memory_order_acquire) == 0)
+                {
+                    s.parking_lot.cancel_park();
+                    break;
+                }
+                s.parking_lot.park(ticket);
+                idle.reset();
+                continue;
+            }
+            s.parking_lot.cancel_park();
+        }
+        idle.reset();
+
+        // A lazy graph may recycle the task once its successors are released.
+        const int i = task->chunk_idx_i;
+        const int j = task->chunk_idx_j;
+        const int type = task->type;
+        run_task(task, s);
+        s.task_table.releaseSuccessors(task, [&s, &queue](Task *next) {
+            queue.push(next);
+            s.parking_lot.notify_one();
+        });
+
+        if (type == 1 && !s.dist.panel_receivers(i).empty())
+        {
+            s.factorized.push(j);
+        }
+        else if (type == 2 && !s.dist.owns(j / s.beta_div_alpha) &&
+                 s.panel_users[j].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            int begin, end;
+            panel_rows(j, s.alpha, std::min(s.m, s.n), begin, end);
+            s.released_bytes.fetch_add(release_rows(s.mat, s.n, begin, end), std::memory_order_relaxed);
+        }
+
+        if (s.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            s.parking_lot.notify_all();
+            break;
+        }
+    }
+}
+
+// Panel sends still in flight: one packed buffer per panel, one request per
+// receiver.
+struct PendingSend
+{
+    std::vector<double> buffer;
+    std::vector<MPI_Request> requests;
+};
+
+struct ExchangeStats
+{
+    long long sent = 0;         // Panel messages sent
+    long long sent_bytes = 0;
+    long long received = 0;     // Panel messages received
+};
+
+// The communication loop of the main thread, until this rank's tasks are
+// done, its sends have completed and every panel it needs has arrived.
+template <class ReadyQueue>
+ExchangeStats exchange_panels(RankState &s, ReadyQueue &queue, int expected, int idle_spins, int idle_yields)
+{
+    ExchangeStats stats;
+    std::list<PendingSend> sends;
+    std::vector<double> incoming;
+    IdleBackoff idle(idle_spins, idle_yields);
+    const int pivots = std::min(s.m, s.n);
+
+    while (true)
+    {
+        // A worker queues its panel before it counts the task as done, so
+        // the panels of a finished rank are all queued by now.
+        const bool finished = s.remaining.load(std::memory_order_acquire) == 0;
+        bool progress = false;
+
+        int j = 0;
+        while (s.factorized.try_pop(j))
+        {
+            int begin, end;
+            panel_rows(j, s.alpha, pivots, begin, end);
+            sends.emplace_back();
+            PendingSend &send = sends.back();
+            pack_panel(s.mat, s.n, j, begin, end, s.up_array.data(), s.b_array.data(),
+                       s.t_array.data() + (size_t)j * s.ldt * s.ldt, s.ldt, s.type2_wy, send.buffer);
+            if (send.buffer.size() > (size_t)INT_MAX)
+            {
+                throw std::length_error("Panel message too large for MPI");
+            }
+            for (int receiver : s.dist.panel_receivers(j / s.beta_div_alpha))
+            {
+                send.requests.emplace_back();
+                MPI_Isend(send.buffer.data(), (int)send.buffer.size(), MPI_DOUBLE, receiver, PANEL_TAG,
+                          MPI_COMM_WORLD, &send.requests.back());
+                stats.sent++;
+                stats.sent_bytes += send.buffer.size() * sizeof(double);
+            }
+            progress = true;
+        }
+
+        int flag = 0;
+        MPI_Status status;
+        MPI_Iprobe(MPI_ANY_SOURCE, PANEL_TAG, MPI_COMM_WORLD, &flag, &status);
+        if (flag)
+        {
+            int count = 0;
+            MPI_Get_count(&status, MPI_DOUBLE, &count);
+            incoming.resize(count);
+            MPI_Recv(incoming.data(), count, MPI_DOUBLE, status.MPI_SOURCE, PANEL_TAG, MPI_COMM_WORLD,
+                     MPI_STATUS_IGNORE);
+            const int panel = unpack_panel(incoming.data(), count, s.mat, s.n, s.alpha, pivots, s.up_array.data(),
+                                           s.b_array.data(), s.t_array.data(), s.ldt, s.type2_wy);
+            s.task_table.releasePanel(panel / s.beta_div_alpha, panel, [&s, &queue](Task *next) {
+                queue.push(next);
+                s.parking_lot.notify_one();
+            });
+            stats.received++;
+            progress = true;
+        }
+
+        for (auto it = sends.begin(); it != sends.end();)
+        {
+            int done = 0;
+            MPI_Testall((int)it->requests.size(), it->requests.data(), &done, MPI_STATUSES_IGNORE);
+            it = done ? sends.erase(it) : std::next(it);
+        }
+        if (finished && sends.empty() && stats.received >= expected)
+        {
+            break;
+        }
+
+        if (progress)
+        {
+            idle.reset();
+        }
+        else if (!idle.wait())
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(PROGRESS_SLEEP_US));
+        }
+    }
+    return stats;
+}
+
+// Starts the workers on the rank's ready queue, seeds it with the root task
+// if this rank owns it, and runs the communication loop until the rank is
+// done.
+template <class ReadyQueue>
+ExchangeStats run_rank(RankState &s, ReadyQueue &queue, int expected, const RunConfig &cfg)
+{
+    std::vector<std::thread> workers;
+    s.remaining.store(s.task_table.ownedTasks(), std::memory_order_relaxed);
+    if (s.dist.owns(0) && s.task_table.ownedTasks() > 0)
+    {
+        queue.push(s.task_table.getTask(0, 0));
+    }
+    for (int t = 0; t < cfg.num_threads; t++)
+    {
+        workers.emplace_back(work<ReadyQueue>, std::ref(s), std::ref(queue), t, cfg.idle_spins, cfg.idle_yields);
+    }
+    ExchangeStats stats = exchange_panels(s, queue, expected, cfg.idle_spins, cfg.idle_yields);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    return stats;
+}
+
+// Collects the factorized rows of every block on rank 0, and their
+// reflector scalars into up and b (rank 0 only).
+void gather_result(const RankState &s, std::vector<double> &up, std::vector<double> &b)
+{
+    if (s.dist.rank == 0)
+    {
+        up = s.up_array;
+        b = s.b_array;
+    }
+    for (int i = 0; i < s.dist.blocks; i++)
+    {
+        const int owner = s.dist.owner(i);
+        if (owner == 0)
+        {
+            continue;
+        }
+        for (int r = s.dist.block_begin(i); r < s.dist.block_end(i); r++)
+        {
+            double *row = s.mat + (size_t)r * s.n;
+            if (s.dist.rank == 0)
+            {
+                MPI_Recv(row, s.n, MPI_DOUBLE, owner, RESULT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+            else if (s.dist.rank == owner)
+            {
+                MPI_Send(row, s.n, MPI_DOUBLE, 0, RESULT_TAG, MPI_COMM_WORLD);
+            }
+        }
+        const int begin = s.dist.block_begin(i);
+        const int count = s.dist.block_end(i) - begin;
+        if (s.dist.rank == 0)
+        {
+            MPI_Recv(up.data() + begin, count, MPI_DOUBLE, owner, RESULT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            MPI_Recv(b.data() + begin, count, MPI_DOUBLE, owner, RESULT_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        }
+        else if (s.dist.rank == owner)
+        {
+            MPI_Send(s.up_array.data() + begin, count, MPI_DOUBLE, 0, RESULT_TAG, MPI_COMM_WORLD);
+            MPI_Send(s.b_array.data() + begin, count, MPI_DOUBLE, 0, RESULT_TAG, MPI_COMM_WORLD);
+        }
+    }
+}
+
+// The shared usage text, plus how mpi.out spreads the matrix.
+void print_mpi_usage(const char *prog, std::ostream &os = std::cerr)
+{
+    print_usage(prog, os);
+    os << "Run under mpirun, one rank per node. Row blocks of beta rows are distributed 1D row-block-cyclically:\n"
+       << "block i is on rank i % P. The input must be a binary matrix (./convert.out IN.txt OUT.bin), which\n"
+       << "each rank maps to read only its own rows. --batch, --window, --tsqr, --tsqr-leaf, --precision,\n"
+       << "--layout, --tile-cols, --rhs, --solution, --append, --delete-rows, --device, --device-share,\n"
+       << "--device-batch, --out-of-core, --memory-budget, --scratch, --trace, --metrics, --hw-counters,\n"
+       << "--timing, --compress, --checkpoint and --checkpoint-interval are not supported; -q takes fifo or\n"
+       << "priority.\n";
+}
+
+// The options set in cfg that mpi.out does not implement, comma-separated;
+// empty if there are none.
+std::string unsupported_options(const RunConfig &cfg)
+{
+    const RunConfig defaults;
+    std::vector<std::string> names;
+    auto check = [&names](bool set, const char *name) {
+        if (set)
+        {
+            names.push_back(name);
+        }
+    };
+    check(cfg.batch, "--batch");
+    check(cfg.batch_window != defaults.batch_window, "--window");
+    check(cfg.tsqr, "--tsqr");
+    check(cfg.tsqr_leaf != defaults.tsqr_leaf, "--tsqr-leaf");
+    check(cfg.precision != defaults.precision, "--precision");
+    check(cfg.layout != defaults.layout, "--layout");
+    check(cfg.tile_cols != defaults.tile_cols, "--tile-cols");
+    check(!cfg.rhs_file.empty(), "--rhs");
+    check(!cfg.solution_file.empty(), "--solution");
+    check(!cfg.append_file.empty(), "--append");
+    check(cfg.delete_count > 0, "--delete-rows");
+    check(cfg.device != defaults.device, "--device");
+    check(cfg.device_share != defaults.device_share, "--device-share");
+    check(cfg.device_batch != defaults.device_batch, "--device-batch");
+    check(cfg.out_of_core, "--out-of-core");
+    check(cfg.memory_budget != defaults.memory_budget, "--memory-budget");
+    check(!cfg.scratch_dir.empty(), "--scratch");
+    check(!cfg.trace_file.empty(), "--trace");
+    check(!cfg.metrics_file.empty(), "--metrics");
+    check(cfg.hw_counters, "--hw-counters");
+    check(!cfg.timing_file.empty(), "--timing");
+    check(cfg.compress, "--compress");
+    check(!cfg.checkpoint_file.empty(), "--checkpoint");
+    check(cfg.checkpoint_interval != defaults.checkpoint_interval, "--checkpoint-interval");
+    std::string list;
+    for (const std::string &name : names)
+    {
+        list += (list.empty() ? "" : ", ") + name;
+    }
+    return list;
+}
+
+int main(int argc, char *argv[])
+{
+    int provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    int rank = 0, ranks = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    const bool root = rank == 0;
+
+    RunConfig cfg;
+    cfg.num_threads = DEFAULT_NUM_THREADS;
+    cfg.alpha = DEFAULT_ALPHA;
+    cfg.beta = DEFAULT_BETA;
+
+    TaskGraphMode graph_mode = TaskGraphMode::eager;
+    try
+    {
+        if (!parse_run_config(argc, argv, cfg))
+        {
+            if (root)
+            {
+                print_mpi_usage(argv[0], std::cout);
+            }
+            MPI_Finalize();
+            return EXIT_SUCCESS;
+        }
+        if (!select_kernel_isa(parse_kernel_isa(cfg.kernel_isa)))
+        {
+            throw std::invalid_argument("Kernel ISA not supported by this CPU: " + cfg.kernel_isa);
+        }
+        graph_mode = parse_task_graph_mode(cfg.graph);
+        placement = ThreadPlacement(CpuTopology::detect(), parse_placement_policy(cfg.placement), cfg.num_threads);
+        const std::string unsupported = unsupported_options(cfg);
+        if (!unsupported.empty())
+        {
+            throw std::invalid_argument("Not supported by the distributed driver, use the shared-memory driver "
+                                        "(main.cpp): " + unsupported);
+        }
+        if (cfg.queue != QueuePolicy::fifo && cfg.queue != QueuePolicy::priority)
+        {
+            throw std::invalid_argument("mpi_main.cpp supports the fifo and priority queues only.");
+        }
+        // Every rank opens the input, so text would be parsed, and held, whole
+        // on each of them.
+        if (!is_binary_matrix_file(cfg.input_file))
+        {
+            throw std::invalid_argument(cfg.input_file + " is not a binary matrix file. mpi.out maps the binary "
+                                        "format so that each rank reads only its own rows; convert the text "
+                                        "first: ./convert.out " + cfg.input_file + " OUT.bin");
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        if (root)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            print_mpi_usage(argv[0]);
+        }
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    // Every rank maps the binary input, so a rank only ever reads the rows
+    // it touches.
+    matrix_t<double> data_matrix;
+    try
+    {
+        data_matrix.read_binary(cfg.input_file);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error (rank " << rank << "): " << e.what() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if (cfg.autotune)
+    {
+        int shape[2] = {cfg.alpha, cfg.beta};
+        if (root)
+        {
+            TuneChoice choice = autotune_tiles(data_matrix.data_ptr(), data_matrix.rows(), data_matrix.cols(),
+                                               cfg.num_threads, cfg.type2 == Type2Mode::wy,
+                                               cfg.tune_cache.empty() ? default_tune_cache_path() : cfg.tune_cache);
+            if (choice.alpha > 0)
+            {
+                shape[0] = choice.alpha;
+                shape[1] = choice.beta;
+            }
+        }
+        MPI_Bcast(shape, 2, MPI_INT, 0, MPI_COMM_WORLD);
+        cfg.alpha = shape[0];
+        cfg.beta = shape[1];
+    }
+
+    RankState s;
+    s.mat = data_matrix.data_ptr();
+    s.m = data_matrix.rows();
+    s.n = data_matrix.cols();
+    s.alpha = cfg.alpha;
+    s.beta_div_alpha = cfg.beta_div_alpha();
+    // The first panel holds alpha + 1 pivots (see TaskTable::init).
+    s.ldt = cfg.alpha + 1;
+    s.type2_wy = cfg.type2 == Type2Mode::wy;
+    const int total_task_rows = TaskTable::task_rows(s.m, cfg.beta);
+    const int total_task_cols = TaskTable::task_cols(s.m, s.n, cfg.alpha);
+    s.dist = RowBlockCyclic(ranks, rank, total_task_rows, cfg.beta, s.m);
+    s.up_array.assign(s.m, 0.0);
+    s.b_array.assign(s.m, 0.0);
+    if (s.type2_wy)
+    {
+        s.t_array.assign((size_t)total_task_cols * s.ldt * s.ldt, 0.0);
+    }
+
+    if (root)
+    {
+        std::cout << "Ranks: " << ranks << ", threads per rank: " << cfg.num_threads << ", alpha: " << cfg.alpha
+                  << ", beta: " << cfg.beta << ", queue: " << queue_policy_name(cfg.queue)
+                  << ", kernels: " << kernel_isa_name(active_kernels().isa)
+                  << ", type2: " << type2_mode_name(cfg.type2) << ", graph: " << task_graph_mode_name(graph_mode)
+                  << std::endl;
+    }
+
+    // Only the owned blocks stay resident.
+    size_t released = 0;
+    for (int i = 0; i < total_task_rows; i++)
+    {
+        if (!s.dist.owns(i))
+        {
+            released += release_rows(s.mat, s.n, s.dist.block_begin(i), s.dist.block_end(i));
+        }
+    }
+
+    s.task_table.init(total_task_rows, total_task_cols, cfg.alpha, cfg.beta, data_matrix, graph_mode);
+    s.task_table.setRowOwner(ranks, rank);
+
+    // The panels of blocks owned elsewhere that a local block below needs.
+    const int bda = s.beta_div_alpha;
+    int expected = 0;
+    s.panel_users.reset(new std::atomic<int>[total_task_cols]());
+    for (int j = 0; j < total_task_cols; j++)
+    {
+        const int users = s.dist.owns(j / bda) ? 0 : s.dist.owned_blocks_below(j / bda);
+        s.panel_users[j].store(users, std::memory_order_relaxed);
+        expected += users > 0;
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = std::chrono::high_resolution_clock::now();
+    ExchangeStats stats;
+    try
+    {
+        if (cfg.queue == QueuePolicy::priority)
+        {
+            PriorityQueue queue;
+            stats = run_rank(s, queue, expected, cfg);
+        }
+        else
+        {
+            FifoQueue queue;
+            stats = run_rank(s, queue, expected, cfg);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error (rank " << rank << "): " << e.what() << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    long long totals[3] = {stats.sent, stats.sent_bytes, stats.received};
+    long long sums[3] = {0, 0, 0};
+    MPI_Reduce(totals, sums, 3, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    // Largest rank: peak resident set and rows released.
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long long memory[2] = {(long long)usage.ru_maxrss * 1024, (long long)(released + s.released_bytes.load())};
+    long long memory_max[2] = {0, 0};
+    MPI_Reduce(memory, memory_max, 2, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (root)
+    {
+        const long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "Time taken: " << elapsed << " ms" << std::endl;
+        std::cout << "Performance: " << householder_flops(s.m, s.n) / std::max(elapsed, 1L) / 1e6 << " GFLOP/s"
+                  << std::endl;
+        std::cout << "Panels: " << sums[0] << " messages sent (" << sums[1] / (1 << 20) << " MB), " << sums[2]
+                  << " received" << std::endl;
+        std::cout << "Memory: peak resident " << memory_max[0] / (1 << 20) << " MB per rank, up to "
+                  << memory_max[1] / (1 << 20) << " MB of rows released" << std::endl;
+    }
+
+    if (!cfg.output_file.empty())
+    {
+        std::vector<double> up, b;
+        gather_result(s, up, b);
+        if (root && cfg.output_format == OutputFormat::binary)
+        {
+            // The records of save_factorization() (checkpoint.h), uncompressed.
+            matrix_t<double> scalars(2, s.m);
+            std::copy(up.begin(), up.end(), scalars.data_ptr());
+            std::copy(b.begin(), b.end(), scalars.data_ptr() + s.m);
+            data_matrix.save_binary(cfg.output_file);
+            scalars.save_binary(cfg.output_file, MATRIX_FILE_ALIGNMENT, true);
+        }
+        else if (root)
+        {
+            data_matrix.save(cfg.output_file);
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
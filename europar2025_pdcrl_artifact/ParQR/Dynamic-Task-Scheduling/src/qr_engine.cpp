@@ -0,0 +1,583 @@
+#include "qr_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tbb/concurrent_priority_queue.h>
+#include <tbb/concurrent_queue.h>
+#include "idle.h"
+#include "kernels.h"
+#include "qr_update.h"
+
+namespace {
+
+struct TaskOrder {
+    bool operator()(const Task* a, const Task* b) const { return a->priority < b->priority; }
+};
+
+}  // namespace
+
+// One job slot: the matrix being factorized and the storage its tasks use,
+// kept between calls. Task::graph is the slot's index.
+struct QrEngine::Context {
+    uint32_t id = 0;
+    TaskTable task_table;
+    DependencyTableAtomic dependency_table;
+    std::vector<double> up, b, t;
+    double* mat = nullptr;
+    int m = -1;                 // Shape the storage was built for
+    int n = -1;
+    std::atomic<int> remaining{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    bool done = false;
+    RowUpdateGraph* update = nullptr;   // Set while the slot runs update tasks
+};
+
+struct QrEngine::Impl {
+    QrEngineOptions options;
+    int ldt = 0;
+    std::vector<std::unique_ptr<Context>> contexts;
+    std::vector<Context*> idle_contexts;
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+
+    tbb::concurrent_queue<Task*> fifo;
+    tbb::concurrent_priority_queue<Task*, TaskOrder> by_priority;
+    ParkingLot parking_lot;
+    std::atomic<bool> stopping{false};
+    std::vector<std::thread> workers;
+
+    void push(Task* task) {
+        if (options.queue == QueuePolicy::priority) {
+            by_priority.push(task);
+        } else {
+            fifo.push(task);
+        }
+        parking_lot.notify_one();
+    }
+
+    // Runs task, releases its successors and wakes the job's caller after
+    // its last task; nothing touches the context after that. A context runs
+    // either a factorization or, while update is set, a RowUpdateGraph.
+    void run(Task* task) {
+        Context& c = *contexts[task->graph];
+        if (c.update != nullptr) {
+            c.update->run(task);
+            c.update->releaseSuccessors(task, [this](Task* next) { push(next); });
+        } else {
+            run_factor_task(c, task);
+        }
+        if (c.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(c.mutex);
+            c.done = true;
+            c.finished.notify_one();
+        }
+    }
+
+    void run_factor_task(Context& c, Task* task) {
+        const int m = c.m, n = c.n;
+        double* t = c.t.data() + (size_t)task->chunk_idx_j * ldt * ldt;
+        const bool wy = options.type2 == Type2Mode::wy;
+        if (task->type == 1) {
+            complete_task1(c.mat, m, n, task->row_start, task->row_end, task->col_start, task->col_end, c.up.data(),
+                           c.b.data());
+            if (wy) {
+                build_wy_factor(c.mat, n, task->row_start, task->row_end, c.up.data(), c.b.data(), t, ldt);
+            }
+        } else if (wy) {
+            complete_task2_wy(c.mat, m, n, task->row_start, task->row_end, task->col_start, task->col_end,
+                              c.up.data(), t, ldt);
+        } else {
+            complete_task2(c.mat, m, n, task->row_start, task->row_end, task->col_start, task->col_end, c.up.data(),
+                           c.b.data());
+        }
+        c.dependency_table.setDependency(task->chunk_idx_i, task->chunk_idx_j, true);
+        c.task_table.releaseSuccessors(task, [this](Task* next) { push(next); });
+    }
+
+    // A worker: pops and runs tasks of any job, parking while there are
+    // none, until the engine stops. One instance per queue, so the loop
+    // never branches on the policy.
+    template <class Queue>
+    void work(Queue& queue) {
+        IdleBackoff idle(options.idle_spins, options.idle_yields);
+        while (true) {
+            Task* task = nullptr;
+            if (!queue.try_pop(task)) {
+                if (stopping.load(std::memory_order_acquire)) {
+                    break;
+                }
+                if (idle.wait()) {
+                    continue;
+                }
+                uint32_t ticket = parking_lot.prepare_park();
+                if (!queue.try_pop(task)) {
+                    if (stopping.load(std::memory_order_acquire)) {
+                        parking_lot.cancel_park();
+                        break;
+                    }
+                    parking_lot.park(ticket);
+                    idle.reset();
+                    continue;
+                }
+                parking_lot.cancel_park();
+            }
+            idle.reset();
+            run(task);
+        }
+    }
+
+    // Takes an idle context, preferring one last used for an m x n matrix.
+    Context* acquire(int m, int n) {
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle_cv.wait(lock, [this] { return !idle_contexts.empty(); });
+        auto it = std::find_if(idle_contexts.begin(), idle_contexts.end(),
+                               [m, n](const Context* c) { return c->m == m && c->n == n; });
+        if (it == idle_contexts.end()) {
+            it = idle_contexts.end() - 1;
+        }
+        Context* c = *it;
+        idle_contexts.erase(it);
+        return c;
+    }
+
+    void release(Context* c) {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        idle_contexts.push_back(c);
+        idle_cv.notify_one();
+    }
+
+    // Runs the graph that init(graph_id) builds on a context of its own and
+    // waits for it; the context's factorization storage is left as it was.
+    template <class Init>
+    void run_update(RowUpdateGraph& graph, Init&& init) {
+        Context* c = acquire(-1, -1);
+        init(c->id);
+        if (graph.numTasks() > 0) {
+            c->update = &graph;
+            c->done = false;
+            c->remaining.store(graph.numTasks(), std::memory_order_relaxed);
+            graph.roots([this](Task* task) { push(task); });
+            std::unique_lock<std::mutex> lock(c->mutex);
+            c->finished.wait(lock, [c] { return c->done; });
+            c->update = nullptr;
+        }
+        release(c);
+    }
+
+    // Rows per update task: enough blocks for every worker, at most beta.
+    int update_block_rows(int rows, int blocks_per_thread) const {
+        const int blocks = options.threads * blocks_per_thread;
+        return std::max(1, std::min(options.beta, (rows + blocks - 1) / blocks));
+    }
+
+    // Readies c's graph and state for an m x n matrix, rebuilding them only
+    // when the shape changes.
+    void prepare(Context& c, int m, int n) {
+        const int rows = TaskTable::task_rows(m, options.beta);
+        const int cols = TaskTable::task_cols(m, n, options.alpha);
+        if (c.m == m && c.n == n) {
+            c.task_table.resetDependencies();
+            c.dependency_table.reset();
+            std::fill(c.up.begin(), c.up.end(), 0.0);
+            std::fill(c.b.begin(), c.b.end(), 0.0);
+        } else {
+            c.task_table.init(rows, cols, options.alpha, options.beta, m, n, options.graph, c.id);
+            c.dependency_table.init(rows, cols);
+            c.up.assign(m, 0.0);
+            c.b.assign(m, 0.0);
+            c.t.assign(options.type2 == Type2Mode::wy ? (size_t)cols * ldt * ldt : 0, 0.0);
+            c.m = m;
+            c.n = n;
+        }
+    }
+};
+
+QrEngine::QrEngine(const QrEngineOptions& options) : impl(new Impl()) {
+    QrEngineOptions& opt = impl->options;
+    opt = options;
+    if (opt.threads == 0) {
+        opt.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (opt.threads < 0 || opt.alpha < 1 || opt.beta < 1 || opt.max_jobs < 1 || opt.idle_spins < 0 ||
+        opt.idle_yields < 0) {
+        throw std::invalid_argument("QrEngine: threads, alpha, beta and max_jobs must be positive.");
+    }
+    if (opt.beta % opt.alpha != 0) {
+        throw std::invalid_argument("QrEngine: beta (" + std::to_string(opt.beta) + ") must be a multiple of alpha (" +
+                                    std::to_string(opt.alpha) + ").");
+    }
+    if (opt.queue != QueuePolicy::fifo && opt.queue != QueuePolicy::priority) {
+        throw std::invalid_argument("QrEngine: only the fifo and priority queues are supported.");
+    }
+    // The first panel holds alpha + 1 pivots (see TaskTable::init).
+    impl->ldt = opt.alpha + 1;
+
+    for (int k = 0; k < opt.max_jobs; k++) {
+        impl->contexts.emplace_back(new Context());
+        impl->contexts.back()->id = k;
+    }
+    for (int k = opt.max_jobs - 1; k >= 0; k--) {
+        impl->idle_contexts.push_back(impl->contexts[k].get());
+    }
+    for (int tid = 0; tid < opt.threads; tid++) {
+        if (opt.queue == QueuePolicy::priority) {
+            impl->workers.emplace_back([this] { impl->work(impl->by_priority); });
+        } else {
+            impl->workers.emplace_back([this] { impl->work(impl->fifo); });
+        }
+    }
+}
+
+QrEngine::~QrEngine() {
+    impl->stopping.store(true, std::memory_order_release);
+    impl->parking_lot.notify_all();
+    for (std::thread& worker : impl->workers) {
+        worker.join();
+    }
+}
+
+void QrEngine::factor(matrix_t<double>& mat) {
+    std::vector<double> up, b;
+    factor(mat, up, b);
+}
+
+void QrEngine::factor(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b) {
+    const int m = mat.rows(), n = mat.cols();
+    up.assign(std::max(m, 0), 0.0);
+    b.assign(std::max(m, 0), 0.0);
+    if (m == 0 || n == 0) {
+        return;
+    }
+    mat.to_row_major();
+
+    Context* c = impl->acquire(m, n);
+    impl->prepare(*c, m, n);
+    c->mat = mat.data_ptr();
+    c->done = false;
+    c->remaining.store(c->task_table.numTasks(), std::memory_order_relaxed);
+    impl->push(c->task_table.getTask(0, 0));
+    {
+        std::unique_lock<std::mutex> lock(c->mutex);
+        c->finished.wait(lock, [c] { return c->done; });
+    }
+    std::copy(c->up.begin(), c->up.end(), up.begin());
+    std::copy(c->b.begin(), c->b.end(), b.begin());
+    c->mat = nullptr;
+    impl->release(c);
+}
+
+// Step 2 of an update (see qr_update.h): rows [first, rows) of mat have had
+// the reflectors [0, first) applied; factorizes their columns [first, n) as
+// a matrix of their own and stores its reflectors as pivots first, ... of mat.
+static void factor_trailing_rows(QrEngine& engine, matrix_t<double>& mat, std::vector<double>& up,
+                                 std::vector<double>& b, int first) {
+    const int rows = mat.rows(), n = mat.cols();
+    if (first >= n || first >= rows) {
+        return;
+    }
+    matrix_t<double> block(rows - first, n - first);
+    for (int i = first; i < rows; i++) {
+        const double* row = mat.data_ptr() + (size_t)i * n;
+        std::copy(row + first, row + n, block.data_ptr() + (size_t)(i - first) * (n - first));
+    }
+    std::vector<double> block_up, block_b;
+    engine.factor(block, block_up, block_b);
+    for (int i = first; i < rows; i++) {
+        const double* row = block.data_ptr() + (size_t)(i - first) * (n - first);
+        std::copy(row, row + (n - first), mat.data_ptr() + (size_t)i * n + first);
+    }
+    std::copy(block_up.begin(), block_up.end(), up.begin() + first);
+    std::copy(block_b.begin(), block_b.end(), b.begin() + first);
+}
+
+static void check_factorization(const matrix_t<double>& mat, const std::vector<double>& up,
+                                const std::vector<double>& b) {
+    if ((int)up.size() != mat.rows() || (int)b.size() != mat.rows()) {
+        throw std::invalid_argument("QrEngine: the factorization has " + std::to_string(up.size()) +
+                                    " reflector scalars for " + std::to_string(mat.rows()) + " rows.");
+    }
+}
+
+void QrEngine::append_rows(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b,
+                           const matrix_t<double>& rows) {
+    check_factorization(mat, up, b);
+    const int m = mat.rows(), k = rows.rows();
+    const int n = m > 0 ? mat.cols() : rows.cols();
+    if (k == 0) {
+        return;
+    }
+    if (rows.cols() != n) {
+        throw std::invalid_argument("QrEngine: appended rows have " + std::to_string(rows.cols()) +
+                                    " columns, the factorization " + std::to_string(n) + ".");
+    }
+    mat.to_row_major();
+    matrix_t<double> grown(m + k, n);
+    if (m > 0) {
+        std::copy(mat.data_ptr(), mat.data_ptr() + (size_t)m * n, grown.data_ptr());
+    }
+    for (int i = 0; i < k; i++) {
+        for (int j = 0; j < n; j++) {
+            grown.data_ptr()[(size_t)(m + i) * n + j] = rows(i, j);
+        }
+    }
+    up.resize(m + k, 0.0);
+    b.resize(m + k, 0.0);
+
+    const int pivots = std::min(m, n);
+    RowUpdateGraph graph;
+    impl->run_update(graph, [&](uint32_t id) {
+        graph.init_append(grown.data_ptr(), n, up.data(), b.data(), m, m + k, pivots, impl->options.alpha,
+                          impl->update_block_rows(k, 1), impl->options.type2 == Type2Mode::wy, id);
+    });
+    factor_trailing_rows(*this, grown, up, b, pivots);
+    mat = std::move(grown);
+}
+
+// Estimated work of the ways to carry out an update, in flops of the blocked
+// factorization kernel. Restoring a row takes one reflector at a time and a
+// rotation is a short dependent chain, so both cost more per flop.
+constexpr double RESTORE_FLOP = 2;
+constexpr double ROTATION_FLOP = 3;
+
+static double factor_work(int rows, int cols) {
+    double work = 0;
+    for (int q = 0; q < std::min(rows, cols); q++) {
+        work += 4.0 * (rows - q) * (cols - q);
+    }
+    return work;
+}
+
+// Compacting: each kept row after the first ghost undoes the rotations and
+// the reflectors from min(first_ghost, p) up to its own, and those rows are
+// refactorized.
+static double compact_work(const std::vector<int>& live, int first_ghost, int m, int n, size_t rotations) {
+    const int pivots = std::min(m, n), from = std::min(first_ghost, pivots);
+    double work = 0;
+    for (size_t k = first_ghost; k < live.size(); k++) {
+        const int last = std::min(live[k], pivots - 1);
+        if (last >= from) {
+            work += RESTORE_FLOP * 4.0 * (last - from + 1) * (n - 0.5 * (from + last));
+        }
+        work += ROTATION_FLOP * 6.0 * rotations;
+    }
+    return work + factor_work((int)live.size() - from, n - from);
+}
+
+// A Givens sweep of the rows [first, rows) of L, which reach extra columns
+// past their diagonal (see RowUpdateGraph::init_givens): its rotations, and
+// its work, each rotation being applied from its own row down.
+static size_t sweep_rotations(int first, int rows, int n, int extra) {
+    size_t count = 0;
+    for (int r = first; r < std::min(rows, n - 1); r++) {
+        count += std::max(0, std::min(n - 1, r + extra) - r);
+    }
+    return count;
+}
+
+// The rotations a factorization of rows rows of n entries may carry: as
+// many as take the room of its matrix, four entries each.
+static size_t max_rotations(int rows, int n) { return (size_t)rows * n / 4; }
+
+static double givens_work(int first, int rows, int n, int extra) {
+    double work = 0;
+    for (int r = first; r < std::min(rows, n - 1); r++) {
+        work += 6.0 * std::max(0, std::min(n - 1, r + extra) - r) * (rows - r);
+    }
+    return ROTATION_FLOP * work;
+}
+
+// Makes rows [first, first + count) of M, stored in rows live[first, ...),
+// ghosts: they join downdate.deleted, their lower part is cleared and they
+// leave live.
+static void mark_deleted(matrix_t<double>& mat, Downdate& downdate, std::vector<int>& live, int first, int count) {
+    const int n = mat.cols();
+    const size_t old = downdate.deleted.size();
+    for (int k = first; k < first + count; k++) {
+        double* row = mat.data_ptr() + (size_t)live[k] * n;
+        std::fill(row, row + std::min(live[k], n - 1) + 1, 0.0);
+        downdate.deleted.push_back(live[k]);
+    }
+    std::inplace_merge(downdate.deleted.begin(), downdate.deleted.begin() + old, downdate.deleted.end());
+    live.erase(live.begin() + first, live.begin() + first + count);
+}
+
+// Ghosts past the pivots of a tall matrix hold no reflector: they are
+// dropped from mat.
+static void drop_ghosts_past_pivots(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b,
+                                    Downdate& downdate) {
+    const int m = mat.rows(), n = mat.cols();
+    const auto past = std::lower_bound(downdate.deleted.begin(), downdate.deleted.end(), n);
+    if (past == downdate.deleted.end()) {
+        return;
+    }
+    matrix_t<double> kept(m - (int)(downdate.deleted.end() - past), n);
+    int rows = 0;
+    auto ghost = past;
+    for (int i = 0; i < m; i++) {
+        if (ghost != downdate.deleted.end() && *ghost == i) {
+            ++ghost;
+            continue;
+        }
+        std::copy(mat.data_ptr() + (size_t)i * n, mat.data_ptr() + (size_t)(i + 1) * n,
+                  kept.data_ptr() + (size_t)rows * n);
+        up[rows] = up[i];
+        b[rows] = b[i];
+        rows++;
+    }
+    up.resize(rows);
+    b.resize(rows);
+    downdate.deleted.erase(past, downdate.deleted.end());
+    mat = std::move(kept);
+}
+
+static void check_rows_of_m(int first, int count, int rows) {
+    if (first < 0 || count < 0 || first > rows - count) {
+        throw std::invalid_argument("QrEngine: cannot delete rows [" + std::to_string(first) + ", " +
+                                    std::to_string(first + count) + ") of " + std::to_string(rows) + ".");
+    }
+}
+
+void QrEngine::delete_rows(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b, int first,
+                           int count) {
+    check_factorization(mat, up, b);
+    check_rows_of_m(first, count, mat.rows());
+    if (count == 0) {
+        return;
+    }
+    mat.to_row_major();
+    Downdate downdate;
+    std::vector<int> live = downdate.live_rows(mat.rows());
+    mark_deleted(mat, downdate, live, first, count);
+    compact(mat, up, b, downdate);
+}
+
+void QrEngine::delete_rows(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b,
+                           Downdate& downdate, int first, int count) {
+    check_factorization(mat, up, b);
+    check_downdate(downdate, mat.rows(), mat.cols());
+    std::vector<int> live = downdate.live_rows(mat.rows());
+    check_rows_of_m(first, count, (int)live.size());
+    if (count == 0) {
+        return;
+    }
+    mat.to_row_major();
+    const int m = mat.rows(), n = mat.cols();
+    mark_deleted(mat, downdate, live, first, count);
+    const int kept = (int)live.size();
+
+    // Rows [first, kept) of L now reach count columns past their diagonal.
+    // Sweep them unless compacting is cheaper, or the rotations would
+    // outgrow the factorization.
+    const size_t rotations = downdate.rotations.size() + sweep_rotations(first, kept, n, count);
+    if (compact_work(live, downdate.deleted.front(), m, n, downdate.rotations.size()) <=
+            givens_work(first, kept, n, count) ||
+        rotations > max_rotations(kept, n)) {
+        compact(mat, up, b, downdate);
+        return;
+    }
+    RowUpdateGraph graph;
+    impl->run_update(graph, [&](uint32_t id) {
+        graph.init_givens(mat.data_ptr(), n, live.data(), first, kept, count, downdate.rotations,
+                          impl->update_block_rows(kept - first, 4), id);
+    });
+    drop_ghosts_past_pivots(mat, up, b, downdate);
+}
+
+void QrEngine::append_rows(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b,
+                           Downdate& downdate, const matrix_t<double>& rows) {
+    check_factorization(mat, up, b);
+    check_downdate(downdate, mat.rows(), mat.cols());
+    const int m = mat.rows(), k = rows.rows(), n = mat.cols();
+    if (downdate.empty() || k == 0) {
+        append_rows(mat, up, b, rows);
+        return;
+    }
+    const int ghosts = (int)downdate.deleted.size(), kept = m - ghosts;
+    std::vector<int> live = downdate.live_rows(m);
+    const double rotate = ROTATION_FLOP * 6.0 * k * downdate.rotations.size() + givens_work(kept, kept + k, n, ghosts);
+    const size_t rotations = downdate.rotations.size() + sweep_rotations(kept, kept + k, n, ghosts);
+    if (compact_work(live, downdate.deleted.front(), m, n, downdate.rotations.size()) <= rotate ||
+        rotations > max_rotations(kept + k, n)) {
+        compact(mat, up, b, downdate);
+        append_rows(mat, up, b, rows);
+        return;
+    }
+
+    // The new rows go below the ghosts as usual, and then through the
+    // rotations, which leave them ghosts columns past their diagonal.
+    append_rows(mat, up, b, rows);
+    RowUpdateGraph graph;
+    impl->run_update(graph, [&](uint32_t id) {
+        graph.init_rotate(mat.data_ptr(), n, m, m + k, downdate.rotations.data(), downdate.rotations.size(),
+                          impl->update_block_rows(k, 1), id);
+    });
+    live = downdate.live_rows(m + k);
+    impl->run_update(graph, [&](uint32_t id) {
+        graph.init_givens(mat.data_ptr(), n, live.data(), kept, kept + k, ghosts, downdate.rotations,
+                          impl->update_block_rows(k, 4), id);
+    });
+}
+
+void QrEngine::compact(matrix_t<double>& mat, std::vector<double>& up, std::vector<double>& b,
+                       Downdate& downdate) {
+    check_factorization(mat, up, b);
+    check_downdate(downdate, mat.rows(), mat.cols());
+    if (downdate.deleted.empty()) {
+        downdate.clear();
+        return;
+    }
+    mat.to_row_major();
+    const int m = mat.rows(), n = mat.cols();
+    const std::vector<int> live = downdate.live_rows(m);
+    const int kept = (int)live.size();
+    const int pivots = std::min(m, n);
+    // Rows before the first ghost are as factor() left them.
+    const int first = downdate.deleted.front();
+    const int from = std::min(first, pivots);
+    const int tail = kept - first;
+
+    if (tail == 0) {
+        matrix_t<double> head(kept, n);
+        std::copy(mat.data_ptr(), mat.data_ptr() + (size_t)kept * n, head.data_ptr());
+        mat = std::move(head);
+        up.resize(kept);
+        b.resize(kept);
+        downdate.clear();
+        return;
+    }
+
+    // The restored rows go below a copy of mat, whose rows hold the
+    // reflectors they undo.
+    matrix_t<double> work(m + tail, n);
+    std::copy(mat.data_ptr(), mat.data_ptr() + (size_t)m * n, work.data_ptr());
+    mat = matrix_t<double>();
+    RowUpdateGraph graph;
+    impl->run_update(graph, [&](uint32_t id) {
+        graph.init_restore(work.data_ptr(), n, up.data(), b.data(), live.data() + first, tail,
+                           downdate.rotations.data(), downdate.rotations.size(), m, from, pivots,
+                           impl->update_block_rows(tail, 4), id);
+    });
+
+    matrix_t<double> shrunk(kept, n);
+    std::copy(work.data_ptr(), work.data_ptr() + (size_t)first * n, shrunk.data_ptr());
+    std::copy(work.data_ptr() + (size_t)m * n, work.data_ptr() + (size_t)(m + tail) * n,
+              shrunk.data_ptr() + (size_t)first * n);
+    work = matrix_t<double>();
+    up.resize(kept);
+    b.resize(kept);
+    std::fill(up.begin() + from, up.end(), 0.0);
+    std::fill(b.begin() + from, b.end(), 0.0);
+    factor_trailing_rows(*this, shrunk, up, b, from);
+    mat = std::move(shrunk);
+    downdate.clear();
+}
+
+int QrEngine::threads() const { return impl->options.threads; }
+
+const QrEngineOptions& QrEngine::options() const { return impl->options; }
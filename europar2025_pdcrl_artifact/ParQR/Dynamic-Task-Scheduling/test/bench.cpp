@@ -0,0 +1,428 @@
+// Microbenchmark suite for the building blocks of the schedulers, each timed
+// on its own so a regression can be pinned to one of them without a full run:
+//
+//   kernels  one type-1 and one type-2 task (complete_task1, complete_task2,
+//            and their compact-WY variants) across n, alpha and beta, in
+//            GFLOP/s of the Householder flop count
+//   queues   push/pop throughput of every ready queue, and of the TBB queues
+//            the drivers use, across 1..N threads
+//   deps     completion throughput of DependencyTable and of each
+//            DependencyTableAtomic layout, with the scheduler's access pattern
+//
+// Results are written as CSV (default) or JSON, one record per measurement:
+//   suite, name, threads, n, alpha, beta, value, unit
+//
+// Usage: bench.out [--suite all|kernels|queues|deps] [--threads N] [--quick]
+//                  [--format csv|json] [--isa auto|scalar|avx2|avx512]
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <tbb/concurrent_queue.h>
+#include <tbb/concurrent_priority_queue.h>
+#include "bn2.h"
+#include "bucket_queue.h"
+#include "kernels.h"
+
+struct BenchResult {
+    std::string suite;
+    std::string name;
+    int threads;
+    int n;
+    int alpha;
+    int beta;
+    double value;
+    std::string unit;
+};
+
+struct BenchOptions {
+    std::string suite = "all";
+    std::string format = "csv";
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool quick = false;
+};
+
+// 1, 2, 4, ... up to max, and max itself.
+std::vector<int> thread_counts(int max) {
+    std::vector<int> counts;
+    for (int t = 1; t < max; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(max);
+    return counts;
+}
+
+// ============================== Kernels ============================== //
+
+// Householder flops of a type-1 task: for each pivot p, the norm of its
+// row tail and one reflector (dot + axpy) on each later row of the tile.
+double task1_flops(int n, int row_start, int row_end, int col_end) {
+    double flops = 0;
+    for (int p = row_start; p < row_end; p++) {
+        flops += 2.0 * (n - p - 1) + 4.0 * (n - p) * std::max(0, col_end - p - 1);
+    }
+    return flops;
+}
+
+// A type-2 task applies every reflector of the panel to each of its rows. The
+// WY variant does the same work as two GEMM-like sweeps, so the same count is
+// used for both.
+double task2_flops(int n, int row_start, int row_end, int col_start, int col_end) {
+    double flops = 0;
+    for (int p = row_start; p < row_end; p++) {
+        flops += 4.0 * (n - p) * (col_end - col_start);
+    }
+    return flops;
+}
+
+// Best time of repeated calls to task, restoring the task's rows from the
+// original matrix before each call (untimed). Repeats for at least min_ns.
+template <class Task>
+double best_seconds(std::vector<double>& mat, const std::vector<double>& orig, size_t first, size_t count,
+                    double min_ns, Task task) {
+    double best = 1e30;
+    double total = 0;
+    for (int rep = 0; rep < 3 || total < min_ns; rep++) {
+        std::memcpy(mat.data() + first, orig.data() + first, count * sizeof(double));
+        auto start = std::chrono::steady_clock::now();
+        task();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        best = std::min(best, ns);
+        total += ns;
+    }
+    return best * 1e-9;
+}
+
+// Times the tasks of panel j = beta/alpha, the first panel with alpha pivots:
+// its type-1 task (row block 1) and the type-2 task of row block 2. Row and
+// column naming follows TaskTable: pivots are row_start..row_end, the rows a
+// task updates are col_start..col_end.
+void bench_kernels(const BenchOptions& opt, std::vector<BenchResult>& out) {
+    const std::vector<int> sizes = opt.quick ? std::vector<int>{1024} : std::vector<int>{1024, 3000, 6000};
+    const std::vector<std::pair<int, int>> tiles = opt.quick
+        ? std::vector<std::pair<int, int>>{{8, 32}}
+        : std::vector<std::pair<int, int>>{{4, 16}, {8, 32}, {16, 64}, {32, 128}, {8, 128}};
+    const double min_ns = opt.quick ? 2e7 : 1e8;
+
+    for (int n : sizes) {
+        std::vector<double> orig((size_t)n * n);
+        std::mt19937_64 rng(n);
+        std::uniform_real_distribution<double> dist(-1.0, 1.0);
+        for (double& v : orig) {
+            v = dist(rng);
+        }
+        std::vector<double> mat = orig;
+
+        for (auto [alpha, beta] : tiles) {
+            if (3 * beta + 1 > n) {
+                continue;
+            }
+            const int ldt = alpha + 1;
+            std::vector<double> up(n, 0.0), b(n, 0.0), T((size_t)ldt * ldt, 0.0);
+            const int row_start = beta + 1, row_end = beta + alpha + 1;
+            const int t1_start = beta + 1, t1_end = 2 * beta + 1;
+            const int t2_start = 2 * beta + 1, t2_end = 3 * beta + 1;
+            const size_t t1_first = (size_t)row_start * n, t1_count = (size_t)(t1_end - row_start) * n;
+            const size_t t2_first = (size_t)t2_start * n, t2_count = (size_t)(t2_end - t2_start) * n;
+
+            auto task1 = [&] {
+                complete_task1(mat.data(), n, n, row_start, row_end, t1_start, t1_end, up.data(), b.data());
+            };
+            auto task1_wy = [&] {
+                task1();
+                build_wy_factor(mat.data(), n, row_start, row_end, up.data(), b.data(), T.data(), ldt);
+            };
+            double t1 = best_seconds(mat, orig, t1_first, t1_count, min_ns, task1);
+            double t1_wy = best_seconds(mat, orig, t1_first, t1_count, min_ns, task1_wy);
+
+            // The type-2 tasks need the panel's reflectors (and T): leave the
+            // factorized panel rows in place.
+            task1_wy();
+            auto task2 = [&] {
+                complete_task2(mat.data(), n, n, row_start, row_end, t2_start, t2_end, up.data(), b.data());
+            };
+            auto task2_wy = [&] {
+                complete_task2_wy(mat.data(), n, n, row_start, row_end, t2_start, t2_end, up.data(), T.data(), ldt);
+            };
+            double t2 = best_seconds(mat, orig, t2_first, t2_count, min_ns, task2);
+            double t2_wy = best_seconds(mat, orig, t2_first, t2_count, min_ns, task2_wy);
+            std::memcpy(mat.data() + t1_first, orig.data() + t1_first, t1_count * sizeof(double));
+
+            const double f1 = task1_flops(n, row_start, row_end, t1_end);
+            const double f2 = task2_flops(n, row_start, row_end, t2_start, t2_end);
+            out.push_back({"kernels", "task1", 1, n, alpha, beta, f1 / t1 * 1e-9, "GFLOP/s"});
+            out.push_back({"kernels", "task1_wy", 1, n, alpha, beta, f1 / t1_wy * 1e-9, "GFLOP/s"});
+            out.push_back({"kernels", "task2", 1, n, alpha, beta, f2 / t2 * 1e-9, "GFLOP/s"});
+            out.push_back({"kernels", "task2_wy", 1, n, alpha, beta, f2 / t2_wy * 1e-9, "GFLOP/s"});
+        }
+    }
+}
+
+// ============================== Queues ============================== //
+
+// Runs body(tid) on num_threads threads started together and returns the
+// elapsed seconds.
+template <class Body>
+double run_threads(int num_threads, Body body) {
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            body(t);
+        });
+    }
+    while (ready.load() < num_threads) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+// Every thread pushes one element and pops one, as a worker pushes a released
+// successor and pops its next task. The queue starts with a few elements per
+// thread, so pops rarely find it empty. Returns millions of operations
+// (pushes plus successful pops) per second.
+template <class Push, class Pop>
+double mixed_throughput(int num_threads, long ops, Push push, Pop pop) {
+    std::atomic<long> done{0};
+    double seconds = run_threads(num_threads, [&](int tid) {
+        long count = 0;
+        for (long k = 0; k < ops; ++k) {
+            push(tid, static_cast<int>(k));
+            count += 1 + pop(tid);
+        }
+        done.fetch_add(count, std::memory_order_relaxed);
+    });
+    return done.load() / seconds * 1e-6;
+}
+
+void bench_queues(const BenchOptions& opt, std::vector<BenchResult>& out) {
+    const long ops = opt.quick ? 100000 : 1000000;
+    const size_t prefill = 64;
+
+    for (int t : thread_counts(opt.max_threads)) {
+        const size_t capacity = (prefill + 64) * t;
+        auto record = [&](const char* name, double mops) {
+            out.push_back({"queues", name, t, 0, 0, 0, mops, "Mops/s"});
+        };
+
+        {
+            CircularQueueMtx<int> q(capacity);
+            for (size_t k = 0; k < prefill * t; ++k) {
+                q.push_back(0);
+            }
+            record("circular_mtx", mixed_throughput(t, ops, [&](int, int v) { q.push_back(v); },
+                                                    [&](int) { return q.pop_front().has_value(); }));
+        }
+        {
+            CircularQueueAtomic<int> q(capacity);
+            for (size_t k = 0; k < prefill * t; ++k) {
+                q.push_back(0);
+            }
+            record("circular_atomic", mixed_throughput(t, ops, [&](int, int v) { q.push_back(v); },
+                                                       [&](int) { return q.pop_front().has_value(); }));
+        }
+        {
+            tbb::concurrent_queue<int> q;
+            for (size_t k = 0; k < prefill * t; ++k) {
+                q.push(0);
+            }
+            record("tbb_queue", mixed_throughput(t, ops, [&](int, int v) { q.push(v); },
+                                                 [&](int) { int v; return q.try_pop(v); }));
+        }
+        {
+            tbb::concurrent_priority_queue<int> q;
+            for (size_t k = 0; k < prefill * t; ++k) {
+                q.push(0);
+            }
+            record("tbb_priority_queue", mixed_throughput(t, ops, [&](int, int v) { q.push(v); },
+                                                          [&](int) { int v; return q.try_pop(v); }));
+        }
+        {
+            // Priorities spread over a band of buckets, as the ready tasks of
+            // a few neighbouring anti-diagonals are.
+            BucketPriorityQueue<int> q(1024);
+            for (size_t k = 0; k < prefill * t; ++k) {
+                q.push(0, k % 16);
+            }
+            record("bucket", mixed_throughput(t, ops, [&](int, int v) { q.push(v, 512 + v % 16); },
+                                              [&](int) { int v; return q.try_pop(v); }));
+        }
+        {
+            // One Chase-Lev deque per thread, as in the steal queue: the
+            // owner pops its own deque and steals from its neighbour one
+            // pop in four.
+            std::vector<std::unique_ptr<ChaseLevDeque<int>>> deques;
+            for (int d = 0; d < t; ++d) {
+                deques.emplace_back(new ChaseLevDeque<int>(capacity));
+                for (size_t k = 0; k < prefill; ++k) {
+                    deques.back()->push(0);
+                }
+            }
+            std::vector<long> counter(t * 8, 0);
+            record("chase_lev", mixed_throughput(t, ops, [&](int tid, int v) { deques[tid]->push(v); },
+                                                 [&](int tid) {
+                                                     if ((++counter[tid * 8] & 3) == 0) {
+                                                         return deques[(tid + 1) % t]->steal().has_value();
+                                                     }
+                                                     return deques[tid]->pop().has_value();
+                                                 }));
+        }
+    }
+}
+
+// =========================== Dependency tables =========================== //
+
+// Completes every cell of a rows x cols grid, sweeps times: cell (i, j) is
+// completed by thread (i + j) % T, which loads its two predecessors (the left
+// neighbour and the panel's type-1 entry) and stores its own entry, as in the
+// dynamic scheduler. Returns millions of completed cells per second.
+template <class Table>
+double completion_throughput(Table& table, int rows, int cols, int sweeps, int num_threads) {
+    const int bda = 4;
+    std::atomic<long> sink{0};
+    double seconds = run_threads(num_threads, [&](int tid) {
+        long reads = 0;
+        for (int s = 0; s < sweeps; ++s) {
+            bool value = (s & 1) == 0;
+            for (int j = 0; j < cols; ++j) {
+                for (int i = (tid - j % num_threads + num_threads) % num_threads; i < rows; i += num_threads) {
+                    if (j > 0) {
+                        reads += table.getDependency(i, j - 1);
+                    }
+                    reads += table.getDependency((j / bda) % rows, j);
+                    table.setDependency(i, j, value);
+                }
+            }
+        }
+        sink.fetch_add(reads, std::memory_order_relaxed);
+    });
+    return static_cast<double>(rows) * cols * sweeps / seconds * 1e-6;
+}
+
+void bench_dependency_tables(const BenchOptions& opt, std::vector<BenchResult>& out) {
+    const int rows = 64, cols = 256;
+    const int sweeps = opt.quick ? 50 : 400;
+
+    for (int t : thread_counts(opt.max_threads)) {
+        auto record = [&](const char* name, double mcells) {
+            out.push_back({"deps", name, t, 0, 0, 0, mcells, "Mcells/s"});
+        };
+        if (t == 1) {
+            // Plain bools: only meaningful single-threaded.
+            DependencyTable plain(rows, cols);
+            record("plain", completion_throughput(plain, rows, cols, sweeps, 1));
+        }
+        DependencyTableAtomic packed(rows, cols, DependencyLayout::packed);
+        DependencyTableAtomic aligned(rows, cols, DependencyLayout::row_aligned);
+        DependencyTableAtomic padded(rows, cols, DependencyLayout::padded);
+        record("atomic_packed", completion_throughput(packed, rows, cols, sweeps, t));
+        record("atomic_row_aligned", completion_throughput(aligned, rows, cols, sweeps, t));
+        record("atomic_padded", completion_throughput(padded, rows, cols, sweeps, t));
+    }
+}
+
+// ============================== Output ============================== //
+
+void write_csv(std::ostream& os, const std::vector<BenchResult>& results) {
+    os << "suite,name,threads,n,alpha,beta,value,unit\n";
+    for (const auto& r : results) {
+        os << r.suite << "," << r.name << "," << r.threads << "," << r.n << "," << r.alpha << "," << r.beta << ","
+           << r.value << "," << r.unit << "\n";
+    }
+}
+
+void write_json(std::ostream& os, const std::vector<BenchResult>& results) {
+    os << "[\n";
+    for (size_t k = 0; k < results.size(); ++k) {
+        const auto& r = results[k];
+        os << "  {\"suite\": \"" << r.suite << "\", \"name\": \"" << r.name << "\", \"threads\": " << r.threads
+           << ", \"n\": " << r.n << ", \"alpha\": " << r.alpha << ", \"beta\": " << r.beta
+           << ", \"value\": " << r.value << ", \"unit\": \"" << r.unit << "\"}"
+           << (k + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "]\n";
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions opt;
+    KernelIsa isa = detect_kernel_isa();
+
+    try {
+        for (int arg = 1; arg < argc; ++arg) {
+            const std::string name = argv[arg];
+            auto value = [&]() -> std::string {
+                if (arg + 1 >= argc) {
+                    throw std::invalid_argument("Missing value for " + name);
+                }
+                return argv[++arg];
+            };
+            if (name == "--suite") {
+                opt.suite = value();
+                if (opt.suite != "all" && opt.suite != "kernels" && opt.suite != "queues" && opt.suite != "deps") {
+                    throw std::invalid_argument("Unknown suite: " + opt.suite);
+                }
+            } else if (name == "--threads") {
+                opt.max_threads = std::max(1, std::atoi(value().c_str()));
+            } else if (name == "--quick") {
+                opt.quick = true;
+            } else if (name == "--format") {
+                opt.format = value();
+                if (opt.format != "csv" && opt.format != "json") {
+                    throw std::invalid_argument("Unknown format: " + opt.format);
+                }
+            } else if (name == "--isa") {
+                isa = parse_kernel_isa(value());
+            } else {
+                throw std::invalid_argument("Unexpected argument: " + name);
+            }
+        }
+        if (!select_kernel_isa(isa)) {
+            throw std::invalid_argument(std::string("ISA not supported on this CPU: ") + kernel_isa_name(isa));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n"
+                  << "Usage: " << argv[0] << " [--suite all|kernels|queues|deps] [--threads N] [--quick]"
+                  << " [--format csv|json] [--isa auto|scalar|avx2|avx512]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cerr << "Kernels: " << kernel_isa_name(active_kernels().isa) << ", up to " << opt.max_threads
+              << " threads" << (opt.quick ? " (quick)" : "") << std::endl;
+
+    std::vector<BenchResult> results;
+    if (opt.suite == "all" || opt.suite == "kernels") {
+        bench_kernels(opt, results);
+    }
+    if (opt.suite == "all" || opt.suite == "queues") {
+        bench_queues(opt, results);
+    }
+    if (opt.suite == "all" || opt.suite == "deps") {
+        bench_dependency_tables(opt, results);
+    }
+
+    if (opt.format == "json") {
+        write_json(std::cout, results);
+    } else {
+        write_csv(std::cout, results);
+    }
+    return 0;
+}
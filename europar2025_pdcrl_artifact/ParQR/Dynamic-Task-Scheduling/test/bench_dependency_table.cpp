@@ -0,0 +1,134 @@
+// Microbenchmark for DependencyTableAtomic layouts and memory ordering.
+//
+// Replays the access pattern of the dynamic scheduler on a task grid without
+// doing any Householder work: cell (i, j) is completed by thread (i + j) % T,
+// so consecutive tasks of a row-block chain, whose entries are adjacent in
+// memory, are completed by different threads, just as in a dynamic schedule.
+// Completing a cell stores its entry and loads its two predecessors (the left
+// neighbour and the panel's type-1 entry). Threads sweep the grid in lock-step
+// column order, toggling the stored value every sweep.
+//
+// Usage: dep_bench.out [rows cols sweeps] [thread counts...]
+//        dep_bench.out 64 256 200 1 2 4 8 16 28 52
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include "bn2.h"
+
+// The table as it was before layouts were introduced: packed, seq_cst.
+class LegacyTable {
+    size_t n;
+    std::vector<std::atomic<bool>> data;
+
+public:
+    LegacyTable(size_t rows, size_t cols) : n(cols), data(rows * cols) {}
+    bool getDependency(size_t i, size_t j) const { return data[i * n + j].load(std::memory_order_seq_cst); }
+    void setDependency(size_t i, size_t j, bool v) { data[i * n + j].store(v, std::memory_order_seq_cst); }
+};
+
+// Reusable spin barrier for lock-stepping the sweeps.
+class SpinBarrier {
+    const int count;
+    std::atomic<int> waiting{0};
+    std::atomic<int> generation{0};
+
+public:
+    explicit SpinBarrier(int count) : count(count) {}
+    void wait() {
+        int gen = generation.load(std::memory_order_acquire);
+        if (waiting.fetch_add(1, std::memory_order_acq_rel) == count - 1) {
+            waiting.store(0, std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+        } else {
+            while (generation.load(std::memory_order_acquire) == gen) {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+// Returns nanoseconds per completed cell.
+template <class Table>
+double run(Table& table, int rows, int cols, int sweeps, int num_threads) {
+    const int bda = 4;
+    std::atomic<long> sink{0};
+    SpinBarrier barrier(num_threads);
+
+    auto worker = [&](int tid) {
+        long reads = 0;
+        for (int s = 0; s < sweeps; ++s) {
+            bool value = (s & 1) == 0;
+            for (int j = 0; j < cols; ++j) {
+                for (int i = (tid - j % num_threads + num_threads) % num_threads; i < rows; i += num_threads) {
+                    if (j > 0) {
+                        reads += table.getDependency(i, j - 1);
+                    }
+                    reads += table.getDependency((j / bda) % rows, j);
+                    table.setDependency(i, j, value);
+                }
+            }
+            barrier.wait();
+        }
+        sink.fetch_add(reads, std::memory_order_relaxed);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (static_cast<double>(rows) * cols * sweeps);
+}
+
+int main(int argc, char* argv[]) {
+    int rows = 64, cols = 256, sweeps = 200;
+    std::vector<int> thread_counts;
+
+    int arg = 1;
+    if (argc >= 4) {
+        rows = std::atoi(argv[1]);
+        cols = std::atoi(argv[2]);
+        sweeps = std::atoi(argv[3]);
+        arg = 4;
+    }
+    for (; arg < argc; ++arg) {
+        thread_counts.push_back(std::atoi(argv[arg]));
+    }
+    if (thread_counts.empty()) {
+        int hw = std::max(1u, std::thread::hardware_concurrency());
+        for (int t = 1; t < hw; t *= 2) {
+            thread_counts.push_back(t);
+        }
+        thread_counts.push_back(hw);
+    }
+
+    std::cout << "Grid " << rows << " x " << cols << ", " << sweeps << " sweeps; ns per completed cell\n";
+    std::cout << std::left << std::setw(10) << "threads" << std::setw(16) << "legacy-seqcst"
+              << std::setw(16) << "packed" << std::setw(16) << "row_aligned" << std::setw(16) << "padded" << "\n";
+
+    for (int t : thread_counts) {
+        LegacyTable legacy(rows, cols);
+        DependencyTableAtomic packed(rows, cols, DependencyLayout::packed);
+        DependencyTableAtomic aligned(rows, cols, DependencyLayout::row_aligned);
+        DependencyTableAtomic padded(rows, cols, DependencyLayout::padded);
+
+        std::cout << std::left << std::setw(10) << t << std::fixed << std::setprecision(2)
+                  << std::setw(16) << run(legacy, rows, cols, sweeps, t)
+                  << std::setw(16) << run(packed, rows, cols, sweeps, t)
+                  << std::setw(16) << run(aligned, rows, cols, sweeps, t)
+                  << std::setw(16) << run(padded, rows, cols, sweeps, t) << std::endl;
+    }
+    return 0;
+}
@@ -1,1292 +1,4489 @@
-#include <iostream>
-#include <string>
-#include <iomanip>
-#include <fstream>
-#include <sstream>    // Added for std::stringstream
-#include <cstdlib>    // Added for std::remove
-#include "bn2.h"     
-
-#include <thread>
-
-// Define color codes
-#define RED "\033[31m"
-#define GREEN "\033[32m"
-#define YELLOW "\033[33m"
-#define RESET "\033[0m"
-
-// Global counter for total failures
-int total_failures = 0;
-
-// Redefine the CHECK macro to accept a stream parameter
-#define CHECK(condition, message, stream) \
-    if (!(condition)) { \
-        (stream) << RED << "Failure: " << message << RESET << std::endl; \
-        ++total_failures; \
-    }
-
-
-// ========================= Matrix_t Tests =========================
-
-// Test Function 1: Operator Access
-void test_operator_access() {
-    // Initialize a local stringstream to collect error messages
-    std::stringstream errors;
-
-    // Initialize a 3x3 matrix and set values
-    matrix_t<int> mat(3, 3);
-    mat(0, 0) = 1;
-    mat(0, 1) = 2;
-    mat(0, 2) = 3;
-    mat(1, 0) = 4;
-    mat(1, 1) = 5;
-    mat(1, 2) = 6;
-    mat(2, 0) = 7;
-    mat(2, 1) = 8;
-    mat(2, 2) = 9;
-
-    // Perform checks using the CHECK macro, passing the errors stream
-    CHECK(mat(0, 0) == 1, "mat(0, 0) should be 1", errors);
-    CHECK(mat(1, 1) == 5, "mat(1, 1) should be 5", errors);
-    CHECK(mat(2, 2) == 9, "mat(2, 2) should be 9", errors);
-
-    const matrix_t<int>& constMat = mat;
-    CHECK(constMat(0, 0) == 1, "constMat(0, 0) should be 1", errors);
-    CHECK(constMat(1, 1) == 5, "constMat(1, 1) should be 5", errors);
-    CHECK(constMat(2, 2) == 9, "constMat(2, 2) should be 9", errors);
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[MT1]. Test Operator Access."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[MT1]. Test Operator Access."
-                  << RED << "[Failed]" << RESET << std::endl;
-        // Print the collected error messages
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test Function 2: Getter/Setter Methods
-void test_get_set() {
-    // Initialize a local stringstream to collect error messages
-    std::stringstream errors;
-
-    // Initialize a 3x3 matrix and set values using set()
-    matrix_t<int> mat(3, 3);
-    mat.set(0, 0, 1);
-    mat.set(0, 1, 2);
-    mat.set(0, 2, 3);
-    mat.set(1, 0, 4);
-    mat.set(1, 1, 5);
-    mat.set(1, 2, 6);
-    mat.set(2, 0, 7);
-    mat.set(2, 1, 8);
-    mat.set(2, 2, 9);
-
-    // Perform checks using the CHECK macro, passing the errors stream
-    CHECK(mat.get(0, 0) == 1, "mat.get(0, 0) should be 1", errors);
-    CHECK(mat.get(1, 1) == 5, "mat.get(1, 1) should be 5", errors);
-    CHECK(mat.get(2, 2) == 9, "mat.get(2, 2) should be 9", errors);
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[MT2]. Test Getter/Setter Methods."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[MT2]. Test Getter/Setter Methods."
-                  << RED << "[Failed]" << RESET << std::endl;
-        // Print the collected error messages
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test Function 3: Matrix Save Method
-void test_save() {
-    // Initialize a local stringstream to collect error messages
-    std::stringstream errors;
-
-    // Create a 3x3 matrix and set values
-    matrix_t<int> mat(3, 3);
-    mat.set(0, 0, 1);
-    mat.set(0, 1, 2);
-    mat.set(0, 2, 3);
-    mat.set(1, 0, 4);
-    mat.set(1, 1, 5);
-    mat.set(1, 2, 6);
-    mat.set(2, 0, 7);
-    mat.set(2, 1, 8);
-    mat.set(2, 2, 9);
-
-    // Save the matrix to a file
-    std::string filename = "test_matrix.txt";
-    mat.save(filename);
-
-    // Read the file and verify its contents
-    std::ifstream infile(filename);
-    if (!infile.is_open()) {
-        errors << RED << "Failure: Unable to open file " << filename << RESET << std::endl;
-        ++total_failures;
-    } else {
-        int value;
-        // Perform checks using the CHECK macro, passing the errors stream
-        CHECK(infile >> value && value == 1, "First value should be 1", errors);
-        CHECK(infile >> value && value == 2, "Second value should be 2", errors);
-        CHECK(infile >> value && value == 3, "Third value should be 3", errors);
-        CHECK(infile >> value && value == 4, "Fourth value should be 4", errors);
-        CHECK(infile >> value && value == 5, "Fifth value should be 5", errors);
-        CHECK(infile >> value && value == 6, "Sixth value should be 6", errors);
-        CHECK(infile >> value && value == 7, "Seventh value should be 7", errors);
-        CHECK(infile >> value && value == 8, "Eighth value should be 8", errors);
-        CHECK(infile >> value && value == 9, "Ninth value should be 9", errors);
-
-        infile.close();
-
-        // Clean up the test file
-        if (std::remove(filename.c_str()) != 0) {
-            errors << RED << "Failure: Unable to delete file " << filename << RESET << std::endl;
-            ++total_failures;
-        }
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[MT3]. Test Matrix Save Method."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[MT3]. Test Matrix Save Method."
-                  << RED << "[Failed]" << RESET << std::endl;
-        // Print the collected error messages
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// ========================= DependencyTable Tests =========================
-
-// Test Function 4: Default Constructor
-void test_default_constructor() {
-    std::stringstream errors;
-
-    DependencyTable dt;
-
-    // Check initial dimensions
-    CHECK(dt.rows() == 0, "Default constructor should initialize rows to 0", errors);
-    CHECK(dt.cols() == 0, "Default constructor should initialize columns to 0", errors);
-
-    // Check data pointer is nullptr (Not directly accessible, so we rely on rows and cols)
-    // Alternatively, if you add a method to check data pointer, you can test it here
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[DT1]. Test Default Constructor."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[DT1]. Test Default Constructor."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// Test Function 5: Parameterized Constructor
-void test_parameterized_constructor() {
-    std::stringstream errors;
-
-    size_t rows = 3;
-    size_t cols = 4;
-    DependencyTable dt(rows, cols);
-
-    // Check dimensions
-    CHECK(dt.rows() == rows, "Parameterized constructor should set correct number of rows", errors);
-    CHECK(dt.cols() == cols, "Parameterized constructor should set correct number of columns", errors);
-
-    // Check all dependencies are initialized to false (default)
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            CHECK(dt.getDependency(i, j) == false, "All dependencies should be initialized to false", errors);
-        }
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[DT2]. Test Parameterized Constructor."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[DT2]. Test Parameterized Constructor."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// Test Function 6: Init Method
-void test_init() {
-    std::stringstream errors;
-
-    DependencyTable dt;
-    size_t initial_rows = 2;
-    size_t initial_cols = 2;
-    dt.init(initial_rows, initial_cols);
-
-    // Check dimensions after init
-    CHECK(dt.rows() == initial_rows, "Init method should set correct number of rows", errors);
-    CHECK(dt.cols() == initial_cols, "Init method should set correct number of columns", errors);
-
-    // Check all dependencies are initialized to false
-    for (size_t i = 0; i < initial_rows; ++i) {
-        for (size_t j = 0; j < initial_cols; ++j) {
-            CHECK(dt.getDependency(i, j) == false, "All dependencies should be initialized to false after init", errors);
-        }
-    }
-
-    // Re-initialize with different dimensions
-    size_t new_rows = 4;
-    size_t new_cols = 5;
-    dt.init(new_rows, new_cols);
-
-    // Check new dimensions
-    CHECK(dt.rows() == new_rows, "Init method should correctly reinitialize number of rows", errors);
-    CHECK(dt.cols() == new_cols, "Init method should correctly reinitialize number of columns", errors);
-
-    // Check all dependencies are reset to false
-    for (size_t i = 0; i < new_rows; ++i) {
-        for (size_t j = 0; j < new_cols; ++j) {
-            CHECK(dt.getDependency(i, j) == false, "All dependencies should be reset to false after re-init", errors);
-        }
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[DT3]. Test Init Method."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[DT3]. Test Init Method."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// Test Function 7: Move Constructor
-void test_move_constructor() {
-    std::stringstream errors;
-
-    size_t rows = 3;
-    size_t cols = 3;
-    DependencyTable dt1(rows, cols);
-    dt1.setDependency(0, 0, true);
-    dt1.setDependency(1, 1, true);
-    dt1.setDependency(2, 2, true);
-
-    // Move construct dt2 from dt1
-    DependencyTable dt2(std::move(dt1));
-
-    // Check dt2 has the data
-    CHECK(dt2.rows() == rows, "Move constructor should transfer correct number of rows", errors);
-    CHECK(dt2.cols() == cols, "Move constructor should transfer correct number of columns", errors);
-    CHECK(dt2.getDependency(0, 0) == true, "Move constructor should transfer dependency at (0,0)", errors);
-    CHECK(dt2.getDependency(1, 1) == true, "Move constructor should transfer dependency at (1,1)", errors);
-    CHECK(dt2.getDependency(2, 2) == true, "Move constructor should transfer dependency at (2,2)", errors);
-
-    // Check dt1 is in a valid state (rows and cols should be 0)
-    CHECK(dt1.rows() == 0, "After move, source should have rows set to 0", errors);
-    CHECK(dt1.cols() == 0, "After move, source should have columns set to 0", errors);
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[DT4]. Test Move Constructor."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[DT4]. Test Move Constructor."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// Test Function 8: Move Assignment Operator
-void test_move_assignment() {
-    std::stringstream errors;
-
-    size_t rows1 = 2;
-    size_t cols1 = 2;
-    DependencyTable dt1(rows1, cols1);
-    dt1.setDependency(0, 0, true);
-    dt1.setDependency(1, 1, true);
-
-    size_t rows2 = 4;
-    size_t cols2 = 4;
-    DependencyTable dt2(rows2, cols2);
-    dt2.setDependency(0, 0, true);
-    dt2.setDependency(3, 3, true);
-
-    // Move assign dt1 to dt2
-    dt2 = std::move(dt1);
-
-    // Check dt2 has the data from dt1
-    CHECK(dt2.rows() == rows1, "Move assignment should transfer correct number of rows", errors);
-    CHECK(dt2.cols() == cols1, "Move assignment should transfer correct number of columns", errors);
-    CHECK(dt2.getDependency(0, 0) == true, "Move assignment should transfer dependency at (0,0)", errors);
-    CHECK(dt2.getDependency(1, 1) == true, "Move assignment should transfer dependency at (1,1)", errors);
-
-    // Check dt1 is in a valid state
-    CHECK(dt1.rows() == 0, "After move assignment, source should have rows set to 0", errors);
-    CHECK(dt1.cols() == 0, "After move assignment, source should have columns set to 0", errors);
-
-    // Ensure dt2 no longer has old data (size2 was 4x4, now 2x2)
-    // Attempting to access (3,3) should throw
-    try {
-        dt2.getDependency(3, 3);
-        errors << RED << "Failure: Accessing (3,3) should throw after move assignment." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected exception
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type when accessing out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[DT5]. Test Move Assignment Operator."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[DT5]. Test Move Assignment Operator."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// Test Function 9: Get and Set Dependency
-void test_get_set_dependency() {
-    std::stringstream errors;
-
-    size_t rows = 3;
-    size_t cols = 3;
-    DependencyTable dt(rows, cols);
-
-    // Set some dependencies
-    dt.setDependency(0, 0, true);
-    dt.setDependency(1, 1, true);
-    dt.setDependency(2, 2, true);
-    dt.setDependency(0, 2, true);
-
-    // Get and check dependencies
-    CHECK(dt.getDependency(0, 0) == true, "Dependency at (0,0) should be true", errors);
-    CHECK(dt.getDependency(1, 1) == true, "Dependency at (1,1) should be true", errors);
-    CHECK(dt.getDependency(2, 2) == true, "Dependency at (2,2) should be true", errors);
-    CHECK(dt.getDependency(0, 2) == true, "Dependency at (0,2) should be true", errors);
-    CHECK(dt.getDependency(0, 1) == false, "Dependency at (0,1) should be false", errors);
-    CHECK(dt.getDependency(1, 0) == false, "Dependency at (1,0) should be false", errors);
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[DT6]. Test Get and Set Dependency."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[DT6]. Test Get and Set Dependency."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// Test Function 10: Operator Overloading
-void test_operator_overloading() {
-    std::stringstream errors;
-
-    size_t rows = 2;
-    size_t cols = 2;
-    DependencyTable dt(rows, cols);
-
-    // Use operator() to set dependencies
-    try {
-        dt(0, 0, true);
-        dt(1, 1, true);
-        dt(0, 1, false);
-        dt(1, 0, true);
-    } catch (...) {
-        errors << RED << "Failure: Operator() threw an unexpected exception during setting." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Use operator() to get dependencies and verify
-    try {
-        CHECK(dt(0, 0) == true, "Operator() should return true for (0,0)", errors);
-        CHECK(dt(1, 1) == true, "Operator() should return true for (1,1)", errors);
-        CHECK(dt(0, 1) == false, "Operator() should return false for (0,1)", errors);
-        CHECK(dt(1, 0) == true, "Operator() should return true for (1,0)", errors);
-    } catch (...) {
-        errors << RED << "Failure: Operator() threw an unexpected exception during getting." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Attempt to access out-of-bounds using operator() and expect exceptions
-    try {
-        dt(2, 2); // Should throw
-        errors << RED << "Failure: Accessing (2,2) should throw an exception." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected exception
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type when accessing out-of-bounds with operator()." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[DT7]. Test Operator Overloading."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[DT7]. Test Operator Overloading."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// Test Function 11: Out of Bounds Access
-void test_out_of_bounds() {
-    std::stringstream errors;
-
-    size_t rows = 2;
-    size_t cols = 2;
-    DependencyTable dt(rows, cols);
-
-    /*
-    // Test getDependency out-of-bounds
-    try {
-        dt.getDependency(2, 0);
-        errors << RED << "Failure: getDependency(2,0) should throw an exception." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected exception
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type in getDependency out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Test setDependency out-of-bounds
-    try {
-        dt.setDependency(0, 2, true);
-        errors << RED << "Failure: setDependency(0,2) should throw an exception." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected exception
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type in setDependency out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-    */
-
-    // Test operator() get out-of-bounds
-    try {
-        dt(0, 3);
-        errors << RED << "Failure: operator()(0,3) should throw an exception." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected exception
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type in operator() get out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Test operator() set out-of-bounds
-    try {
-        dt(3, 0, true);
-        errors << RED << "Failure: operator()(3,0, true) should throw an exception." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected exception
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type in operator() set out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60) << "[DT8]. Test Out of Bounds Access."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60) << "[DT8]. Test Out of Bounds Access."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str()<< std::endl;
-    }
-}
-
-// =================== DependencyTableAtomic Tests ======================== //
-
-// Test 1: Default Constructor
-void test_default_constructor_atomic() {
-    std::stringstream errors;
-
-    DependencyTableAtomic dt;
-
-    // Check initial dimensions
-    CHECK(dt.rows() == 0, "Default constructor should initialize rows to 0", errors);
-    CHECK(dt.cols() == 0, "Default constructor should initialize cols to 0", errors);
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA1]. Test Default Constructor."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA1]. Test Default Constructor."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test 2: Parameterized Constructor
-void test_parameterized_constructor_atomic() {
-    std::stringstream errors;
-
-    size_t rows = 3;
-    size_t cols = 4;
-    DependencyTableAtomic dt(rows, cols);
-
-    // Check dimensions
-    CHECK(dt.rows() == rows, "Parameterized constructor should set correct number of rows", errors);
-    CHECK(dt.cols() == cols, "Parameterized constructor should set correct number of columns", errors);
-
-    // Check all dependencies are initialized to false by default
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            CHECK(dt.getDependency(i, j) == false,
-                  "All dependencies should be initialized to false", errors);
-        }
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA2]. Test Parameterized Constructor."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA2]. Test Parameterized Constructor."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test 3: Init Method
-void test_init_atomic() {
-    std::stringstream errors;
-
-    DependencyTableAtomic dt;
-    size_t initial_rows = 2;
-    size_t initial_cols = 2;
-    dt.init(initial_rows, initial_cols);
-
-    // Check dimensions after init
-    CHECK(dt.rows() == initial_rows, "Init method should set correct number of rows", errors);
-    CHECK(dt.cols() == initial_cols, "Init method should set correct number of columns", errors);
-
-    // Check all dependencies are initialized to false
-    for (size_t i = 0; i < initial_rows; ++i) {
-        for (size_t j = 0; j < initial_cols; ++j) {
-            CHECK(dt.getDependency(i, j) == false,
-                  "All dependencies should be initialized to false after init", errors);
-        }
-    }
-
-    // Re-initialize with different dimensions
-    size_t new_rows = 4;
-    size_t new_cols = 5;
-    dt.init(new_rows, new_cols);
-
-    // Check new dimensions
-    CHECK(dt.rows() == new_rows, "Init method should correctly reinitialize number of rows", errors);
-    CHECK(dt.cols() == new_cols, "Init method should correctly reinitialize number of columns", errors);
-
-    // Check all dependencies are reset to false
-    for (size_t i = 0; i < new_rows; ++i) {
-        for (size_t j = 0; j < new_cols; ++j) {
-            CHECK(dt.getDependency(i, j) == false,
-                  "All dependencies should be reset to false after re-init", errors);
-        }
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA3]. Test Init Method."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA3]. Test Init Method."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test 4: Move Constructor
-void test_move_constructor_atomic() {
-    std::stringstream errors;
-
-    size_t rows = 3;
-    size_t cols = 3;
-    DependencyTableAtomic dt1(rows, cols);
-    dt1.setDependency(0, 0, true);
-    dt1.setDependency(1, 1, true);
-    dt1.setDependency(2, 2, true);
-
-    // Move construct dt2 from dt1
-    DependencyTableAtomic dt2(std::move(dt1));
-
-    // Check dt2 has the data
-    CHECK(dt2.rows() == rows, "Move constructor should transfer correct number of rows", errors);
-    CHECK(dt2.cols() == cols, "Move constructor should transfer correct number of cols", errors);
-    CHECK(dt2.getDependency(0, 0) == true,  "Move constructor should transfer dependency at (0,0)", errors);
-    CHECK(dt2.getDependency(1, 1) == true,  "Move constructor should transfer dependency at (1,1)", errors);
-    CHECK(dt2.getDependency(2, 2) == true,  "Move constructor should transfer dependency at (2,2)", errors);
-
-    // Check dt1 is in a valid moved-from state
-    CHECK(dt1.rows() == 0, "After move, source should have rows set to 0", errors);
-    CHECK(dt1.cols() == 0, "After move, source should have cols set to 0", errors);
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA4]. Test Move Constructor."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA4]. Test Move Constructor."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test 5: Move Assignment Operator
-void test_move_assignment_atomic() {
-    std::stringstream errors;
-
-    size_t rows1 = 2;
-    size_t cols1 = 2;
-    DependencyTableAtomic dt1(rows1, cols1);
-    dt1.setDependency(0, 0, true);
-    dt1.setDependency(1, 1, true);
-
-    size_t rows2 = 4;
-    size_t cols2 = 4;
-    DependencyTableAtomic dt2(rows2, cols2);
-    dt2.setDependency(0, 0, true);
-    dt2.setDependency(3, 3, true);
-
-    // Move assign dt2 <- dt1
-    dt2 = std::move(dt1);
-
-    // Check dt2 has the data from dt1
-    CHECK(dt2.rows() == rows1, "Move assignment should transfer correct number of rows", errors);
-    CHECK(dt2.cols() == cols1, "Move assignment should transfer correct number of cols", errors);
-    CHECK(dt2.getDependency(0, 0) == true,  "Move assignment should transfer dependency at (0,0)", errors);
-    CHECK(dt2.getDependency(1, 1) == true,  "Move assignment should transfer dependency at (1,1)", errors);
-
-    // Check dt1 is in a valid moved-from state
-    CHECK(dt1.rows() == 0, "After move assignment, source should have rows set to 0", errors);
-    CHECK(dt1.cols() == 0, "After move assignment, source should have cols set to 0", errors);
-
-    // Ensure dt2 no longer has old data (it should be 2x2 now)
-    // Accessing (3,3) should throw
-    try {
-        dt2.getDependency(3, 3);
-        errors << RED << "Failure: Accessing (3,3) should throw after move assignment." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type when accessing out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA5]. Test Move Assignment Operator."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA5]. Test Move Assignment Operator."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test 6: Get and Set Dependency
-void test_get_set_dependency_atomic() {
-    std::stringstream errors;
-
-    size_t rows = 3;
-    size_t cols = 3;
-    DependencyTableAtomic dt(rows, cols);
-
-    // Set some dependencies
-    dt.setDependency(0, 0, true);
-    dt.setDependency(1, 1, true);
-    dt.setDependency(2, 2, true);
-    dt.setDependency(0, 2, true);
-
-    // Verify using getDependency
-    CHECK(dt.getDependency(0, 0) == true,  "Dependency at (0,0) should be true", errors);
-    CHECK(dt.getDependency(1, 1) == true,  "Dependency at (1,1) should be true", errors);
-    CHECK(dt.getDependency(2, 2) == true,  "Dependency at (2,2) should be true", errors);
-    CHECK(dt.getDependency(0, 2) == true,  "Dependency at (0,2) should be true", errors);
-    CHECK(dt.getDependency(0, 1) == false, "Dependency at (0,1) should be false", errors);
-    CHECK(dt.getDependency(1, 0) == false, "Dependency at (1,0) should be false", errors);
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA6]. Test Get and Set Dependency."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA6]. Test Get and Set Dependency."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test 7: Operator Overloading
-void test_operator_overloading_atomic() {
-    std::stringstream errors;
-
-    size_t rows = 2;
-    size_t cols = 2;
-    DependencyTableAtomic dt(rows, cols);
-
-    // Use operator() to set dependencies
-    try {
-        dt(0, 0, true);
-        dt(1, 1, true);
-        dt(0, 1, false);
-        dt(1, 0, true);
-    } catch (...) {
-        errors << RED << "Failure: Operator() threw an unexpected exception during set." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Use operator() to get dependencies
-    try {
-        CHECK(dt(0, 0) == true,  "Operator() should return true for (0,0)", errors);
-        CHECK(dt(1, 1) == true,  "Operator() should return true for (1,1)", errors);
-        CHECK(dt(0, 1) == false, "Operator() should return false for (0,1)", errors);
-        CHECK(dt(1, 0) == true,  "Operator() should return true for (1,0)", errors);
-    } catch (...) {
-        errors << RED << "Failure: Operator() threw an unexpected exception during get." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Attempt out-of-bounds access for get
-    try {
-        dt(2, 2); // Should throw
-        errors << RED << "Failure: Accessing (2,2) should throw an exception." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type when accessing out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA7]. Test Operator Overloading."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA7]. Test Operator Overloading."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// Test 8: Out of Bounds Access
-void test_out_of_bounds_atomic() {
-    std::stringstream errors;
-
-    size_t rows = 2;
-    size_t cols = 2;
-    DependencyTableAtomic dt(rows, cols);
-
-    // Operator() get out-of-bounds
-    try {
-        dt(0, 3); // Should throw
-        errors << RED << "Failure: operator()(0,3) should throw an exception." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type in operator() get out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Operator() set out-of-bounds
-    try {
-        dt(3, 0, true); // Should throw
-        errors << RED << "Failure: operator()(3,0,true) should throw an exception." << RESET << std::endl;
-        ++total_failures;
-    } catch (const std::out_of_range&) {
-        // Expected
-    } catch (...) {
-        errors << RED << "Failure: Unexpected exception type in operator() set out-of-bounds." << RESET << std::endl;
-        ++total_failures;
-    }
-
-    // Determine if the test passed or failed
-    if (errors.str().empty()) {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA8]. Test Out of Bounds Access."
-                  << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-        std::cout << std::left << std::setw(60)
-                  << "[DTA8]. Test Out of Bounds Access."
-                  << RED << "[Failed]" << RESET << std::endl;
-        std::cout << errors.str() << std::endl;
-    }
-}
-
-// ====================== CircularQueueMtx Tests =========================== //
-
-// Test Case 1: Test Empty Queue and Size
-void test_queue_empty_and_size() {
-    std::stringstream errors;
-    CircularQueueMtx<int> q(5);
-
-    CHECK(q.empty(), "Queue should be empty initially", errors);
-    CHECK(q.size() == 0, "Queue size should be 0 initially", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest1] Test Empty and Size"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest1] Test Empty and Size"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test Case 2: Test push_back and pop_front (FIFO behavior)
-void test_queue_push_pop_fifo() {
-    std::stringstream errors;
-    CircularQueueMtx<int> queue(5);
-    // Push several elements at the back.
-    CHECK(queue.push_back(1), "Push_back 1 should succeed", errors);
-    CHECK(queue.push_back(2), "Push_back 2 should succeed", errors);
-    CHECK(queue.push_back(3), "Push_back 3 should succeed", errors);
-    CHECK(queue.size() == 3, "Queue size should be 3 after three pushes", errors);
-    CHECK(!queue.empty(), "Queue should not be empty after pushes", errors);
-
-    // Pop the elements from the front (FIFO).
-    auto a = queue.pop_front();
-    CHECK(a.has_value() && a.value() == 1, "First pop_front should return 1", errors);
-    auto b = queue.pop_front();
-    CHECK(b.has_value() && b.value() == 2, "Second pop_front should return 2", errors);
-    auto c = queue.pop_front();
-    CHECK(c.has_value() && c.value() == 3, "Third pop_front should return 3", errors);
-    CHECK(queue.empty(), "Queue should be empty after popping all elements", errors);
-
-    // Additional pop from empty queue should return nullopt.
-    auto d = queue.pop_front();
-    CHECK(!d.has_value(), "pop_front on empty queue should return nullopt", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest2] Test Push_Back and Pop_Front FIFO"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest2] Test Push_Back and Pop_Front FIFO"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test Case 3: Test push_front and pop_back (Reverse order)
-void test_queue_push_front_pop_back() {
-    std::stringstream errors;
-    CircularQueueMtx<int> queue(5);
-    // Insert elements using push_front.
-    CHECK(queue.push_front(10), "Push_front 10 should succeed", errors);
-    CHECK(queue.push_front(20), "Push_front 20 should succeed", errors);
-    CHECK(queue.push_front(30), "Push_front 30 should succeed", errors);
-    // The elements (in order of insertion via push_front) end up as: 30, 20, 10.
-    // Popping from the back should return the element inserted first (i.e. 10, then 20, then 30).
-    auto a = queue.pop_back();
-    CHECK(a.has_value() && a.value() == 10, "First pop_back should return 10", errors);
-    auto b = queue.pop_back();
-    CHECK(b.has_value() && b.value() == 20, "Second pop_back should return 20", errors);
-    auto c = queue.pop_back();
-    CHECK(c.has_value() && c.value() == 30, "Third pop_back should return 30", errors);
-    CHECK(queue.empty(), "Queue should be empty after pop_back operations", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest3] Test Push_Front and Pop_Back"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest3] Test Push_Front and Pop_Back"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test Case 4: Test Full Queue Behavior
-void test_queue_full() {
-    std::stringstream errors;
-    CircularQueueMtx<int> queue(3);
-    CHECK(queue.push_back(1), "Push_back 1 should succeed", errors);
-    CHECK(queue.push_back(2), "Push_back 2 should succeed", errors);
-    CHECK(queue.push_back(3), "Push_back 3 should succeed", errors);
-    CHECK(queue.full(), "Queue should be full after three pushes", errors);
-
-    // Attempt additional pushes; they must fail.
-    CHECK(!queue.push_back(4), "Push_back 4 should fail on full queue", errors);
-    CHECK(!queue.push_front(5), "Push_front 5 should fail on full queue", errors);
-
-    // After a pop, the queue is no longer full.
-    auto a = queue.pop_front();
-    CHECK(a.has_value(), "pop_front should succeed on full queue", errors);
-    CHECK(!queue.full(), "Queue should not be full after a pop", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest4] Test Full Queue Behavior"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest4] Test Full Queue Behavior"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test Case 5: Multi-threaded Producer/Consumer Operations
-void test_queue_multi_threaded() {
-    std::stringstream errors;
-    const size_t capacity = 50;
-    const int num_elements = 1000;
-    CircularQueueMtx<int> queue(capacity);
-    std::atomic<bool> done{false};
-    std::atomic<int> produced{0};
-    std::atomic<int> consumed{0};
-
-    // Producer thread: push numbers into the queue.
-    auto producer = [&]() {
-         for (int i = 0; i < num_elements; ++i) {
-              while (!queue.push_back(i)) {
-                   std::this_thread::yield();
-              }
-              produced.fetch_add(1, std::memory_order_relaxed);
-         }
-         done = true;
-    };
-
-    // Consumer thread: pop numbers from the queue.
-    auto consumer = [&]() {
-         while (!done || !queue.empty()) {
-              auto value = queue.pop_front();
-              if (value.has_value()) {
-                   consumed.fetch_add(1, std::memory_order_relaxed);
-              } else {
-                   std::this_thread::yield();
-              }
-         }
-    };
-
-    std::thread prodThread(producer);
-    std::thread consThread(consumer);
-    prodThread.join();
-    consThread.join();
-
-    CHECK(produced.load(std::memory_order_relaxed) == num_elements,
-          "Produced count should equal num_elements", errors);
-    CHECK(consumed.load(std::memory_order_relaxed) == num_elements,
-          "Consumed count should equal num_elements", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest5] Test Multi-threaded Operations"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[QueueTest5] Test Multi-threaded Operations"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-
-// ==================== CircularQueueAtomic Tests ========================= //
-
-// Test 1: Verify that a new queue is empty and its size is zero.
-void test_atomic_queue_empty_and_size() {
-    std::stringstream errors;
-    CircularQueueAtomic<int> queue(5);
-    CHECK(queue.empty(), "Queue should be empty initially", errors);
-    CHECK(queue.size() == 0, "Queue size should be 0 initially", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest1] Test Empty and Size"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest1] Test Empty and Size"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test 2: Test push_back and pop_front (FIFO behavior).
-void test_atomic_queue_push_pop_fifo() {
-    std::stringstream errors;
-    CircularQueueAtomic<int> queue(5);
-
-    // Insert elements using push_back.
-    for (int i = 0; i < 3; ++i) {
-        bool ok = queue.push_back(i);
-        CHECK(ok, "push_back should succeed", errors);
-    }
-    CHECK(queue.size() == 3, "Queue size should be 3 after 3 pushes", errors);
-
-    // Remove the elements using pop_front and verify FIFO order.
-    for (int i = 0; i < 3; ++i) {
-        auto opt = queue.pop_front();
-        CHECK(opt.has_value(), "pop_front should return a value", errors);
-        CHECK(opt.value() == i, "pop_front value should match FIFO order", errors);
-    }
-    CHECK(queue.empty(), "Queue should be empty after popping all elements", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest2] Test Push_Back and Pop_Front FIFO"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest2] Test Push_Back and Pop_Front FIFO"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test 3: Test push_front and pop_back (reverse order behavior).
-void test_atomic_queue_push_front_pop_back() {
-    std::stringstream errors;
-    CircularQueueAtomic<int> queue(5);
-
-    // Insert elements using push_front.
-    for (int i = 0; i < 3; ++i) {
-        bool ok = queue.push_front(100 + i);
-        CHECK(ok, "push_front should succeed", errors);
-    }
-    // When using push_front, the first inserted element is at the back.
-    // Removing elements via pop_back should return them in the order of insertion.
-    for (int i = 0; i < 3; ++i) {
-        auto opt = queue.pop_back();
-        CHECK(opt.has_value(), "pop_back should return a value", errors);
-        CHECK(opt.value() == 100 + i, "pop_back value should match order", errors);
-    }
-    CHECK(queue.empty(), "Queue should be empty after pop_back operations", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest3] Test Push_Front and Pop_Back"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest3] Test Push_Front and Pop_Back"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test 4: Test full queue behavior.
-void test_atomic_queue_full() {
-    std::stringstream errors;
-    CircularQueueAtomic<int> queue(3);
-
-    // Fill the queue.
-    CHECK(queue.push_back(1), "push_back 1 should succeed", errors);
-    CHECK(queue.push_back(2), "push_back 2 should succeed", errors);
-    CHECK(queue.push_back(3), "push_back 3 should succeed", errors);
-    CHECK(queue.full(), "Queue should be full after three pushes", errors);
-
-    // Additional pushes should fail.
-    CHECK(!queue.push_back(4), "push_back 4 should fail on full queue", errors);
-    CHECK(!queue.push_front(5), "push_front 5 should fail on full queue", errors);
-
-    // After a pop, the queue should no longer be full.
-    auto opt = queue.pop_front();
-    CHECK(opt.has_value(), "pop_front should succeed", errors);
-    CHECK(!queue.full(), "Queue should not be full after popping an element", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest4] Test Full Queue Behavior"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest4] Test Full Queue Behavior"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test 5: Multi-threaded Producer/Consumer Operations.
-void test_atomic_queue_multi_threaded() {
-    std::stringstream errors;
-    const size_t capacity = 50;
-    const int numElements = 1000;
-    CircularQueueAtomic<int> queue(capacity);
-    std::atomic<bool> done{false};
-    std::atomic<int> produced{0};
-    std::atomic<int> consumed{0};
-
-    // Producer thread: pushes numbers into the queue.
-    auto producer = [&]() {
-         for (int i = 0; i < numElements; ++i) {
-              while (!queue.push_back(i)) {
-                   std::this_thread::yield();
-              }
-              produced.fetch_add(1, std::memory_order_relaxed);
-         }
-         done = true;
-    };
-
-    // Consumer thread: pops numbers from the queue.
-    auto consumer = [&]() {
-         while (!done || !queue.empty()) {
-              auto item = queue.pop_front();
-              if (item.has_value()) {
-                   consumed.fetch_add(1, std::memory_order_relaxed);
-              } else {
-                   std::this_thread::yield();
-              }
-         }
-    };
-
-    std::thread prodThread(producer);
-    std::thread consThread(consumer);
-    prodThread.join();
-    consThread.join();
-
-    CHECK(produced.load(std::memory_order_relaxed) == numElements, "Produced count should equal numElements", errors);
-    CHECK(consumed.load(std::memory_order_relaxed) == numElements, "Consumed count should equal numElements", errors);
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest5] Test Multi-threaded Operations"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest5] Test Multi-threaded Operations"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-// Test 6: Verify the convenience push/pop methods.
-void test_atomic_queue_push_and_pop() {
-    std::stringstream errors;
-    CircularQueueAtomic<int> queue(10);
-
-    // Use push (alias for push_back) to insert values.
-    for (int i = 0; i < 5; ++i) {
-         bool ok = queue.push(i);
-         CHECK(ok, "push should succeed", errors);
-    }
-    // Use pop (alias for pop_front) to remove values and verify FIFO order.
-    for (int i = 0; i < 5; ++i) {
-         auto result = queue.pop();
-         CHECK(result.has_value(), "pop should return a value", errors);
-         CHECK(result.value() == i, "pop should return FIFO order value", errors);
-    }
-
-    if (errors.str().empty()) {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest6] Test push/pop Convenience Methods"
-                   << GREEN << "[Passed]" << RESET << std::endl;
-    } else {
-         std::cout << std::left << std::setw(60)
-                   << "[AtomicQueueTest6] Test push/pop Convenience Methods"
-                   << RED << "[Failed]" << RESET << std::endl;
-         std::cout << errors.str();
-         total_failures++;
-    }
-}
-
-int main(int argc, char *argv[]) {
-    std::cout << "Inside Test.\n" << std::endl;
-
-    std::cout << YELLOW << "Starting matrix_t Test Cases." << RESET << std::endl;
-
-    // Run matrix_t test functions
-    test_operator_access();
-    test_get_set();
-    test_save();
-
-    std::cout << YELLOW << "\nStarting DependencyTable Test Cases." << RESET << std::endl;
-
-    // Run DependencyTable test functions
-    test_default_constructor();
-    test_parameterized_constructor();
-    test_init();
-    test_move_constructor();
-    test_move_assignment();
-    test_get_set_dependency();
-    test_operator_overloading();
-    test_out_of_bounds();
-
-    std::cout << YELLOW << "\nStarting DependencyTableAtomic Test Cases." << RESET << std::endl;
-
-    // Run DependencyTableAtomic test functions
-    test_default_constructor_atomic();
-    test_parameterized_constructor_atomic();
-    test_init_atomic();
-    test_move_constructor_atomic();
-    test_move_assignment_atomic();
-    test_get_set_dependency_atomic();
-    test_operator_overloading_atomic();
-    test_out_of_bounds_atomic();
-
-    std::cout << YELLOW << "\nStarting CircularQueueMtx Test Cases." << RESET << std::endl;
-
-    test_queue_empty_and_size();
-    test_queue_push_pop_fifo();
-    test_queue_push_front_pop_back();
-    test_queue_full();
-    test_queue_multi_threaded();
-
-    std::cout << YELLOW << "\nStarting CircularQueueAtomic Test Cases." << RESET << std::endl;
-
-    test_atomic_queue_empty_and_size();
-    test_atomic_queue_push_pop_fifo();
-    test_atomic_queue_push_front_pop_back();
-    test_atomic_queue_full();
-    test_atomic_queue_multi_threaded();
-    test_atomic_queue_push_and_pop();
-
-
-    std::cout << std::endl;
-
-    // Summary of test results
-    if (total_failures == 0) {
-        std::cout << GREEN << "All tests passed." << RESET << std::endl;
-    } else {
-        std::cout << RED << "Some tests failed. Total Failures: " << total_failures << RESET << std::endl;
-    }
-
-    return (total_failures == 0) ? 0 : 1;
+#include <iostream>
+#include <string>
+#include <iomanip>
+#include <fstream>
+#include <sstream>    // Added for std::stringstream
+#include <cstdlib>    // Added for std::remove
+#include "autotune.h"
+#include "bn2.h"     
+#include "bucket_queue.h"
+#include "device.h"
+#include "distributed.h"
+#include "idle.h"
+#include "kernels.h"
+#include "lstsq.h"
+#include "placement.h"
+#include "run_config.h"
+#include "trace.h"
+#include "tsqr.h"
+#include "metrics.h"
+#include "out_of_core.h"
+#include "qr_engine.h"
+#include "checkpoint.h"
+#include "bench_history.h"
+
+#include <thread>
+#include <deque>
+
+// Define color codes
+#define RED "\033[31m"
+#define GREEN "\033[32m"
+#define YELLOW "\033[33m"
+#define RESET "\033[0m"
+
+// Global counter for total failures
+int total_failures = 0;
+
+// Redefine the CHECK macro to accept a stream parameter
+#define CHECK(condition, message, stream) \
+    if (!(condition)) { \
+        (stream) << RED << "Failure: " << message << RESET << std::endl; \
+        ++total_failures; \
+    }
+
+
+// ========================= Matrix_t Tests =========================
+
+// Test Function 1: Operator Access
+void test_operator_access() {
+    // Initialize a local stringstream to collect error messages
+    std::stringstream errors;
+
+    // Initialize a 3x3 matrix and set values
+    matrix_t<int> mat(3, 3);
+    mat(0, 0) = 1;
+    mat(0, 1) = 2;
+    mat(0, 2) = 3;
+    mat(1, 0) = 4;
+    mat(1, 1) = 5;
+    mat(1, 2) = 6;
+    mat(2, 0) = 7;
+    mat(2, 1) = 8;
+    mat(2, 2) = 9;
+
+    // Perform checks using the CHECK macro, passing the errors stream
+    CHECK(mat(0, 0) == 1, "mat(0, 0) should be 1", errors);
+    CHECK(mat(1, 1) == 5, "mat(1, 1) should be 5", errors);
+    CHECK(mat(2, 2) == 9, "mat(2, 2) should be 9", errors);
+
+    const matrix_t<int>& constMat = mat;
+    CHECK(constMat(0, 0) == 1, "constMat(0, 0) should be 1", errors);
+    CHECK(constMat(1, 1) == 5, "constMat(1, 1) should be 5", errors);
+    CHECK(constMat(2, 2) == 9, "constMat(2, 2) should be 9", errors);
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT1]. Test Operator Access."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT1]. Test Operator Access."
+                  << RED << "[Failed]" << RESET << std::endl;
+        // Print the collected error messages
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test Function 2: Getter/Setter Methods
+void test_get_set() {
+    // Initialize a local stringstream to collect error messages
+    std::stringstream errors;
+
+    // Initialize a 3x3 matrix and set values using set()
+    matrix_t<int> mat(3, 3);
+    mat.set(0, 0, 1);
+    mat.set(0, 1, 2);
+    mat.set(0, 2, 3);
+    mat.set(1, 0, 4);
+    mat.set(1, 1, 5);
+    mat.set(1, 2, 6);
+    mat.set(2, 0, 7);
+    mat.set(2, 1, 8);
+    mat.set(2, 2, 9);
+
+    // Perform checks using the CHECK macro, passing the errors stream
+    CHECK(mat.get(0, 0) == 1, "mat.get(0, 0) should be 1", errors);
+    CHECK(mat.get(1, 1) == 5, "mat.get(1, 1) should be 5", errors);
+    CHECK(mat.get(2, 2) == 9, "mat.get(2, 2) should be 9", errors);
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT2]. Test Getter/Setter Methods."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT2]. Test Getter/Setter Methods."
+                  << RED << "[Failed]" << RESET << std::endl;
+        // Print the collected error messages
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test Function 3: Matrix Save Method
+void test_save() {
+    // Initialize a local stringstream to collect error messages
+    std::stringstream errors;
+
+    // Create a 3x3 matrix and set values
+    matrix_t<int> mat(3, 3);
+    mat.set(0, 0, 1);
+    mat.set(0, 1, 2);
+    mat.set(0, 2, 3);
+    mat.set(1, 0, 4);
+    mat.set(1, 1, 5);
+    mat.set(1, 2, 6);
+    mat.set(2, 0, 7);
+    mat.set(2, 1, 8);
+    mat.set(2, 2, 9);
+
+    // Save the matrix to a file
+    std::string filename = "test_matrix.txt";
+    mat.save(filename);
+
+    // Read the file and verify its contents
+    std::ifstream infile(filename);
+    if (!infile.is_open()) {
+        errors << RED << "Failure: Unable to open file " << filename << RESET << std::endl;
+        ++total_failures;
+    } else {
+        int value;
+        // Perform checks using the CHECK macro, passing the errors stream
+        CHECK(infile >> value && value == 1, "First value should be 1", errors);
+        CHECK(infile >> value && value == 2, "Second value should be 2", errors);
+        CHECK(infile >> value && value == 3, "Third value should be 3", errors);
+        CHECK(infile >> value && value == 4, "Fourth value should be 4", errors);
+        CHECK(infile >> value && value == 5, "Fifth value should be 5", errors);
+        CHECK(infile >> value && value == 6, "Sixth value should be 6", errors);
+        CHECK(infile >> value && value == 7, "Seventh value should be 7", errors);
+        CHECK(infile >> value && value == 8, "Eighth value should be 8", errors);
+        CHECK(infile >> value && value == 9, "Ninth value should be 9", errors);
+
+        infile.close();
+
+        // Clean up the test file
+        if (std::remove(filename.c_str()) != 0) {
+            errors << RED << "Failure: Unable to delete file " << filename << RESET << std::endl;
+            ++total_failures;
+        }
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT3]. Test Matrix Save Method."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT3]. Test Matrix Save Method."
+                  << RED << "[Failed]" << RESET << std::endl;
+        // Print the collected error messages
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 3b: Binary Save / Read (mmap and bulk read)
+void test_binary_roundtrip() {
+    std::stringstream errors;
+
+    matrix_t<double> mat(3, 4);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            mat.set(i, j, 0.1 * (i * 4 + j) - 1.0 / 3.0);
+        }
+    }
+
+    std::string filename = "test_matrix.bin";
+    mat.save_binary(filename);
+
+    CHECK(is_binary_matrix_file(filename), "Saved file should carry the binary magic", errors);
+
+    for (int use_mmap = 0; use_mmap < 2; ++use_mmap) {
+        matrix_t<double> loaded;
+        loaded.read_binary(filename, use_mmap == 1);
+        CHECK(loaded.rows() == 3 && loaded.cols() == 4, "Binary read should restore the dimensions", errors);
+        CHECK(loaded.is_mapped() == (use_mmap == 1), "Storage should match the requested read mode", errors);
+        bool same = true;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                same = same && loaded(i, j) == mat(i, j);
+            }
+        }
+        CHECK(same, "Binary read should restore every value exactly", errors);
+
+        // Mapped storage is private: writes must not reach the file.
+        loaded(0, 0) = 42.0;
+    }
+
+    // read_matrix() auto-detects the binary format; moving keeps the mapping alive.
+    matrix_t<double> detected(filename);
+    matrix_t<double> moved(std::move(detected));
+    CHECK(moved.is_mapped(), "Constructor should mmap a binary file", errors);
+    CHECK(moved(0, 0) == mat(0, 0), "Mapped file should be unchanged by private writes", errors);
+    CHECK(moved(2, 3) == mat(2, 3), "Moved matrix should keep its data", errors);
+
+    // Element type mismatch is reported.
+    try {
+        matrix_t<float> wrong(filename);
+        errors << RED << "Failure: Reading doubles as float should throw." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::runtime_error&) {
+        // Expected exception
+    }
+
+    if (std::remove(filename.c_str()) != 0) {
+        errors << RED << "Failure: Unable to delete file " << filename << RESET << std::endl;
+        ++total_failures;
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT4]. Test Binary Save/Read."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT4]. Test Binary Save/Read."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test Function 3c: Text Read (header detection, column checks, chunked parse)
+void test_text_read() {
+    std::stringstream errors;
+    std::string filename = "test_matrix_text.txt";
+
+    auto write_file = [&](const std::string& contents) {
+        std::ofstream out(filename);
+        out << contents;
+    };
+
+    // Header line "m n"; values may be laid out freely.
+    write_file("2 3\n1 2.5 -3\n+4 5e-1\n6\n");
+    {
+        matrix_t<double> mat(filename);
+        CHECK(mat.rows() == 2 && mat.cols() == 3, "Header should set the dimensions", errors);
+        CHECK(mat(0, 1) == 2.5 && mat(1, 0) == 4.0 && mat(1, 1) == 0.5 && mat(1, 2) == 6.0,
+              "Header file values should be parsed in order", errors);
+    }
+
+    // No header: the first line fixes the column count; blank lines are skipped.
+    write_file("1.5 2 3\r\n\n4 5 6\r\n7 8 9");
+    {
+        matrix_t<double> mat(filename);
+        CHECK(mat.rows() == 3 && mat.cols() == 3, "Headerless file should infer the dimensions", errors);
+        CHECK(mat(0, 0) == 1.5 && mat(2, 2) == 9.0, "Headerless file values should be parsed in order", errors);
+    }
+
+    // Inconsistent rows, short data, extra data and bad tokens are rejected.
+    const char* bad_files[] = {"1 2 3\n4 5\n", "2 2\n1 2 3\n", "1 1\n1 2\n", "1 2 3\n4 x 6\n"};
+    for (const char* contents : bad_files) {
+        write_file(contents);
+        try {
+            matrix_t<double> mat(filename);
+            errors << RED << "Failure: Malformed file should throw: " << contents << RESET << std::endl;
+            ++total_failures;
+        } catch (const std::runtime_error&) {
+            // Expected exception
+        }
+    }
+
+    // A file large enough to be split into several chunks parses identically
+    // with one and with several threads.
+    {
+        const int rows = 600, cols = 400;
+        std::vector<double> values(rows * cols);
+        std::ofstream out(filename);
+        out.precision(17);
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                values[i * cols + j] = std::sin(i * cols + j) * 1.0e3;
+                out << values[i * cols + j] << (j + 1 < cols ? " " : "\n");
+            }
+        }
+        out.close();
+
+        matrix_t<double> serial, parallel;
+        serial.read_matrix(filename, 1);
+        parallel.read_matrix(filename, 4);
+        bool same = serial.rows() == rows && serial.cols() == cols &&
+                    parallel.rows() == rows && parallel.cols() == cols;
+        for (int i = 0; same && i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                same = same && serial(i, j) == values[i * cols + j] && parallel(i, j) == values[i * cols + j];
+            }
+        }
+        CHECK(same, "Chunked parse should round-trip every value exactly", errors);
+    }
+
+    if (std::remove(filename.c_str()) != 0) {
+        errors << RED << "Failure: Unable to delete file " << filename << RESET << std::endl;
+        ++total_failures;
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT5]. Test Text Read."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT5]. Test Text Read."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test Function 3d: Tiled Layout (conversion, access, copies, row-major output)
+void test_tiled_layout() {
+    std::stringstream errors;
+
+    const int rows = 13, cols = 11;
+    matrix_t<double> mat(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            mat.set(i, j, i * 100.0 + j + 0.5);
+        }
+    }
+
+    matrix_t<double> tiled = mat;
+    tiled.to_tiled(4, 3);
+    CHECK(tiled.layout() == MatrixLayout::tiled, "to_tiled should switch the layout", errors);
+    CHECK(tiled.tile_rows() == 4 && tiled.tile_cols() == 3 && tiled.tiles_per_row() == 4,
+          "Tile geometry should match the request", errors);
+    CHECK(tiled.tile_stride() == 16, "Tile stride should round 12 elements up to a cache line", errors);
+    CHECK(reinterpret_cast<uintptr_t>(tiled.data_ptr()) % MATRIX_TILE_ALIGNMENT == 0,
+          "Tiled storage should be cache-line aligned", errors);
+    CHECK(tiled.data_ptr()[tiled.index(5, 7)] == mat(5, 7), "index() should address the tiled storage", errors);
+
+    bool same = true;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            same = same && tiled(i, j) == mat(i, j);
+        }
+    }
+    CHECK(same, "Tiled element access should see the row-major values", errors);
+
+    // Edge tile, written through the tiled storage.
+    tiled.set(12, 10, -1.0);
+    mat.set(12, 10, -1.0);
+
+    matrix_t<double> copy(tiled);
+    CHECK(copy.layout() == MatrixLayout::tiled && copy(12, 10) == -1.0 && copy(3, 4) == mat(3, 4),
+          "Copies should keep the tiled layout and values", errors);
+
+    // Results are written row-major whatever the layout.
+    std::string filename = "test_tiled.bin";
+    tiled.save_binary(filename);
+    matrix_t<double> loaded(filename);
+    same = loaded.rows() == rows && loaded.cols() == cols;
+    for (int i = 0; same && i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            same = same && loaded(i, j) == mat(i, j);
+        }
+    }
+    CHECK(same, "save_binary of a tiled matrix should write row-major data", errors);
+    std::remove(filename.c_str());
+
+    copy.to_row_major();
+    CHECK(copy.layout() == MatrixLayout::row_major, "to_row_major should switch the layout", errors);
+    same = true;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            same = same && copy.data_ptr()[i * cols + j] == mat(i, j);
+        }
+    }
+    CHECK(same, "Round trip through the tiled layout should be exact", errors);
+
+    try {
+        copy.to_tiled(0, 3);
+        errors << RED << "Failure: Zero-sized tiles should throw." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::invalid_argument&) {
+        // Expected exception
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT6]. Test Tiled Layout."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT6]. Test Tiled Layout."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test Function 3e: First Touch (parallel re-homing keeps layout and values)
+void test_first_touch() {
+    std::stringstream errors;
+
+    const int rows = 21, cols = 9;
+    matrix_t<double> mat(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            mat.set(i, j, i - 0.25 * j);
+        }
+    }
+
+    for (int tiled = 0; tiled < 2; ++tiled) {
+        matrix_t<double> placed = mat;
+        if (tiled) {
+            placed.to_tiled(4, 5);
+        }
+        const double* before = placed.data_ptr();
+        std::atomic<int> started{0};
+        placed.first_touch(8, 3, [&](int) { started.fetch_add(1); });
+
+        CHECK(started.load() == 3, "Every first-touch thread should run on_start", errors);
+        CHECK(placed.data_ptr() != before, "first_touch should move the storage", errors);
+        CHECK(placed.layout() == (tiled ? MatrixLayout::tiled : MatrixLayout::row_major),
+              "first_touch should keep the layout", errors);
+        bool same = true;
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                same = same && placed(i, j) == mat(i, j);
+            }
+        }
+        CHECK(same, "first_touch should keep every value", errors);
+    }
+
+    try {
+        matrix_t<double> tiled = mat;
+        tiled.to_tiled(4, 5);
+        tiled.first_touch(6, 2, [](int) {});
+        errors << RED << "Failure: Row blocks that split tiles should throw." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::invalid_argument&) {
+        // Expected exception
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT7]. Test First-Touch Placement."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT7]. Test First-Touch Placement."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test Function 3f: Multi-Matrix Binary Files (save_binary append, records)
+void test_binary_records() {
+    std::stringstream errors;
+
+    std::string filename = "test_batch.bin";
+    std::vector<matrix_t<double>> mats;
+    const int sizes[3] = {5, 1, 9};
+    for (int k = 0; k < 3; ++k) {
+        mats.emplace_back(sizes[k], sizes[k] + 1);
+        for (int i = 0; i < sizes[k]; ++i) {
+            for (int j = 0; j <= sizes[k]; ++j) {
+                mats[k].set(i, j, k + 0.01 * (i * 16 + j));
+            }
+        }
+        mats[k].save_binary(filename, MATRIX_FILE_ALIGNMENT, k > 0);
+    }
+
+    std::vector<uint64_t> records = binary_matrix_records(filename);
+    CHECK(records.size() == 3, "The file should hold three matrices", errors);
+    for (size_t k = 0; k < records.size() && k < 3; ++k) {
+        CHECK(records[k] % MATRIX_FILE_ALIGNMENT == 0, "Every matrix should start aligned", errors);
+        for (int use_mmap = 0; use_mmap < 2; ++use_mmap) {
+            matrix_t<double> loaded;
+            loaded.read_binary(filename, use_mmap == 1, records[k]);
+            bool same = loaded.rows() == sizes[k] && loaded.cols() == sizes[k] + 1;
+            for (int i = 0; same && i < sizes[k]; ++i) {
+                for (int j = 0; j <= sizes[k]; ++j) {
+                    same = same && loaded(i, j) == mats[k](i, j);
+                }
+            }
+            CHECK(same, "Matrix " + std::to_string(k) + " should read back exactly", errors);
+        }
+    }
+
+    // Without append, the file is replaced.
+    mats[1].save_binary(filename);
+    CHECK(binary_matrix_records(filename).size() == 1, "A plain save should truncate the file", errors);
+
+    if (std::remove(filename.c_str()) != 0) {
+        errors << RED << "Failure: Unable to delete file " << filename << RESET << std::endl;
+        ++total_failures;
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[MT8]. Test Multi-Matrix Binary Files."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[MT8]. Test Multi-Matrix Binary Files."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= DependencyTable Tests =========================
+
+// Test Function 4: Default Constructor
+void test_default_constructor() {
+    std::stringstream errors;
+
+    DependencyTable dt;
+
+    // Check initial dimensions
+    CHECK(dt.rows() == 0, "Default constructor should initialize rows to 0", errors);
+    CHECK(dt.cols() == 0, "Default constructor should initialize columns to 0", errors);
+
+    // Check data pointer is nullptr (Not directly accessible, so we rely on rows and cols)
+    // Alternatively, if you add a method to check data pointer, you can test it here
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DT1]. Test Default Constructor."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DT1]. Test Default Constructor."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 5: Parameterized Constructor
+void test_parameterized_constructor() {
+    std::stringstream errors;
+
+    size_t rows = 3;
+    size_t cols = 4;
+    DependencyTable dt(rows, cols);
+
+    // Check dimensions
+    CHECK(dt.rows() == rows, "Parameterized constructor should set correct number of rows", errors);
+    CHECK(dt.cols() == cols, "Parameterized constructor should set correct number of columns", errors);
+
+    // Check all dependencies are initialized to false (default)
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            CHECK(dt.getDependency(i, j) == false, "All dependencies should be initialized to false", errors);
+        }
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DT2]. Test Parameterized Constructor."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DT2]. Test Parameterized Constructor."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 6: Init Method
+void test_init() {
+    std::stringstream errors;
+
+    DependencyTable dt;
+    size_t initial_rows = 2;
+    size_t initial_cols = 2;
+    dt.init(initial_rows, initial_cols);
+
+    // Check dimensions after init
+    CHECK(dt.rows() == initial_rows, "Init method should set correct number of rows", errors);
+    CHECK(dt.cols() == initial_cols, "Init method should set correct number of columns", errors);
+
+    // Check all dependencies are initialized to false
+    for (size_t i = 0; i < initial_rows; ++i) {
+        for (size_t j = 0; j < initial_cols; ++j) {
+            CHECK(dt.getDependency(i, j) == false, "All dependencies should be initialized to false after init", errors);
+        }
+    }
+
+    // Re-initialize with different dimensions
+    size_t new_rows = 4;
+    size_t new_cols = 5;
+    dt.init(new_rows, new_cols);
+
+    // Check new dimensions
+    CHECK(dt.rows() == new_rows, "Init method should correctly reinitialize number of rows", errors);
+    CHECK(dt.cols() == new_cols, "Init method should correctly reinitialize number of columns", errors);
+
+    // Check all dependencies are reset to false
+    for (size_t i = 0; i < new_rows; ++i) {
+        for (size_t j = 0; j < new_cols; ++j) {
+            CHECK(dt.getDependency(i, j) == false, "All dependencies should be reset to false after re-init", errors);
+        }
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DT3]. Test Init Method."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DT3]. Test Init Method."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 7: Move Constructor
+void test_move_constructor() {
+    std::stringstream errors;
+
+    size_t rows = 3;
+    size_t cols = 3;
+    DependencyTable dt1(rows, cols);
+    dt1.setDependency(0, 0, true);
+    dt1.setDependency(1, 1, true);
+    dt1.setDependency(2, 2, true);
+
+    // Move construct dt2 from dt1
+    DependencyTable dt2(std::move(dt1));
+
+    // Check dt2 has the data
+    CHECK(dt2.rows() == rows, "Move constructor should transfer correct number of rows", errors);
+    CHECK(dt2.cols() == cols, "Move constructor should transfer correct number of columns", errors);
+    CHECK(dt2.getDependency(0, 0) == true, "Move constructor should transfer dependency at (0,0)", errors);
+    CHECK(dt2.getDependency(1, 1) == true, "Move constructor should transfer dependency at (1,1)", errors);
+    CHECK(dt2.getDependency(2, 2) == true, "Move constructor should transfer dependency at (2,2)", errors);
+
+    // Check dt1 is in a valid state (rows and cols should be 0)
+    CHECK(dt1.rows() == 0, "After move, source should have rows set to 0", errors);
+    CHECK(dt1.cols() == 0, "After move, source should have columns set to 0", errors);
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DT4]. Test Move Constructor."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DT4]. Test Move Constructor."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 8: Move Assignment Operator
+void test_move_assignment() {
+    std::stringstream errors;
+
+    size_t rows1 = 2;
+    size_t cols1 = 2;
+    DependencyTable dt1(rows1, cols1);
+    dt1.setDependency(0, 0, true);
+    dt1.setDependency(1, 1, true);
+
+    size_t rows2 = 4;
+    size_t cols2 = 4;
+    DependencyTable dt2(rows2, cols2);
+    dt2.setDependency(0, 0, true);
+    dt2.setDependency(3, 3, true);
+
+    // Move assign dt1 to dt2
+    dt2 = std::move(dt1);
+
+    // Check dt2 has the data from dt1
+    CHECK(dt2.rows() == rows1, "Move assignment should transfer correct number of rows", errors);
+    CHECK(dt2.cols() == cols1, "Move assignment should transfer correct number of columns", errors);
+    CHECK(dt2.getDependency(0, 0) == true, "Move assignment should transfer dependency at (0,0)", errors);
+    CHECK(dt2.getDependency(1, 1) == true, "Move assignment should transfer dependency at (1,1)", errors);
+
+    // Check dt1 is in a valid state
+    CHECK(dt1.rows() == 0, "After move assignment, source should have rows set to 0", errors);
+    CHECK(dt1.cols() == 0, "After move assignment, source should have columns set to 0", errors);
+
+    // Ensure dt2 no longer has old data (size2 was 4x4, now 2x2)
+    // Attempting to access (3,3) should throw
+    try {
+        dt2.getDependency(3, 3);
+        errors << RED << "Failure: Accessing (3,3) should throw after move assignment." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected exception
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type when accessing out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DT5]. Test Move Assignment Operator."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DT5]. Test Move Assignment Operator."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 9: Get and Set Dependency
+void test_get_set_dependency() {
+    std::stringstream errors;
+
+    size_t rows = 3;
+    size_t cols = 3;
+    DependencyTable dt(rows, cols);
+
+    // Set some dependencies
+    dt.setDependency(0, 0, true);
+    dt.setDependency(1, 1, true);
+    dt.setDependency(2, 2, true);
+    dt.setDependency(0, 2, true);
+
+    // Get and check dependencies
+    CHECK(dt.getDependency(0, 0) == true, "Dependency at (0,0) should be true", errors);
+    CHECK(dt.getDependency(1, 1) == true, "Dependency at (1,1) should be true", errors);
+    CHECK(dt.getDependency(2, 2) == true, "Dependency at (2,2) should be true", errors);
+    CHECK(dt.getDependency(0, 2) == true, "Dependency at (0,2) should be true", errors);
+    CHECK(dt.getDependency(0, 1) == false, "Dependency at (0,1) should be false", errors);
+    CHECK(dt.getDependency(1, 0) == false, "Dependency at (1,0) should be false", errors);
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DT6]. Test Get and Set Dependency."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DT6]. Test Get and Set Dependency."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 10: Operator Overloading
+void test_operator_overloading() {
+    std::stringstream errors;
+
+    size_t rows = 2;
+    size_t cols = 2;
+    DependencyTable dt(rows, cols);
+
+    // Use operator() to set dependencies
+    try {
+        dt(0, 0, true);
+        dt(1, 1, true);
+        dt(0, 1, false);
+        dt(1, 0, true);
+    } catch (...) {
+        errors << RED << "Failure: Operator() threw an unexpected exception during setting." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Use operator() to get dependencies and verify
+    try {
+        CHECK(dt(0, 0) == true, "Operator() should return true for (0,0)", errors);
+        CHECK(dt(1, 1) == true, "Operator() should return true for (1,1)", errors);
+        CHECK(dt(0, 1) == false, "Operator() should return false for (0,1)", errors);
+        CHECK(dt(1, 0) == true, "Operator() should return true for (1,0)", errors);
+    } catch (...) {
+        errors << RED << "Failure: Operator() threw an unexpected exception during getting." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Attempt to access out-of-bounds using operator() and expect exceptions
+    try {
+        dt(2, 2); // Should throw
+        errors << RED << "Failure: Accessing (2,2) should throw an exception." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected exception
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type when accessing out-of-bounds with operator()." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DT7]. Test Operator Overloading."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DT7]. Test Operator Overloading."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// Test Function 11: Out of Bounds Access
+void test_out_of_bounds() {
+    std::stringstream errors;
+
+    size_t rows = 2;
+    size_t cols = 2;
+    DependencyTable dt(rows, cols);
+
+    /*
+    // Test getDependency out-of-bounds
+    try {
+        dt.getDependency(2, 0);
+        errors << RED << "Failure: getDependency(2,0) should throw an exception." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected exception
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type in getDependency out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Test setDependency out-of-bounds
+    try {
+        dt.setDependency(0, 2, true);
+        errors << RED << "Failure: setDependency(0,2) should throw an exception." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected exception
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type in setDependency out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+    */
+
+    // Test operator() get out-of-bounds
+    try {
+        dt(0, 3);
+        errors << RED << "Failure: operator()(0,3) should throw an exception." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected exception
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type in operator() get out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Test operator() set out-of-bounds
+    try {
+        dt(3, 0, true);
+        errors << RED << "Failure: operator()(3,0, true) should throw an exception." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected exception
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type in operator() set out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DT8]. Test Out of Bounds Access."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DT8]. Test Out of Bounds Access."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str()<< std::endl;
+    }
+}
+
+// =================== DependencyTableAtomic Tests ======================== //
+
+// Test 1: Default Constructor
+void test_default_constructor_atomic() {
+    std::stringstream errors;
+
+    DependencyTableAtomic dt;
+
+    // Check initial dimensions
+    CHECK(dt.rows() == 0, "Default constructor should initialize rows to 0", errors);
+    CHECK(dt.cols() == 0, "Default constructor should initialize cols to 0", errors);
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA1]. Test Default Constructor."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA1]. Test Default Constructor."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 2: Parameterized Constructor
+void test_parameterized_constructor_atomic() {
+    std::stringstream errors;
+
+    size_t rows = 3;
+    size_t cols = 4;
+    DependencyTableAtomic dt(rows, cols);
+
+    // Check dimensions
+    CHECK(dt.rows() == rows, "Parameterized constructor should set correct number of rows", errors);
+    CHECK(dt.cols() == cols, "Parameterized constructor should set correct number of columns", errors);
+
+    // Check all dependencies are initialized to false by default
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            CHECK(dt.getDependency(i, j) == false,
+                  "All dependencies should be initialized to false", errors);
+        }
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA2]. Test Parameterized Constructor."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA2]. Test Parameterized Constructor."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 3: Init Method
+void test_init_atomic() {
+    std::stringstream errors;
+
+    DependencyTableAtomic dt;
+    size_t initial_rows = 2;
+    size_t initial_cols = 2;
+    dt.init(initial_rows, initial_cols);
+
+    // Check dimensions after init
+    CHECK(dt.rows() == initial_rows, "Init method should set correct number of rows", errors);
+    CHECK(dt.cols() == initial_cols, "Init method should set correct number of columns", errors);
+
+    // Check all dependencies are initialized to false
+    for (size_t i = 0; i < initial_rows; ++i) {
+        for (size_t j = 0; j < initial_cols; ++j) {
+            CHECK(dt.getDependency(i, j) == false,
+                  "All dependencies should be initialized to false after init", errors);
+        }
+    }
+
+    // Re-initialize with different dimensions
+    size_t new_rows = 4;
+    size_t new_cols = 5;
+    dt.init(new_rows, new_cols);
+
+    // Check new dimensions
+    CHECK(dt.rows() == new_rows, "Init method should correctly reinitialize number of rows", errors);
+    CHECK(dt.cols() == new_cols, "Init method should correctly reinitialize number of columns", errors);
+
+    // Check all dependencies are reset to false
+    for (size_t i = 0; i < new_rows; ++i) {
+        for (size_t j = 0; j < new_cols; ++j) {
+            CHECK(dt.getDependency(i, j) == false,
+                  "All dependencies should be reset to false after re-init", errors);
+        }
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA3]. Test Init Method."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA3]. Test Init Method."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 4: Move Constructor
+void test_move_constructor_atomic() {
+    std::stringstream errors;
+
+    size_t rows = 3;
+    size_t cols = 3;
+    DependencyTableAtomic dt1(rows, cols);
+    dt1.setDependency(0, 0, true);
+    dt1.setDependency(1, 1, true);
+    dt1.setDependency(2, 2, true);
+
+    // Move construct dt2 from dt1
+    DependencyTableAtomic dt2(std::move(dt1));
+
+    // Check dt2 has the data
+    CHECK(dt2.rows() == rows, "Move constructor should transfer correct number of rows", errors);
+    CHECK(dt2.cols() == cols, "Move constructor should transfer correct number of cols", errors);
+    CHECK(dt2.getDependency(0, 0) == true,  "Move constructor should transfer dependency at (0,0)", errors);
+    CHECK(dt2.getDependency(1, 1) == true,  "Move constructor should transfer dependency at (1,1)", errors);
+    CHECK(dt2.getDependency(2, 2) == true,  "Move constructor should transfer dependency at (2,2)", errors);
+
+    // Check dt1 is in a valid moved-from state
+    CHECK(dt1.rows() == 0, "After move, source should have rows set to 0", errors);
+    CHECK(dt1.cols() == 0, "After move, source should have cols set to 0", errors);
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA4]. Test Move Constructor."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA4]. Test Move Constructor."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 5: Move Assignment Operator
+void test_move_assignment_atomic() {
+    std::stringstream errors;
+
+    size_t rows1 = 2;
+    size_t cols1 = 2;
+    DependencyTableAtomic dt1(rows1, cols1);
+    dt1.setDependency(0, 0, true);
+    dt1.setDependency(1, 1, true);
+
+    size_t rows2 = 4;
+    size_t cols2 = 4;
+    DependencyTableAtomic dt2(rows2, cols2);
+    dt2.setDependency(0, 0, true);
+    dt2.setDependency(3, 3, true);
+
+    // Move assign dt2 <- dt1
+    dt2 = std::move(dt1);
+
+    // Check dt2 has the data from dt1
+    CHECK(dt2.rows() == rows1, "Move assignment should transfer correct number of rows", errors);
+    CHECK(dt2.cols() == cols1, "Move assignment should transfer correct number of cols", errors);
+    CHECK(dt2.getDependency(0, 0) == true,  "Move assignment should transfer dependency at (0,0)", errors);
+    CHECK(dt2.getDependency(1, 1) == true,  "Move assignment should transfer dependency at (1,1)", errors);
+
+    // Check dt1 is in a valid moved-from state
+    CHECK(dt1.rows() == 0, "After move assignment, source should have rows set to 0", errors);
+    CHECK(dt1.cols() == 0, "After move assignment, source should have cols set to 0", errors);
+
+    // Ensure dt2 no longer has old data (it should be 2x2 now)
+    // Accessing (3,3) should throw
+    try {
+        dt2.getDependency(3, 3);
+        errors << RED << "Failure: Accessing (3,3) should throw after move assignment." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type when accessing out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA5]. Test Move Assignment Operator."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA5]. Test Move Assignment Operator."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 6: Get and Set Dependency
+void test_get_set_dependency_atomic() {
+    std::stringstream errors;
+
+    size_t rows = 3;
+    size_t cols = 3;
+    DependencyTableAtomic dt(rows, cols);
+
+    // Set some dependencies
+    dt.setDependency(0, 0, true);
+    dt.setDependency(1, 1, true);
+    dt.setDependency(2, 2, true);
+    dt.setDependency(0, 2, true);
+
+    // Verify using getDependency
+    CHECK(dt.getDependency(0, 0) == true,  "Dependency at (0,0) should be true", errors);
+    CHECK(dt.getDependency(1, 1) == true,  "Dependency at (1,1) should be true", errors);
+    CHECK(dt.getDependency(2, 2) == true,  "Dependency at (2,2) should be true", errors);
+    CHECK(dt.getDependency(0, 2) == true,  "Dependency at (0,2) should be true", errors);
+    CHECK(dt.getDependency(0, 1) == false, "Dependency at (0,1) should be false", errors);
+    CHECK(dt.getDependency(1, 0) == false, "Dependency at (1,0) should be false", errors);
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA6]. Test Get and Set Dependency."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA6]. Test Get and Set Dependency."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 7: Operator Overloading
+void test_operator_overloading_atomic() {
+    std::stringstream errors;
+
+    size_t rows = 2;
+    size_t cols = 2;
+    DependencyTableAtomic dt(rows, cols);
+
+    // Use operator() to set dependencies
+    try {
+        dt(0, 0, true);
+        dt(1, 1, true);
+        dt(0, 1, false);
+        dt(1, 0, true);
+    } catch (...) {
+        errors << RED << "Failure: Operator() threw an unexpected exception during set." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Use operator() to get dependencies
+    try {
+        CHECK(dt(0, 0) == true,  "Operator() should return true for (0,0)", errors);
+        CHECK(dt(1, 1) == true,  "Operator() should return true for (1,1)", errors);
+        CHECK(dt(0, 1) == false, "Operator() should return false for (0,1)", errors);
+        CHECK(dt(1, 0) == true,  "Operator() should return true for (1,0)", errors);
+    } catch (...) {
+        errors << RED << "Failure: Operator() threw an unexpected exception during get." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Attempt out-of-bounds access for get
+    try {
+        dt(2, 2); // Should throw
+        errors << RED << "Failure: Accessing (2,2) should throw an exception." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type when accessing out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA7]. Test Operator Overloading."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA7]. Test Operator Overloading."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 8: Out of Bounds Access
+void test_out_of_bounds_atomic() {
+    std::stringstream errors;
+
+    size_t rows = 2;
+    size_t cols = 2;
+    DependencyTableAtomic dt(rows, cols);
+
+    // Operator() get out-of-bounds
+    try {
+        dt(0, 3); // Should throw
+        errors << RED << "Failure: operator()(0,3) should throw an exception." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type in operator() get out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Operator() set out-of-bounds
+    try {
+        dt(3, 0, true); // Should throw
+        errors << RED << "Failure: operator()(3,0,true) should throw an exception." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::out_of_range&) {
+        // Expected
+    } catch (...) {
+        errors << RED << "Failure: Unexpected exception type in operator() set out-of-bounds." << RESET << std::endl;
+        ++total_failures;
+    }
+
+    // Determine if the test passed or failed
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA8]. Test Out of Bounds Access."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60)
+                  << "[DTA8]. Test Out of Bounds Access."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test Function 9 (Atomic): Storage Layouts
+void test_layouts_atomic() {
+    std::stringstream errors;
+
+    const size_t rows = 5, cols = 70;
+    DependencyTableAtomic packed(rows, cols, DependencyLayout::packed);
+    DependencyTableAtomic aligned(rows, cols, DependencyLayout::row_aligned);
+    DependencyTableAtomic padded(rows, cols, DependencyLayout::padded);
+
+    CHECK(aligned.layout() == DependencyLayout::row_aligned, "Layout should be recorded", errors);
+    CHECK(packed.footprint() == 384, "Packed table should use ceil(rows*cols/64) lines", errors);
+    CHECK(aligned.footprint() == rows * 128, "Row-aligned rows should start on their own lines", errors);
+    CHECK(padded.footprint() == rows * cols * 64, "Padded table should use one line per entry", errors);
+
+    // All layouts behave as the same rows x cols table.
+    bool same = true;
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            bool value = (i * 7 + j * 3) % 5 == 0;
+            packed.setDependency(i, j, value);
+            aligned.setDependency(i, j, value);
+            padded.setDependency(i, j, value);
+        }
+    }
+    for (size_t i = 0; i < rows; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+            bool value = (i * 7 + j * 3) % 5 == 0;
+            same = same && packed(i, j) == value && aligned(i, j) == value && padded(i, j) == value;
+        }
+    }
+    CHECK(same, "Every layout should store each entry independently", errors);
+
+    // Moving keeps the layout.
+    DependencyTableAtomic moved(std::move(padded));
+    CHECK(moved.layout() == DependencyLayout::padded && moved(4, 69) == ((4 * 7 + 69 * 3) % 5 == 0),
+          "Moved table should keep its layout and contents", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DTA9]. Test Storage Layouts."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DTA9]. Test Storage Layouts."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ====================== CircularQueueMtx Tests =========================== //
+
+// Test Case 1: Test Empty Queue and Size
+void test_queue_empty_and_size() {
+    std::stringstream errors;
+    CircularQueueMtx<int> q(5);
+
+    CHECK(q.empty(), "Queue should be empty initially", errors);
+    CHECK(q.size() == 0, "Queue size should be 0 initially", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest1] Test Empty and Size"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest1] Test Empty and Size"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test Case 2: Test push_back and pop_front (FIFO behavior)
+void test_queue_push_pop_fifo() {
+    std::stringstream errors;
+    CircularQueueMtx<int> queue(5);
+    // Push several elements at the back.
+    CHECK(queue.push_back(1), "Push_back 1 should succeed", errors);
+    CHECK(queue.push_back(2), "Push_back 2 should succeed", errors);
+    CHECK(queue.push_back(3), "Push_back 3 should succeed", errors);
+    CHECK(queue.size() == 3, "Queue size should be 3 after three pushes", errors);
+    CHECK(!queue.empty(), "Queue should not be empty after pushes", errors);
+
+    // Pop the elements from the front (FIFO).
+    auto a = queue.pop_front();
+    CHECK(a.has_value() && a.value() == 1, "First pop_front should return 1", errors);
+    auto b = queue.pop_front();
+    CHECK(b.has_value() && b.value() == 2, "Second pop_front should return 2", errors);
+    auto c = queue.pop_front();
+    CHECK(c.has_value() && c.value() == 3, "Third pop_front should return 3", errors);
+    CHECK(queue.empty(), "Queue should be empty after popping all elements", errors);
+
+    // Additional pop from empty queue should return nullopt.
+    auto d = queue.pop_front();
+    CHECK(!d.has_value(), "pop_front on empty queue should return nullopt", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest2] Test Push_Back and Pop_Front FIFO"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest2] Test Push_Back and Pop_Front FIFO"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test Case 3: Test push_front and pop_back (Reverse order)
+void test_queue_push_front_pop_back() {
+    std::stringstream errors;
+    CircularQueueMtx<int> queue(5);
+    // Insert elements using push_front.
+    CHECK(queue.push_front(10), "Push_front 10 should succeed", errors);
+    CHECK(queue.push_front(20), "Push_front 20 should succeed", errors);
+    CHECK(queue.push_front(30), "Push_front 30 should succeed", errors);
+    // The elements (in order of insertion via push_front) end up as: 30, 20, 10.
+    // Popping from the back should return the element inserted first (i.e. 10, then 20, then 30).
+    auto a = queue.pop_back();
+    CHECK(a.has_value() && a.value() == 10, "First pop_back should return 10", errors);
+    auto b = queue.pop_back();
+    CHECK(b.has_value() && b.value() == 20, "Second pop_back should return 20", errors);
+    auto c = queue.pop_back();
+    CHECK(c.has_value() && c.value() == 30, "Third pop_back should return 30", errors);
+    CHECK(queue.empty(), "Queue should be empty after pop_back operations", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest3] Test Push_Front and Pop_Back"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest3] Test Push_Front and Pop_Back"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test Case 4: Test Full Queue Behavior
+void test_queue_full() {
+    std::stringstream errors;
+    CircularQueueMtx<int> queue(3);
+    CHECK(queue.push_back(1), "Push_back 1 should succeed", errors);
+    CHECK(queue.push_back(2), "Push_back 2 should succeed", errors);
+    CHECK(queue.push_back(3), "Push_back 3 should succeed", errors);
+    CHECK(queue.full(), "Queue should be full after three pushes", errors);
+
+    // Attempt additional pushes; they must fail.
+    CHECK(!queue.push_back(4), "Push_back 4 should fail on full queue", errors);
+    CHECK(!queue.push_front(5), "Push_front 5 should fail on full queue", errors);
+
+    // After a pop, the queue is no longer full.
+    auto a = queue.pop_front();
+    CHECK(a.has_value(), "pop_front should succeed on full queue", errors);
+    CHECK(!queue.full(), "Queue should not be full after a pop", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest4] Test Full Queue Behavior"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest4] Test Full Queue Behavior"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test Case 5: Multi-threaded Producer/Consumer Operations
+void test_queue_multi_threaded() {
+    std::stringstream errors;
+    const size_t capacity = 50;
+    const int num_elements = 1000;
+    CircularQueueMtx<int> queue(capacity);
+    std::atomic<bool> done{false};
+    std::atomic<int> produced{0};
+    std::atomic<int> consumed{0};
+
+    // Producer thread: push numbers into the queue.
+    auto producer = [&]() {
+         for (int i = 0; i < num_elements; ++i) {
+              while (!queue.push_back(i)) {
+                   std::this_thread::yield();
+              }
+              produced.fetch_add(1, std::memory_order_relaxed);
+         }
+         done = true;
+    };
+
+    // Consumer thread: pop numbers from the queue.
+    auto consumer = [&]() {
+         while (!done || !queue.empty()) {
+              auto value = queue.pop_front();
+              if (value.has_value()) {
+                   consumed.fetch_add(1, std::memory_order_relaxed);
+              } else {
+                   std::this_thread::yield();
+              }
+         }
+    };
+
+    std::thread prodThread(producer);
+    std::thread consThread(consumer);
+    prodThread.join();
+    consThread.join();
+
+    CHECK(produced.load(std::memory_order_relaxed) == num_elements,
+          "Produced count should equal num_elements", errors);
+    CHECK(consumed.load(std::memory_order_relaxed) == num_elements,
+          "Consumed count should equal num_elements", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest5] Test Multi-threaded Operations"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[QueueTest5] Test Multi-threaded Operations"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+
+// ==================== CircularQueueAtomic Tests ========================= //
+
+// Test 1: Verify that a new queue is empty and its size is zero.
+void test_atomic_queue_empty_and_size() {
+    std::stringstream errors;
+    CircularQueueAtomic<int> queue(5);
+    CHECK(queue.empty(), "Queue should be empty initially", errors);
+    CHECK(queue.size() == 0, "Queue size should be 0 initially", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest1] Test Empty and Size"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest1] Test Empty and Size"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test 2: Test push_back and pop_front (FIFO behavior).
+void test_atomic_queue_push_pop_fifo() {
+    std::stringstream errors;
+    CircularQueueAtomic<int> queue(5);
+
+    // Insert elements using push_back.
+    for (int i = 0; i < 3; ++i) {
+        bool ok = queue.push_back(i);
+        CHECK(ok, "push_back should succeed", errors);
+    }
+    CHECK(queue.size() == 3, "Queue size should be 3 after 3 pushes", errors);
+
+    // Remove the elements using pop_front and verify FIFO order.
+    for (int i = 0; i < 3; ++i) {
+        auto opt = queue.pop_front();
+        CHECK(opt.has_value(), "pop_front should return a value", errors);
+        CHECK(opt.value() == i, "pop_front value should match FIFO order", errors);
+    }
+    CHECK(queue.empty(), "Queue should be empty after popping all elements", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest2] Test Push_Back and Pop_Front FIFO"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest2] Test Push_Back and Pop_Front FIFO"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test 3: Test push_front and pop_back (reverse order behavior).
+void test_atomic_queue_push_front_pop_back() {
+    std::stringstream errors;
+    CircularQueueAtomic<int> queue(5);
+
+    // Insert elements using push_front.
+    for (int i = 0; i < 3; ++i) {
+        bool ok = queue.push_front(100 + i);
+        CHECK(ok, "push_front should succeed", errors);
+    }
+    // When using push_front, the first inserted element is at the back.
+    // Removing elements via pop_back should return them in the order of insertion.
+    for (int i = 0; i < 3; ++i) {
+        auto opt = queue.pop_back();
+        CHECK(opt.has_value(), "pop_back should return a value", errors);
+        CHECK(opt.value() == 100 + i, "pop_back value should match order", errors);
+    }
+    CHECK(queue.empty(), "Queue should be empty after pop_back operations", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest3] Test Push_Front and Pop_Back"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest3] Test Push_Front and Pop_Back"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test 4: Test full queue behavior.
+void test_atomic_queue_full() {
+    std::stringstream errors;
+    CircularQueueAtomic<int> queue(3);
+
+    // Fill the queue.
+    CHECK(queue.push_back(1), "push_back 1 should succeed", errors);
+    CHECK(queue.push_back(2), "push_back 2 should succeed", errors);
+    CHECK(queue.push_back(3), "push_back 3 should succeed", errors);
+    CHECK(queue.full(), "Queue should be full after three pushes", errors);
+
+    // Additional pushes should fail.
+    CHECK(!queue.push_back(4), "push_back 4 should fail on full queue", errors);
+    CHECK(!queue.push_front(5), "push_front 5 should fail on full queue", errors);
+
+    // After a pop, the queue should no longer be full.
+    auto opt = queue.pop_front();
+    CHECK(opt.has_value(), "pop_front should succeed", errors);
+    CHECK(!queue.full(), "Queue should not be full after popping an element", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest4] Test Full Queue Behavior"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest4] Test Full Queue Behavior"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test 5: Multi-threaded Producer/Consumer Operations.
+void test_atomic_queue_multi_threaded() {
+    std::stringstream errors;
+    const size_t capacity = 50;
+    const int numElements = 1000;
+    CircularQueueAtomic<int> queue(capacity);
+    std::atomic<bool> done{false};
+    std::atomic<int> produced{0};
+    std::atomic<int> consumed{0};
+
+    // Producer thread: pushes numbers into the queue.
+    auto producer = [&]() {
+         for (int i = 0; i < numElements; ++i) {
+              while (!queue.push_back(i)) {
+                   std::this_thread::yield();
+              }
+              produced.fetch_add(1, std::memory_order_relaxed);
+         }
+         done = true;
+    };
+
+    // Consumer thread: pops numbers from the queue.
+    auto consumer = [&]() {
+         while (!done || !queue.empty()) {
+              auto item = queue.pop_front();
+              if (item.has_value()) {
+                   consumed.fetch_add(1, std::memory_order_relaxed);
+              } else {
+                   std::this_thread::yield();
+              }
+         }
+    };
+
+    std::thread prodThread(producer);
+    std::thread consThread(consumer);
+    prodThread.join();
+    consThread.join();
+
+    CHECK(produced.load(std::memory_order_relaxed) == numElements, "Produced count should equal numElements", errors);
+    CHECK(consumed.load(std::memory_order_relaxed) == numElements, "Consumed count should equal numElements", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest5] Test Multi-threaded Operations"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest5] Test Multi-threaded Operations"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// Test 6: Verify the convenience push/pop methods.
+void test_atomic_queue_push_and_pop() {
+    std::stringstream errors;
+    CircularQueueAtomic<int> queue(10);
+
+    // Use push (alias for push_back) to insert values.
+    for (int i = 0; i < 5; ++i) {
+         bool ok = queue.push(i);
+         CHECK(ok, "push should succeed", errors);
+    }
+    // Use pop (alias for pop_front) to remove values and verify FIFO order.
+    for (int i = 0; i < 5; ++i) {
+         auto result = queue.pop();
+         CHECK(result.has_value(), "pop should return a value", errors);
+         CHECK(result.value() == i, "pop should return FIFO order value", errors);
+    }
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest6] Test push/pop Convenience Methods"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[AtomicQueueTest6] Test push/pop Convenience Methods"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+         total_failures++;
+    }
+}
+
+// ===================== ChaseLevDeque Tests ========================= //
+
+// Test 1: Owner pops LIFO, thieves steal FIFO, and the buffer grows.
+void test_chase_lev_single_threaded() {
+    std::stringstream errors;
+    ChaseLevDeque<int> deque(4);
+
+    CHECK(deque.empty(), "New deque should be empty", errors);
+    CHECK(!deque.pop().has_value(), "pop on an empty deque should fail", errors);
+    CHECK(!deque.steal().has_value(), "steal on an empty deque should fail", errors);
+
+    // Push past the initial capacity to force two resizes.
+    for (int i = 0; i < 16; ++i) {
+        deque.push(i);
+    }
+    CHECK(deque.size() == 16, "Size should be 16 after growing", errors);
+
+    auto stolen = deque.steal();
+    CHECK(stolen.has_value() && stolen.value() == 0, "steal should take the oldest element", errors);
+    auto popped = deque.pop();
+    CHECK(popped.has_value() && popped.value() == 15, "pop should take the newest element", errors);
+
+    int expected = 14;
+    bool lifo = true;
+    while (auto item = deque.pop()) {
+        lifo = lifo && item.value() == expected--;
+    }
+    CHECK(lifo && expected == 0, "Remaining elements should pop in LIFO order", errors);
+    CHECK(deque.empty(), "Deque should be empty after draining", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[ChaseLevTest1] Test Owner/Thief Order and Growth"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[ChaseLevTest1] Test Owner/Thief Order and Growth"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// Test 2: One owner pushing and popping against several thieves; every
+// element must be taken exactly once.
+void test_chase_lev_multi_threaded() {
+    std::stringstream errors;
+    const int numElements = 100000;
+    const int numThieves = 3;
+    ChaseLevDeque<int> deque(16);
+    std::vector<std::atomic<int>> taken(numElements);
+    for (auto& t : taken) {
+        t.store(0);
+    }
+    std::atomic<int> consumed{0};
+
+    auto thief = [&]() {
+        while (consumed.load(std::memory_order_relaxed) < numElements) {
+            if (auto item = deque.steal()) {
+                taken[item.value()].fetch_add(1, std::memory_order_relaxed);
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < numThieves; ++i) {
+        thieves.emplace_back(thief);
+    }
+
+    // Owner: push in bursts and pop some back, like a worker releasing tasks.
+    for (int i = 0; i < numElements; ++i) {
+        deque.push(i);
+        if (i % 3 == 0) {
+            if (auto item = deque.pop()) {
+                taken[item.value()].fetch_add(1, std::memory_order_relaxed);
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    while (consumed.load(std::memory_order_relaxed) < numElements) {
+        if (auto item = deque.pop()) {
+            taken[item.value()].fetch_add(1, std::memory_order_relaxed);
+            consumed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    for (auto& t : thieves) {
+        t.join();
+    }
+
+    bool once = true;
+    for (auto& t : taken) {
+        once = once && t.load() == 1;
+    }
+    CHECK(consumed.load() == numElements, "Consumed count should equal numElements", errors);
+    CHECK(once, "Every element should be taken exactly once", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[ChaseLevTest2] Test Concurrent Pop/Steal"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[ChaseLevTest2] Test Concurrent Pop/Steal"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ================== BucketPriorityQueue Tests ====================== //
+
+// Test 1: Highest priority first, FIFO within a priority, including past the
+// ring into the overflow; out-of-range priorities share the top bucket, and
+// reserve keeps the queued elements.
+void test_bucket_queue_order() {
+    std::stringstream errors;
+    BucketPriorityQueue<int> queue(8);
+    int value = -1;
+    CHECK(queue.empty() && !queue.try_pop(value), "A new queue should be empty", errors);
+
+    for (int k = 0; k < 100; ++k) {
+        queue.push(1000 + k, 3);
+    }
+    queue.push(7, 7);
+    queue.push(1, 1);
+    queue.push(50, 50);         // Clamped to bucket 7, behind 7
+    CHECK(queue.try_pop(value) && value == 7, "The highest priority should come first", errors);
+    CHECK(queue.try_pop(value) && value == 50, "Priorities past the end should share the top bucket", errors);
+    bool fifo = true;
+    for (int k = 0; k < 100; ++k) {
+        fifo = queue.try_pop(value) && value == 1000 + k && fifo;
+    }
+    CHECK(fifo, "One priority should pop in FIFO order, past the ring", errors);
+
+    queue.push(2, 2);
+    queue.reserve(64);
+    queue.push(40, 40);
+    CHECK(queue.num_buckets() == 64, "reserve should add buckets", errors);
+    CHECK(queue.try_pop(value) && value == 40, "New buckets should be usable after reserve", errors);
+    CHECK(queue.try_pop(value) && value == 2, "reserve should keep the queued elements", errors);
+    CHECK(queue.try_pop(value) && value == 1, "The lowest priority should come last", errors);
+    CHECK(!queue.try_pop(value) && queue.empty(), "The drained queue should be empty", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[BucketTest1] Test Priority and FIFO Order"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[BucketTest1] Test Priority and FIFO Order"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// Test 2: Threads push and pop concurrently across priorities, the way
+// workers release and take tasks; every element must be taken exactly once.
+void test_bucket_queue_multi_threaded() {
+    std::stringstream errors;
+    const int numThreads = 4;
+    const int perThread = 50000;
+    const int numElements = numThreads * perThread;
+    BucketPriorityQueue<int> queue(32);
+    std::vector<std::atomic<int>> taken(numElements);
+    for (auto& t : taken) {
+        t.store(0);
+    }
+    std::atomic<int> consumed{0};
+
+    auto worker = [&](int tid) {
+        int value = 0;
+        for (int k = 0; k < perThread; ++k) {
+            int item = tid * perThread + k;
+            queue.push(item, item % 37);
+            if (k % 2 == 0 && queue.try_pop(value)) {
+                taken[value].fetch_add(1, std::memory_order_relaxed);
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        while (consumed.load(std::memory_order_relaxed) < numElements) {
+            if (queue.try_pop(value)) {
+                taken[value].fetch_add(1, std::memory_order_relaxed);
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    bool once = true;
+    for (auto& t : taken) {
+        once = once && t.load() == 1;
+    }
+    CHECK(consumed.load() == numElements, "Consumed count should equal numElements", errors);
+    CHECK(once, "Every element should be taken exactly once", errors);
+    CHECK(queue.empty(), "The queue should be empty afterwards", errors);
+
+    if (errors.str().empty()) {
+         std::cout << std::left << std::setw(60)
+                   << "[BucketTest2] Test Concurrent Push/Pop"
+                   << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+         std::cout << std::left << std::setw(60)
+                   << "[BucketTest2] Test Concurrent Push/Pop"
+                   << RED << "[Failed]" << RESET << std::endl;
+         std::cout << errors.str();
+    }
+}
+
+// ========================= Idle Policy Tests ========================= //
+
+// Test 1: IdleBackoff spins, then yields, then asks the caller to park.
+void test_idle_backoff() {
+    std::stringstream errors;
+    IdleBackoff idle(3, 2);
+
+    int waits = 0;
+    while (idle.wait()) {
+        ++waits;
+    }
+    CHECK(waits == 5, "wait() should succeed spins + yields times", errors);
+    CHECK(!idle.wait(), "wait() should keep asking to park until reset", errors);
+    idle.reset();
+    CHECK(idle.wait(), "wait() should spin again after reset", errors);
+
+    IdleBackoff park_now(0, 0);
+    CHECK(!park_now.wait(), "Zero spins and yields should park immediately", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[ID1]. Test Idle Back-off Phases."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[ID1]. Test Idle Back-off Phases."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 2: Parked threads are woken by notify; a notify issued between
+// prepare_park() and park() is not lost.
+void test_parking_lot() {
+    std::stringstream errors;
+    ParkingLot lot;
+    std::atomic<int> published{0};
+    std::atomic<int> seen{0};
+    const int numThreads = 4;
+
+    auto sleeper = [&]() {
+        while (true) {
+            uint32_t ticket = lot.prepare_park();
+            if (published.load() > 0) {
+                lot.cancel_park();
+                break;
+            }
+            lot.park(ticket);
+        }
+        seen.fetch_add(1);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(sleeper);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    published.store(1);
+    lot.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+    CHECK(seen.load() == numThreads, "notify_all should wake every parked thread", errors);
+
+    // A notify that lands after prepare_park() makes park() return at once
+    // (the test would hang here otherwise).
+    uint32_t ticket = lot.prepare_park();
+    lot.notify_one();
+    lot.park(ticket);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[ID2]. Test Parking Lot Wake-ups."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[ID2]. Test Parking Lot Wake-ups."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 3: No thread leaves a SpinBarrier phase before every thread has
+// finished the previous one, including with more threads than cores.
+void test_spin_barrier() {
+    std::stringstream errors;
+    const int numThreads = 6;
+    const int phases = 200;
+    SpinBarrier barrier(numThreads, 10);
+    std::vector<int> progress(numThreads, 0);
+    std::atomic<int> violations{0};
+
+    auto worker = [&](int tid) {
+        bool sense = false;
+        for (int p = 0; p < phases; ++p) {
+            progress[tid] = p + 1;
+            barrier.wait(sense);
+            for (int t = 0; t < numThreads; ++t) {
+                if (progress[t] < p + 1) {
+                    violations.fetch_add(1);
+                }
+            }
+            barrier.wait(sense);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    CHECK(violations.load() == 0, "Every thread should see all writes made before the barrier", errors);
+    CHECK(std::all_of(progress.begin(), progress.end(), [&](int p) { return p == phases; }),
+          "Every thread should finish every phase", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[ID3]. Test Spin Barrier Phases."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[ID3]. Test Spin Barrier Phases."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Placement Tests ========================= //
+
+// Test 1: CPU lists, compact/scatter mapping and row-block ownership on a
+// synthetic two-node topology.
+void test_thread_placement() {
+    std::stringstream errors;
+
+    CHECK(parse_cpu_list("0-2,8, 10-11\n") == std::vector<int>({0, 1, 2, 8, 10, 11}),
+          "CPU list ranges should expand", errors);
+
+    CpuTopology topology;
+    topology.node_cpus = {{0, 1, 2}, {4, 5, 6}};
+
+    ThreadPlacement compact(topology, PlacementPolicy::compact, 7);
+    CHECK(compact.cpu_of(0) == 0 && compact.cpu_of(2) == 2 && compact.cpu_of(3) == 4 && compact.node_of(3) == 1,
+          "Compact should fill node 0 before node 1", errors);
+    CHECK(compact.cpu_of(6) == 0 && compact.node_of(6) == 0, "Compact should wrap when oversubscribed", errors);
+
+    ThreadPlacement scatter(topology, PlacementPolicy::scatter, 4);
+    CHECK(scatter.cpu_of(0) == 0 && scatter.cpu_of(1) == 4 && scatter.cpu_of(2) == 1 && scatter.cpu_of(3) == 5,
+          "Scatter should alternate nodes", errors);
+    CHECK(scatter.num_nodes() == 2 && scatter.block_owner(6) == 2 && scatter.block_node(5) == 1,
+          "Row blocks should be owned cyclically", errors);
+
+    ThreadPlacement unbound(topology, PlacementPolicy::none, 4);
+    CHECK(unbound.num_nodes() == 1 && unbound.block_node(5) == 0 && unbound.bind(3),
+          "Unbound placement should hide the nodes", errors);
+
+    // Binding to a CPU we are allowed on succeeds.
+    CpuTopology detected = CpuTopology::detect();
+    CHECK(detected.num_nodes() >= 1, "Topology detection should find a node", errors);
+    ThreadPlacement local(detected, PlacementPolicy::compact, 1);
+    bool bound = false;
+    std::thread([&] { bound = local.bind(0); }).join();
+    CHECK(bound, "Binding to an allowed CPU should succeed", errors);
+
+    CHECK(parse_placement_policy("scatter") == PlacementPolicy::scatter, "\"scatter\" should parse", errors);
+    try {
+        parse_placement_policy("spread");
+        errors << RED << "Failure: Unknown placement should throw." << RESET << std::endl;
+        ++total_failures;
+    } catch (const std::invalid_argument&) {
+        // Expected exception
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[NU1]. Test Thread Placement."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[NU1]. Test Thread Placement."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Trace Tests ========================= //
+
+// Records tasks from two threads and checks the Chrome trace: one slice per
+// task on its thread's track, with the queueing delay taken from the ready
+// event of the same task.
+void test_task_trace() {
+    std::stringstream errors;
+
+    TaskTrace trace;
+    CHECK(!trace.enabled(), "Tracing should be off until init", errors);
+    trace.init(2, 4);
+    CHECK(trace.enabled(), "init should enable tracing", errors);
+
+    trace.ready(1, 0, 0, 0);
+    uint64_t start = trace.now();
+    trace.task(0, 0, 0, 0, 1, start, start + 2500);
+    std::thread other([&trace] {
+        // More tasks than reserved: the buffer grows.
+        for (uint32_t j = 1; j < 8; ++j) {
+            trace.task(1, 3, 2, j, 2, 1000 * j, 1000 * j + 500);
+        }
+    });
+    other.join();
+    CHECK(trace.num_tasks() == 8, "Every recorded task should be kept", errors);
+
+    std::stringstream json;
+    trace.write_chrome_json(json, {"first"});
+    const std::string text = json.str();
+    CHECK(text.find("\"name\":\"first\"") != std::string::npos, "Tracks should take the given names", errors);
+    CHECK(text.find("\"name\":\"worker 1\"") != std::string::npos, "Unnamed tracks should be numbered", errors);
+    CHECK(text.find("\"name\":\"T1 (0,0)\"") != std::string::npos && text.find("\"dur\":2.5") != std::string::npos,
+          "The type-1 task should be one 2.5 us slice", errors);
+    CHECK(text.find("\"tid\":1,\"name\":\"T2 (2,7)\"") != std::string::npos,
+          "Tasks should stay on the recording thread's track", errors);
+    size_t queued = 0;
+    for (size_t pos = text.find("queued_us"); pos != std::string::npos; pos = text.find("queued_us", pos + 1)) {
+        ++queued;
+    }
+    CHECK(queued == 1, "Only the task with a ready event should report its queueing delay", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[TR1]. Test Chrome Trace Export."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[TR1]. Test Chrome Trace Export."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Metrics Tests ========================= //
+
+// Summarizes a hand-written trace: per-thread totals, the counters pushed by
+// the workers, and the critical path through (0,0) -> (1,0) -> (1,1), which
+// beats the two tasks of job 1 and the off-path task (2,0).
+void test_run_metrics() {
+    std::stringstream errors;
+
+    TaskTrace trace;
+    trace.init(2, 8);
+    RunMetrics metrics;
+    CHECK(!metrics.enabled(), "Metrics should be off until init", errors);
+    metrics.init(2, false);
+    CHECK(metrics.enabled() && !metrics.hw_enabled(), "init should enable the software metrics only", errors);
+
+    trace.ready(1, 5, 0, 0);    // Pushed, never run
+    trace.task(0, 0, 0, 0, 1, 0, 1000);
+    trace.task(1, 0, 1, 0, 2, 1000, 3000);
+    trace.task(0, 0, 2, 0, 2, 1000, 1100);
+    trace.task(0, 0, 1, 1, 1, 3000, 3500);
+    trace.task(1, 1, 0, 0, 1, 0, 1500);
+    trace.task(1, 1, 1, 0, 2, 1500, 2500);
+    metrics.counters(0).failed_pops = 7;
+    metrics.counters(1).parks = 3;
+
+    RunSummary summary = metrics.summarize(trace, 5000, 1, 1e6);
+    CHECK(summary.threads.size() == 2, "Every thread should get a summary row", errors);
+    CHECK(summary.threads[0].type1_tasks == 2 && summary.threads[0].type1_ns == 1500 &&
+          summary.threads[0].type2_tasks == 1 && summary.threads[0].busy_ns() == 1600,
+          "Task times should be split by type", errors);
+    CHECK(summary.threads[1].pushes == 1 && summary.threads[0].failed_pops == 7 && summary.threads[1].parks == 3,
+          "Worker counters should be copied into the summary", errors);
+    CHECK(summary.critical_path_ns == 3500, "The critical path should follow the dependencies", errors);
+    CHECK(summary.queue_samples == 0, "Tasks without a ready event should not be sampled", errors);
+
+    trace.ready(0, 0, 9, 9);
+    const uint64_t start = trace.now() + 1000000;
+    trace.task(1, 0, 9, 9, 2, start, start + 10);   // Queued for at least 1 ms
+    summary = metrics.summarize(trace, 5000, 1, 1e6);
+    CHECK(summary.queue_samples == 1 && summary.queue_p50_ns >= 1000000 && summary.queue_hist[0] == 0,
+          "The queueing delay should land in a millisecond bucket", errors);
+
+    std::stringstream json, csv;
+    RunMetrics::write_json(json, summary);
+    RunMetrics::write_csv(csv, summary);
+    CHECK(json.str().find("\"critical_path_ms\": 0.0035") != std::string::npos &&
+          json.str().find("\"failed_pops\": 7") != std::string::npos,
+          "The JSON report should carry the summary", errors);
+    const std::string rows = csv.str();
+    CHECK(std::count(rows.begin(), rows.end(), '\n') == 3, "The CSV report should have one row per thread", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[ME1]. Test Run Metrics Summary."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[ME1]. Test Run Metrics Summary."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ====================== Benchmark History Tests ====================== //
+
+// Test 1: Medians, their confidence intervals, the U test and the JSON the
+// database and the --timing records are written in.
+void test_bench_statistics() {
+    std::stringstream errors;
+
+    SampleSummary five = summarize_samples({5, 1, 3, 2, 4});
+    CHECK(five.count == 5 && five.median == 3 && five.mean == 3 && five.ci_low == 1 && five.ci_high == 5 &&
+              std::abs(five.confidence - 0.9375) < 1e-12,
+          "Five samples should give [min, max] at 93.75%", errors);
+    std::vector<double> twenty;
+    for (int i = 20; i >= 1; i--) {
+        twenty.push_back(i);
+    }
+    SampleSummary s20 = summarize_samples(twenty);
+    CHECK(s20.median == 10.5 && s20.ci_low == 6 && s20.ci_high == 15 && s20.confidence >= 0.95 &&
+              s20.confidence < 0.96,
+          "Twenty samples should give the 6th and 15th order statistics", errors);
+
+    const std::vector<double> slow = {6, 7, 8, 9, 10}, fast = {1, 2, 3, 4, 5};
+    CHECK(std::abs(mann_whitney_greater(slow, fast) - 1.0 / 252) < 1e-12 &&
+              std::abs(mann_whitney_greater(fast, slow) - 1.0) < 1e-12,
+          "Separated samples should give the exact tail 1/C(10,5)", errors);
+    const double mixed = mann_whitney_greater({1, 3, 5, 7, 9}, {2, 4, 6, 8, 10});
+    CHECK(mixed > 0.5 && mixed < 0.8, "Interleaved samples should not differ", errors);
+    const double tied = mann_whitney_greater({2, 2, 3, 3, 3, 4}, {1, 1, 2, 2, 1, 1});
+    CHECK(tied > 0 && tied < 0.01, "Tied samples should use the corrected normal approximation", errors);
+
+    JsonValue doc = JsonValue::parse(" {\"a\": [1, -2.5e3, true, null], \"s\": \"q\\\"\\n\", \"o\": {}} ");
+    std::stringstream written;
+    doc.write(written);
+    JsonValue again = JsonValue::parse(written.str());
+    CHECK(again.find("a") != nullptr && again.find("a")->items().size() == 4 &&
+              again.find("a")->items()[1].as_number() == -2500 && again.find("a")->items()[2].as_bool() &&
+              again.string_or("s", "") == "q\"\n" && again.find("o")->kind() == JsonValue::object,
+          "JSON should survive a write and a parse", errors);
+    bool malformed = false;
+    try {
+        JsonValue::parse("{\"a\": [1, 2}");
+    } catch (const std::runtime_error&) {
+        malformed = true;
+    }
+    CHECK(malformed, "Malformed JSON should be rejected", errors);
+
+    const std::string timing = "bench_timing_test.json";
+    save_run_timing(timing, "dynamic", 300, 200, 4, 4, 16, 2000000);
+    std::ifstream in(timing);
+    std::stringstream text;
+    text << in.rdbuf();
+    JsonValue record = JsonValue::parse(text.str());
+    CHECK(record.string_or("driver", "") == "dynamic" && record.number_or("m", 0) == 300 &&
+              record.number_or("wall_ns", 0) == 2000000 &&
+              std::abs(record.number_or("gflops_per_s", 0) - householder_flops(300, 200) / 2e6) < 1e-6,
+          "A timing record should carry the run and its GFLOP/s", errors);
+    std::remove(timing.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[BH1]. Test Benchmark Statistics."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[BH1]. Test Benchmark Statistics."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 2: Efficiency, verdicts against a baseline, and the database file.
+void test_bench_database() {
+    std::stringstream errors;
+
+    auto entry = [](const std::string& driver, int threads, std::vector<double> samples) {
+        BenchEntry e;
+        e.driver = driver;
+        e.m = e.n = 500;
+        e.threads = threads;
+        e.alpha = 4;
+        e.beta = 16;
+        e.samples_ms = samples;
+        e.stats = summarize_samples(samples);
+        return e;
+    };
+    BenchRun base;
+    base.label = "base";
+    base.entries = {entry("dynamic", 1, {80, 81, 79, 80.5, 79.5}), entry("dynamic", 4, {25, 25.2, 24.8, 25.1, 24.9}),
+                    entry("static", 4, {30, 30.2, 29.8, 30.1, 29.9}), entry("static", 1, {90, 91, 89, 90.5, 89.5})};
+    set_parallel_efficiency(base);
+    CHECK(std::abs(base.entries[0].efficiency - 1) < 1e-12 && std::abs(base.entries[1].efficiency - 0.8) < 1e-12 &&
+              std::abs(base.entries[2].efficiency - 0.75) < 1e-12,
+          "Efficiency should be T(1) / (p T(p)) per driver", errors);
+
+    BenchRun current;
+    current.label = "next";
+    current.entries = {entry("dynamic", 1, {96, 97, 95, 96.5, 95.5}),      // 20% slower
+                       entry("dynamic", 4, {25.5, 25.7, 25.3, 25.6, 25.4}), // 2% slower
+                       entry("static", 4, {24, 24.2, 23.8, 24.1, 23.9}),    // 20% faster
+                       entry("static", 1, {70, 130, 90, 85, 95}),           // Noisy
+                       entry("static", 2, {50, 50, 50, 50, 50})};           // Not in the baseline
+    std::vector<BenchComparison> changes = compare_bench_runs(current, base, 0.05, 0.01);
+    CHECK(changes.size() == 5 && changes[0].verdict == BenchComparison::regression &&
+              std::abs(changes[0].ratio - 1.2) < 1e-12 && changes[0].p_value < 0.01,
+          "A significant 20% slowdown should be a regression", errors);
+    CHECK(changes[1].verdict == BenchComparison::unchanged && changes[1].p_value < 0.01,
+          "A significant change below the threshold should not be flagged", errors);
+    CHECK(changes[2].verdict == BenchComparison::improvement, "A significant speedup should be an improvement",
+          errors);
+    CHECK(changes[3].verdict == BenchComparison::unchanged && changes[4].verdict == BenchComparison::no_baseline &&
+              changes[4].base == nullptr,
+          "Noisy and new points should not be flagged", errors);
+
+    const std::string path = "bench_db_test.json";
+    std::remove(path.c_str());
+    {
+        BenchDatabase db(path);
+        CHECK(db.runs.empty() && db.baseline.empty(), "A missing database should start empty", errors);
+        db.add(base);
+        db.add(current);
+        db.baseline = "base";
+        db.save();
+    }
+    BenchDatabase db(path);
+    const BenchRun* loaded = db.find("next");
+    CHECK(db.baseline == "base" && db.runs.size() == 2 && loaded != nullptr && loaded->entries.size() == 5 &&
+              loaded->entries[3].samples_ms == current.entries[3].samples_ms &&
+              loaded->entries[3].stats.median == current.entries[3].stats.median && db.find("base") != nullptr &&
+              std::abs(db.find("base")->entries[1].efficiency - 0.8) < 1e-9,
+          "The database should keep every run, trial and its baseline", errors);
+    current.entries.pop_back();
+    db.add(current);
+    CHECK(db.runs.size() == 2 && db.find("next")->entries.size() == 4, "A label should be stored once", errors);
+    std::remove(path.c_str());
+
+    std::ofstream(path) << "[1, 2, 3]";
+    bool rejected = false;
+    try {
+        BenchDatabase other(path);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    CHECK(rejected, "A file that is not a database should be rejected", errors);
+    std::remove(path.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[BH2]. Test Benchmark Database and Baseline."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[BH2]. Test Benchmark Database and Baseline."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= RunConfig Tests ========================= //
+
+// Test 1: Command-line options override the driver defaults.
+void test_run_config_parse() {
+    std::stringstream errors;
+
+    RunConfig cfg;
+    cfg.num_threads = 28;
+    cfg.alpha = 4;
+    cfg.beta = 16;
+
+    const char* argv[] = {"a.out", "-t", "8", "--alpha=12", "--beta", "24", "-q", "priority", "matrix.txt"};
+    bool ok = parse_run_config(9, const_cast<char**>(argv), cfg);
+
+    CHECK(ok, "parse_run_config should succeed", errors);
+    CHECK(cfg.num_threads == 8, "Threads should be 8", errors);
+    CHECK(cfg.alpha == 12, "Alpha should be 12", errors);
+    CHECK(cfg.beta == 24, "Beta should be 24", errors);
+    CHECK(cfg.beta_div_alpha() == 2, "beta_div_alpha should be 2", errors);
+    CHECK(cfg.queue == QueuePolicy::priority, "Queue policy should be priority", errors);
+    CHECK(cfg.input_file == "matrix.txt", "Input file should be matrix.txt", errors);
+    CHECK(parse_queue_policy("steal") == QueuePolicy::steal, "\"steal\" should select work stealing", errors);
+    CHECK(parse_queue_policy("bucket") == QueuePolicy::bucket, "\"bucket\" should select the bucketed queue",
+          errors);
+    CHECK(parse_non_negative_int("0", "--spin") == 0, "Spin count may be zero", errors);
+
+    const char* tiled_argv[] = {"a.out", "--layout", "tiled", "--tile-cols=96", "matrix.txt"};
+    RunConfig tiled_cfg;
+    parse_run_config(5, const_cast<char**>(tiled_argv), tiled_cfg);
+    CHECK(parse_matrix_layout(tiled_cfg.layout) == MatrixLayout::tiled && tiled_cfg.tile_cols == 96,
+          "Layout options should select 96-column tiles", errors);
+    const char* batch_argv[] = {"a.out", "a.bin", "--batch", "@list.txt", "--window=8"};
+    RunConfig batch_cfg;
+    parse_run_config(5, const_cast<char**>(batch_argv), batch_cfg);
+    CHECK(batch_cfg.batch && batch_cfg.batch_window == 8 && batch_cfg.inputs.size() == 2
+          && batch_cfg.input_file == "a.bin", "--batch should collect every input", errors);
+    CHECK(parse_task_graph_mode(RunConfig().graph) == TaskGraphMode::eager
+          && parse_task_graph_mode("lazy") == TaskGraphMode::lazy, "The task graph should default to eager", errors);
+    const char* tune_argv[] = {"a.out", "--autotune", "--tune-cache", "none", "matrix.txt"};
+    RunConfig tune_cfg;
+    parse_run_config(5, const_cast<char**>(tune_argv), tune_cfg);
+    CHECK(tune_cfg.autotune && tune_cfg.tune_cache == "none" && !RunConfig().autotune,
+          "--autotune should be opt-in", errors);
+    const char* tsqr_argv[] = {"a.out", "--tsqr", "--tsqr-leaf=512", "matrix.txt"};
+    RunConfig tsqr_cfg;
+    parse_run_config(4, const_cast<char**>(tsqr_argv), tsqr_cfg);
+    CHECK(tsqr_cfg.tsqr && tsqr_cfg.tsqr_leaf == 512 && !RunConfig().tsqr, "--tsqr should be opt-in", errors);
+    const char* precision_argv[] = {"a.out", "--precision", "mixed", "--rhs=b.txt", "matrix.txt"};
+    RunConfig precision_cfg;
+    parse_run_config(5, const_cast<char**>(precision_argv), precision_cfg);
+    CHECK(precision_cfg.precision == Precision::mixed && precision_cfg.rhs_file == "b.txt"
+          && RunConfig().precision == Precision::fp64 && parse_precision("float") == Precision::fp32,
+          "--precision should default to double", errors);
+    const char* device_argv[] = {"a.out", "--device", "host", "--device-share=50", "--device-batch", "4", "m.txt"};
+    RunConfig device_cfg;
+    parse_run_config(7, const_cast<char**>(device_argv), device_cfg);
+    CHECK(device_cfg.device == DeviceKind::host && device_cfg.device_share == 50 && device_cfg.device_batch == 4
+          && RunConfig().device == DeviceKind::none, "--device should be opt-in", errors);
+    const char* ooc_argv[] = {"a.out", "--out-of-core", "--memory-budget=64", "--scratch", "/data", "m.bin"};
+    RunConfig ooc_cfg;
+    parse_run_config(6, const_cast<char**>(ooc_argv), ooc_cfg);
+    CHECK(ooc_cfg.out_of_core && ooc_cfg.memory_budget == 64 && ooc_cfg.scratch_dir == "/data"
+          && !RunConfig().out_of_core, "--out-of-core should be opt-in", errors);
+    const char* output_argv[] = {"a.out", "-o", "r.bin", "--output-format=binary", "--compress", "--checkpoint",
+                                 "run.ckpt", "--checkpoint-interval", "0.25", "m.bin"};
+    RunConfig output_cfg;
+    parse_run_config(10, const_cast<char**>(output_argv), output_cfg);
+    CHECK(output_cfg.output_format == OutputFormat::binary && output_cfg.compress
+          && output_cfg.checkpoint_file == "run.ckpt" && output_cfg.checkpoint_interval == 0.25
+          && RunConfig().output_format == OutputFormat::text && RunConfig().checkpoint_file.empty(),
+          "Binary output and checkpoints should be opt-in", errors);
+    const char* update_argv[] = {"a.out", "--append", "new.txt", "--delete-rows=5:20", "f.bin"};
+    const char* window_argv[] = {"a.out", "--delete-rows", "7", "f.bin"};
+    RunConfig update_cfg, window_cfg;
+    parse_run_config(5, const_cast<char**>(update_argv), update_cfg);
+    parse_run_config(4, const_cast<char**>(window_argv), window_cfg);
+    CHECK(update_cfg.update() && update_cfg.append_file == "new.txt" && update_cfg.delete_first == 5 &&
+              update_cfg.delete_count == 20 && window_cfg.update() && window_cfg.append_file.empty() &&
+              window_cfg.delete_first == 0 && window_cfg.delete_count == 7 && !RunConfig().update(),
+          "--append and --delete-rows should be parsed", errors);
+    const char* timing_argv[] = {"a.out", "--timing", "t.json", "m.bin"};
+    RunConfig timing_cfg;
+    parse_run_config(4, const_cast<char**>(timing_argv), timing_cfg);
+    CHECK(timing_cfg.timing_file == "t.json" && RunConfig().timing_file.empty(), "--timing should be opt-in",
+          errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[RC1]. Test Option Parsing."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[RC1]. Test Option Parsing."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 2: Invalid values are rejected with std::invalid_argument.
+void test_run_config_invalid() {
+    std::stringstream errors;
+
+    auto rejects = [](std::vector<const char*> args) {
+        RunConfig cfg;
+        try {
+            parse_run_config(static_cast<int>(args.size()), const_cast<char**>(args.data()), cfg);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+
+    CHECK(rejects({"a.out", "-t", "0", "m.txt"}), "Zero threads should be rejected", errors);
+    CHECK(rejects({"a.out", "-a", "3", "-b", "16", "m.txt"}), "Beta not a multiple of alpha should be rejected", errors);
+    CHECK(rejects({"a.out", "-q", "lifo", "m.txt"}), "Unknown queue policy should be rejected", errors);
+    CHECK(rejects({"a.out", "--precision", "half", "m.txt"}), "Unknown precision should be rejected", errors);
+    CHECK(rejects({"a.out", "-t", "4x", "m.txt"}), "Trailing garbage should be rejected", errors);
+    CHECK(rejects({"a.out", "-a"}), "Missing option value should be rejected", errors);
+    CHECK(rejects({"a.out", "-t", "4"}), "Missing input file should be rejected", errors);
+    CHECK(rejects({"a.out", "--spin", "-1", "m.txt"}), "Negative spin count should be rejected", errors);
+    CHECK(rejects({"a.out", "a.txt", "b.txt"}), "Several inputs should need --batch", errors);
+    CHECK(rejects({"a.out", "--device", "opencl", "m.txt"}), "Unknown device should be rejected", errors);
+    CHECK(rejects({"a.out", "--device-share", "101", "m.txt"}), "A device share above 100% should be rejected",
+          errors);
+    CHECK(rejects({"a.out", "--memory-budget", "0", "m.txt"}), "An empty memory budget should be rejected", errors);
+    CHECK(rejects({"a.out", "--output-format", "hdf5", "m.txt"}), "Unknown output format should be rejected", errors);
+    CHECK(rejects({"a.out", "--compress", "m.txt"}), "--compress should need the binary format", errors);
+    CHECK(rejects({"a.out", "--checkpoint-interval", "0", "m.txt"}) &&
+              rejects({"a.out", "--checkpoint-interval", "0.0001", "m.txt"}) &&
+              rejects({"a.out", "--checkpoint-interval", "1s", "m.txt"}) &&
+              rejects({"a.out", "--checkpoint-interval", "nan", "m.txt"}),
+          "Zero, sub-millisecond and malformed checkpoint intervals should be rejected", errors);
+    CHECK(rejects({"a.out", "--delete-rows", "0", "f.bin"}) && rejects({"a.out", "--delete-rows", "3:", "f.bin"}) &&
+              rejects({"a.out", "--delete-rows", "-1:4", "f.bin"}),
+          "Empty or malformed row ranges should be rejected", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[RC2]. Test Invalid Options."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[RC2]. Test Invalid Options."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= TaskTable Tests ========================= //
+
+// Runs the task graph serially from (0, 0), releasing successors the way the
+// dynamic scheduler does, and checks every task becomes ready exactly once and
+// only after its predecessors have completed.
+void test_task_table_release() {
+    std::stringstream errors;
+
+    const int n = 24, alpha = 2, beta = 6;
+    const int rows = n / beta, cols = n / alpha, bda = beta / alpha;
+    matrix_t<double> mat(n, n);
+    TaskTable table(rows, cols, alpha, beta, mat);
+
+    int expected_tasks = 0;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            expected_tasks += table.getTask(i, j) != nullptr;
+        }
+    }
+
+    for (int run = 0; run < 2; ++run) {
+        std::vector<int> ready_count(rows * cols, 0);
+        std::vector<bool> done(rows * cols, false);
+        std::vector<Task*> ready = {table.getTask(0, 0)};
+        bool order_ok = true;
+        int completed = 0;
+
+        while (!ready.empty()) {
+            Task* t = ready.back();
+            ready.pop_back();
+            int i = t->chunk_idx_i, j = t->chunk_idx_j;
+            if (j > 0 && !done[i * cols + j - 1]) order_ok = false;
+            if (t->type == 2 && !done[(j / bda) * cols + j]) order_ok = false;
+            done[i * cols + j] = true;
+            ++completed;
+            table.releaseSuccessors(t, [&](Task* next) {
+                ++ready_count[next->chunk_idx_i * cols + next->chunk_idx_j];
+                ready.push_back(next);
+            });
+        }
+
+        CHECK(completed == expected_tasks, "Every task should be released", errors);
+        CHECK(order_ok, "Tasks should only be released after their predecessors", errors);
+        CHECK(std::count_if(ready_count.begin(), ready_count.end(), [](int c) { return c > 1; }) == 0,
+              "No task should be released twice", errors);
+        CHECK(done[(rows - 1) * cols + cols - 1], "The last panel should be factorized", errors);
+
+        table.resetDependencies();
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[TT1]. Test Dependency-Counting Release."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[TT1]. Test Dependency-Counting Release."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Checks the arena layout: the non-empty cells of each task row are
+// consecutive Tasks, rows follow each other with no gaps, and cells above
+// the staircase have no task.
+void test_task_table_arena() {
+    std::stringstream errors;
+
+    const int n = 30, alpha = 3, beta = 6;
+    const int rows = n / beta, cols = n / alpha, bda = beta / alpha;
+    matrix_t<double> mat(n, n);
+    TaskTable table(rows, cols, alpha, beta, mat);
+
+    int expected_tasks = 0;
+    for (int i = 0; i < rows; ++i) {
+        expected_tasks += std::min((i + 1) * bda, cols);
+    }
+    CHECK(table.numTasks() == expected_tasks, "numTasks should count the staircase cells", errors);
+
+    const Task* first = table.getTask(0, 0);
+    int index = 0;
+    bool contiguous = true, bounds_ok = true;
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            const Task* t = table.getTask(i, j);
+            if (j >= (i + 1) * bda) {
+                CHECK(t == nullptr, "Cell (" + std::to_string(i) + ", " + std::to_string(j) + ") should be empty",
+                      errors);
+                continue;
+            }
+            contiguous = contiguous && t == first + index++;
+            bounds_ok = bounds_ok && t->chunk_idx_i == static_cast<uint32_t>(i)
+                        && t->chunk_idx_j == static_cast<uint32_t>(j)
+                        && t->row_start == static_cast<uint32_t>(alpha * j + 1)
+                        && t->col_start == static_cast<uint32_t>(beta * i + 1)
+                        && t->col_end == static_cast<uint32_t>(std::min(beta * (i + 1) + 1, n));
+        }
+    }
+    CHECK(contiguous, "Tasks should be stored row by row in one arena", errors);
+    CHECK(bounds_ok, "Task bounds and indices should match the grid", errors);
+    CHECK(table(rows - 1, cols - 1) == first + expected_tasks - 1, "operator() should match getTask", errors);
+    CHECK(sizeof(Task) <= 40, "Task should stay compact", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[TT2]. Test Arena Task Storage."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[TT2]. Test Arena Task Storage."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Runs a lazy task graph serially the way TT1 runs the eager one: every task
+// must match its eager counterpart, become ready once and only after its
+// predecessors, and fewer tasks than the whole grid should ever be alive.
+void test_task_table_lazy() {
+    std::stringstream errors;
+
+    const int n = 48, alpha = 2, beta = 8;
+    const int rows = n / beta, cols = n / alpha, bda = beta / alpha;
+    matrix_t<double> mat(n, n);
+    TaskTable eager(rows, cols, alpha, beta, mat);
+    TaskTable table(rows, cols, alpha, beta, mat, TaskGraphMode::lazy);
+
+    CHECK(table.mode() == TaskGraphMode::lazy, "The table should be lazy", errors);
+    CHECK(table.numTasks() == eager.numTasks(), "numTasks should not depend on the mode", errors);
+    CHECK(table.getTask(0, 1) == nullptr, "Only the root column should be alive before the run", errors);
+
+    for (int run = 0; run < 2; ++run) {
+        std::vector<int> ready_count(rows * cols, 0);
+        std::vector<bool> done(rows * cols, false);
+        // FIFO order, so several columns are alive at once.
+        std::deque<Task*> ready = {table.getTask(0, 0)};
+        bool order_ok = true, fields_ok = true;
+        int completed = 0;
+
+        while (!ready.empty()) {
+            Task* t = ready.front();
+            ready.pop_front();
+            int i = t->chunk_idx_i, j = t->chunk_idx_j;
+            const Task* e = eager.getTask(i, j);
+            fields_ok = fields_ok && e != nullptr && t->type == e->type && t->priority == e->priority
+                        && t->enq_nxt_t1 == e->enq_nxt_t1 && t->num_deps == e->num_deps
+                        && t->row_start == e->row_start && t->row_end == e->row_end
+                        && t->col_start == e->col_start && t->col_end == e->col_end;
+            if (j > 0 && !done[i * cols + j - 1]) order_ok = false;
+            if (t->type == 2 && !done[(j / bda) * cols + j]) order_ok = false;
+            done[i * cols + j] = true;
+            ++completed;
+            table.releaseSuccessors(t, [&](Task* next) {
+                ++ready_count[next->chunk_idx_i * cols + next->chunk_idx_j];
+                ready.push_back(next);
+            });
+        }
+
+        CHECK(completed == table.numTasks(), "Every task should be released", errors);
+        CHECK(order_ok, "Tasks should only be released after their predecessors", errors);
+        CHECK(fields_ok, "Lazy tasks should match the eager tasks", errors);
+        CHECK(std::count_if(ready_count.begin(), ready_count.end(), [](int c) { return c > 1; }) == 0,
+              "No task should be released twice", errors);
+        CHECK(table.getTask(rows - 1, cols - 1) == nullptr, "Completed columns should be recycled", errors);
+
+        table.resetDependencies();
+    }
+
+    CHECK(table.peakTasks() < static_cast<size_t>(table.numTasks()),
+          "Only a window of the graph should be alive", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[TT3]. Test Lazy Task Graph."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[TT3]. Test Lazy Task Graph."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Lower-trapezoidal factor of a factorized m x n row-major matrix, as an
+// m x m row-major L with L L^T = M M^T (columns past n stay zero).
+static std::vector<double> factor_of(const double* a, int m, int n) {
+    std::vector<double> L((size_t)m * m, 0.0);
+    for (int r = 0; r < m; ++r) {
+        for (int c = 0; c <= r && c < n; ++c) {
+            L[(size_t)r * m + c] = a[(size_t)r * n + c];
+        }
+    }
+    return L;
+}
+
+// Largest entry of |L L^T - M M^T| over the largest entry of M M^T.
+static double gram_error(const std::vector<double>& L, const double* mat, int m, int n) {
+    double worst = 0.0, scale = 0.0;
+    for (int r = 0; r < m; ++r) {
+        for (int c = 0; c < m; ++c) {
+            double want = 0.0, got = 0.0;
+            for (int k = 0; k < n; ++k) want += mat[(size_t)r * n + k] * mat[(size_t)c * n + k];
+            for (int k = 0; k < m; ++k) got += L[(size_t)r * m + k] * L[(size_t)c * m + k];
+            worst = std::max(worst, std::fabs(want - got));
+            scale = std::max(scale, std::fabs(want));
+        }
+    }
+    return worst / scale;
+}
+
+// Rectangular grids keep their partial last block and panel, and running
+// every task in column order factorizes the matrix (M M^T = L L^T).
+void test_task_table_rectangular() {
+    std::stringstream errors;
+
+    CHECK(TaskTable::task_rows(33, 8) == 4 && TaskTable::task_rows(34, 8) == 5 && TaskTable::task_rows(1, 8) == 1,
+          "task_rows should round partial row blocks up", errors);
+    CHECK(TaskTable::task_cols(13, 29, 4) == 3 && TaskTable::task_cols(29, 13, 4) == 3
+          && TaskTable::task_cols(300, 200, 8) == 25, "task_cols should count min(m, n) pivots", errors);
+
+    const int alpha = 2, beta = 4;
+    const std::pair<int, int> shapes[] = {{13, 29}, {29, 13}, {18, 18}};
+    for (auto [m, n] : shapes) {
+        const std::string name = std::to_string(m) + " x " + std::to_string(n);
+        std::vector<double> original((size_t)m * n);
+        for (size_t k = 0; k < original.size(); ++k) {
+            original[k] = std::sin(0.61 * k + m) + (k % (n + 1) == 0 ? 1.5 : 0.0);
+        }
+        matrix_t<double> mat(m, n);
+        std::copy(original.begin(), original.end(), mat.data_ptr());
+        const int rows = TaskTable::task_rows(m, beta), cols = TaskTable::task_cols(m, n, alpha);
+        TaskTable table(rows, cols, alpha, beta, mat);
+
+        const Task* last = table.getTask(rows - 1, cols - 1);
+        CHECK(last != nullptr && last->row_end == (uint32_t)std::min(m, n) && last->col_end == (uint32_t)m,
+              name + " last task should end at the last pivot and row", errors);
+
+        std::vector<double> up(m, 0.0), b(m, 0.0);
+        for (int j = 0; j < cols; ++j) {
+            for (int i = 0; i < rows; ++i) {
+                const Task* t = table.getTask(i, j);
+                if (t == nullptr || i < j / (beta / alpha)) continue;
+                if (t->type == 1) {
+                    complete_task1(mat.data_ptr(), m, n, t->row_start, t->row_end, t->col_start, t->col_end,
+                                   up.data(), b.data());
+                } else {
+                    complete_task2(mat.data_ptr(), m, n, t->row_start, t->row_end, t->col_start, t->col_end,
+                                   up.data(), b.data());
+                }
+            }
+        }
+        const double err = gram_error(factor_of(mat.data_ptr(), m, n), original.data(), m, n);
+        CHECK(err < 1e-12, name + " factorization should reproduce M M^T (error " + std::to_string(err) + ")",
+              errors);
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[TT4]. Test Rectangular Task Grid."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[TT4]. Test Rectangular Task Grid."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Kernel Tests ========================= //
+
+// Fills an n x n matrix with reproducible values in [-1, 1).
+static std::vector<double> make_test_matrix(int n, unsigned seed) {
+    std::vector<double> mat(static_cast<size_t>(n) * n);
+    for (size_t i = 0; i < mat.size(); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        mat[i] = static_cast<double>((seed >> 8) & 0xFFFF) / 32768.0 - 1.0;
+    }
+    return mat;
+}
+
+// Test 1: The fixed-alpha type-2 path matches the generic path bit for bit.
+void test_kernel_fixed_alpha() {
+    std::stringstream errors;
+
+    const int n = 64;
+    const int alpha = 8;
+    std::vector<double> ref = make_test_matrix(n, 7);
+    std::vector<double> up(n, 0.0), b(n, 0.0);
+
+    // Bitwise comparisons need the scalar kernels behind the dispatcher.
+    KernelIsa previous = active_kernels().isa;
+    select_kernel_isa(KernelIsa::scalar);
+
+    // Reflectors for pivots [1, alpha + 1) and a trailing tile of rows [17, 33).
+    complete_task1(ref.data(), n, n, 1, alpha + 1, 1, 17, up.data(), b.data());
+    std::vector<double> fast = ref;
+
+    apply_reflectors<0>(ref.data(), n, 0, alpha + 1, 17, 33, up.data(), b.data());
+    apply_reflectors<alpha + 1>(fast.data(), n, 0, alpha + 1, 17, 33, up.data(), b.data());
+    CHECK(ref == fast, "Fixed and generic reflector application should agree", errors);
+
+    // Full-size tile through the dispatcher.
+    complete_task2(ref.data(), n, n, alpha + 1, 2 * alpha + 1, 33, 49, up.data(), b.data());
+    apply_reflectors<0>(fast.data(), n, alpha + 1, 2 * alpha + 1, 33, 49, up.data(), b.data());
+    CHECK(ref == fast, "complete_task2 should match the generic path", errors);
+
+    select_kernel_isa(previous);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[KN1]. Test Fixed-Alpha Type-2 Kernel."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[KN1]. Test Fixed-Alpha Type-2 Kernel."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 2: Every SIMD kernel set supported by this CPU matches the scalar
+// kernels to rounding, including row and vector-length remainders.
+void test_kernel_simd() {
+    std::stringstream errors;
+
+    const int n = 71;               // Not a multiple of any vector width
+    const int alpha = 5;
+    const KernelSet scalar = make_kernel_set(KernelIsa::scalar);
+    const KernelIsa isas[] = {KernelIsa::avx2, KernelIsa::avx512};
+    int tested = 0;
+
+    for (KernelIsa isa : isas) {
+        if (!kernel_isa_supported(isa)) {
+            continue;
+        }
+        ++tested;
+        const KernelSet simd = make_kernel_set(isa);
+        const std::string name = kernel_isa_name(isa);
+
+        std::vector<double> ref = make_test_matrix(n, 11);
+        std::vector<double> up(n, 0.0), b(n, 0.0);
+
+        double max_ref, sum_ref, max_simd, sum_simd;
+        scalar.norm(ref.data() + 3, n - 3, &max_ref, &sum_ref);
+        simd.norm(ref.data() + 3, n - 3, &max_simd, &sum_simd);
+        CHECK(max_ref == max_simd && std::fabs(sum_ref - sum_simd) <= 1e-12 * sum_ref,
+              name + " column norm should match the scalar kernel", errors);
+
+        // Panel [0, alpha) on the scalar path, so both start from the same reflectors.
+        KernelIsa previous = active_kernels().isa;
+        select_kernel_isa(KernelIsa::scalar);
+        complete_task1(ref.data(), n, n, 1, alpha, 1, 13, up.data(), b.data());
+        select_kernel_isa(previous);
+        std::vector<double> fast = ref;
+
+        // 9 trailing rows: two blocks of KERNEL_ROWS and a single-row remainder.
+        scalar.apply(ref.data(), n, 0, alpha, 13, 22, up.data(), b.data());
+        simd.apply(fast.data(), n, 0, alpha, 13, 22, up.data(), b.data());
+
+        double max_diff = 0.0;
+        for (size_t i = 0; i < ref.size(); ++i) {
+            max_diff = std::max(max_diff, std::fabs(ref[i] - fast[i]));
+        }
+        CHECK(max_diff <= 1e-12, name + " reflector application should match the scalar kernel", errors);
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60)
+                  << "[KN2]. Test SIMD Kernels (" + std::to_string(tested) + " ISAs)."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[KN2]. Test SIMD Kernels."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 3: The blocked compact-WY type-2 path matches reflector-at-a-time
+// application for every kernel set, including a degenerate (zero) pivot.
+void test_kernel_wy() {
+    std::stringstream errors;
+
+    const int n = 83;
+    const int alpha = 6;
+    const int ldt = alpha + 1;
+    const KernelSet scalar = make_kernel_set(KernelIsa::scalar);
+    const KernelIsa isas[] = {KernelIsa::scalar, KernelIsa::avx2, KernelIsa::avx512};
+
+    std::vector<double> base = make_test_matrix(n, 23);
+    // Pivot 7 (first of the panel below) has an all-zero column: no reflector.
+    for (int i = 7; i < n; ++i) {
+        base[7 * n + i] = 0.0;
+    }
+    std::vector<double> up(n, 0.0), b(n, 0.0), T(ldt * ldt, 0.0);
+
+    KernelIsa previous = active_kernels().isa;
+    select_kernel_isa(KernelIsa::scalar);
+    complete_task1(base.data(), n, n, 7, 7 + alpha, 7, 7 + alpha, up.data(), b.data());
+    select_kernel_isa(previous);
+    build_wy_factor(base.data(), n, 7, 7 + alpha, up.data(), b.data(), T.data(), ldt);
+    CHECK(T[0] == 0.0 && T[ldt + 1] != 0.0, "Only the degenerate pivot should have tau == 0", errors);
+
+    std::vector<double> ref = base;
+    scalar.apply(ref.data(), n, 7, 7 + alpha, 20, 31, up.data(), b.data());
+
+    for (KernelIsa isa : isas) {
+        if (!kernel_isa_supported(isa)) {
+            continue;
+        }
+        std::vector<double> blocked = base;
+        make_kernel_set(isa).apply_wy(blocked.data(), n, 7, 7 + alpha, 20, 31, up.data(), T.data(), ldt);
+
+        double max_diff = 0.0;
+        for (size_t i = 0; i < ref.size(); ++i) {
+            max_diff = std::max(max_diff, std::fabs(ref[i] - blocked[i]));
+        }
+        CHECK(max_diff <= 1e-12, std::string(kernel_isa_name(isa)) + " WY application should match", errors);
+    }
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[KN3]. Test Compact-WY Type-2 Kernel."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[KN3]. Test Compact-WY Type-2 Kernel."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 4: The tile kernels produce the same factorization steps as the
+// row-major ones, with tiles that split both the panel and the rows' columns.
+void test_kernel_tiled() {
+    std::stringstream errors;
+
+    const int n = 83;
+    const int alpha = 6;
+    const int ldt = alpha + 1;
+    const KernelIsa isas[] = {KernelIsa::scalar, KernelIsa::avx2, KernelIsa::avx512};
+    const std::vector<double> base = make_test_matrix(n, 31);
+    KernelIsa previous = active_kernels().isa;
+
+    for (KernelIsa isa : isas) {
+        if (!kernel_isa_supported(isa)) {
+            continue;
+        }
+        select_kernel_isa(isa);
+        const std::string name = kernel_isa_name(isa);
+
+        std::vector<double> ref = base;
+        std::vector<double> up_ref(n, 0.0), b_ref(n, 0.0), T_ref(ldt * ldt, 0.0);
+        matrix_t<double> mat(n, n);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                mat.set(i, j, base[i * n + j]);
+            }
+        }
+        mat.to_tiled(5, 7);
+        TiledView tiles{mat.data_ptr(), n, mat.tile_rows(), mat.tile_cols(), mat.tiles_per_row(), mat.tile_stride()};
+        std::vector<double> up(n, 0.0), b(n, 0.0), T(ldt * ldt, 0.0);
+
+        // Panel [7, 13) with its diagonal tile up to row 19, then rows [20, 31).
+        complete_task1(ref.data(), n, n, 7, 7 + alpha, 7, 19, up_ref.data(), b_ref.data());
+        build_wy_factor(ref.data(), n, 7, 7 + alpha, up_ref.data(), b_ref.data(), T_ref.data(), ldt);
+        complete_task2_wy(ref.data(), n, n, 7, 7 + alpha, 20, 31, up_ref.data(), T_ref.data(), ldt);
+
+        complete_task1(tiles, 7, 7 + alpha, 7, 19, up.data(), b.data());
+        build_wy_factor(tiles, 7, 7 + alpha, up.data(), b.data(), T.data(), ldt);
+        complete_task2_wy(tiles, 7, 7 + alpha, 20, 31, up.data(), T.data(), ldt);
+
+        double max_diff = 0.0;
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                max_diff = std::max(max_diff, std::fabs(ref[i * n + j] - mat(i, j)));
+            }
+        }
+        for (int p = 0; p < ldt * ldt; ++p) {
+            max_diff = std::max(max_diff, std::fabs(T_ref[p] - T[p]));
+        }
+        for (int p = 7; p < 7 + alpha; ++p) {
+            max_diff = std::max(max_diff, std::fabs(up_ref[p] - up[p]) + std::fabs(b_ref[p] - b[p]));
+        }
+        CHECK(max_diff <= 1e-12, name + " tile kernels should match the row-major kernels", errors);
+    }
+    select_kernel_isa(previous);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[KN4]. Test Tiled-Layout Kernels."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[KN4]. Test Tiled-Layout Kernels."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Factorizes the m x n row-major a in place panel by panel, as the drivers
+// do but sequentially, in the precision of a.
+template <class Real>
+static void factor_panels(std::vector<Real>& a, int m, int n, int alpha, bool wy, std::vector<Real>& up,
+                          std::vector<Real>& b) {
+    const int pivots = std::min(m, n), ldt = alpha + 1;
+    std::vector<Real> T((size_t)ldt * ldt);
+    up.assign(m, 0);
+    b.assign(m, 0);
+    for (int row_start = 1; row_start < pivots; row_start += alpha) {
+        const int row_end = std::min(row_start + alpha, pivots);
+        complete_task1(a.data(), m, n, row_start, row_end, row_start, row_end, up.data(), b.data());
+        if (wy) {
+            build_wy_factor(a.data(), n, row_start, row_end, up.data(), b.data(), T.data(), ldt);
+            complete_task2_wy(a.data(), m, n, row_start, row_end, row_end, m, up.data(), T.data(), ldt);
+        } else {
+            complete_task2(a.data(), m, n, row_start, row_end, row_end, m, up.data(), b.data());
+        }
+    }
+}
+
+// Test 5: The float kernels of every supported ISA factorize like the double
+// ones to single-precision accuracy, and select_kernel_isa() switches both.
+void test_kernel_float() {
+    std::stringstream errors;
+
+    const int m = 45, n = 70, alpha = 4;
+    std::vector<double> mat((size_t)m * n);
+    for (size_t k = 0; k < mat.size(); ++k) {
+        mat[k] = std::sin(0.7 * k) + (k % (n + 1) == 0 ? 2.0 : 0.0);
+    }
+    std::vector<double> ref = mat, up_ref, b_ref;
+    factor_panels(ref, m, n, alpha, true, up_ref, b_ref);
+    double scale = 0.0;
+    for (double v : ref) scale = std::max(scale, std::fabs(v));
+
+    KernelIsa previous = active_kernels().isa;
+    const KernelIsa isas[] = {KernelIsa::scalar, KernelIsa::avx2, KernelIsa::avx512};
+    for (KernelIsa isa : isas) {
+        if (!select_kernel_isa(isa)) {
+            continue;
+        }
+        const std::string name = kernel_isa_name(isa);
+        CHECK(active_kernels<float>().isa == isa, name + " should be selected for float too", errors);
+        for (bool wy : {false, true}) {
+            std::vector<float> single(mat.begin(), mat.end()), up, b;
+            factor_panels(single, m, n, alpha, wy, up, b);
+            double max_diff = 0.0;
+            for (size_t k = 0; k < ref.size(); ++k) {
+                max_diff = std::max(max_diff, std::fabs(ref[k] - single[k]));
+            }
+            CHECK(max_diff <= 1e-4 * scale, name + (wy ? " WY" : " reflector") +
+                  " float factorization should match double to single precision", errors);
+        }
+    }
+    select_kernel_isa(previous);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[KN5]. Test Single-Precision Kernels."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[KN5]. Test Single-Precision Kernels."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Autotune Tests ========================= //
+
+// Test 1: Candidates fit the matrix and the model prefers parallel work.
+void test_autotune_model() {
+    std::stringstream errors;
+
+    const std::vector<std::pair<int, int>> shapes = tune_candidates(100, 120);
+    CHECK(!shapes.empty(), "A 100 x 120 matrix should have candidates", errors);
+    for (auto [alpha, beta] : shapes) {
+        CHECK(beta % alpha == 0 && 3 * beta + 1 <= 100, "Candidates should fit the matrix", errors);
+    }
+    CHECK(tune_candidates(6, 6).empty() && tune_candidates(500, 6).empty(),
+          "A matrix with few pivots should have no candidates", errors);
+
+    const double one = predict_factorization_ns(1024, 1024, 16, 32, 1, 1000, 500);
+    const double four = predict_factorization_ns(1024, 1024, 16, 32, 4, 1000, 500);
+    CHECK(one > 0 && four < one, "More threads should predict a shorter run", errors);
+    CHECK(predict_factorization_ns(1024, 1024, 16, 32, 4, 2000, 500) > four,
+          "Slower tasks should predict a longer run", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[AT1]. Test Autotune Candidates And Model."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[AT1]. Test Autotune Candidates And Model."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 2: Trials pick a candidate, the cache round-trips, and the matrix is untouched.
+void test_autotune_cache() {
+    std::stringstream errors;
+
+    const int m = 100, n = 130;
+    std::vector<double> mat((size_t)m * n);
+    for (size_t k = 0; k < mat.size(); k++) {
+        mat[k] = std::sin(0.37 * k) + (k % (n + 1) == 0 ? 2.0 : 0.0);
+    }
+    const std::vector<double> original = mat;
+    const std::string path = "autotune_test_cache.txt";
+    {
+        std::ofstream out(path);
+        out << "# comment\n" << "garbage line\n" << m << " " << n << " 2 wy 3 4 1.0 cpu\n";
+    }
+
+    TuneChoice choice = autotune_tiles(mat.data(), m, n, 2, true, path);
+    const std::vector<std::pair<int, int>> shapes = tune_candidates(m, n);
+    CHECK(!choice.from_cache && std::find(shapes.begin(), shapes.end(), std::make_pair(choice.alpha, choice.beta))
+          != shapes.end(), "Trials should pick one of the candidates", errors);
+    CHECK(mat == original, "Trials should not modify the matrix", errors);
+
+    TuneChoice cached = autotune_tiles(mat.data(), m, n, 2, true, path);
+    CHECK(cached.from_cache && cached.alpha == choice.alpha && cached.beta == choice.beta,
+          "The second run should hit the cache", errors);
+    TuningCache cache(path);
+    TuneChoice other;
+    CHECK(!cache.lookup(m, n, 4, "wy", cpu_model_name(), other) && !cache.lookup(n, m, 2, "wy", cpu_model_name(), other)
+          && !cache.lookup(m, n, 2, "wy", "cpu", other),
+          "Lookups should match threads and a valid entry only", errors);
+    std::remove(path.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[AT2]. Test Autotune Trials And Cache."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[AT2]. Test Autotune Trials And Cache."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= TSQR Tests ========================= //
+
+// Test 1: The reduction tree reproduces M M^T for several thread counts,
+// leaf widths and type-2 kernels, without touching the matrix.
+void test_tsqr() {
+    std::stringstream errors;
+
+    const int m = 11, n = 203;
+    std::vector<double> mat((size_t)m * n);
+    for (size_t k = 0; k < mat.size(); ++k) {
+        mat[k] = std::cos(0.29 * k) + (k % (n + 1) == 0 ? 1.0 : 0.0);
+    }
+    const std::vector<double> original = mat;
+
+    const int threads[] = {1, 2, 3, 4};
+    const int leaves[] = {5, 16, 400};
+    for (int t : threads) {
+        for (int leaf : leaves) {
+            for (bool wy : {false, true}) {
+                const std::vector<double> L = tsqr(mat.data(), m, n, t, leaf, 4, wy);
+                const double err = gram_error(L, mat.data(), m, n);
+                bool lower = true;
+                for (int r = 0; r < m; ++r) {
+                    for (int c = r + 1; c < m; ++c) lower = lower && L[(size_t)r * m + c] == 0.0;
+                }
+                CHECK(err < 1e-12 && lower, std::to_string(t) + " threads, leaf " + std::to_string(leaf)
+                      + " should give a lower-triangular L with L L^T = M M^T", errors);
+            }
+        }
+    }
+    CHECK(mat == original, "tsqr should not modify the matrix", errors);
+
+    CHECK(tsqr_num_leaves(203, 1, 16) == 13 && tsqr_num_leaves(203, 4, 16) == 16 && tsqr_num_leaves(10, 4, 400) == 4,
+          "tsqr_num_leaves should count every worker's leaves", errors);
+    CHECK(tsqr_tree_depth(1) == 0 && tsqr_tree_depth(2) == 1 && tsqr_tree_depth(5) == 3 && tsqr_tree_depth(8) == 3,
+          "tsqr_tree_depth should be ceil(log2(threads))", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[TS1]. Test TSQR Reduction Tree."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[TS1]. Test TSQR Reduction Tree."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Least Squares Tests ========================= //
+
+// Test 1: Direct solves recover x from a consistent system, and mixed
+// precision refinement of a large-residual problem reaches the double solve.
+void test_least_squares() {
+    std::stringstream errors;
+
+    const int m = 24, n = 61, alpha = 4;
+    matrix_t<double> M(m, n);
+    for (int k = 0; k < m; ++k) {
+        for (int i = 0; i < n; ++i) {
+            M(k, i) = std::cos(0.37 * (k * n + i)) + (k == i ? 1.0 : 0.0);
+        }
+    }
+    std::vector<double> x_true(m), consistent(n, 0.0), noisy(n);
+    for (int k = 0; k < m; ++k) {
+        x_true[k] = 1.0 + 0.25 * k;
+        for (int i = 0; i < n; ++i) consistent[i] += M(k, i) * x_true[k];
+    }
+    for (int i = 0; i < n; ++i) noisy[i] = consistent[i] + 3.0 * std::sin(1.3 * i);
+
+    matrix_t<float> M_f;
+    M_f.assign_converted(M);
+    CHECK(M_f.rows() == m && M_f.cols() == n && M_f(3, 5) == static_cast<float>(M(3, 5)),
+          "assign_converted should copy and round every element", errors);
+
+    std::vector<double> factor(M.data_ptr(), M.data_ptr() + (size_t)m * n), up, b;
+    std::vector<float> factor_f(M_f.data_ptr(), M_f.data_ptr() + (size_t)m * n), up_f, b_f;
+    factor_panels(factor, m, n, alpha, true, up, b);
+    factor_panels(factor_f, m, n, alpha, true, up_f, b_f);
+
+    auto max_rel_diff = [](const std::vector<double>& x, const std::vector<double>& ref) {
+        double diff = 0.0, scale = 0.0;
+        for (size_t k = 0; k < x.size(); ++k) {
+            diff = std::max(diff, std::fabs(x[k] - ref[k]));
+            scale = std::max(scale, std::fabs(ref[k]));
+        }
+        return diff / scale;
+    };
+
+    std::vector<double> x(m), x_f(m), x_mixed(m), x_ref(m);
+    lstsq_solve(factor.data(), m, n, up.data(), b.data(), consistent.data(), x.data());
+    lstsq_solve(factor_f.data(), m, n, up_f.data(), b_f.data(), consistent.data(), x_f.data());
+    CHECK(max_rel_diff(x, x_true) < 1e-13, "The double solve should recover x", errors);
+    CHECK(max_rel_diff(x_f, x_true) < 1e-5 && max_rel_diff(x_f, x_true) > 1e-12,
+          "The float solve should recover x to single precision", errors);
+
+    // The Q from the reflectors is orthogonal: Q Q^T y == y.
+    std::vector<double> y = noisy;
+    apply_qt(factor.data(), m, n, up.data(), b.data(), y.data());
+    apply_q(factor.data(), m, n, up.data(), b.data(), y.data());
+    CHECK(max_rel_diff(y, noisy) < 1e-14, "apply_q should undo apply_qt", errors);
+
+    lstsq_solve(factor.data(), m, n, up.data(), b.data(), noisy.data(), x_ref.data());
+    RefineResult result = lstsq_refine(M.data_ptr(), factor_f.data(), m, n, up_f.data(), b_f.data(), noisy.data(),
+                                       x_mixed.data());
+    CHECK(result.converged && result.iterations >= 2 && result.iterations <= REFINE_MAX_ITERATIONS,
+          "Refinement should converge in a few steps", errors);
+    CHECK(max_rel_diff(x_mixed, x_ref) < 1e-13, "Refinement should reach the double solution", errors);
+    CHECK(result.residual > 1.0, "The noisy problem should keep a large residual", errors);
+
+    bool rejected = false;
+    try {
+        check_lstsq_shape(n, m);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    CHECK(rejected, "More rows than columns should be rejected", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[LS1]. Test Least Squares And Refinement."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[LS1]. Test Least Squares And Refinement."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 2: QApplier transforms and solves blocks of right-hand sides like the
+// one-vector routines, independently of the thread count.
+void test_q_applier() {
+    std::stringstream errors;
+
+    struct Shape { int m, n, alpha; };
+    const Shape shapes[] = {{24, 61, 4}, {70, 70, 8}, {40, 100, 3}};
+    const int nrhs = 19;
+    for (const Shape& sh : shapes) {
+        const int m = sh.m, n = sh.n;
+        const std::string name = std::to_string(m) + "x" + std::to_string(n);
+        std::vector<double> factor((size_t)m * n), up, b;
+        for (size_t k = 0; k < factor.size(); ++k) {
+            factor[k] = std::sin(0.91 * k) + (k % (n + 1) == 0 ? 2.0 : 0.0);
+        }
+        factor_panels(factor, m, n, sh.alpha, true, up, b);
+        std::vector<float> factor_f(factor.begin(), factor.end()), up_f(up.begin(), up.end()),
+            b_f(b.begin(), b.end());
+
+        // Right-hand sides with a padded leading dimension.
+        const int ld = n + 3;
+        std::vector<double> B((size_t)nrhs * ld, -7.0);
+        for (int r = 0; r < nrhs; ++r) {
+            for (int i = 0; i < n; ++i) {
+                B[(size_t)r * ld + i] = std::cos(0.13 * (r * n + i)) + r;
+            }
+        }
+
+        QApplier<double> q1(factor.data(), m, n, up.data(), b.data(), 1), q4(factor.data(), m, n, up.data(),
+                                                                              b.data(), 4);
+        std::vector<double> Y = B, Y4 = B;
+        q1.apply_qt(Y.data(), nrhs, ld);
+        q4.apply_qt(Y4.data(), nrhs, ld);
+        CHECK(Y == Y4, name + ": threads should not change Q^T Y", errors);
+        double diff = 0.0;
+        for (int r = 0; r < nrhs; ++r) {
+            std::vector<double> y(B.begin() + (size_t)r * ld, B.begin() + (size_t)r * ld + n);
+            apply_qt(factor.data(), m, n, up.data(), b.data(), y.data());
+            for (int i = 0; i < n; ++i) {
+                diff = std::max(diff, std::fabs(y[i] - Y[(size_t)r * ld + i]));
+            }
+        }
+        CHECK(diff < 1e-12 * nrhs, name + ": the block Q^T should match apply_qt", errors);
+        CHECK(Y[(size_t)ld - 1] == -7.0, name + ": padding should not be touched", errors);
+        q4.apply_q(Y.data(), nrhs, ld);
+        diff = 0.0;
+        for (size_t k = 0; k < B.size(); ++k) {
+            diff = std::max(diff, std::fabs(Y[k] - B[k]));
+        }
+        CHECK(diff < 1e-12 * nrhs, name + ": Q should undo Q^T", errors);
+
+        if (m <= n) {
+            std::vector<double> X((size_t)nrhs * m), x(m);
+            q4.solve(B.data(), nrhs, ld, X.data(), m);
+            std::vector<double> X_f((size_t)nrhs * m);
+            QApplier<float>(factor_f.data(), m, n, up_f.data(), b_f.data(), 3).solve(B.data(), nrhs, ld, X_f.data(),
+                                                                                   m);
+            double diff_f = 0.0, scale = 0.0;
+            diff = 0.0;
+            for (int r = 0; r < nrhs; ++r) {
+                lstsq_solve(factor.data(), m, n, up.data(), b.data(), B.data() + (size_t)r * ld, x.data());
+                for (int k = 0; k < m; ++k) {
+                    diff = std::max(diff, std::fabs(x[k] - X[(size_t)r * m + k]));
+                    diff_f = std::max(diff_f, std::fabs(x[k] - X_f[(size_t)r * m + k]));
+                    scale = std::max(scale, std::fabs(x[k]));
+                }
+            }
+            CHECK(diff < 1e-12 * scale, name + ": the block solve should match lstsq_solve", errors);
+            CHECK(diff_f < 1e-3 * scale, name + ": the float block solve should match to single precision", errors);
+        }
+    }
+
+    // A zero pivot is reported before any worker starts.
+    std::vector<double> singular(4 * 6, 1.0), up(4, 1.0), b(4, 0.0), X(4), rhs(6, 1.0);
+    singular[2 * 6 + 2] = 0.0;
+    bool rejected = false;
+    try {
+        QApplier<double>(singular.data(), 4, 6, up.data(), b.data(), 2).solve(rhs.data(), 1, 6, X.data(), 4);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    CHECK(rejected, "A singular R should be rejected", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[LS2]. Test Block Q Application And Solves."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[LS2]. Test Block Q Application And Solves."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Distributed Tests ========================= //
+
+// One simulated rank of mpi_main.cpp: a full copy of the matrix, of which it
+// only factorizes its own row blocks.
+struct SimRank {
+    std::vector<double> mat, up, b, T;
+    TaskTable table;
+    std::deque<Task*> ready;
+    std::deque<std::vector<double>> inbox;
+    int done = 0;
+    int received = 0;
+};
+
+// Runs the m x n matrix through ranks simulated ranks, exchanging panels as
+// messages, and returns the rows gathered from their owners. received gets
+// the panel messages each rank took in.
+static std::vector<double> simulate_ranks(const std::vector<double>& a, int m, int n, int alpha, int beta, int ranks,
+                                          bool wy, TaskGraphMode mode, std::vector<int>& received) {
+    const int rows = TaskTable::task_rows(m, beta), cols = TaskTable::task_cols(m, n, alpha), ldt = alpha + 1;
+    const int pivots = std::min(m, n);
+    matrix_t<double> shape(m, n);
+    std::vector<SimRank> sim(ranks);
+    for (int r = 0; r < ranks; ++r) {
+        sim[r].mat = a;
+        sim[r].up.assign(m, 0.0);
+        sim[r].b.assign(m, 0.0);
+        sim[r].T.assign((size_t)cols * ldt * ldt, 0.0);
+        sim[r].table.init(rows, cols, alpha, beta, shape, mode);
+        sim[r].table.setRowOwner(ranks, r);
+    }
+    sim[0].ready.push_back(sim[0].table.getTask(0, 0));
+
+    bool busy = true;
+    while (busy) {
+        busy = false;
+        for (int r = 0; r < ranks; ++r) {
+            SimRank& s = sim[r];
+            RowBlockCyclic dist(ranks, r, rows, beta, m);
+            auto push = [&s](Task* next) { s.ready.push_back(next); };
+            while (!s.inbox.empty()) {
+                const std::vector<double>& msg = s.inbox.front();
+                int j = unpack_panel(msg.data(), msg.size(), s.mat.data(), n, alpha, pivots, s.up.data(),
+                                     s.b.data(), s.T.data(), ldt, wy);
+                s.table.releasePanel(j / (beta / alpha), j, push);
+                s.inbox.pop_front();
+                s.received++;
+                busy = true;
+            }
+            if (s.ready.empty()) {
+                continue;
+            }
+            Task* t = s.ready.front();
+            s.ready.pop_front();
+            const int i = t->chunk_idx_i, j = t->chunk_idx_j, type = t->type;
+            double* T = s.T.data() + (size_t)j * ldt * ldt;
+            if (type == 1) {
+                complete_task1(s.mat.data(), m, n, t->row_start, t->row_end, t->col_start, t->col_end,
+                               s.up.data(), s.b.data());
+                if (wy) {
+                    build_wy_factor(s.mat.data(), n, t->row_start, t->row_end, s.up.data(), s.b.data(), T, ldt);
+                }
+            } else if (wy) {
+                complete_task2_wy(s.mat.data(), m, n, t->row_start, t->row_end, t->col_start, t->col_end,
+                                  s.up.data(), T, ldt);
+            } else {
+                complete_task2(s.mat.data(), m, n, t->row_start, t->row_end, t->col_start, t->col_end,
+                               s.up.data(), s.b.data());
+            }
+            s.table.releaseSuccessors(t, push);
+            if (type == 1) {
+                int begin, end;
+                panel_rows(j, alpha, pivots, begin, end);
+                std::vector<double> msg;
+                pack_panel(s.mat.data(), n, j, begin, end, s.up.data(), s.b.data(), T, ldt, wy, msg);
+                for (int receiver : dist.panel_receivers(i)) {
+                    sim[receiver].inbox.push_back(msg);
+                }
+            }
+            s.done++;
+            busy = true;
+        }
+    }
+
+    std::vector<double> result((size_t)m * n, 0.0);
+    RowBlockCyclic dist(ranks, 0, rows, beta, m);
+    received.clear();
+    for (int r = 0; r < ranks; ++r) {
+        received.push_back(sim[r].done == sim[r].table.ownedTasks() ? sim[r].received : -1);
+    }
+    for (int i = 0; i < rows; ++i) {
+        const std::vector<double>& owner = sim[dist.owner(i)].mat;
+        std::copy(owner.begin() + (size_t)dist.block_begin(i) * n, owner.begin() + (size_t)dist.block_end(i) * n,
+                  result.begin() + (size_t)dist.block_begin(i) * n);
+    }
+    return result;
+}
+
+// Test 1: Row blocks spread over simulated ranks, which only run their own
+// task rows and exchange factorized panels as messages, give the same result
+// as one process, bit for bit.
+void test_distributed_factorization() {
+    std::stringstream errors;
+
+    RowBlockCyclic dist(3, 1, 8, 4, 30);
+    CHECK(dist.owns(4) && !dist.owns(5) && dist.owned_blocks() == 3 && dist.block_begin(0) == 0 &&
+          dist.block_begin(1) == 5 && dist.block_end(7) == 30, "Block-cyclic ownership and bounds", errors);
+    CHECK(dist.panel_receivers(5) == std::vector<int>({0, 1}) && dist.panel_receivers(6) == std::vector<int>({1}) &&
+          dist.panel_receivers(7).empty(), "Panels go to the owners of the blocks below", errors);
+    CHECK(dist.owned_blocks_below(0) == 3 && dist.owned_blocks_below(4) == 1 && dist.owned_blocks_below(7) == 0,
+          "Owned blocks below a panel", errors);
+
+    struct Shape { int m, n, alpha, beta; };
+    const Shape shapes[] = {{70, 70, 4, 8}, {45, 90, 2, 8}, {90, 45, 4, 4}};
+    for (const Shape& sh : shapes) {
+        std::vector<double> a((size_t)sh.m * sh.n);
+        for (size_t k = 0; k < a.size(); ++k) {
+            a[k] = std::sin(1.1 * k) + std::cos(0.05 * k);
+        }
+        for (bool wy : {true, false}) {
+            std::vector<int> received;
+            const std::vector<double> ref = simulate_ranks(a, sh.m, sh.n, sh.alpha, sh.beta, 1, wy,
+                                                           TaskGraphMode::eager, received);
+            for (int ranks : {2, 3, 5}) {
+                for (TaskGraphMode mode : {TaskGraphMode::eager, TaskGraphMode::lazy}) {
+                    const std::string name = std::to_string(sh.m) + "x" + std::to_string(sh.n) + " on " +
+                                             std::to_string(ranks) + " ranks (" + task_graph_mode_name(mode) +
+                                             (wy ? ", wy)" : ", reflectors)");
+                    const std::vector<double> got = simulate_ranks(a, sh.m, sh.n, sh.alpha, sh.beta, ranks, wy,
+                                                                   mode, received);
+                    CHECK(std::find(received.begin(), received.end(), -1) == received.end(),
+                          name + ": every rank should run all of its tasks", errors);
+                    CHECK(got == ref, name + " should match one process", errors);
+                }
+            }
+        }
+    }
+
+    // Released rows read as zeros; the pages a range only partly covers keep
+    // their data.
+    const int n = 1000, m = 64;
+    std::vector<double> big((size_t)m * n, 1.0);
+    const size_t bytes = release_rows(big.data(), n, 10, 40);
+    CHECK(bytes > 0 && bytes <= 30 * n * sizeof(double), "release_rows should release whole pages", errors);
+    CHECK(big[(size_t)20 * n] == 0.0, "Released rows should read as zeros", errors);
+    CHECK(big[(size_t)10 * n - 1] == 1.0 && big[(size_t)40 * n] == 1.0, "Rows outside the range should be kept",
+          errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DS1]. Test Distributed Row-Block Factorization."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DS1]. Test Distributed Row-Block Factorization."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Device Tests ========================= //
+
+// Runs the m x n matrix serially the way main.cpp does with --device: CPU
+// tasks one at a time on a, the ready tasks of the device row blocks in
+// batches of up to batch on a DeviceRows copy. Returns a, or an empty vector
+// if some task never ran.
+static std::vector<double> run_hybrid(std::vector<double> a, int m, int n, int alpha, int beta, int share, int batch,
+                                      bool wy, TaskGraphMode mode, size_t& device_tasks) {
+    const int rows = TaskTable::task_rows(m, beta), cols = TaskTable::task_cols(m, n, alpha), ldt = alpha + 1;
+    matrix_t<double> shape(m, n);
+    TaskTable table(rows, cols, alpha, beta, shape, mode);
+    std::vector<double> up(m, 0.0), b(m, 0.0), T((size_t)cols * ldt * ldt, 0.0);
+    const DeviceSplit split{share, beta / alpha, cols};
+    DeviceRows<double> device;
+    device.init(share > 0 ? DeviceKind::host : DeviceKind::none, split, a.data(), m, n, beta, ldt, wy);
+
+    std::deque<Task*> cpu, gpu;
+    auto push = [&](Task* next) { (split.takes(next) ? gpu : cpu).push_back(next); };
+    cpu.push_back(table.getTask(0, 0));
+    int done = 0;
+    device_tasks = 0;
+    while (!cpu.empty() || !gpu.empty()) {
+        if (!gpu.empty()) {
+            std::vector<Task*> run;
+            while (!gpu.empty() && (int)run.size() < batch) {
+                run.push_back(gpu.front());
+                gpu.pop_front();
+            }
+            for (Task* t : run) {
+                device.enqueue(t, a.data(), up.data(), b.data(), wy ? T.data() : nullptr);
+            }
+            device.synchronize();
+            for (Task* t : run) {
+                device.finish(t, a.data());
+                table.releaseSuccessors(t, push);
+            }
+            device_tasks += run.size();
+            done += run.size();
+            continue;
+        }
+        Task* t = cpu.front();
+        cpu.pop_front();
+        double* Tj = T.data() + (size_t)t->chunk_idx_j * ldt * ldt;
+        if (t->type == 1) {
+            complete_task1(a.data(), m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), b.data());
+            if (wy) {
+                build_wy_factor(a.data(), n, t->row_start, t->row_end, up.data(), b.data(), Tj, ldt);
+            }
+        } else if (wy) {
+            complete_task2_wy(a.data(), m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), Tj,
+                              ldt);
+        } else {
+            complete_task2(a.data(), m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), b.data());
+        }
+        table.releaseSuccessors(t, push);
+        done++;
+    }
+    return done == table.numTasks() ? a : std::vector<double>();
+}
+
+// Test 1: Row blocks kept on a (host) device, which runs their type-2 tasks
+// in batches and only exchanges panels and finished blocks with the host,
+// give the CPU-only result bit for bit.
+void test_device_offload() {
+    std::stringstream errors;
+
+    const DeviceSplit half{50, 2, 10}, all{100, 2, 10}, none{0, 2, 10};
+    CHECK(!half.on_device(0) && !half.on_device(1) && half.on_device(2) && !half.on_device(3) && half.on_device(4),
+          "A 50% share should take every other row block", errors);
+    CHECK(!all.on_device(0) && all.on_device(1) && all.on_device(7) && !none.on_device(3),
+          "Block 0 never goes to the device", errors);
+    CHECK(all.leaves_device(3, 5) && !all.leaves_device(3, 4) && all.leaves_device(8, 9),
+          "A block leaves the device after its last type-2 task", errors);
+
+    struct Shape { int m, n, alpha, beta; };
+    const Shape shapes[] = {{70, 70, 4, 8}, {45, 90, 2, 8}, {90, 45, 4, 4}};
+    for (const Shape& sh : shapes) {
+        std::vector<double> a((size_t)sh.m * sh.n);
+        for (size_t k = 0; k < a.size(); ++k) {
+            a[k] = std::sin(0.7 * k) + std::cos(0.03 * k);
+        }
+        for (bool wy : {true, false}) {
+            size_t device_tasks = 0;
+            const std::vector<double> ref = run_hybrid(a, sh.m, sh.n, sh.alpha, sh.beta, 0, 1, wy,
+                                                       TaskGraphMode::eager, device_tasks);
+            for (int share : {30, 100}) {
+                for (int batch : {1, 7}) {
+                    const TaskGraphMode mode = batch == 1 ? TaskGraphMode::eager : TaskGraphMode::lazy;
+                    const std::string name = std::to_string(sh.m) + "x" + std::to_string(sh.n) + ", " +
+                                             std::to_string(share) + "% on the device in batches of " +
+                                             std::to_string(batch) + (wy ? " (wy)" : " (reflectors)");
+                    const std::vector<double> got = run_hybrid(a, sh.m, sh.n, sh.alpha, sh.beta, share, batch, wy,
+                                                               mode, device_tasks);
+                    CHECK(device_tasks > 0, name + ": the device should run tasks", errors);
+                    CHECK(!got.empty() && got == ref, name + " should match the CPU", errors);
+                }
+            }
+        }
+    }
+
+    CHECK(make_device_backend<double>(DeviceKind::none) == nullptr, "No backend without a device", errors);
+#ifndef PARQR_CUDA
+    bool rejected = false;
+    try {
+        make_device_backend<double>(DeviceKind::cuda);
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    CHECK(rejected, "A build without CUDA should reject the cuda device", errors);
+#endif
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[DV1]. Test Hybrid Device Offload."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[DV1]. Test Hybrid Device Offload."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Out-of-Core Tests ========================= //
+
+// Factorizes the binary matrix file input out of core into output, with one
+// worker on this thread and the I/O thread alongside. Returns false if a task
+// was lost.
+static bool run_out_of_core(OutOfCoreMatrix& ooc, const std::string& input, const std::string& output, int alpha,
+                            int beta, bool wy, size_t budget, TaskGraphMode mode) {
+    ooc.open(input, 0, output, "", alpha, beta, budget);
+    const int m = ooc.rows(), n = ooc.cols(), ldt = alpha + 1;
+    const int rows = TaskTable::task_rows(m, beta), cols = TaskTable::task_cols(m, n, alpha);
+    TaskTable table;
+    table.init(rows, cols, alpha, beta, m, n, mode);
+    std::vector<double> up(m, 0.0), b(m, 0.0), T((size_t)cols * ldt * ldt, 0.0);
+    double* a = ooc.data();
+
+    std::mutex mutex;
+    std::deque<Task*> ready;
+    auto push = [&](Task* t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.push_back(t);
+    };
+    if (ooc.admit(table.getTask(0, 0))) {
+        push(table.getTask(0, 0));
+    }
+    std::thread io([&] { ooc.run(push); });
+
+    int done = 0;
+    while (done < table.numTasks()) {
+        Task* t = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ready.empty()) {
+                t = ready.front();
+                ready.pop_front();
+            }
+        }
+        if (t == nullptr) {
+            std::this_thread::yield();
+            continue;
+        }
+        double* Tj = T.data() + (size_t)t->chunk_idx_j * ldt * ldt;
+        if (t->type == 1) {
+            complete_task1(a, m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), b.data());
+            if (wy) {
+                build_wy_factor(a, n, t->row_start, t->row_end, up.data(), b.data(), Tj, ldt);
+            }
+        } else if (wy) {
+            complete_task2_wy(a, m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), Tj, ldt);
+        } else {
+            complete_task2(a, m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), b.data());
+        }
+        ooc.retire(t);
+        table.releaseSuccessors(t, [&](Task* next) {
+            if (ooc.admit(next)) {
+                push(next);
+            }
+        });
+        done++;
+    }
+    io.join();
+    return ready.empty();
+}
+
+// Test 1: Factorizing from a working file, a few row blocks at a time, gives
+// the in-core result bit for bit and keeps to the memory budget.
+void test_out_of_core() {
+    std::stringstream errors;
+    const std::string input = "test_ooc_in.bin", output = "test_ooc_out.bin";
+
+    struct Shape { int m, n, alpha, beta; };
+    const Shape shapes[] = {{70, 70, 4, 8}, {45, 90, 2, 8}, {90, 45, 4, 4}};
+    for (const Shape& sh : shapes) {
+        matrix_t<double> mat(sh.m, sh.n);
+        std::vector<double> a((size_t)sh.m * sh.n);
+        for (size_t k = 0; k < a.size(); ++k) {
+            a[k] = std::sin(0.7 * k) + std::cos(0.03 * k);
+        }
+        std::copy(a.begin(), a.end(), mat.data_ptr());
+        mat.save_binary(input);
+        const size_t block = (size_t)(sh.beta + 1) * sh.n * sizeof(double);
+        const int blocks = TaskTable::task_rows(sh.m, sh.beta);
+
+        for (bool wy : {true, false}) {
+            size_t device_tasks = 0;
+            const std::vector<double> ref = run_hybrid(a, sh.m, sh.n, sh.alpha, sh.beta, 0, 1, wy,
+                                                       TaskGraphMode::eager, device_tasks);
+            for (int slots : {3, 5, blocks}) {
+                const TaskGraphMode mode = slots == 5 ? TaskGraphMode::lazy : TaskGraphMode::eager;
+                const std::string name = std::to_string(sh.m) + "x" + std::to_string(sh.n) + " in " +
+                                         std::to_string(slots) + " blocks" + (wy ? " (wy)" : " (reflectors)");
+                OutOfCoreMatrix ooc;
+                const bool complete = run_out_of_core(ooc, input, output, sh.alpha, sh.beta, wy, slots * block, mode);
+                CHECK(complete, name + ": every task should run once", errors);
+                CHECK(ooc.window() == (slots == blocks ? blocks : slots - OOC_PIVOT_SLOTS),
+                      name + ": the window should fill the budget", errors);
+                CHECK(ooc.peak_resident <= slots * block, name + ": the budget should hold", errors);
+                CHECK(ooc.bytes_written == a.size() * sizeof(double), name + ": each block is written once", errors);
+                matrix_t<double> result;
+                result.read_binary(output);
+                CHECK(result.rows() == sh.m && result.cols() == sh.n &&
+                          std::equal(ref.begin(), ref.end(), result.data_ptr()),
+                      name + " should match the in-core result", errors);
+            }
+        }
+    }
+
+    // A budget without room for a window and the pivot blocks is rejected.
+    bool rejected = false;
+    try {
+        OutOfCoreMatrix ooc;
+        ooc.open(input, 0, output, "", 4, 4, 2 * 5 * 45 * sizeof(double));
+    } catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    CHECK(rejected, "A budget of two blocks should be rejected", errors);
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[OC1]. Test Out-of-Core Factorization."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[OC1]. Test Out-of-Core Factorization."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Engine Tests ========================= //
+
+// Test 1: QrEngine gives the result of a serial run of the task graph, for
+// repeated shapes that reuse a context and for concurrent callers that share
+// the pool.
+void test_qr_engine() {
+    std::stringstream errors;
+
+    struct Shape { int m, n; };
+    const Shape shapes[] = {{70, 70}, {45, 90}, {90, 45}, {1, 9}};
+    auto input = [](const Shape& sh, int seed) {
+        std::vector<double> a((size_t)sh.m * sh.n);
+        for (size_t k = 0; k < a.size(); ++k) {
+            a[k] = std::sin(0.7 * k + seed) + std::cos(0.03 * k);
+        }
+        return a;
+    };
+    auto to_matrix = [](const std::vector<double>& a, const Shape& sh) {
+        matrix_t<double> mat(sh.m, sh.n);
+        std::copy(a.begin(), a.end(), mat.data_ptr());
+        return mat;
+    };
+
+    for (bool wy : {true, false}) {
+        QrEngineOptions options;
+        options.threads = 3;
+        options.alpha = 4;
+        options.beta = 8;
+        options.type2 = wy ? Type2Mode::wy : Type2Mode::reflectors;
+        options.queue = wy ? QueuePolicy::fifo : QueuePolicy::priority;
+        options.graph = wy ? TaskGraphMode::eager : TaskGraphMode::lazy;
+        options.max_jobs = 2;
+        QrEngine engine(options);
+        CHECK(engine.threads() == 3, "The engine should start the requested workers", errors);
+
+        // Sequential calls, each shape twice.
+        for (int round = 0; round < 2; ++round) {
+            for (const Shape& sh : shapes) {
+                const std::string name = std::to_string(sh.m) + "x" + std::to_string(sh.n) + (wy ? " (wy)" : "") +
+                                         (round > 0 ? ", reused" : "");
+                const std::vector<double> a = input(sh, round);
+                size_t device_tasks = 0;
+                const std::vector<double> ref = run_hybrid(a, sh.m, sh.n, 4, 8, 0, 1, wy, TaskGraphMode::eager,
+                                                           device_tasks);
+                matrix_t<double> mat = to_matrix(a, sh);
+                std::vector<double> up, b;
+                engine.factor(mat, up, b);
+                CHECK(std::equal(ref.begin(), ref.end(), mat.data_ptr()), name + " should match a serial run",
+                      errors);
+                CHECK((int)up.size() == sh.m && (int)b.size() == sh.m, name + ": one scalar per row", errors);
+                if (sh.m <= sh.n && sh.m > 1) {
+                    // The reflector scalars solve the least-squares problem.
+                    std::vector<double> rhs(sh.n), x(sh.m), M(a);
+                    for (int k = 0; k < sh.n; ++k) {
+                        rhs[k] = std::cos(0.5 * k);
+                    }
+                    lstsq_solve(mat.data_ptr(), sh.m, sh.n, up.data(), b.data(), rhs.data(), x.data());
+                    // Normal equations: M (M^T x - b) = 0.
+                    double worst = 0.0, scale = 0.0;
+                    for (int i = 0; i < sh.m; ++i) {
+                        double g = 0.0;
+                        for (int k = 0; k < sh.n; ++k) {
+                            double r = -rhs[k];
+                            for (int l = 0; l < sh.m; ++l) {
+                                r += M[(size_t)l * sh.n + k] * x[l];
+                            }
+                            g += M[(size_t)i * sh.n + k] * r;
+                        }
+                        worst = std::max(worst, std::fabs(g));
+                        scale = std::max(scale, std::fabs(x[i]));
+                    }
+                    CHECK(worst < 1e-10 * std::max(1.0, scale) * sh.n, name + ": the solve should be accurate",
+                          errors);
+                }
+            }
+        }
+
+        // Concurrent callers, more than max_jobs of them.
+        const int clients = 4, calls = 5;
+        std::vector<int> wrong(clients, 0);
+        std::vector<std::thread> pool;
+        for (int c = 0; c < clients; ++c) {
+            pool.emplace_back([&, c] {
+                for (int k = 0; k < calls; ++k) {
+                    const Shape& sh = shapes[(c + k) % 3];
+                    const std::vector<double> a = input(sh, c * calls + k);
+                    size_t device_tasks = 0;
+                    const std::vector<double> ref = run_hybrid(a, sh.m, sh.n, 4, 8, 0, 1, wy, TaskGraphMode::eager,
+                                                               device_tasks);
+                    matrix_t<double> mat = to_matrix(a, sh);
+                    engine.factor(mat);
+                    wrong[c] += !std::equal(ref.begin(), ref.end(), mat.data_ptr());
+                }
+            });
+        }
+        for (std::thread& t : pool) {
+            t.join();
+        }
+        CHECK(std::all_of(wrong.begin(), wrong.end(), [](int w) { return w == 0; }),
+              std::string("Concurrent calls should match serial runs") + (wy ? " (wy)" : ""), errors);
+    }
+
+    auto rejects = [](QrEngineOptions options) {
+        try {
+            QrEngine engine(options);
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    QrEngineOptions bad_beta, bad_queue;
+    bad_beta.beta = 6;
+    bad_queue.queue = QueuePolicy::steal;
+    CHECK(rejects(bad_beta) && rejects(bad_queue), "Bad engine options should be rejected", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[EN1]. Test Resident Engine."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[EN1]. Test Resident Engine."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+void test_row_update() {
+    std::stringstream errors;
+
+    // Rows [first, first + count) of one well-conditioned pseudo-random
+    // matrix, so that batches of it can be appended in any order. The entries
+    // hash their indices in integers, so that every call site gives the same
+    // bits whatever the compiler contracts.
+    auto rows_of = [](int first, int count, int n) {
+        matrix_t<double> mat(count, n);
+        for (int i = 0; i < count; ++i) {
+            for (int j = 0; j < n; ++j) {
+                uint32_t h = (uint32_t)(first + i) * 2654435761u ^ ((uint32_t)j + 1) * 40503u;
+                h = (h ^ (h >> 15)) * 2246822519u;
+                h ^= h >> 13;
+                mat.data_ptr()[(size_t)i * n + j] = (h >> 8) / 16777216.0 - 0.5;
+            }
+        }
+        return mat;
+    };
+    // The factor of M is unique for the sign convention of the kernels, so
+    // an update should give the L of a refactorization, and the same
+    // least-squares solutions through its reflectors.
+    auto same_factorization = [](const matrix_t<double>& got, const std::vector<double>& got_up,
+                                 const std::vector<double>& got_b, const matrix_t<double>& want,
+                                 const std::vector<double>& want_up, const std::vector<double>& want_b) {
+        const int m = want.rows(), n = want.cols();
+        if (got.rows() != m || got.cols() != n || (int)got_up.size() != m || (int)got_b.size() != m) {
+            return false;
+        }
+        double worst = 0.0;
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j <= std::min(i, n - 1); ++j) {
+                worst = std::max(worst, std::fabs(got(i, j) - want(i, j)));
+            }
+        }
+        if (worst > 1e-10 * n) {
+            return false;
+        }
+        if (m > n || m < 2) {
+            return true;
+        }
+        std::vector<double> rhs(n), x(m), y(m);
+        for (int k = 0; k < n; ++k) {
+            rhs[k] = std::cos(0.5 * k);
+        }
+        lstsq_solve(got.data_ptr(), m, n, got_up.data(), got_b.data(), rhs.data(), x.data());
+        lstsq_solve(want.data_ptr(), m, n, want_up.data(), want_b.data(), rhs.data(), y.data());
+        for (int i = 0; i < m; ++i) {
+            if (std::fabs(x[i] - y[i]) > 1e-8 * std::max(1.0, std::fabs(y[i]))) {
+                return false;
+            }
+        }
+        return true;
+    };
+    // A downdated factorization keeps L' in its kept rows, as the refactored
+    // want has it up to the signs of its columns, and solves through its
+    // rotations as want does.
+    auto same_downdated = [](const matrix_t<double>& got, const std::vector<double>& got_up,
+                             const std::vector<double>& got_b, const Downdate& downdate, const matrix_t<double>& want,
+                             const std::vector<double>& want_up, const std::vector<double>& want_b) {
+        const int m = want.rows(), n = want.cols();
+        const std::vector<int> live = downdate.live_rows(got.rows());
+        if ((int)live.size() != m || got.cols() != n || (int)got_up.size() != got.rows()) {
+            return false;
+        }
+        double worst = 0.0;
+        for (int i = 0; i < m; ++i) {
+            for (int j = 0; j <= std::min(i, n - 1); ++j) {
+                worst = std::max(worst, std::fabs(std::fabs(got(live[i], j)) - std::fabs(want(i, j))));
+            }
+        }
+        if (worst > 1e-10 * n) {
+            return false;
+        }
+        if (m > n) {
+            return true;
+        }
+        std::vector<double> rhs(n), x(m), y(m);
+        for (int k = 0; k < n; ++k) {
+            rhs[k] = std::cos(0.5 * k);
+        }
+        QApplier<double>(got.data_ptr(), got.rows(), n, got_up.data(), got_b.data(), 2, &downdate)
+            .solve(rhs.data(), 1, n, x.data(), m);
+        lstsq_solve(want.data_ptr(), m, n, want_up.data(), want_b.data(), rhs.data(), y.data());
+        for (int i = 0; i < m; ++i) {
+            if (std::fabs(x[i] - y[i]) > 1e-8 * std::max(1.0, std::fabs(y[i]))) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for (bool wy : {true, false}) {
+        QrEngineOptions options;
+        options.threads = 3;
+        options.alpha = 4;
+        options.beta = 8;
+        options.type2 = wy ? Type2Mode::wy : Type2Mode::reflectors;
+        options.queue = wy ? QueuePolicy::fifo : QueuePolicy::priority;
+        QrEngine engine(options);
+        const std::string mode = wy ? " (wy)" : "";
+
+        // Appends: within the pivots, across m = n, and below a tall matrix;
+        // the first starts from nothing.
+        struct Append { int m, k, n; };
+        for (const Append& a : {Append{0, 13, 60}, Append{21, 17, 60}, Append{50, 23, 60}, Append{70, 9, 40},
+                                Append{1, 6, 30}}) {
+            const std::string name = std::to_string(a.m) + "+" + std::to_string(a.k) + "x" + std::to_string(a.n) + mode;
+            matrix_t<double> mat = rows_of(0, a.m, a.n), full = rows_of(0, a.m + a.k, a.n);
+            std::vector<double> up, b, full_up, full_b;
+            engine.factor(mat, up, b);
+            engine.append_rows(mat, up, b, rows_of(a.m, a.k, a.n));
+            engine.factor(full, full_up, full_b);
+            CHECK(same_factorization(mat, up, b, full, full_up, full_b),
+                  name + ": appending should match a refactorization", errors);
+        }
+
+        // A stream of batches keeps matching, and a sliding window (drop the
+        // oldest rows, append as many) too.
+        const int n = 64;
+        matrix_t<double> mat;
+        std::vector<double> up, b;
+        int base = 0, size = 0;
+        for (int batch = 0; batch < 4; ++batch) {
+            engine.append_rows(mat, up, b, rows_of(size, 10, n));
+            size += 10;
+        }
+        matrix_t<double> want = rows_of(0, size, n);
+        std::vector<double> want_up, want_b;
+        engine.factor(want, want_up, want_b);
+        CHECK(same_factorization(mat, up, b, want, want_up, want_b), "Batches of appends should match" + mode,
+              errors);
+        for (int step = 0; step < 2; ++step) {
+            engine.delete_rows(mat, up, b, 0, 7);
+            engine.append_rows(mat, up, b, rows_of(base + size, 7, n));
+            base += 7;
+        }
+        want = rows_of(base, size, n);
+        engine.factor(want, want_up, want_b);
+        CHECK(same_factorization(mat, up, b, want, want_up, want_b), "A sliding window should match" + mode, errors);
+
+        // Deleting rows in the middle, and the last rows, which is exact.
+        matrix_t<double> keep_a = rows_of(0, 15, n), keep_b = rows_of(24, 16, n);
+        matrix_t<double> cut(31, n);
+        std::copy(keep_a.data_ptr(), keep_a.data_ptr() + 15 * n, cut.data_ptr());
+        std::copy(keep_b.data_ptr(), keep_b.data_ptr() + 16 * n, cut.data_ptr() + 15 * n);
+        matrix_t<double> middle = rows_of(0, 40, n);
+        engine.factor(middle, up, b);
+        engine.delete_rows(middle, up, b, 15, 9);
+        engine.factor(cut, want_up, want_b);
+        CHECK(same_factorization(middle, up, b, cut, want_up, want_b), "Deleting middle rows should match" + mode,
+              errors);
+
+        matrix_t<double> tail = rows_of(0, 40, n), head = rows_of(0, 30, n);
+        engine.factor(tail, up, b);
+        engine.delete_rows(tail, up, b, 30, 10);
+        engine.factor(head, want_up, want_b);
+        CHECK(same_factorization(tail, up, b, head, want_up, want_b),
+              "Deleting the last rows should truncate the factorization" + mode, errors);
+
+        // Rows past the pivots of a tall matrix do not change any reflector.
+        matrix_t<double> tall = rows_of(0, 50, 20), short_tall(45, 20);
+        const matrix_t<double> source = rows_of(0, 50, 20);
+        std::copy(source.data_ptr(), source.data_ptr() + 30 * 20, short_tall.data_ptr());
+        std::copy(source.data_ptr() + 35 * 20, source.data_ptr() + 50 * 20, short_tall.data_ptr() + 30 * 20);
+        engine.factor(tall, up, b);
+        engine.delete_rows(tall, up, b, 30, 5);
+        engine.factor(short_tall, want_up, want_b);
+        CHECK(same_factorization(tall, up, b, short_tall, want_up, want_b),
+              "Deleting rows past the pivots should match" + mode, errors);
+
+        // With a Downdate, old rows are rotated out and stay as ghosts; a
+        // window slides over them, rows in the middle go too, and compacting
+        // gives back the refactorization.
+        for (int cols : {n, 20}) {
+            const std::string name = "40x" + std::to_string(cols) + mode;
+            matrix_t<double> dd = rows_of(0, 40, cols);
+            Downdate downdate;
+            engine.factor(dd, up, b);
+            engine.delete_rows(dd, up, b, downdate, 0, 4);
+            want = rows_of(4, 36, cols);
+            engine.factor(want, want_up, want_b);
+            CHECK(!downdate.rotations.empty() && same_downdated(dd, up, b, downdate, want, want_up, want_b),
+                  name + ": deleting old rows should downdate", errors);
+            engine.append_rows(dd, up, b, downdate, rows_of(40, 4, cols));
+            engine.delete_rows(dd, up, b, downdate, 10, 3);
+            matrix_t<double> window(37, cols);
+            const matrix_t<double> source = rows_of(4, 40, cols);
+            std::copy(source.data_ptr(), source.data_ptr() + 10 * cols, window.data_ptr());
+            std::copy(source.data_ptr() + 13 * cols, source.data_ptr() + 40 * cols, window.data_ptr() + 10 * cols);
+            want = window;
+            engine.factor(want, want_up, want_b);
+            CHECK(!downdate.empty() && same_downdated(dd, up, b, downdate, want, want_up, want_b),
+                  name + ": updating a downdated factorization should match", errors);
+            engine.compact(dd, up, b, downdate);
+            CHECK(downdate.empty() && same_factorization(dd, up, b, want, want_up, want_b),
+                  name + ": compacting should give the refactorization", errors);
+        }
+    }
+
+    QrEngine engine(QrEngineOptions{2, 4, 8});
+    matrix_t<double> mat = rows_of(0, 10, 12);
+    std::vector<double> up, b;
+    engine.factor(mat, up, b);
+    auto rejects = [&](auto&& update) {
+        try {
+            update();
+        } catch (const std::invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    CHECK(rejects([&] { engine.append_rows(mat, up, b, rows_of(0, 3, 11)); }) &&
+              rejects([&] { engine.delete_rows(mat, up, b, 8, 3); }) &&
+              rejects([&] { std::vector<double> none; engine.delete_rows(mat, none, b, 0, 1); }),
+          "Mismatched updates should be rejected", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[EN2]. Test Row Append and Delete."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[EN2]. Test Row Append and Delete."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// ========================= Checkpoint Tests ========================= //
+
+// Runs the ready tasks of a graph serially, the oldest first, until limit
+// tasks have completed or none is left; returns the number run.
+static int run_ready_tasks(const TaskTable& table, DependencyTableAtomic& deps, std::deque<Task*>& ready, double* a,
+                           int m, int n, std::vector<double>& up, std::vector<double>& b, std::vector<double>& T,
+                           int ldt, bool wy, int limit) {
+    int done = 0;
+    while (done < limit && !ready.empty()) {
+        Task* t = ready.front();
+        ready.pop_front();
+        double* Tj = T.data() + (size_t)t->chunk_idx_j * ldt * ldt;
+        if (t->type == 1) {
+            complete_task1(a, m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), b.data());
+            if (wy) {
+                build_wy_factor(a, n, t->row_start, t->row_end, up.data(), b.data(), Tj, ldt);
+            }
+        } else if (wy) {
+            complete_task2_wy(a, m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), Tj, ldt);
+        } else {
+            complete_task2(a, m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(), b.data());
+        }
+        deps.setDependency(t->chunk_idx_i, t->chunk_idx_j, true);
+        table.releaseSuccessors(t, [&ready](Task* next) { ready.push_back(next); });
+        done++;
+    }
+    return done;
+}
+
+// Test 1: A binary result holds the matrix and its reflector scalars, and
+// reads back bit for bit, plain or compressed, with its downdate if any.
+void test_binary_result() {
+    std::stringstream errors;
+    const std::string plain = "test_result.bin", packed = "test_result.bin.gz";
+
+    const int m = 37, n = 53;
+    matrix_t<double> mat(m, n);
+    for (int k = 0; k < m * n; ++k) {
+        mat.data_ptr()[k] = std::sin(0.7 * k) * 1e3;
+    }
+    std::vector<double> up(m), b(m);
+    for (int i = 0; i < m; ++i) {
+        up[i] = 1.0 / (i + 1);
+        b[i] = -std::sqrt(i + 0.5);
+    }
+    save_factorization(plain, mat, up, b, false);
+    save_factorization(packed, mat, up, b, true);
+
+    for (const std::string& file : {plain, packed}) {
+        matrix_t<double> got;
+        std::vector<double> got_up, got_b;
+        load_factorization(file, got, got_up, got_b);
+        CHECK(got.rows() == m && got.cols() == n && std::equal(got.data_ptr(), got.data_ptr() + m * n, mat.data_ptr()),
+              file + ": the matrix should read back exactly", errors);
+        CHECK(got_up == up && got_b == b, file + ": the reflector scalars should read back exactly", errors);
+    }
+
+    // The plain file is the binary matrix format: the matrix maps in place
+    // and the scalars are a second record.
+    matrix_t<double> mapped;
+    mapped.read_binary(plain);
+    const std::vector<uint64_t> records = binary_matrix_records(plain);
+    CHECK(std::equal(mapped.data_ptr(), mapped.data_ptr() + m * n, mat.data_ptr()) && records.size() == 2,
+          "A binary result should be two records of the matrix format", errors);
+    CHECK(!is_binary_matrix_file(packed), "The compressed result should be a gzip stream", errors);
+
+    // A downdated factorization adds its ghost rows and rotations, which only
+    // a load with a Downdate accepts.
+    Downdate downdate;
+    downdate.deleted = {2, 5, 11};
+    downdate.rotations = {Rotation{2, 3, 0.6, -0.8}, Rotation{3, 4, std::sqrt(0.5), std::sqrt(0.5)}};
+    for (bool compress : {false, true}) {
+        save_factorization(plain, mat, up, b, compress, downdate);
+        matrix_t<double> got;
+        std::vector<double> got_up, got_b;
+        Downdate got_downdate;
+        load_factorization(plain, got, got_up, got_b, &got_downdate);
+        bool same = got_up == up && got_downdate.deleted == downdate.deleted &&
+                    got_downdate.rotations.size() == downdate.rotations.size();
+        for (size_t k = 0; same && k < downdate.rotations.size(); ++k) {
+            const Rotation &g = got_downdate.rotations[k], &want = downdate.rotations[k];
+            same = g.i == want.i && g.j == want.j && g.c == want.c && g.s == want.s;
+        }
+        CHECK(same && (compress || binary_matrix_records(plain).size() == 4),
+              "A downdate should read back exactly" + std::string(compress ? " (compressed)" : ""), errors);
+        bool refused = false;
+        try {
+            load_factorization(plain, got, got_up, got_b);
+        } catch (const std::runtime_error&) {
+            refused = true;
+        }
+        CHECK(refused, "A downdated file should need a Downdate to load", errors);
+    }
+
+    // A record of another element type is rejected.
+    bool rejected = false;
+    try {
+        RecordReader reader(plain);
+        std::vector<float> values;
+        uint64_t rows = 0, cols = 0;
+        reader.read(values, rows, cols);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    CHECK(rejected, "Reading doubles as floats should be rejected", errors);
+    std::remove(plain.c_str());
+    std::remove(packed.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[CK1]. Test Binary Result Files."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[CK1]. Test Binary Result Files."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 2: A run stopped after some tasks and resumed from its checkpoint in
+// a fresh task graph gives the result of an uninterrupted run.
+void test_checkpoint_resume() {
+    std::stringstream errors;
+    const std::string file = "test_run.ckpt";
+
+    struct Shape { int m, n, alpha, beta; };
+    const Shape shapes[] = {{70, 70, 4, 8}, {45, 90, 2, 8}, {90, 45, 4, 4}};
+    for (const Shape& sh : shapes) {
+        std::vector<double> a((size_t)sh.m * sh.n);
+        for (size_t k = 0; k < a.size(); ++k) {
+            a[k] = std::sin(0.7 * k) + std::cos(0.03 * k);
+        }
+        const int rows = TaskTable::task_rows(sh.m, sh.beta), cols = TaskTable::task_cols(sh.m, sh.n, sh.alpha);
+        const int ldt = sh.alpha + 1;
+        for (bool wy : {true, false}) {
+            size_t device_tasks = 0;
+            const std::vector<double> ref = run_hybrid(a, sh.m, sh.n, sh.alpha, sh.beta, 0, 1, wy,
+                                                       TaskGraphMode::eager, device_tasks);
+            for (TaskGraphMode mode : {TaskGraphMode::eager, TaskGraphMode::lazy}) {
+                const std::string name = std::to_string(sh.m) + "x" + std::to_string(sh.n) + (wy ? " wy" : "") +
+                                         (mode == TaskGraphMode::lazy ? " lazy" : "");
+                const CheckpointInfo run{sh.m, sh.n, sh.alpha, sh.beta, wy, 0};
+
+                // First run: a third of the tasks, then a checkpoint.
+                std::vector<double> first(a), up(sh.m, 0.0), b(sh.m, 0.0);
+                std::vector<double> T(wy ? (size_t)cols * ldt * ldt : 0, 0.0);
+                TaskTable table;
+                table.init(rows, cols, sh.alpha, sh.beta, sh.m, sh.n, mode);
+                DependencyTableAtomic deps(rows, cols);
+                std::deque<Task*> ready{table.getTask(0, 0)};
+                const int total = table.numTasks();
+                const int ran = run_ready_tasks(table, deps, ready, first.data(), sh.m, sh.n, up, b, T, ldt, wy,
+                                                total / 3);
+                CheckpointSnapshot<double> snapshot;
+                snapshot.capture(run, first.data(), up, b, T, deps);
+                snapshot.save(file);
+                CHECK(snapshot.info.completed == ran, name + ": the checkpoint should count the tasks run", errors);
+
+                // Second run: a fresh graph from the checkpoint.
+                CheckpointSnapshot<double> loaded;
+                loaded.load(file);
+                CHECK(loaded.info.same_run(run) && loaded.info.completed == ran,
+                      name + ": the checkpoint should describe its run", errors);
+                std::vector<double> second(a.size(), 0.0), up2(sh.m, 0.0), b2(sh.m, 0.0), T2(T.size(), 0.0);
+                TaskTable table2;
+                table2.init(rows, cols, sh.alpha, sh.beta, sh.m, sh.n, mode);
+                DependencyTableAtomic deps2(rows, cols);
+                std::deque<Task*> ready2;
+                const int restored = loaded.restore(second.data(), up2, b2, T2, deps2, table2,
+                                                    [&ready2](Task* t) { ready2.push_back(t); });
+                CHECK(restored == ran && ready2.size() == ready.size(),
+                      name + ": the resumed run should start from the same ready tasks", errors);
+                const int rest = run_ready_tasks(table2, deps2, ready2, second.data(), sh.m, sh.n, up2, b2, T2, ldt,
+                                                 wy, total);
+                CHECK(restored + rest == total, name + ": every remaining task should run once", errors);
+                CHECK(second == ref, name + ": the resumed result should match an uninterrupted run", errors);
+            }
+        }
+    }
+
+    // A file that is not a checkpoint is rejected.
+    matrix_t<double> other(3, 3);
+    other.save_binary(file);
+    bool rejected = false;
+    try {
+        CheckpointSnapshot<double> snapshot;
+        snapshot.load(file);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    CHECK(rejected, "A plain matrix file should not load as a checkpoint", errors);
+    std::remove(file.c_str());
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[CK2]. Test Checkpoint and Resume."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[CK2]. Test Checkpoint and Resume."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+// Test 3: CheckpointGate stops threaded workers at consistent cuts: while it
+// is paused nothing runs, and the completed cells are closed under the
+// dependencies. The paused run still finishes with the serial result.
+void test_checkpoint_gate() {
+    std::stringstream errors;
+
+    const int m = 90, n = 90, alpha = 4, beta = 8, ldt = alpha + 1, threads = 4;
+    std::vector<double> a((size_t)m * n);
+    for (size_t k = 0; k < a.size(); ++k) {
+        a[k] = std::sin(0.7 * k) + std::cos(0.03 * k);
+    }
+    size_t device_tasks = 0;
+    const std::vector<double> ref = run_hybrid(a, m, n, alpha, beta, 0, 1, true, TaskGraphMode::eager, device_tasks);
+
+    const int rows = TaskTable::task_rows(m, beta), cols = TaskTable::task_cols(m, n, alpha);
+    TaskTable table;
+    table.init(rows, cols, alpha, beta, m, n, TaskGraphMode::eager);
+    DependencyTableAtomic deps(rows, cols);
+    std::vector<double> up(m, 0.0), b(m, 0.0), T((size_t)cols * ldt * ldt, 0.0);
+    tbb::concurrent_queue<Task*> queue;
+    std::atomic<int> remaining(table.numTasks()), running(0);
+
+    CheckpointGate gate;
+    gate.enable();
+    gate.submitted(1);
+    queue.push(table.getTask(0, 0));
+    std::vector<std::thread> workers;
+    for (int w = 0; w < threads; ++w) {
+        workers.emplace_back([&] {
+            while (remaining.load() > 0) {
+                Task* t = nullptr;
+                if (!queue.try_pop(t)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                running++;
+                double* Tj = T.data() + (size_t)t->chunk_idx_j * ldt * ldt;
+                if (t->type == 1) {
+                    complete_task1(a.data(), m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(),
+                                   b.data());
+                    build_wy_factor(a.data(), n, t->row_start, t->row_end, up.data(), b.data(), Tj, ldt);
+                } else {
+                    complete_task2_wy(a.data(), m, n, t->row_start, t->row_end, t->col_start, t->col_end, up.data(),
+                                      Tj, ldt);
+                }
+                deps.setDependency(t->chunk_idx_i, t->chunk_idx_j, true);
+                table.releaseSuccessors(t, [&](Task* next) {
+                    if (!gate.hold(next)) {
+                        queue.push(next);
+                    }
+                });
+                running--;
+                remaining--;
+                gate.completed();
+            }
+        });
+    }
+
+    int pauses = 0, partial = 0;
+    bool idle = true, closed = true;
+    while (remaining.load() > 0) {
+        gate.pause();
+        idle = idle && running.load() == 0 && queue.empty();
+        partial += remaining.load() > 0;
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                if (!deps.getDependency(i, j)) {
+                    continue;
+                }
+                const int pivots = j / (beta / alpha);
+                closed = closed && (j == 0 || deps.getDependency(i, j - 1)) &&
+                         (i == pivots || deps.getDependency(pivots, j));
+            }
+        }
+        for (Task* t : gate.resume()) {
+            queue.push(t);
+        }
+        pauses++;
+    }
+    for (std::thread& w : workers) {
+        w.join();
+    }
+    CHECK(partial > 0, "A pause should hold the run before its end", errors);
+    CHECK(pauses > 0 && idle, "No task should be queued or running during a pause", errors);
+    CHECK(closed, "Every pause should see the dependencies of each completed cell", errors);
+    CHECK(a == ref, "A paused run should match the serial result", errors);
+
+    if (errors.str().empty()) {
+        std::cout << std::left << std::setw(60) << "[CK3]. Test Checkpoint Gate."
+                  << GREEN << "[Passed]" << RESET << std::endl;
+    } else {
+        std::cout << std::left << std::setw(60) << "[CK3]. Test Checkpoint Gate."
+                  << RED << "[Failed]" << RESET << std::endl;
+        std::cout << errors.str() << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "Inside Test.\n" << std::endl;
+
+    std::cout << YELLOW << "Starting matrix_t Test Cases." << RESET << std::endl;
+
+    // Run matrix_t test functions
+    test_operator_access();
+    test_get_set();
+    test_save();
+    test_binary_roundtrip();
+    test_text_read();
+    test_tiled_layout();
+    test_first_touch();
+    test_binary_records();
+
+    std::cout << YELLOW << "\nStarting DependencyTable Test Cases." << RESET << std::endl;
+
+    // Run DependencyTable test functions
+    test_default_constructor();
+    test_parameterized_constructor();
+    test_init();
+    test_move_constructor();
+    test_move_assignment();
+    test_get_set_dependency();
+    test_operator_overloading();
+    test_out_of_bounds();
+
+    std::cout << YELLOW << "\nStarting DependencyTableAtomic Test Cases." << RESET << std::endl;
+
+    // Run DependencyTableAtomic test functions
+    test_default_constructor_atomic();
+    test_parameterized_constructor_atomic();
+    test_init_atomic();
+    test_move_constructor_atomic();
+    test_move_assignment_atomic();
+    test_get_set_dependency_atomic();
+    test_operator_overloading_atomic();
+    test_out_of_bounds_atomic();
+    test_layouts_atomic();
+
+    std::cout << YELLOW << "\nStarting CircularQueueMtx Test Cases." << RESET << std::endl;
+
+    test_queue_empty_and_size();
+    test_queue_push_pop_fifo();
+    test_queue_push_front_pop_back();
+    test_queue_full();
+    test_queue_multi_threaded();
+
+    std::cout << YELLOW << "\nStarting CircularQueueAtomic Test Cases." << RESET << std::endl;
+
+    test_atomic_queue_empty_and_size();
+    test_atomic_queue_push_pop_fifo();
+    test_atomic_queue_push_front_pop_back();
+    test_atomic_queue_full();
+    test_atomic_queue_multi_threaded();
+    test_atomic_queue_push_and_pop();
+
+    std::cout << YELLOW << "\nStarting ChaseLevDeque Test Cases." << RESET << std::endl;
+
+    test_chase_lev_single_threaded();
+    test_chase_lev_multi_threaded();
+
+    std::cout << YELLOW << "\nStarting BucketPriorityQueue Test Cases." << RESET << std::endl;
+
+    test_bucket_queue_order();
+    test_bucket_queue_multi_threaded();
+
+    std::cout << YELLOW << "\nStarting Idle Policy Test Cases." << RESET << std::endl;
+
+    test_idle_backoff();
+    test_parking_lot();
+    test_spin_barrier();
+
+    std::cout << YELLOW << "\nStarting Placement Test Cases." << RESET << std::endl;
+
+    test_thread_placement();
+
+    std::cout << YELLOW << "\nStarting Trace Test Cases." << RESET << std::endl;
+
+    test_task_trace();
+
+    std::cout << YELLOW << "\nStarting Metrics Test Cases." << RESET << std::endl;
+
+    test_run_metrics();
+
+    std::cout << YELLOW << "\nStarting Benchmark History Test Cases." << RESET << std::endl;
+
+    test_bench_statistics();
+    test_bench_database();
+
+    std::cout << YELLOW << "\nStarting RunConfig Test Cases." << RESET << std::endl;
+
+    test_run_config_parse();
+    test_run_config_invalid();
+
+    std::cout << YELLOW << "\nStarting TaskTable Test Cases." << RESET << std::endl;
+
+    test_task_table_release();
+    test_task_table_arena();
+    test_task_table_lazy();
+    test_task_table_rectangular();
+
+    std::cout << std::endl;
+
+    std::cout << YELLOW << "\nStarting Kernel Test Cases." << RESET << std::endl;
+
+    test_kernel_fixed_alpha();
+    test_kernel_simd();
+    test_kernel_wy();
+    test_kernel_tiled();
+    test_kernel_float();
+
+    std::cout << YELLOW << "\nStarting Autotune Test Cases." << RESET << std::endl;
+
+    test_autotune_model();
+    test_autotune_cache();
+
+    std::cout << YELLOW << "\nStarting TSQR Test Cases." << RESET << std::endl;
+
+    test_tsqr();
+
+    std::cout << YELLOW << "\nStarting Least Squares Test Cases." << RESET << std::endl;
+
+    test_least_squares();
+    test_q_applier();
+
+    std::cout << YELLOW << "\nStarting Distributed Test Cases." << RESET << std::endl;
+
+    test_distributed_factorization();
+
+    std::cout << YELLOW << "\nStarting Device Test Cases." << RESET << std::endl;
+
+    test_device_offload();
+
+    std::cout << YELLOW << "\nStarting Out-of-Core Test Cases." << RESET << std::endl;
+
+    test_out_of_core();
+
+    std::cout << YELLOW << "\nStarting Engine Test Cases." << RESET << std::endl;
+
+    test_qr_engine();
+    test_row_update();
+
+    std::cout << YELLOW << "\nStarting Checkpoint Test Cases." << RESET << std::endl;
+
+    test_binary_result();
+    test_checkpoint_resume();
+    test_checkpoint_gate();
+
+    std::cout << std::endl;
+
+    // Summary of test results
+    if (total_failures == 0) {
+        std::cout << GREEN << "All tests passed." << RESET << std::endl;
+    } else {
+        std::cout << RED << "Some tests failed. Total Failures: " << total_failures << RESET << std::endl;
+    }
+
+    return (total_failures == 0) ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,545 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <thread>
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "autotune.h"
+#include "bench_history.h"
+#include "bn2.h"
+#include "metrics.h"
+#include "run_config.h"
+
+// Regression harness for the two schedulers: times the dynamic driver
+// (a.out, main.cpp) and the static one (barrier.out, barrier_main.cpp) over
+// a grid of sizes and thread counts, summarizes each point (median, its 95%
+// confidence interval, GFLOP/s, parallel efficiency), appends the run to a
+// JSON database and flags significant changes against the stored baseline
+// (see bench_history.h).
+//
+// Every trial is a fresh driver process on the same binary matrix, so one
+// trial's caches and page mappings never help the next; the drivers report
+// the factorization time alone through --timing. The first --warmup trials
+// of each point are discarded.
+//
+//   regress.out [options]             run the grid, compare and record
+//
+// Exit status: 0, 1 if a regression was flagged, 2 on errors.
+
+struct RegressOptions
+{
+    std::string dynamic_driver = "./a.out";
+    std::string static_driver = "./barrier.out";
+    std::vector<std::string> drivers = {"dynamic", "static"};
+    std::vector<std::pair<int, int>> sizes = {{1000, 1000}, {2000, 2000}};
+    std::vector<int> threads;
+    int alpha = 4;
+    int beta = 16;
+    int warmup = 1;
+    int repeat = 5;
+    std::string db = "bench_db.json";
+    std::string label;              // Empty: the commit
+    std::string baseline;           // Empty: the database's baseline
+    bool set_baseline = false;
+    bool save = true;
+    double threshold = 0.05;
+    double significance = 0.01;
+    std::string scratch;            // Empty: $TMPDIR or /tmp
+};
+
+void print_regress_usage(const char *prog, std::ostream &os = std::cerr)
+{
+    os << "Usage: " << prog << " [options]\n"
+       << "      --dynamic PATH    Dynamic scheduler driver (default ./a.out)\n"
+       << "      --static PATH     Static scheduler driver (default ./barrier.out, make barrier)\n"
+       << "      --drivers LIST    Drivers to run: dynamic,static (default both)\n"
+       << "      --sizes LIST      Matrix sizes, N or MxN each (default 1000,2000)\n"
+       << "  -t, --threads LIST    Thread counts (default 1, 2, 4, ... and the hardware threads)\n"
+       << "  -a, --alpha N         Pivots per task (default 4)\n"
+       << "  -b, --beta N          Rows per task, a multiple of alpha (default 16)\n"
+       << "      --warmup N        Discarded trials per point (default 1)\n"
+       << "      --repeat N        Timed trials per point (default 5)\n"
+       << "      --quick           One 500 x 500 matrix, 1 and all hardware threads\n"
+       << "      --db FILE         Result database (default bench_db.json)\n"
+       << "      --label NAME      Name of this run in the database (default the git commit)\n"
+       << "      --baseline LABEL  Run to compare with (default the database's baseline)\n"
+       << "      --set-baseline    Make this run the baseline\n"
+       << "      --no-save         Compare only; leave the database as it is\n"
+       << "      --threshold PCT   Smallest change of the median that is flagged (default 5)\n"
+       << "      --significance P  Largest p-value of a flagged change (default 0.01)\n"
+       << "      --scratch DIR     Directory of the generated matrices (default $TMPDIR or /tmp)\n"
+       << "  -h, --help            Show this message\n";
+}
+
+std::vector<std::string> split_list(const std::string &text)
+{
+    std::vector<std::string> items;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    if (items.empty())
+    {
+        throw std::invalid_argument("Empty list: " + text);
+    }
+    return items;
+}
+
+// N for a square matrix, or MxN.
+std::pair<int, int> parse_size(const std::string &text)
+{
+    const size_t x = text.find('x');
+    if (x == std::string::npos)
+    {
+        int n = parse_positive_int(text, "--sizes");
+        return {n, n};
+    }
+    return {parse_positive_int(text.substr(0, x), "--sizes"), parse_positive_int(text.substr(x + 1), "--sizes")};
+}
+
+double parse_fraction(const std::string &text, const std::string &what, double scale)
+{
+    char *end = nullptr;
+    double v = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || v < 0)
+    {
+        throw std::invalid_argument("Invalid value for " + what + ": " + text);
+    }
+    return v / scale;
+}
+
+// Returns false if only the help text was requested.
+bool parse_regress_options(int argc, char *argv[], RegressOptions &opt)
+{
+    bool quick = false;
+    bool sizes_given = false;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        auto next_value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "--help")
+        {
+            return false;
+        }
+        else if (arg == "--dynamic")
+        {
+            opt.dynamic_driver = next_value();
+        }
+        else if (arg == "--static")
+        {
+            opt.static_driver = next_value();
+        }
+        else if (arg == "--drivers")
+        {
+            opt.drivers = split_list(next_value());
+            for (const std::string &d : opt.drivers)
+            {
+                if (d != "dynamic" && d != "static")
+                {
+                    throw std::invalid_argument("Unknown driver: " + d);
+                }
+            }
+        }
+        else if (arg == "--sizes")
+        {
+            opt.sizes.clear();
+            for (const std::string &s : split_list(next_value()))
+            {
+                opt.sizes.push_back(parse_size(s));
+            }
+            sizes_given = true;
+        }
+        else if (arg == "-t" || arg == "--threads")
+        {
+            opt.threads.clear();
+            for (const std::string &t : split_list(next_value()))
+            {
+                opt.threads.push_back(parse_positive_int(t, arg));
+            }
+        }
+        else if (arg == "-a" || arg == "--alpha")
+        {
+            opt.alpha = parse_positive_int(next_value(), arg);
+        }
+        else if (arg == "-b" || arg == "--beta")
+        {
+            opt.beta = parse_positive_int(next_value(), arg);
+        }
+        else if (arg == "--warmup")
+        {
+            opt.warmup = parse_non_negative_int(next_value(), arg);
+        }
+        else if (arg == "--repeat")
+        {
+            opt.repeat = parse_positive_int(next_value(), arg);
+        }
+        else if (arg == "--quick")
+        {
+            quick = true;
+        }
+        else if (arg == "--db")
+        {
+            opt.db = next_value();
+        }
+        else if (arg == "--label")
+        {
+            opt.label = next_value();
+        }
+        else if (arg == "--baseline")
+        {
+            opt.baseline = next_value();
+        }
+        else if (arg == "--set-baseline")
+        {
+            opt.set_baseline = true;
+        }
+        else if (arg == "--no-save")
+        {
+            opt.save = false;
+        }
+        else if (arg == "--threshold")
+        {
+            opt.threshold = parse_fraction(next_value(), arg, 100);
+        }
+        else if (arg == "--significance")
+        {
+            opt.significance = parse_fraction(next_value(), arg, 1);
+        }
+        else if (arg == "--scratch")
+        {
+            opt.scratch = next_value();
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+    }
+
+    const int hw = std::max(1u, std::thread::hardware_concurrency());
+    if (quick && !sizes_given)
+    {
+        opt.sizes = {{500, 500}};
+    }
+    if (opt.threads.empty() && quick)
+    {
+        opt.threads = hw > 1 ? std::vector<int>{1, hw} : std::vector<int>{1};
+    }
+    else if (opt.threads.empty())
+    {
+        for (int t = 1; t < hw; t *= 2)
+        {
+            opt.threads.push_back(t);
+        }
+        opt.threads.push_back(hw);
+    }
+    if (opt.beta % opt.alpha != 0)
+    {
+        throw std::invalid_argument("beta (" + std::to_string(opt.beta) + ") must be a multiple of alpha ("
+                                    + std::to_string(opt.alpha) + ").");
+    }
+    if (opt.set_baseline && !opt.save)
+    {
+        throw std::invalid_argument("--set-baseline needs the run to be saved.");
+    }
+    return true;
+}
+
+// ============================== Runs ============================== //
+
+std::string shell_quote(const std::string &s)
+{
+    std::string out = "'";
+    for (char c : s)
+    {
+        out += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return out + "'";
+}
+
+// First line of the output of command, or fallback.
+std::string command_line(const std::string &command, const std::string &fallback)
+{
+    FILE *pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr)
+    {
+        return fallback;
+    }
+    char buf[256];
+    std::string line = fgets(buf, sizeof(buf), pipe) != nullptr ? std::string(buf) : std::string();
+    const bool ok = pclose(pipe) == 0;
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+    {
+        line.pop_back();
+    }
+    return ok && !line.empty() ? line : fallback;
+}
+
+// The short commit, marked -dirty when tracked files have changed.
+std::string current_commit()
+{
+    std::string commit = command_line("git rev-parse --short HEAD 2>/dev/null", "unknown");
+    if (commit != "unknown" &&
+        command_line("git status --porcelain --untracked-files=no 2>/dev/null | head -n 1", "").size() > 0)
+    {
+        commit += "-dirty";
+    }
+    return commit;
+}
+
+std::string utc_timestamp()
+{
+    std::time_t now = std::time(nullptr);
+    char buf[32];
+    std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return buf;
+}
+
+// A uniformly random m x n binary matrix file, the same for every run of
+// the harness, so runs on different commits time the same input.
+void write_matrix(const std::string &path, int m, int n)
+{
+    matrix_t<double> mat(m, n);
+    std::mt19937_64 rng((uint64_t)m * 1000003 + n);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    double *data = mat.data_ptr();
+    for (size_t k = 0; k < (size_t)m * n; k++)
+    {
+        data[k] = dist(rng);
+    }
+    mat.save_binary(path);
+}
+
+// One trial: the driver's factorization time in ms. Throws
+// std::runtime_error with the end of the driver's output if it fails.
+double run_trial(const std::string &driver, const std::string &matrix, int m, int n, int threads,
+                 const RegressOptions &opt, const std::string &timing, const std::string &log)
+{
+    std::remove(timing.c_str());
+    const std::string command = shell_quote(driver) + " -t " + std::to_string(threads) + " -a " +
+                                std::to_string(opt.alpha) + " -b " + std::to_string(opt.beta) + " --timing " +
+                                shell_quote(timing) + " " + shell_quote(matrix) + " > " + shell_quote(log) + " 2>&1";
+    const int status = std::system(command.c_str());
+
+    std::ifstream in(timing);
+    std::stringstream text;
+    text << in.rdbuf();
+    if (status != 0 || !in.is_open())
+    {
+        std::ifstream output(log);
+        std::string line, tail;
+        while (std::getline(output, line))
+        {
+            tail = line;
+        }
+        const int code = WIFEXITED(status) ? WEXITSTATUS(status) : status;
+        throw std::runtime_error(driver + " failed (exit status " + std::to_string(code) + "): " + tail);
+    }
+    JsonValue record = JsonValue::parse(text.str());
+    if ((int)record.number_or("m", -1) != m || (int)record.number_or("n", -1) != n ||
+        (int)record.number_or("threads", -1) != threads)
+    {
+        throw std::runtime_error(driver + " timed a different run than asked for; see " + timing);
+    }
+    return record.number_or("wall_ns", 0) / 1e6;
+}
+
+void print_table(const BenchRun &run, const std::vector<BenchComparison> &changes, bool compared)
+{
+    std::cout << std::left << std::setw(9) << "driver" << std::setw(12) << "size" << std::right << std::setw(8)
+              << "threads" << std::setw(12) << "median ms" << std::setw(24) << "CI ms" << std::setw(10) << "GFLOP/s"
+              << std::setw(8) << "eff";
+    if (compared)
+    {
+        std::cout << std::setw(10) << "vs base" << std::setw(10) << "p" << "  verdict";
+    }
+    std::cout << std::endl;
+    for (size_t k = 0; k < run.entries.size(); k++)
+    {
+        const BenchEntry &e = run.entries[k];
+        std::ostringstream ci, size;
+        ci << std::fixed << std::setprecision(2) << "[" << e.stats.ci_low << ", " << e.stats.ci_high << "] "
+           << std::setprecision(0) << e.stats.confidence * 100 << "%";
+        size << e.m << "x" << e.n;
+        std::cout << std::left << std::setw(9) << e.driver << std::setw(12) << size.str() << std::right
+                  << std::setw(8) << e.threads << std::fixed << std::setprecision(2) << std::setw(12)
+                  << e.stats.median << std::setw(24) << ci.str() << std::setw(10) << e.gflops_per_s
+                  << std::setw(8) << e.efficiency;
+        if (compared)
+        {
+            const BenchComparison &c = changes[k];
+            if (c.base != nullptr)
+            {
+                std::ostringstream ratio;
+                ratio << std::showpos << std::fixed << std::setprecision(1) << (c.ratio - 1) * 100 << "%";
+                std::cout << std::setw(10) << ratio.str() << std::setw(10) << std::setprecision(4) << c.p_value;
+            }
+            else
+            {
+                std::cout << std::setw(20) << "";
+            }
+            std::cout << "  " << bench_verdict_name(c.verdict);
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    RegressOptions opt;
+    try
+    {
+        if (!parse_regress_options(argc, argv, opt))
+        {
+            print_regress_usage(argv[0], std::cout);
+            return EXIT_SUCCESS;
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        print_regress_usage(argv[0]);
+        return 2;
+    }
+
+    BenchRun run;
+    std::string scratch = opt.scratch;
+    if (scratch.empty())
+    {
+        const char *tmp = std::getenv("TMPDIR");
+        scratch = tmp != nullptr && *tmp != '\0' ? tmp : "/tmp";
+    }
+    const std::string prefix = scratch + "/parqr_regress_" + std::to_string(getpid());
+    const std::string timing = prefix + "_timing.json";
+    const std::string log = prefix + "_driver.log";
+    std::vector<std::string> matrices;
+
+    int status = 0;
+    try
+    {
+        BenchDatabase db(opt.db);
+
+        run.commit = current_commit();
+        run.label = opt.label.empty() ? run.commit : opt.label;
+        run.timestamp = utc_timestamp();
+        run.cpu = cpu_model_name();
+        char host[256] = {0};
+        run.host = gethostname(host, sizeof(host) - 1) == 0 ? host : "unknown";
+        run.warmup = opt.warmup;
+
+        std::cout << "Run " << run.label << " on " << run.host << " (" << run.cpu << "), " << opt.warmup
+                  << " warm-up and " << opt.repeat << " timed trials per point" << std::endl;
+
+        for (const auto &size : opt.sizes)
+        {
+            const int m = size.first, n = size.second;
+            const std::string matrix = prefix + "_" + std::to_string(m) + "x" + std::to_string(n) + ".bin";
+            write_matrix(matrix, m, n);
+            matrices.push_back(matrix);
+
+            for (const std::string &driver : opt.drivers)
+            {
+                const std::string &path = driver == "dynamic" ? opt.dynamic_driver : opt.static_driver;
+                for (int t : opt.threads)
+                {
+                    BenchEntry e;
+                    e.driver = driver;
+                    e.m = m;
+                    e.n = n;
+                    e.threads = t;
+                    e.alpha = opt.alpha;
+                    e.beta = opt.beta;
+                    for (int trial = 0; trial < opt.warmup + opt.repeat; trial++)
+                    {
+                        double ms = run_trial(path, matrix, m, n, t, opt, timing, log);
+                        if (trial >= opt.warmup)
+                        {
+                            e.samples_ms.push_back(ms);
+                        }
+                    }
+                    e.stats = summarize_samples(e.samples_ms);
+                    e.gflops_per_s = e.stats.median > 0 ? householder_flops(m, n) / (e.stats.median * 1e6) : 0;
+                    std::cout << "  " << driver << " " << m << "x" << n << ", " << t << " threads: median "
+                              << e.stats.median << " ms" << std::endl;
+                    run.entries.push_back(e);
+                }
+            }
+        }
+        set_parallel_efficiency(run);
+
+        const std::string base_label = opt.baseline.empty() ? db.baseline : opt.baseline;
+        const BenchRun *base = base_label.empty() ? nullptr : db.find(base_label);
+        if (!opt.baseline.empty() && base == nullptr)
+        {
+            throw std::runtime_error("No run labelled " + opt.baseline + " in " + opt.db);
+        }
+        std::vector<BenchComparison> changes;
+        if (base != nullptr)
+        {
+            changes = compare_bench_runs(run, *base, opt.threshold, opt.significance);
+        }
+
+        std::cout << std::endl;
+        print_table(run, changes, base != nullptr);
+        std::cout << std::endl;
+
+        int regressions = 0, improvements = 0;
+        for (const BenchComparison &c : changes)
+        {
+            regressions += c.verdict == BenchComparison::regression;
+            improvements += c.verdict == BenchComparison::improvement;
+        }
+        if (base != nullptr)
+        {
+            std::cout << "Against " << base->label << " (" << base->timestamp << "): " << regressions
+                      << " regressions, " << improvements << " improvements (threshold " << opt.threshold * 100
+                      << "%, p < " << opt.significance << ")" << std::endl;
+            if (base->cpu != run.cpu || base->host != run.host)
+            {
+                std::cout << "Warning: the baseline was measured on " << base->host << " (" << base->cpu << ")"
+                          << std::endl;
+            }
+        }
+        status = regressions > 0 ? 1 : 0;
+
+        if (opt.save)
+        {
+            db.add(run);
+            if (opt.set_baseline || db.baseline.empty())
+            {
+                db.baseline = run.label;
+                std::cout << "Baseline: " << run.label << std::endl;
+            }
+            db.save();
+            std::cout << "Results: run " << run.label << " saved to " << opt.db << std::endl;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        status = 2;
+    }
+
+    for (const std::string &matrix : matrices)
+    {
+        std::remove(matrix.c_str());
+    }
+    std::remove(timing.c_str());
+    std::remove(log.c_str());
+    return status;
+}
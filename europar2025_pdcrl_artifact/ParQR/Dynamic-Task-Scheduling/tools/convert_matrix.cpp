@@ -0,0 +1,64 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "bn2.h"
+
+// One-shot converter between the text matrix format accepted by
+// matrix_t::read_matrix and the binary format (matrix_file_header_t).
+//
+//   convert.out <input.txt> <output.bin>             text   -> binary
+//   convert.out --to-text <input.bin> <output.txt>   binary -> text
+//   convert.out --pack <output.bin> <input>...       many   -> one binary (a.out --batch)
+
+int main(int argc, char *argv[])
+{
+    bool to_text = argc == 4 && std::string(argv[1]) == "--to-text";
+    bool pack = argc >= 4 && std::string(argv[1]) == "--pack";
+
+    if (argc != 3 && !to_text && !pack)
+    {
+        std::cerr << "Usage: " << argv[0] << " <input.txt> <output.bin>" << std::endl;
+        std::cerr << "       " << argv[0] << " --to-text <input.bin> <output.txt>" << std::endl;
+        std::cerr << "       " << argv[0] << " --pack <output.bin> <input>..." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        if (pack)
+        {
+            const std::string output = argv[2];
+            std::ofstream(output, std::ios::binary | std::ios::trunc);
+            for (int i = 3; i < argc; i++)
+            {
+                matrix_t<double> mat(argv[i]);
+                mat.save_binary(output, MATRIX_FILE_ALIGNMENT, true);
+            }
+            std::cout << "Packed " << argc - 3 << " matrices into " << output << std::endl;
+            return EXIT_SUCCESS;
+        }
+
+        const std::string input = argv[argc - 2];
+        const std::string output = argv[argc - 1];
+        matrix_t<double> mat(input);
+
+        if (to_text)
+        {
+            mat.save(output);
+        }
+        else
+        {
+            mat.save_binary(output);
+        }
+
+        std::cout << "Converted " << mat.rows() << "x" << mat.cols() << " matrix: "
+                  << input << " -> " << output << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
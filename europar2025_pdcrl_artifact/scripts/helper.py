@@ -16,6 +16,11 @@ MAKEFILE_NAME = "Makefile"
 TESTCASE_DIR = "testcase" 
 RESULTS_DIR = "results" # Subdirectory for CSVs and plots
 EXECUTABLE_NAME = "./a.out" 
+CONVERTER_NAME = "./convert.out" # Text -> binary matrix converter (make convert)
+MPI_EXECUTABLE_NAME = "./mpi.out" # Distributed driver (make mpi)
+MPIRUN = os.environ.get("MPIRUN", "mpirun") # MPI launcher, e.g. "srun" or "mpirun --hostfile hosts"
+METRICS_FILE_NAME = "run_metrics.json" # Scheduler report of the last run (--metrics, see include/metrics.h)
+COLLECT_METRICS = False # Set by --metrics: also record each run's scheduler report
 
 # --- Helper Functions (from previous version, mostly unchanged) ---
 def log_info(message):
@@ -47,6 +52,21 @@ def generate_matrix_if_needed(rows, cols, filepath):
         log_info(f"Using existing matrix: {filepath}")
     return filepath
 
+def ensure_binary_matrix(text_filepath):
+    """Converts a text matrix to the binary format once; the drivers mmap it instead of re-parsing text."""
+    bin_filepath = os.path.splitext(text_filepath)[0] + ".bin"
+    if os.path.exists(bin_filepath) and os.path.getmtime(bin_filepath) >= os.path.getmtime(text_filepath):
+        return bin_filepath
+    try:
+        if not os.path.exists(CONVERTER_NAME):
+            subprocess.run("make convert", shell=True, check=True, capture_output=True, text=True)
+        subprocess.run([CONVERTER_NAME, text_filepath, bin_filepath], check=True, capture_output=True, text=True)
+        log_info(f"Converted {text_filepath} -> {bin_filepath}")
+        return bin_filepath
+    except subprocess.CalledProcessError as e:
+        log_warn(f"Binary conversion failed, using text input: {e.stderr}")
+        return text_filepath
+
 def update_makefile(source_file_name_only):
     log_info(f"Updating Makefile: MAIN_SRC = {source_file_name_only}")
     cmd = f"sed -i 's|^MAIN_SRC * =.*|MAIN_SRC = {source_file_name_only}|' {MAKEFILE_NAME}"
@@ -56,15 +76,18 @@ def update_makefile(source_file_name_only):
         log_error(f"Failed to update Makefile: {e.stderr.decode() if e.stderr else e.stdout.decode()}")
         sys.exit(1)
 
-def update_cpp_macro(cpp_file_path, macro_name, macro_value):
-    log_info(f"Updating {cpp_file_path}: {macro_name} = {macro_value}")
-    regex = f"'s/^#define[[:space:]]\\+{macro_name}[[:space:]]\\+[0-9.]\\+/#define {macro_name} {macro_value}/'"
-    cmd = f"sed -i {regex} {cpp_file_path}"
-    try:
-        subprocess.run(cmd, shell=True, check=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-    except subprocess.CalledProcessError as e:
-        log_error(f"Failed to update macro {macro_name} in {cpp_file_path}: {e.stderr.decode() if e.stderr else e.stdout.decode()}")
-        sys.exit(1)
+def build_run_args(num_threads=None, alpha=None, beta=None, use_priority=None):
+    """Runtime options understood by both drivers (see include/run_config.h)."""
+    args = []
+    if num_threads is not None:
+        args += ["-t", str(num_threads)]
+    if alpha is not None:
+        args += ["-a", str(alpha)]
+    if beta is not None:
+        args += ["-b", str(beta)]
+    if use_priority is not None:
+        args += ["-q", "priority" if int(use_priority) == 1 else "fifo"]
+    return args
 
 def compile_code():
     log_info("Compiling C++ code (make clean && make -j)...")
@@ -78,8 +101,19 @@ def compile_code():
         log_error(f"STDERR:\n{e.stderr}")
         sys.exit(1)
 
-def run_executable(matrix_file_for_exe, time_regex_str, timeout_seconds=3600): # Default 1hr timeout for benchmarks
-    cmd_list = [EXECUTABLE_NAME, matrix_file_for_exe]
+_built_source = None
+
+def ensure_built(source_file_name_only):
+    """Rebuilds only when switching driver sources; parameters are passed at runtime."""
+    global _built_source
+    if _built_source != source_file_name_only:
+        update_makefile(source_file_name_only)
+        compile_code()
+        _built_source = source_file_name_only
+
+def run_executable(matrix_file_for_exe, time_regex_str, timeout_seconds=3600, run_args=(), executable=None, launcher=()): # Default 1hr timeout for benchmarks
+    # launcher prefixes the command, e.g. ["mpirun", "-np", "4"] for mpi.out
+    cmd_list = [*launcher, executable or EXECUTABLE_NAME, *run_args, matrix_file_for_exe]
     log_info(f"Executing: {' '.join(cmd_list)}")
     try:
         result = subprocess.run(cmd_list, capture_output=True, text=True, check=True, timeout=timeout_seconds)
@@ -92,6 +126,9 @@ def run_executable(matrix_file_for_exe, time_regex_str, timeout_seconds=3600): #
         if match:
             exec_time_ms = float(match.group(1))
             log_info(f"Extracted execution time: {exec_time_ms:.2f} ms")
+            metrics_match = re.search(r"Metrics: critical path\s*([0-9.eE+-]+)\s*ms", result.stdout)
+            if metrics_match:
+                log_info(f"Extracted critical path: {float(metrics_match.group(1)):.2f} ms")
             return exec_time_ms
         else:
             log_error("Could not parse execution time from output.")
@@ -107,6 +144,43 @@ def run_executable(matrix_file_for_exe, time_regex_str, timeout_seconds=3600): #
         log_error(f"Execution timed out (>{timeout_seconds}s) for: {' '.join(cmd_list)}")
         return None
 
+def load_run_metrics(path):
+    """Main numbers of a --metrics report (see include/metrics.h), or None."""
+    try:
+        with open(path) as f:
+            metrics = json.load(f)
+    except (OSError, ValueError):
+        log_warn(f"No metrics report at {path}.")
+        return None
+    threads = metrics["threads"]
+    return {
+        "CriticalPath_ms": metrics["critical_path_ms"],
+        "IdleFraction": sum(t["idle_ms"] for t in threads) / max(1e-9, metrics["wall_ms"] * len(threads)),
+        "Type1_ms": metrics["task_ms"]["type1"],
+        "Type2_ms": metrics["task_ms"]["type2"],
+        "FailedPops": metrics["queue"]["failed_pops"],
+        "QueueDelayP99_us": metrics["queue_delay_us"]["p99"],
+    }
+
+def run_cycles(matrix_file_for_exe, run_args, cycles=None, **kwargs):
+    """Runs a configuration several times. Returns the successful times (ms) and,
+    with --metrics, the mean of each run's scheduler report (or None)."""
+    cycle_times_ms, cycle_metrics = [], []
+    if COLLECT_METRICS:
+        run_args = [*run_args, "--metrics", METRICS_FILE_NAME]
+    for cycle in range(cycles or DEFAULT_CYCLES):
+        log_info(f"      Run {cycle+1}/{cycles or DEFAULT_CYCLES}")
+        if COLLECT_METRICS and os.path.exists(METRICS_FILE_NAME):
+            os.remove(METRICS_FILE_NAME)
+        exec_time = run_executable(matrix_file_for_exe, DEFAULT_TIME_REGEX, run_args=run_args, **kwargs)
+        if exec_time is not None:
+            cycle_times_ms.append(exec_time)
+            metrics = load_run_metrics(METRICS_FILE_NAME) if COLLECT_METRICS else None
+            if metrics is not None:
+                cycle_metrics.append(metrics)
+    mean_metrics = pd.DataFrame(cycle_metrics).mean().to_dict() if cycle_metrics else None
+    return cycle_times_ms, mean_metrics
+
 def run_single_config_from_dict(config_dict, default_time_regex):
     log_info(f"--- Running Test From Dict: {config_dict.get('test_description', 'Unnamed Dict Config')} ---")
     cpp_source = config_dict["cpp_source_file"]
@@ -119,23 +193,22 @@ def run_single_config_from_dict(config_dict, default_time_regex):
     cycles = config_dict.get("cycles", 1)
     time_regex = config_dict.get("output_time_regex", default_time_regex)
 
+    if use_priority is not None and "barrier" in cpp_source.lower():
+        use_priority = None # The static scheduler has no ready queue
+    run_args = build_run_args(num_threads, alpha, beta, use_priority)
+
     update_makefile(cpp_source)
-    update_cpp_macro(cpp_source, "NUM_THREADS", num_threads)
-    update_cpp_macro(cpp_source, "ALPHA", alpha)
-    update_cpp_macro(cpp_source, "BETA", beta)
-    if use_priority is not None and "main" in cpp_source.lower():
-        update_cpp_macro(cpp_source, "USE_PRIORITY_MAIN_QUEUE", use_priority)
-    
     compile_code()
     os.makedirs(TESTCASE_DIR, exist_ok=True)
     matrix_file_for_run = os.path.join(TESTCASE_DIR, f"matrix_{matrix_rows}x{matrix_cols}.txt")
     generate_matrix_if_needed(matrix_rows, matrix_cols, matrix_file_for_run)
+    matrix_file_for_run = ensure_binary_matrix(matrix_file_for_run)
 
     total_time_ms = 0
     successful_runs = 0
     for i in range(cycles):
         log_info(f"--- Cycle {i+1}/{cycles} ---")
-        exec_time = run_executable(matrix_file_for_run, time_regex, timeout_seconds=120) # Shorter timeout for single config/minimal test
+        exec_time = run_executable(matrix_file_for_run, time_regex, timeout_seconds=120, run_args=run_args) # Shorter timeout for single config/minimal test
         if exec_time is not None:
             total_time_ms += exec_time
             successful_runs += 1
@@ -171,19 +244,17 @@ def run_param_tuning_benchmark(results_basedir):
     # Ensure matrix exists for the fixed size
     matrix_file_path = os.path.join(TESTCASE_DIR, f"matrix_{FIXED_MATRIX_SIZE}x{FIXED_MATRIX_SIZE}.txt")
     generate_matrix_if_needed(FIXED_MATRIX_SIZE, FIXED_MATRIX_SIZE, matrix_file_path)
+    matrix_file_path = ensure_binary_matrix(matrix_file_path)
 
-    # Set C++ source file in Makefile and fixed number of threads
+    # Build once; threads, alpha, beta and the queue policy are runtime options
     update_makefile(main_cpp_file)
-    update_cpp_macro(main_cpp_file, "NUM_THREADS", FIXED_THREADS)
+    compile_code()
 
     # Iterate for "Without Priority" (0) and "With Priority" (1) to generate two heatmaps
     for priority_setting in [0, 1]:
         priority_str = "with_priority" if priority_setting == 1 else "without_priority"
         log_info(f"--- Running Parameter Tuning for: {priority_str.upper()} ---")
         
-        # Set priority macro in intel.cpp
-        update_cpp_macro(main_cpp_file, "USE_PRIORITY_MAIN_QUEUE", priority_setting)
-        
         current_tuning_results = []
         
         # Estimate total valid configurations for progress logging
@@ -209,21 +280,12 @@ def run_param_tuning_benchmark(results_basedir):
                 actual_configs_run += 1
                 log_info(f"Config {actual_configs_run}/{estimated_valid_configs} ({priority_str}): Alpha={alpha_val}, Beta={beta_val}")
 
-                update_cpp_macro(main_cpp_file, "ALPHA", alpha_val)
-                update_cpp_macro(main_cpp_file, "BETA", beta_val)
-                compile_code() # Recompile due to ALPHA/BETA macro changes
-
-                cycle_times_ms = []
-                for cycle in range(DEFAULT_CYCLES): # DEFAULT_CYCLES should be defined (e.g., 3)
-                    log_info(f"  Run {cycle+1}/{DEFAULT_CYCLES}")
-                    # DEFAULT_TIME_REGEX should be defined
-                    exec_time = run_executable(matrix_file_path, DEFAULT_TIME_REGEX) 
-                    if exec_time is not None:
-                        cycle_times_ms.append(exec_time)
-                    else:
-                        log_warn(f"    Run {cycle+1} failed for Alpha={alpha_val}, Beta={beta_val}, Prio={priority_setting}. This point might be unstable.")
-                        # Decide if a single failed cycle invalidates the (alpha,beta) point
-                        # For parameter tuning, it's often better to get some data if possible
+                run_args = build_run_args(FIXED_THREADS, alpha_val, beta_val, priority_setting)
+
+                # For parameter tuning, a point with some failed runs still keeps the successful ones
+                cycle_times_ms, metrics = run_cycles(matrix_file_path, run_args)
+                if len(cycle_times_ms) < DEFAULT_CYCLES:
+                    log_warn(f"    {DEFAULT_CYCLES - len(cycle_times_ms)} run(s) failed for Alpha={alpha_val}, Beta={beta_val}, Prio={priority_setting}. This point might be unstable.")
                 
                 if cycle_times_ms: # If at least one run was successful
                     avg_time_ms = np.mean(cycle_times_ms)
@@ -234,7 +296,8 @@ def run_param_tuning_benchmark(results_basedir):
                         "Alpha": alpha_val,
                         "Beta": beta_val,
                         "AvgTime_ms": avg_time_ms,
-                        "SuccessfulRuns": len(cycle_times_ms)
+                        "SuccessfulRuns": len(cycle_times_ms),
+                        **(metrics or {})
                     })
                     log_info(f"  Avg time for Alpha={alpha_val}, Beta={beta_val} ({len(cycle_times_ms)}/{DEFAULT_CYCLES} runs): {avg_time_ms:.2f} ms")
                 else:
@@ -304,29 +367,20 @@ def run_scalability_benchmark(results_basedir):
             log_info(f"  Matrix Size: {m_size}x{m_size}")
             matrix_file_path = os.path.join(TESTCASE_DIR, f"matrix_{m_size}x{m_size}.txt")
             generate_matrix_if_needed(m_size, m_size, matrix_file_path)
+            matrix_file_path = ensure_binary_matrix(matrix_file_path)
 
             for config in configs_to_run:
                 log_info(f"    Config: {config['label']}")
-                update_makefile(config['source'])
-                update_cpp_macro(config['source'], "NUM_THREADS", threads)
-                update_cpp_macro(config['source'], "ALPHA", config['alpha'])
-                update_cpp_macro(config['source'], "BETA", config['beta'])
-                if config['prio'] is not None:
-                    update_cpp_macro(config['source'], "USE_PRIORITY_MAIN_QUEUE", config['prio'])
-                compile_code()
-
-                cycle_times_ms = []
-                for cycle in range(DEFAULT_CYCLES):
-                    log_info(f"      Run {cycle+1}/{DEFAULT_CYCLES}")
-                    exec_time = run_executable(matrix_file_path, DEFAULT_TIME_REGEX)
-                    if exec_time is not None:
-                        cycle_times_ms.append(exec_time)
+                ensure_built(config['source'])
+                run_args = build_run_args(threads, config['alpha'], config['beta'], config['prio'])
+
+                cycle_times_ms, metrics = run_cycles(matrix_file_path, run_args)
                 
                 if cycle_times_ms:
                     avg_time = np.mean(cycle_times_ms)
                     all_results.append({
                         "Method": config['label'], "MatrixSize": m_size, 
-                        "Threads": threads, "AvgTime_ms": avg_time
+                        "Threads": threads, "AvgTime_ms": avg_time, **(metrics or {})
                     })
                     log_info(f"      Avg time: {avg_time:.2f} ms")
     
@@ -360,6 +414,90 @@ def run_scalability_benchmark(results_basedir):
     log_info("===== Scalability Benchmark FINISHED =====")
 
 
+# Distributed scaling of mpi.out (not in the paper)
+def run_mpi_scalability_benchmark(results_basedir):
+    log_info("===== Starting MPI Scalability Benchmark (strong and weak scaling) =====")
+    rank_counts = [1, 2, 4, 8]
+    threads_per_rank = 26
+    strong_m_size = 10800
+    weak_base_size = 4800 # Matrix size at one rank; N = N0 * P^(1/3) keeps the work per rank constant
+    config = {"alpha": 20, "beta": 20, "prio": 1} # Same as "With Priority" in the scalability benchmark
+
+    log_info("Building mpi.out (make mpi)...")
+    try:
+        subprocess.run("make mpi", shell=True, check=True, capture_output=True, text=True)
+    except subprocess.CalledProcessError as e:
+        log_error(f"Building mpi.out failed:\n{e.stderr}")
+        return
+
+    run_args = build_run_args(threads_per_rank, config['alpha'], config['beta'], config['prio'])
+    all_results = []
+    for ranks in rank_counts:
+        weak_size = int(round(weak_base_size * ranks ** (1.0 / 3) / config['beta'])) * config['beta']
+        launcher = [*MPIRUN.split(), "-np", str(ranks)]
+        for kind, m_size in (("Strong", strong_m_size), ("Weak", weak_size)):
+            log_info(f"  {kind}: {ranks} ranks x {threads_per_rank} threads, {m_size}x{m_size}")
+            matrix_file_path = os.path.join(TESTCASE_DIR, f"matrix_{m_size}x{m_size}.txt")
+            generate_matrix_if_needed(m_size, m_size, matrix_file_path)
+            matrix_file_path = ensure_binary_matrix(matrix_file_path)
+
+            cycle_times_ms = []
+            for cycle in range(DEFAULT_CYCLES):
+                log_info(f"      Run {cycle+1}/{DEFAULT_CYCLES}")
+                exec_time = run_executable(matrix_file_path, DEFAULT_TIME_REGEX, run_args=run_args,
+                                           executable=MPI_EXECUTABLE_NAME, launcher=launcher)
+                if exec_time is not None:
+                    cycle_times_ms.append(exec_time)
+
+            if cycle_times_ms:
+                avg_time = np.mean(cycle_times_ms)
+                all_results.append({
+                    "Scaling": kind, "Ranks": ranks, "ThreadsPerRank": threads_per_rank,
+                    "MatrixSize": m_size, "AvgTime_ms": avg_time
+                })
+                log_info(f"      Avg time: {avg_time:.2f} ms")
+
+    if all_results:
+        df = pd.DataFrame(all_results)
+        df["AvgTime_s"] = df["AvgTime_ms"] / 1000.0
+        # Efficiency against the smallest rank count: T1 * r1 / (T * r) for strong
+        # scaling, T1 / T for weak scaling.
+        def efficiency(group):
+            base = group.sort_values("Ranks").iloc[0]
+            if group.name == "Strong":
+                return base["AvgTime_ms"] * base["Ranks"] / (group["AvgTime_ms"] * group["Ranks"])
+            return base["AvgTime_ms"] / group["AvgTime_ms"]
+        df["Efficiency"] = df.groupby("Scaling", group_keys=False)[["Ranks", "AvgTime_ms"]].apply(efficiency)
+        csv_path = os.path.join(results_basedir, "mpi_scalability_results.csv")
+        df.to_csv(csv_path, index=False)
+        log_info(f"MPI scalability results saved to {csv_path}")
+
+        fig, (ax_time, ax_eff) = plt.subplots(1, 2, figsize=(12, 5))
+        for kind, group_data in df.groupby("Scaling"):
+            group_data = group_data.sort_values("Ranks")
+            ax_time.plot(group_data["Ranks"], group_data["AvgTime_s"], marker='o', label=kind)
+            ax_eff.plot(group_data["Ranks"], group_data["Efficiency"], marker='o', label=kind)
+        ax_time.set_xlabel("MPI Ranks")
+        ax_time.set_ylabel("Execution Time (s)")
+        ax_time.set_title(f"Strong ({strong_m_size}) and Weak ({weak_base_size} at 1 rank) Scaling")
+        ax_eff.set_xlabel("MPI Ranks")
+        ax_eff.set_ylabel("Parallel Efficiency")
+        ax_eff.set_ylim(0, 1.1)
+        for ax in (ax_time, ax_eff):
+            ax.set_xscale("log", base=2)
+            ax.set_xticks(rank_counts)
+            ax.set_xticklabels(rank_counts)
+            ax.grid(True)
+            ax.legend()
+        plot_path = os.path.join(results_basedir, "mpi_scalability.png")
+        plt.savefig(plot_path)
+        plt.close()
+        log_info(f"Plot saved to {plot_path}")
+    else:
+        log_warn("No results for MPI scalability benchmark.")
+    log_info("===== MPI Scalability Benchmark FINISHED =====")
+
+
 # Experiment 3: Throughput (Fig 5)
 def run_throughput_benchmark(results_basedir):
     log_info("===== Starting Throughput Benchmark (Experiment 3 - Fig 5) =====")
@@ -376,32 +514,23 @@ def run_throughput_benchmark(results_basedir):
     all_results = []
     matrix_file_path = os.path.join(TESTCASE_DIR, f"matrix_{fixed_m_size}x{fixed_m_size}.txt")
     generate_matrix_if_needed(fixed_m_size, fixed_m_size, matrix_file_path)
+    matrix_file_path = ensure_binary_matrix(matrix_file_path)
 
     for config in configs_to_run:
         log_info(f"--- Running for Config: {config['label']} ---")
-        update_makefile(config['source'])
-        update_cpp_macro(config['source'], "ALPHA", config['alpha'])
-        update_cpp_macro(config['source'], "BETA", config['beta'])
-        if config['prio'] is not None:
-            update_cpp_macro(config['source'], "USE_PRIORITY_MAIN_QUEUE", config['prio'])
+        ensure_built(config['source'])
 
         for threads in threads_to_run_data_for:
             log_info(f"  Threads: {threads}")
-            update_cpp_macro(config['source'], "NUM_THREADS", threads)
-            compile_code() # Recompile if NUM_THREADS changed
+            run_args = build_run_args(threads, config['alpha'], config['beta'], config['prio'])
 
-            cycle_times_ms = []
-            for cycle in range(DEFAULT_CYCLES):
-                log_info(f"    Run {cycle+1}/{DEFAULT_CYCLES}")
-                exec_time = run_executable(matrix_file_path, DEFAULT_TIME_REGEX)
-                if exec_time is not None:
-                    cycle_times_ms.append(exec_time)
+            cycle_times_ms, metrics = run_cycles(matrix_file_path, run_args)
             
             if cycle_times_ms:
                 avg_time = np.mean(cycle_times_ms)
                 all_results.append({
                     "Method": config['label'], "Threads": threads, 
-                    "MatrixSize": fixed_m_size, "AvgTime_ms": avg_time
+                    "MatrixSize": fixed_m_size, "AvgTime_ms": avg_time, **(metrics or {})
                 })
                 log_info(f"    Avg time: {avg_time:.2f} ms")
 
@@ -440,12 +569,16 @@ def run_throughput_benchmark(results_basedir):
 # --- Main Entry Point ---
 def main():
     parser = argparse.ArgumentParser(description="Master experiment runner for ParQR artifact.")
+    parser.add_argument("--metrics", action="store_true",
+                        help="Also record each run's scheduler report (--metrics: critical path, idle fraction, task times, queue delay).")
     parser.add_argument("--config", type=str, help="Path to a JSON configuration file for a single run (e.g., minimal test).")
     parser.add_argument("--experiment", type=str, 
-                        choices=["param_tuning", "scalability", "throughput", "all_required", "all"], 
-                        help="Run a predefined benchmark experiment or all.")
+                        choices=["param_tuning", "scalability", "throughput", "mpi_scalability", "all_required", "all"], 
+                        help="Run a predefined benchmark experiment or all (mpi_scalability needs MPI and runs only on its own).")
     
     args = parser.parse_args()
+    global COLLECT_METRICS
+    COLLECT_METRICS = args.metrics
 
     log_info(f"Master runner script CWD: {os.getcwd()}")
     # Basic check for Makefile
@@ -482,6 +615,8 @@ def main():
             run_scalability_benchmark(RESULTS_DIR)
         if args.experiment == "throughput" or args.experiment == "all_required" or args.experiment == "all":
             run_throughput_benchmark(RESULTS_DIR)
+        if args.experiment == "mpi_scalability":
+            run_mpi_scalability_benchmark(RESULTS_DIR)
         log_info(f"Benchmark experiment(s) '{args.experiment}' finished.")
         container_results_path = os.path.abspath(RESULTS_DIR)
         log_info(f"All results for this run were saved inside the container at: {container_results_path}")